@@ -0,0 +1,290 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BINARY_DERIVATIVES_HH
+#define _BINARY_DERIVATIVES_HH
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+using namespace std;
+
+//! Layout of the binary export of the results of the computing pass (see the binaryderivs option)
+/*! The file is made of a header followed by sections, each of which is an
+  array of fixed-size records aligned on 8 bytes, so that the file can be
+  memory-mapped and its arrays used in place. Integers and floating point
+  numbers are stored in the byte order of the machine that wrote the file.
+
+  The expressions of the equations, of the model local variables and of the
+  derivatives form a single DAG, flattened into a table of nodes sorted in
+  topological order: the arguments of a node always come before it. Nodes
+  are designated by their index in this table.
+
+  Each derivatives tensor is stored in coordinate format, as a matrix of
+  indices (one row per non-zero element, the first column being the
+  equation number) and an array of node indices giving the values. All
+  indices are 0-based. Variable indices are the columns of the Jacobian (as
+  in the "col" field of the JSON output), and parameter indices are the
+  parameter numbers. Second and third derivatives are only stored once for
+  all the permutations of their variables, as in the JSON output. */
+namespace BinaryDerivatives
+{
+  const char magic[8] = { 'D', 'Y', 'N', 'D', 'E', 'R', 'I', 'V' };
+  const int32_t version = 1;
+
+  enum class NodeType : int32_t
+    {
+     constant,       //!< value is the constant
+     variable,       //!< arg1 is the symbol ID, arg2 the lag, arg3 the SymbolType
+     unaryOp,        //!< op_code is a UnaryOpcode, arg1 the argument, arg2 and arg3 the parameters of steady state derivatives, extra the expectation information set
+     binaryOp,       //!< op_code is a BinaryOpcode, arg1 and arg2 the arguments, extra the derivation order of the powerDeriv operator
+     trinaryOp       //!< op_code is a TrinaryOpcode, arg1, arg2 and arg3 the arguments
+    };
+
+  struct Node
+  {
+    NodeType type;
+    int32_t op_code;
+    int32_t arg1, arg2, arg3;
+    int32_t extra;
+    double value;
+  };
+  static_assert(sizeof(Node) == 32, "Node records must be packed");
+
+  //! The derivatives tensors, with the names of their counterparts in the JSON output
+  enum class Tensor
+    {
+     jacobian,                            //!< (eq, var)
+     hessian,                             //!< (eq, var1, var2)
+     thirdDerivatives,                    //!< (eq, var1, var2, var3)
+     residualsParams,                     //!< deriv_wrt_params: (eq, param)
+     jacobianParams,                      //!< deriv_jacobian_wrt_params: (eq, var, param)
+     residualsParamsSecond,               //!< second_deriv_residuals_wrt_params: (eq, param1, param2)
+     jacobianParamsSecond,                //!< second_deriv_jacobian_wrt_params: (eq, var, param1, param2)
+     hessianParams                        //!< derivative_hessian_wrt_params: (eq, var1, var2, param)
+    };
+  const int nb_tensors = 8;
+
+  //! Number of columns of the indices matrix of a tensor
+  inline int
+  tensorRank(Tensor tensor)
+  {
+    static const int ranks[nb_tensors] = { 2, 3, 4, 2, 3, 3, 4, 4 };
+    return ranks[static_cast<int>(tensor)];
+  }
+
+  //! Position of an array in the file, and its number of elements
+  struct Section
+  {
+    int64_t offset, size;
+  };
+
+  struct Header
+  {
+    char magic[8];
+    int32_t version;
+    int32_t nb_equations;
+    //! Number of columns of the Jacobian
+    int32_t nb_var_cols;
+    int32_t nb_params;
+    //! Nodes (Node)
+    Section nodes;
+    //! Root node of each equation (int32_t), which is an equal binary operator
+    Section equations;
+    //! Model local variables used by the expressions, as pairs of symbol ID and node index (int32_t)
+    Section local_variables;
+    //! Indices (int32_t) and values (node indices, int32_t) of the tensors
+    Section tensor_indices[nb_tensors], tensor_values[nb_tensors];
+  };
+
+  //! Rounds a size up to a multiple of 8 bytes
+  inline int64_t
+  align(int64_t size)
+  {
+    return (size + 7) & ~static_cast<int64_t>(7);
+  }
+
+  //! Reads a file in this format, by mapping it in memory when possible
+  /*! The accessors return pointers into the file, which remain valid as long as the reader exists */
+  class Reader
+  {
+  private:
+    const char *data{nullptr};
+    size_t length{0};
+    bool mapped{false};
+    vector<char> buffer;
+
+    template<typename T>
+    const T *
+    section(const Section &s) const
+    {
+      return reinterpret_cast<const T *>(data + s.offset);
+    }
+
+    bool
+    checkSection(const Section &s, size_t element_size) const
+    {
+      return s.offset >= static_cast<int64_t>(sizeof(Header)) && s.offset % 8 == 0 && s.size >= 0
+        && static_cast<uint64_t>(s.offset) + static_cast<uint64_t>(s.size) * element_size <= length;
+    }
+  public:
+    Reader() = default;
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    ~Reader()
+    {
+      close();
+    }
+
+    //! Opens a file, returns false if it cannot be read or is not in the expected format
+    bool
+    open(const string &filename)
+    {
+      close();
+#ifndef _WIN32
+      int fd = ::open(filename.c_str(), O_RDONLY);
+      if (fd >= 0)
+        {
+          struct stat st;
+          if (fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+              void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+              if (p != MAP_FAILED)
+                {
+                  data = static_cast<const char *>(p);
+                  length = st.st_size;
+                  mapped = true;
+                }
+            }
+          ::close(fd);
+        }
+#endif
+      if (!mapped)
+        {
+          ifstream input(filename, ios::in | ios::binary);
+          if (!input.is_open())
+            return false;
+          buffer.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+          data = buffer.data();
+          length = buffer.size();
+        }
+
+      if (length < sizeof(Header) || memcmp(header().magic, magic, sizeof(magic)) || header().version != version)
+        {
+          close();
+          return false;
+        }
+      const Header &h = header();
+      bool ok = checkSection(h.nodes, sizeof(Node)) && checkSection(h.equations, sizeof(int32_t))
+        && h.equations.size == h.nb_equations
+        && checkSection(h.local_variables, 2 * sizeof(int32_t));
+      for (int i = 0; ok && i < nb_tensors; i++)
+        ok = checkSection(h.tensor_indices[i], tensorRank(static_cast<Tensor>(i)) * sizeof(int32_t))
+          && checkSection(h.tensor_values[i], sizeof(int32_t))
+          && h.tensor_indices[i].size == h.tensor_values[i].size;
+      if (!ok)
+        close();
+      return ok;
+    }
+
+    void
+    close()
+    {
+#ifndef _WIN32
+      if (mapped)
+        munmap(const_cast<char *>(data), length);
+#endif
+      mapped = false;
+      buffer.clear();
+      data = nullptr;
+      length = 0;
+    }
+
+    const Header &
+    header() const
+    {
+      return *reinterpret_cast<const Header *>(data);
+    }
+
+    int
+    nbNodes() const
+    {
+      return header().nodes.size;
+    }
+
+    const Node *
+    nodes() const
+    {
+      return section<Node>(header().nodes);
+    }
+
+    const int32_t *
+    equations() const
+    {
+      return section<int32_t>(header().equations);
+    }
+
+    int
+    nbLocalVariables() const
+    {
+      return header().local_variables.size;
+    }
+
+    //! Pairs of symbol ID and node index
+    const int32_t *
+    localVariables() const
+    {
+      return section<int32_t>(header().local_variables);
+    }
+
+    //! Number of non-zero elements of a tensor
+    int
+    nnz(Tensor tensor) const
+    {
+      return header().tensor_values[static_cast<int>(tensor)].size;
+    }
+
+    //! Indices of the non-zero elements of a tensor, as a row-major matrix with tensorRank() columns
+    const int32_t *
+    indices(Tensor tensor) const
+    {
+      return section<int32_t>(header().tensor_indices[static_cast<int>(tensor)]);
+    }
+
+    //! Node indices of the values of the non-zero elements of a tensor
+    const int32_t *
+    values(Tensor tensor) const
+    {
+      return section<int32_t>(header().tensor_values[static_cast<int>(tensor)]);
+    }
+  };
+}
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "BufferedSink.hh"
+
+BufferedSink::BufferedSink(callback_t callback_arg, size_t size) :
+  callback(move(callback_arg)), buffer(size)
+{
+  // Keep room for the character passed to overflow()
+  setp(buffer.data(), buffer.data() + buffer.size() - 1);
+}
+
+bool
+BufferedSink::flush()
+{
+  streamsize n = pptr() - pbase();
+  setp(buffer.data(), buffer.data() + buffer.size() - 1);
+  return n == 0 || callback(buffer.data(), n);
+}
+
+BufferedSink::int_type
+BufferedSink::overflow(int_type c)
+{
+  if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+      *pptr() = traits_type::to_char_type(c);
+      pbump(1);
+    }
+  return flush() ? traits_type::not_eof(c) : traits_type::eof();
+}
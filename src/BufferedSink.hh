@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BUFFERED_SINK_HH
+#define _BUFFERED_SINK_HH
+
+#include <vector>
+#include <streambuf>
+#include <functional>
+
+using namespace std;
+
+//! Output stream buffer accumulating the data in a buffer of fixed size, and passing it by chunks to a callback
+/*! The callback is called when the buffer is full, and by flush(). Flushing
+  the stream does not call it: the writers of the preprocessor flush at
+  every end of line, which would otherwise cost a call per line. The owner
+  must therefore call flush() once the output is complete. */
+class BufferedSink : public streambuf
+{
+public:
+  //! Receives a chunk of the output, returns false on failure
+  using callback_t = function<bool(const char *data, streamsize size)>;
+private:
+  const callback_t callback;
+  vector<char> buffer;
+public:
+  explicit BufferedSink(callback_t callback_arg, size_t size = 64*1024);
+  //! Passes the content of the buffer to the callback, if it is not empty
+  bool flush();
+protected:
+  int_type overflow(int_type c) override;
+};
+
+#endif
@@ -0,0 +1,928 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <cmath>
+#include <sstream>
+#include <queue>
+#include <functional>
+#include <algorithm>
+
+#include "BytecodeOptimizer.hh"
+#include "CodeInterpreter.hh"
+
+namespace
+{
+  //! Reads a value of the code at the given position, returns false if the code is too short
+  template<typename T>
+  bool
+  readAt(const string &code, size_t pos, T &value)
+  {
+    if (pos + sizeof(T) > code.size())
+      return false;
+    memcpy(&value, code.data() + pos, sizeof(T));
+    return true;
+  }
+
+  //! Size of an FBEGINBLOCK instruction (see FBEGINBLOCK_::write()), 0 if the code is too short
+  size_t
+  beginBlockSize(const string &code, size_t pos)
+  {
+    size_t size = sizeof(uint8_t);
+    int block_size;
+    uint8_t type;
+    if (!readAt(code, pos + size, block_size) || block_size < 0)
+      return 0;
+    size += sizeof(int);
+    if (!readAt(code, pos + size, type))
+      return 0;
+    size += sizeof(uint8_t) + 2 * sizeof(int) * static_cast<size_t>(block_size);
+    if (type == SOLVE_TWO_BOUNDARIES_SIMPLE || type == SOLVE_TWO_BOUNDARIES_COMPLETE
+        || type == SOLVE_BACKWARD_COMPLETE || type == SOLVE_FORWARD_COMPLETE)
+      size += sizeof(bool) + 4 * sizeof(int);
+    // nb_col_jacob, then det_exo_size, exo_size and other_endo_size, each followed by a number of columns
+    size += sizeof(int);
+    size_t nb_vectors_elements = 0;
+    for (int i = 0; i < 3; i++)
+      {
+        unsigned int vector_size;
+        if (!readAt(code, pos + size, vector_size))
+          return 0;
+        nb_vectors_elements += vector_size;
+        size += 2 * sizeof(unsigned int);
+      }
+    return size + nb_vectors_elements * sizeof(unsigned int);
+  }
+
+  //! Size of an FCALL instruction (see FCALL_::write()), 0 if the code is too short
+  size_t
+  callSize(const string &code, size_t pos)
+  {
+    size_t size = sizeof(uint8_t) + 6 * sizeof(unsigned int) + sizeof(ExternalFunctionType);
+    // The names of the function and of its argument
+    for (int i = 0; i < 2; i++)
+      {
+        int length;
+        if (!readAt(code, pos + size, length) || length < 0)
+          return 0;
+        size += sizeof(int) + length;
+      }
+    return size;
+  }
+
+  bool
+  isJump(uint8_t op_code)
+  {
+    return op_code == FJMPIFEVAL || op_code == FJMP;
+  }
+}
+
+template<typename T>
+T
+BytecodeOptimizer::argument(const Instruction &ins, size_t offset)
+{
+  T value;
+  memcpy(&value, ins.bytes.data() + offset, sizeof(T));
+  return value;
+}
+
+template<typename T>
+void
+BytecodeOptimizer::replace(int i, T tag)
+{
+  ostringstream bytes;
+  unsigned int instruction_number = 0;
+  tag.write(bytes, instruction_number);
+  instructions[i].bytes = bytes.str();
+  instructions[i].op_code = static_cast<uint8_t>(instructions[i].bytes[0]);
+  modified[i] = true;
+}
+
+void
+BytecodeOptimizer::remove(int i)
+{
+  removed[i] = true;
+}
+
+bool
+BytecodeOptimizer::isUntouched(int i) const
+{
+  return !removed[i] && !modified[i];
+}
+
+bool
+BytecodeOptimizer::decode(const string &code)
+{
+  size_t pos = 0;
+  bool end = false;
+  while (!end)
+    {
+      if (pos >= code.size())
+        return false;
+      auto op_code = static_cast<uint8_t>(code[pos]);
+      size_t size;
+      switch (op_code)
+        {
+        case FLDZ:
+          size = sizeof(FLDZ_);
+          break;
+        case FLDC:
+          size = sizeof(FLDC_);
+          break;
+        case FDIMT:
+          size = sizeof(FDIMT_);
+          break;
+        case FDIMST:
+          size = sizeof(FDIMST_);
+          break;
+        case FLDT:
+          size = sizeof(FLDT_);
+          break;
+        case FLDST:
+          size = sizeof(FLDST_);
+          break;
+        case FSTPT:
+          size = sizeof(FSTPT_);
+          break;
+        case FSTPST:
+          size = sizeof(FSTPST_);
+          break;
+        case FLDU:
+          size = sizeof(FLDU_);
+          break;
+        case FLDSU:
+          size = sizeof(FLDSU_);
+          break;
+        case FSTPU:
+          size = sizeof(FSTPU_);
+          break;
+        case FSTPSU:
+          size = sizeof(FSTPSU_);
+          break;
+        case FLDV:
+          size = sizeof(FLDV_);
+          break;
+        case FLDSV:
+          size = sizeof(FLDSV_);
+          break;
+        case FLDVS:
+          size = sizeof(FLDVS_);
+          break;
+        case FSTPV:
+          size = sizeof(FSTPV_);
+          break;
+        case FSTPSV:
+          size = sizeof(FSTPSV_);
+          break;
+        case FLDR:
+          size = sizeof(FLDR_);
+          break;
+        case FSTPR:
+          size = sizeof(FSTPR_);
+          break;
+        case FSTPG:
+          size = sizeof(FSTPG_);
+          break;
+        case FSTPG2:
+          size = sizeof(FSTPG2_);
+          break;
+        case FSTPG3:
+          size = sizeof(FSTPG3_);
+          break;
+        case FUNARY:
+          size = sizeof(FUNARY_);
+          break;
+        case FBINARY:
+          size = sizeof(FBINARY_);
+          break;
+        case FTRINARY:
+          size = sizeof(FTRINARY_);
+          break;
+        case FCUML:
+          size = sizeof(FCUML_);
+          break;
+        case FJMPIFEVAL:
+          size = sizeof(FJMPIFEVAL_);
+          break;
+        case FJMP:
+          size = sizeof(FJMP_);
+          break;
+        case FBEGINBLOCK:
+          size = beginBlockSize(code, pos);
+          break;
+        case FENDBLOCK:
+          size = sizeof(FENDBLOCK_);
+          break;
+        case FENDEQU:
+          size = sizeof(FENDEQU_);
+          break;
+        case FEND:
+          size = sizeof(FEND_);
+          end = true;
+          break;
+        case FOK:
+          size = sizeof(FOK_);
+          break;
+        case FNUMEXPR:
+          size = sizeof(FNUMEXPR_);
+          break;
+        case FCALL:
+          size = callSize(code, pos);
+          break;
+        case FPUSH:
+          size = sizeof(FPUSH_);
+          break;
+        case FPOP:
+          size = sizeof(FPOP_);
+          break;
+        case FLDTEF:
+          size = sizeof(FLDTEF_);
+          break;
+        case FSTPTEF:
+          size = sizeof(FSTPTEF_);
+          break;
+        case FLDTEFD:
+          size = sizeof(FLDTEFD_);
+          break;
+        case FSTPTEFD:
+          size = sizeof(FSTPTEFD_);
+          break;
+        case FLDTEFDD:
+          size = sizeof(FLDTEFDD_);
+          break;
+        case FSTPTEFDD:
+          size = sizeof(FSTPTEFDD_);
+          break;
+        default:
+          return false;
+        }
+      if (size == 0 || pos + size > code.size())
+        return false;
+      instructions.push_back({ op_code, code.substr(pos, size), -1 });
+      pos += size;
+    }
+  if (pos != code.size())
+    return false;
+
+  // The offset of a jump is relative to the instruction following it
+  int n = instructions.size();
+  for (int i = 0; i < n; i++)
+    if (isJump(instructions[i].op_code))
+      {
+        long target = i + 1 + static_cast<long>(argument<unsigned int>(instructions[i]));
+        if (target >= n)
+          return false;
+        instructions[i].target = target;
+      }
+
+  removed.assign(n, false);
+  modified.assign(n, false);
+  return true;
+}
+
+string
+BytecodeOptimizer::encode() const
+{
+  ostringstream code;
+  unsigned int instruction_number = 0;
+  for (int i = 0; i < static_cast<int>(instructions.size()); i++)
+    {
+      const Instruction &ins = instructions[i];
+      if (ins.op_code == FJMPIFEVAL)
+        {
+          FJMPIFEVAL_ fjmp_if_eval(ins.target - i - 1);
+          fjmp_if_eval.write(code, instruction_number);
+        }
+      else if (ins.op_code == FJMP)
+        {
+          FJMP_ fjmp(ins.target - i - 1);
+          fjmp.write(code, instruction_number);
+        }
+      else
+        code.write(ins.bytes.data(), ins.bytes.size());
+    }
+  return code.str();
+}
+
+void
+BytecodeOptimizer::compact()
+{
+  int n = instructions.size();
+  /* A removed instruction is mapped to the next remaining one, which is where
+     the jumps that targeted it now continue */
+  vector<int> new_index(n + 1);
+  int nb_remaining = 0;
+  for (int i = 0; i < n; i++)
+    {
+      new_index[i] = nb_remaining;
+      if (!removed[i])
+        nb_remaining++;
+    }
+  new_index[n] = nb_remaining;
+
+  vector<Instruction> remaining;
+  remaining.reserve(nb_remaining);
+  for (int i = 0; i < n; i++)
+    if (!removed[i])
+      {
+        remaining.push_back(move(instructions[i]));
+        if (isJump(remaining.back().op_code))
+          remaining.back().target = new_index[remaining.back().target];
+      }
+  instructions = move(remaining);
+  removed.assign(nb_remaining, false);
+  modified.assign(nb_remaining, false);
+}
+
+void
+BytecodeOptimizer::computeLeaders()
+{
+  int n = instructions.size();
+  leaders.assign(n, false);
+  for (int i = 0; i < n; i++)
+    if (isJump(instructions[i].op_code))
+      {
+        leaders[instructions[i].target] = true;
+        if (i + 1 < n)
+          leaders[i + 1] = true;
+      }
+    else if (instructions[i].op_code == FBEGINBLOCK && i + 1 < n)
+      // The interpreter starts the evaluation of a block after its FBEGINBLOCK
+      leaders[i + 1] = true;
+}
+
+bool
+BytecodeOptimizer::stackEffect(const Instruction &ins, int &pops, int &pushes) const
+{
+  pushes = 1;
+  switch (ins.op_code)
+    {
+    case FLDZ:
+    case FLDC:
+    case FLDT:
+    case FLDST:
+    case FLDU:
+    case FLDSU:
+    case FLDR:
+    case FLDV:
+    case FLDSV:
+    case FLDVS:
+    case FLDTEF:
+    case FLDTEFD:
+    case FLDTEFDD:
+      pops = 0;
+      return true;
+    case FUNARY:
+      pops = 1;
+      return true;
+    case FBINARY:
+      // The derivation order of powerDeriv is pushed before its arguments
+      pops = argument<uint8_t>(ins) == static_cast<uint8_t>(BinaryOpcode::powerDeriv) ? 3 : 2;
+      return true;
+    case FTRINARY:
+      pops = 3;
+      return true;
+    case FCUML:
+      pops = 2;
+      return true;
+    case FNUMEXPR:
+      pops = pushes = 0;
+      return true;
+    default:
+      return false;
+    }
+}
+
+int
+BytecodeOptimizer::popsOfStatement(const Instruction &ins) const
+{
+  switch (ins.op_code)
+    {
+    case FSTPT:
+    case FSTPST:
+    case FSTPU:
+    case FSTPSU:
+    case FSTPV:
+    case FSTPSV:
+    case FSTPR:
+    case FSTPG:
+    case FSTPG2:
+    case FSTPG3:
+      return 1;
+    case FDIMT:
+    case FDIMST:
+    case FBEGINBLOCK:
+    case FENDBLOCK:
+    case FENDEQU:
+    case FEND:
+    case FJMPIFEVAL:
+    case FJMP:
+      return 0;
+    default:
+      return -1;
+    }
+}
+
+bool
+BytecodeOptimizer::isConstant(const Instruction &ins, double &value)
+{
+  if (ins.op_code == FLDZ)
+    {
+      value = 0;
+      return true;
+    }
+  if (ins.op_code == FLDC)
+    {
+      value = argument<double>(ins);
+      return true;
+    }
+  return false;
+}
+
+bool
+BytecodeOptimizer::isLoadOfTemporaryTerm(const Instruction &ins)
+{
+  return ins.op_code == FLDT || ins.op_code == FLDST;
+}
+
+bool
+BytecodeOptimizer::isStoreOfTemporaryTerm(const Instruction &ins)
+{
+  return ins.op_code == FSTPT || ins.op_code == FSTPST;
+}
+
+void
+BytecodeOptimizer::computeStackDataflow()
+{
+  int n = instructions.size();
+  operands.assign(n, {});
+  consumers.assign(n, -1);
+  // The instructions which pushed the values of the stack, when they are known
+  vector<int> stack;
+  for (int i = 0; i < n; i++)
+    {
+      if (leaders[i])
+        stack.clear();
+      int pops, pushes;
+      if (!stackEffect(instructions[i], pops, pushes))
+        {
+          pops = popsOfStatement(instructions[i]);
+          pushes = 0;
+        }
+      if (pops < 0)
+        {
+          stack.clear();
+          continue;
+        }
+      operands[i].assign(pops, -1);
+      for (int k = pops - 1; k >= 0 && !stack.empty(); k--)
+        {
+          operands[i][k] = stack.back();
+          consumers[stack.back()] = i;
+          stack.pop_back();
+        }
+      if (pushes)
+        stack.push_back(i);
+    }
+}
+
+void
+BytecodeOptimizer::countLoads()
+{
+  nb_loads.clear();
+  for (const auto &ins : instructions)
+    if (isLoadOfTemporaryTerm(ins))
+      {
+        auto slot = argument<unsigned int>(ins);
+        if (slot >= nb_loads.size())
+          nb_loads.resize(slot + 1, 0);
+        nb_loads[slot]++;
+      }
+}
+
+void
+BytecodeOptimizer::loadConstant(int i, double value)
+{
+  // Zero has a shorter encoding
+  if (value == 0 && !signbit(value))
+    replace(i, FLDZ_());
+  else
+    replace(i, FLDC_(value));
+}
+
+bool
+BytecodeOptimizer::foldConstant(int i, double c, int k)
+{
+  const Instruction &op = instructions[k];
+  // Position of the constant among the operands, 0 for the bottom of the stack
+  int pos = find(operands[k].begin(), operands[k].end(), i) - operands[k].begin();
+
+  if (op.op_code == FUNARY)
+    {
+      if (argument<uint8_t>(op) != static_cast<uint8_t>(UnaryOpcode::uminus))
+        return false;
+      loadConstant(i, -c);
+      remove(k);
+      return true;
+    }
+
+  BinaryOpcode op_type;
+  if (op.op_code == FCUML)
+    op_type = BinaryOpcode::plus;
+  else if (op.op_code == FBINARY && operands[k].size() == 2)
+    op_type = static_cast<BinaryOpcode>(argument<uint8_t>(op));
+  else
+    return false;
+
+  int other = operands[k][1 - pos];
+  double c2;
+  if (other >= 0 && isUntouched(other) && isConstant(instructions[other], c2))
+    {
+      // Both operands are constants: compute the result as the interpreter would
+      double v1 = pos == 0 ? c : c2, v2 = pos == 0 ? c2 : c, result;
+      switch (op_type)
+        {
+        case BinaryOpcode::plus:
+          result = v1 + v2;
+          break;
+        case BinaryOpcode::minus:
+          result = v1 - v2;
+          break;
+        case BinaryOpcode::times:
+          result = v1 * v2;
+          break;
+        case BinaryOpcode::divide:
+          result = v2 != 0 ? v1 / v2 : NAN;
+          break;
+        default:
+          result = NAN;
+        }
+      if (!isfinite(result))
+        return false;
+      loadConstant(operands[k][0], result);
+      remove(operands[k][1]);
+      remove(k);
+      return true;
+    }
+
+  /* Operations with a neutral element, or amounting to a change of sign. They
+     must give the same result for every x, including the sign of zero: x+0 is
+     +0 for x=-0, hence only x+(-0), x-(+0) and (-0)-x are simplified */
+  bool neutral = false, negation = false;
+  switch (op_type)
+    {
+    case BinaryOpcode::plus:
+      neutral = c == 0 && signbit(c);
+      break;
+    case BinaryOpcode::minus:
+      neutral = c == 0 && !signbit(c) && pos == 1;
+      negation = c == 0 && signbit(c) && pos == 0;
+      break;
+    case BinaryOpcode::times:
+      neutral = c == 1;
+      negation = c == -1;
+      break;
+    case BinaryOpcode::divide:
+      neutral = c == 1 && pos == 1;
+      negation = c == -1 && pos == 1;
+      break;
+    case BinaryOpcode::power:
+      neutral = c == 1 && pos == 1;
+      break;
+    default:
+      break;
+    }
+  if (neutral)
+    {
+      remove(i);
+      remove(k);
+    }
+  else if (negation)
+    {
+      remove(i);
+      replace(k, FUNARY_(static_cast<uint8_t>(UnaryOpcode::uminus)));
+    }
+  return neutral || negation;
+}
+
+bool
+BytecodeOptimizer::foldConstants()
+{
+  bool changed = false;
+  for (int i = 0; i < static_cast<int>(instructions.size()); i++)
+    {
+      double c;
+      if (!isConstant(instructions[i], c) || !isUntouched(i))
+        continue;
+      int k = consumers[i];
+      if (k >= 0 && isUntouched(k) && foldConstant(i, c, k))
+        changed = true;
+      else if (instructions[i].op_code == FLDC && c == 0 && !signbit(c))
+        {
+          loadConstant(i, c);
+          changed = true;
+        }
+    }
+  return changed;
+}
+
+bool
+BytecodeOptimizer::forwardStores()
+{
+  int n = instructions.size();
+  auto nextStatement = [&](int i)
+    {
+      int j = i + 1;
+      while (j < n && instructions[j].op_code == FNUMEXPR && !leaders[j])
+        j++;
+      return j < n && !leaders[j] ? j : -1;
+    };
+
+  bool changed = false;
+  for (int i = 0; i < n; i++)
+    {
+      if (!isUntouched(i))
+        continue;
+      int j = nextStatement(i);
+      if (j < 0 || !isUntouched(j))
+        continue;
+      const Instruction &first = instructions[i], &second = instructions[j];
+      bool store_load = (first.op_code == FSTPT && second.op_code == FLDT)
+        || (first.op_code == FSTPST && second.op_code == FLDST);
+      bool load_store = (first.op_code == FLDT && second.op_code == FSTPT)
+        || (first.op_code == FLDST && second.op_code == FSTPST);
+      if (!(store_load || load_store))
+        continue;
+      auto slot = argument<unsigned int>(first);
+      if (slot != argument<unsigned int>(second))
+        continue;
+      /* A temporary term stored, and loaded back for its only use, is left on
+         the stack; a temporary term loaded and immediately stored back in the
+         same slot is left untouched */
+      if (load_store || nb_loads[slot] == 1)
+        {
+          remove(i);
+          remove(j);
+          changed = true;
+        }
+    }
+  return changed;
+}
+
+bool
+BytecodeOptimizer::removeDeadStores()
+{
+  int n = instructions.size();
+  bool changed = false;
+  /* The stores are visited backwards, so that the temporary terms only used by
+     a dead temporary term are found dead in the same pass */
+  for (int s = n - 1; s >= 0; s--)
+    {
+      if (!isStoreOfTemporaryTerm(instructions[s]) || !isUntouched(s))
+        continue;
+      auto slot = argument<unsigned int>(instructions[s]);
+      if (slot < nb_loads.size() && nb_loads[slot] > 0)
+        continue;
+
+      // Instructions computing the stored value
+      vector<int> computation, to_visit{operands[s][0]};
+      bool known = true;
+      while (known && !to_visit.empty())
+        {
+          int i = to_visit.back();
+          to_visit.pop_back();
+          if (i < 0 || !isUntouched(i))
+            known = false;
+          else
+            {
+              computation.push_back(i);
+              to_visit.insert(to_visit.end(), operands[i].begin(), operands[i].end());
+            }
+        }
+      if (!known)
+        continue;
+
+      for (int i : computation)
+        {
+          if (isLoadOfTemporaryTerm(instructions[i]))
+            nb_loads[argument<unsigned int>(instructions[i])]--;
+          remove(i);
+        }
+      remove(s);
+      changed = true;
+
+      /* The FNUMEXPR describing the computation is useless if the next
+         instruction is also an FNUMEXPR */
+      int first = *min_element(computation.begin(), computation.end());
+      if (first > 0 && !leaders[first] && instructions[first - 1].op_code == FNUMEXPR && isUntouched(first - 1)
+          && s + 1 < n && !leaders[s + 1] && instructions[s + 1].op_code == FNUMEXPR)
+        remove(first - 1);
+    }
+  return changed;
+}
+
+bool
+BytecodeOptimizer::compactTemporaryTerms(int &dim_before, int &dim_after)
+{
+  int n = instructions.size();
+  int dim_instruction = -1;
+  for (int i = 0; i < n; i++)
+    if (instructions[i].op_code == FDIMT || instructions[i].op_code == FDIMST)
+      {
+        if (dim_instruction >= 0)
+          return false;
+        dim_instruction = i;
+      }
+  if (dim_instruction < 0)
+    return false;
+  unsigned int dim = argument<unsigned int>(instructions[dim_instruction]);
+  dim_before = dim_after = dim;
+
+  // Basic blocks, and model blocks (whose code starts at an FBEGINBLOCK)
+  vector<int> basic_block(n), bb_start, region_start;
+  for (int i = 0; i < n; i++)
+    {
+      bool new_region = i == 0 || instructions[i].op_code == FBEGINBLOCK;
+      if (new_region || leaders[i])
+        bb_start.push_back(i);
+      if (new_region)
+        region_start.push_back(bb_start.size() - 1);
+      basic_block[i] = bb_start.size() - 1;
+    }
+  int nb_bb = bb_start.size();
+  region_start.push_back(nb_bb);
+
+  vector<vector<int>> predecessors(nb_bb);
+  for (int b = 0; b < nb_bb; b++)
+    {
+      int last = (b + 1 < nb_bb ? bb_start[b + 1] : n) - 1;
+      if (b + 1 < nb_bb && instructions[last].op_code != FJMP
+          && instructions[bb_start[b + 1]].op_code != FBEGINBLOCK)
+        predecessors[b + 1].push_back(b);
+      if (isJump(instructions[last].op_code))
+        {
+          int target = basic_block[instructions[last].target];
+          // Only forward jumps within a model block are expected
+          if (target <= b || instructions[bb_start[target]].op_code == FBEGINBLOCK
+              || upper_bound(region_start.begin(), region_start.end(), target)
+              != upper_bound(region_start.begin(), region_start.end(), b))
+            return false;
+          predecessors[target].push_back(b);
+        }
+    }
+
+  /* A temporary term read by a model block before it has been written by that
+     block on all paths carries a value from elsewhere: it keeps its own slot */
+  vector<bool> pinned(dim, false);
+  vector<int> first_access(dim, -1), last_access(dim, -1);
+  vector<int> local_id(dim, -1), local_region(dim, -1);
+  for (int r = 0; r + 1 < static_cast<int>(region_start.size()); r++)
+    {
+      int b_begin = region_start[r], b_end = region_start[r + 1];
+      int i_begin = bb_start[b_begin], i_end = b_end < nb_bb ? bb_start[b_end] : n;
+      int nb_local = 0;
+      for (int i = i_begin; i < i_end; i++)
+        if (isLoadOfTemporaryTerm(instructions[i]) || isStoreOfTemporaryTerm(instructions[i]))
+          {
+            auto slot = argument<unsigned int>(instructions[i]);
+            if (slot >= dim)
+              return false;
+            if (local_region[slot] != r)
+              {
+                local_region[slot] = r;
+                local_id[slot] = nb_local++;
+              }
+            if (first_access[slot] < 0)
+              first_access[slot] = i;
+            last_access[slot] = i;
+          }
+
+      // Temporary terms written on all the paths leading to the end of each basic block
+      vector<vector<bool>> written(b_end - b_begin);
+      for (int b = b_begin; b < b_end; b++)
+        {
+          vector<bool> current(nb_local, predecessors[b].size() > 0);
+          for (int p : predecessors[b])
+            for (int l = 0; l < nb_local; l++)
+              current[l] = current[l] && written[p - b_begin][l];
+          int i_last = b + 1 < nb_bb ? bb_start[b + 1] : n;
+          for (int i = bb_start[b]; i < i_last; i++)
+            if (isLoadOfTemporaryTerm(instructions[i]))
+              {
+                auto slot = argument<unsigned int>(instructions[i]);
+                if (!current[local_id[slot]])
+                  pinned[slot] = true;
+              }
+            else if (isStoreOfTemporaryTerm(instructions[i]))
+              current[local_id[argument<unsigned int>(instructions[i])]] = true;
+          written[b - b_begin] = move(current);
+        }
+    }
+
+  vector<int> new_slot(dim, -1);
+  int nb_slots = 0;
+  for (unsigned int slot = 0; slot < dim; slot++)
+    if (pinned[slot])
+      new_slot[slot] = nb_slots++;
+
+  /* Linear scan allocation of the other slots: since the jumps go forward, and
+     these terms are written before being read in each model block, a term is
+     live at most between its first and its last access */
+  priority_queue<int, vector<int>, greater<int>> free_slots;
+  priority_queue<pair<int, int>, vector<pair<int, int>>, greater<pair<int, int>>> active;
+  for (int i = 0; i < n; i++)
+    {
+      if (!isLoadOfTemporaryTerm(instructions[i]) && !isStoreOfTemporaryTerm(instructions[i]))
+        continue;
+      auto slot = argument<unsigned int>(instructions[i]);
+      if (new_slot[slot] < 0)
+        {
+          while (!active.empty() && active.top().first < i)
+            {
+              free_slots.push(active.top().second);
+              active.pop();
+            }
+          if (free_slots.empty())
+            new_slot[slot] = nb_slots++;
+          else
+            {
+              new_slot[slot] = free_slots.top();
+              free_slots.pop();
+            }
+          active.emplace(last_access[slot], new_slot[slot]);
+        }
+      switch (instructions[i].op_code)
+        {
+        case FLDT:
+          replace(i, FLDT_(new_slot[slot]));
+          break;
+        case FLDST:
+          replace(i, FLDST_(new_slot[slot]));
+          break;
+        case FSTPT:
+          replace(i, FSTPT_(new_slot[slot]));
+          break;
+        default:
+          replace(i, FSTPST_(new_slot[slot]));
+        }
+    }
+
+  if (instructions[dim_instruction].op_code == FDIMT)
+    replace(dim_instruction, FDIMT_(nb_slots));
+  else
+    replace(dim_instruction, FDIMST_(nb_slots));
+  dim_after = nb_slots;
+  return true;
+}
+
+bool
+BytecodeOptimizer::optimize(string &code, Statistics &stats)
+{
+  BytecodeOptimizer optimizer;
+  if (!optimizer.decode(code))
+    return false;
+  stats.instructions_before = optimizer.instructions.size();
+
+  vector<bool (BytecodeOptimizer::*)()> passes
+    = { &BytecodeOptimizer::foldConstants, &BytecodeOptimizer::forwardStores, &BytecodeOptimizer::removeDeadStores };
+  bool changed;
+  do
+    {
+      changed = false;
+      for (auto pass : passes)
+        {
+          optimizer.computeLeaders();
+          optimizer.computeStackDataflow();
+          optimizer.countLoads();
+          if ((optimizer.*pass)())
+            {
+              optimizer.compact();
+              changed = true;
+            }
+        }
+    }
+  while (changed);
+
+  optimizer.computeLeaders();
+  stats.temporary_terms_before = stats.temporary_terms_after = 0;
+  optimizer.compactTemporaryTerms(stats.temporary_terms_before, stats.temporary_terms_after);
+  stats.instructions_after = optimizer.instructions.size();
+  code = optimizer.encode();
+  return true;
+}
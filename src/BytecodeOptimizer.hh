@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _BYTECODE_OPTIMIZER_HH
+#define _BYTECODE_OPTIMIZER_HH
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+//! Optimizer of the code written to the .cod files by the compile() methods
+/*! The code is decoded into a list of instructions, on which the following
+  transformations are repeated until none applies:
+  - peephole rules fold the operations on constants and remove the operations
+    with a neutral element (x*1, x/1...), as long as the result is the same
+    for all values of x, including signed zeros and NaNs;
+  - a temporary term stored and immediately loaded back, and used nowhere else,
+    is left on the stack;
+  - the stores of temporary terms that are never loaded are removed, together
+    with the instructions computing their values.
+  The temporary terms are then renumbered so that terms whose lifetimes do not
+  overlap share the same slot, and the size declared by FDIMT/FDIMST is
+  reduced accordingly. The relative offsets of the jumps (FJMPIFEVAL/FJMP) are
+  recomputed after the removal of instructions.
+
+  Values are only tracked on the stack within a basic block, and the
+  instructions whose effect on the stack is not fully known (external function
+  calls, FPUSH/FPOP...) act as barriers.
+
+  Nothing outside of the code refers to the slots of the temporary terms
+  array: the interpreter allocates it with the size given by FDIMT/FDIMST
+  (see CodeLoad), and the numbers of temporary terms written to the driver
+  (dynamic_tmp_nbr...) only describe the MATLAB, C and Julia files. A
+  temporary term read by a model block before it has written it holds a value
+  computed by another block (global temporary terms): it keeps a slot of its
+  own, so that the blocks still give the same results when they are
+  evaluated separately. */
+class BytecodeOptimizer
+{
+public:
+  struct Statistics
+  {
+    int instructions_before, instructions_after;
+    //! Sizes of the temporary terms array
+    int temporary_terms_before, temporary_terms_after;
+  };
+  //! Optimizes the code of a .cod file
+  /*! Returns false, leaving the code unchanged, if the code cannot be decoded */
+  static bool optimize(string &code, Statistics &stats);
+private:
+  struct Instruction
+  {
+    uint8_t op_code;
+    //! Encoding of the instruction, as written in the file
+    string bytes;
+    //! For jumps, the instruction at which execution continues when the jump is taken
+    int target;
+  };
+  vector<Instruction> instructions;
+  //! Instructions which can be reached otherwise than from the previous instruction
+  vector<bool> leaders;
+  //! For each instruction, the instructions which pushed its operands (-1 if unknown), bottom of the stack first
+  vector<vector<int>> operands;
+  //! For each instruction pushing a value, the instruction which pops it (-1 if unknown)
+  vector<int> consumers;
+  //! Number of loads of each temporary term
+  vector<int> nb_loads;
+  //! Instructions removed, or modified, since the last call to compact()
+  vector<bool> removed, modified;
+
+  BytecodeOptimizer() = default;
+  bool decode(const string &code);
+  string encode() const;
+  //! Removes the instructions marked as removed, and updates the jump targets
+  void compact();
+  void computeLeaders();
+  //! Fills operands and consumers, by simulating the stack within each basic block
+  void computeStackDataflow();
+  void countLoads();
+  bool foldConstants();
+  //! Simplifies the operation k, one of whose operands is the constant c pushed by instruction i
+  bool foldConstant(int i, double c, int k);
+  void loadConstant(int i, double value);
+  bool forwardStores();
+  bool removeDeadStores();
+  //! Renumbers the temporary terms, returns false if the code does not have the expected structure
+  bool compactTemporaryTerms(int &dim_before, int &dim_after);
+
+  //! Returns the number of values popped and pushed by an instruction without side effect; returns false for other instructions
+  bool stackEffect(const Instruction &ins, int &pops, int &pushes) const;
+  //! Returns the number of values popped by an instruction that has side effects, or -1 if unknown
+  int popsOfStatement(const Instruction &ins) const;
+  static bool isConstant(const Instruction &ins, double &value);
+  static bool isLoadOfTemporaryTerm(const Instruction &ins);
+  static bool isStoreOfTemporaryTerm(const Instruction &ins);
+  //! Returns the argument of an instruction, located at the given offset
+  template<typename T>
+  static T argument(const Instruction &ins, size_t offset = sizeof(uint8_t));
+  //! Replaces an instruction by a tag object
+  template<typename T>
+  void replace(int i, T tag);
+  void remove(int i);
+  bool isUntouched(int i) const;
+};
+
+#endif
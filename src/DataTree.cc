@@ -19,6 +19,7 @@
 
 #include <cstdlib>
 #include <cassert>
+#include <algorithm>
 #include <iostream>
 #include <regex>
 
@@ -50,20 +51,33 @@ DataTree::DataTree(SymbolTable &symbol_table_arg,
   Pi = AddNonNegativeConstant("3.141592653589793");
 }
 
-DataTree::~DataTree() = default;
+DataTree::~DataTree()
+{
+  // Nodes live in node_arena, which does not call their destructors
+  for (auto node : node_list)
+    node->~ExprNode();
+}
 
 expr_t
 DataTree::AddNonNegativeConstant(const string &value)
 {
-  int id = num_constants.AddNonNegativeConstant(value);
+  return AddNumConstInternal(num_constants.AddNonNegativeConstant(value));
+}
 
+expr_t
+DataTree::AddNonNegativeConstant(double value)
+{
+  return AddNumConstInternal(num_constants.AddNonNegativeConstant(value));
+}
+
+expr_t
+DataTree::AddNumConstInternal(int id)
+{
   auto it = num_const_node_map.find(id);
   if (it != num_const_node_map.end())
     return it->second;
 
-  auto sp = make_unique<NumConstNode>(*this, node_list.size(), id);
-  auto p = sp.get();
-  node_list.push_back(move(sp));
+  auto p = newNode<NumConstNode>(id);
   num_const_node_map[id] = p;
   return p;
 }
@@ -75,9 +89,7 @@ DataTree::AddVariableInternal(int symb_id, int lag)
   if (it != variable_node_map.end())
     return it->second;
 
-  auto sp = make_unique<VariableNode>(*this, node_list.size(), symb_id, lag);
-  auto p = sp.get();
-  node_list.push_back(move(sp));
+  auto p = newNode<VariableNode>(symb_id, lag);
   variable_node_map[{ symb_id, lag }] = p;
   return p;
 }
@@ -518,9 +530,7 @@ DataTree::AddVarExpectation(const string &model_name)
   if (it != var_expectation_node_map.end())
     return it->second;
 
-  auto sp = make_unique<VarExpectationNode>(*this, node_list.size(), model_name);
-  auto p = sp.get();
-  node_list.push_back(move(sp));
+  auto p = newNode<VarExpectationNode>(model_name);
   var_expectation_node_map[model_name] = p;
   return p;
 }
@@ -532,9 +542,7 @@ DataTree::AddPacExpectation(const string &model_name)
   if (it != pac_expectation_node_map.end())
     return it->second;
 
-  auto sp = make_unique<PacExpectationNode>(*this, node_list.size(), model_name);
-  auto p = sp.get();
-  node_list.push_back(move(sp));
+  auto p = newNode<PacExpectationNode>(model_name);
   pac_expectation_node_map[model_name] = p;
   return p;
 }
@@ -568,9 +576,7 @@ DataTree::AddExternalFunction(int symb_id, const vector<expr_t> &arguments)
   if (it != external_function_node_map.end())
     return it->second;
 
-  auto sp = make_unique<ExternalFunctionNode>(*this, node_list.size(), symb_id, arguments);
-  auto p = sp.get();
-  node_list.push_back(move(sp));
+  auto p = newNode<ExternalFunctionNode>(symb_id, arguments);
   external_function_node_map[{ arguments, symb_id }] = p;
   return p;
 }
@@ -585,9 +591,7 @@ DataTree::AddFirstDerivExternalFunction(int top_level_symb_id, const vector<expr
   if (it != first_deriv_external_function_node_map.end())
     return it->second;
 
-  auto sp = make_unique<FirstDerivExternalFunctionNode>(*this, node_list.size(), top_level_symb_id, arguments, input_index);
-  auto p = sp.get();
-  node_list.push_back(move(sp));
+  auto p = newNode<FirstDerivExternalFunctionNode>(top_level_symb_id, arguments, input_index);
   first_deriv_external_function_node_map[{ arguments, input_index, top_level_symb_id }] = p;
   return p;
 }
@@ -603,9 +607,7 @@ DataTree::AddSecondDerivExternalFunction(int top_level_symb_id, const vector<exp
   if (it != second_deriv_external_function_node_map.end())
     return it->second;
 
-  auto sp = make_unique<SecondDerivExternalFunctionNode>(*this, node_list.size(), top_level_symb_id, arguments, input_index1, input_index2);
-  auto p = sp.get();
-  node_list.push_back(move(sp));
+  auto p = newNode<SecondDerivExternalFunctionNode>(top_level_symb_id, arguments, input_index1, input_index2);
   second_deriv_external_function_node_map[{ arguments, input_index1, input_index2, top_level_symb_id }] = p;
   return p;
 }
@@ -661,8 +663,8 @@ DataTree::getDynJacobianCol(int deriv_id) const noexcept(false)
 bool
 DataTree::isUnaryOpUsed(UnaryOpcode opcode) const
 {
-  for (const auto & it : unary_op_node_map)
-    if (get<1>(it.first) == opcode)
+  for (auto node : unary_op_node_map)
+    if (node->get_op_code() == opcode)
       return true;
 
   return false;
@@ -671,8 +673,8 @@ DataTree::isUnaryOpUsed(UnaryOpcode opcode) const
 bool
 DataTree::isBinaryOpUsed(BinaryOpcode opcode) const
 {
-  for (const auto & it : binary_op_node_map)
-    if (get<2>(it.first) == opcode)
+  for (auto node : binary_op_node_map)
+    if (node->get_op_code() == opcode)
       return true;
 
   return false;
@@ -681,8 +683,8 @@ DataTree::isBinaryOpUsed(BinaryOpcode opcode) const
 bool
 DataTree::isTrinaryOpUsed(TrinaryOpcode opcode) const
 {
-  for (const auto & it : trinary_op_node_map)
-    if (get<3>(it.first) == opcode)
+  for (auto node : trinary_op_node_map)
+    if (node->op_code == opcode)
       return true;
 
   return false;
@@ -728,6 +730,258 @@ DataTree::minLagForSymbol(int symb_id) const
   return r;
 }
 
+bool
+DataTree::findNeededNodes(const vector<expr_t> &roots, vector<bool> &needed) const
+{
+  /* Since the arguments of a node are always created before it, a single pass
+     in decreasing order of indices is enough to find all the needed nodes */
+  needed.assign(node_list.size(), false);
+  for (auto root : roots)
+    needed[root->idx] = true;
+
+  for (int i = static_cast<int>(node_list.size()) - 1; i >= 0; i--)
+    {
+      if (!needed[i])
+        continue;
+      expr_t node = node_list[i];
+      if (dynamic_cast<NumConstNode *>(node) || dynamic_cast<VariableNode *>(node))
+        continue;
+      else if (auto uop = dynamic_cast<UnaryOpNode *>(node))
+        {
+          if (!uop->adl_param_name.empty() || !uop->adl_lags.empty())
+            return false;
+          needed[uop->arg->idx] = true;
+        }
+      else if (auto bop = dynamic_cast<BinaryOpNode *>(node))
+        {
+          needed[bop->get_arg1()->idx] = true;
+          needed[bop->get_arg2()->idx] = true;
+        }
+      else if (auto top = dynamic_cast<TrinaryOpNode *>(node))
+        {
+          needed[top->arg1->idx] = true;
+          needed[top->arg2->idx] = true;
+          needed[top->arg3->idx] = true;
+        }
+      else
+        return false;
+    }
+  return true;
+}
+
+bool
+DataTree::writeNodes(ostream &output, const vector<expr_t> &roots) const
+{
+  vector<bool> needed;
+  if (!findNeededNodes(roots, needed))
+    return false;
+
+  output << node_list.size() << " " << count(needed.begin(), needed.end(), true) << endl;
+  for (int i = 0; i < static_cast<int>(node_list.size()); i++)
+    {
+      if (!needed[i])
+        continue;
+      expr_t node = node_list[i];
+      output << i << " ";
+      if (auto cnode = dynamic_cast<NumConstNode *>(node))
+        output << "n " << num_constants.get(cnode->get_id());
+      else if (auto vnode = dynamic_cast<VariableNode *>(node))
+        output << "v " << vnode->get_symb_id() << " " << vnode->get_lag();
+      else if (auto uop = dynamic_cast<UnaryOpNode *>(node))
+        output << "u " << static_cast<int>(uop->op_code) << " " << uop->arg->idx << " "
+               << uop->expectation_information_set << " " << uop->param1_symb_id << " " << uop->param2_symb_id;
+      else if (auto bop = dynamic_cast<BinaryOpNode *>(node))
+        output << "b " << static_cast<int>(bop->get_op_code()) << " " << bop->get_arg1()->idx << " "
+               << bop->get_arg2()->idx << " " << bop->get_power_deriv_order();
+      else
+        {
+          auto top = dynamic_cast<TrinaryOpNode *>(node);
+          output << "t " << static_cast<int>(top->op_code) << " " << top->arg1->idx << " "
+                 << top->arg2->idx << " " << top->arg3->idx;
+        }
+      output << endl;
+    }
+  return true;
+}
+
+bool
+DataTree::flattenNodes(const vector<expr_t> &roots, vector<BinaryDerivatives::Node> &nodes, vector<int> &index) const
+{
+  using BinaryDerivatives::NodeType;
+
+  vector<bool> needed;
+  if (!findNeededNodes(roots, needed))
+    return false;
+
+  nodes.clear();
+  index.assign(node_list.size(), -1);
+  for (int i = 0; i < static_cast<int>(node_list.size()); i++)
+    {
+      if (!needed[i])
+        continue;
+      expr_t node = node_list[i];
+      BinaryDerivatives::Node n{NodeType::constant, 0, -1, -1, -1, 0, 0};
+      if (auto cnode = dynamic_cast<NumConstNode *>(node))
+        n.value = num_constants.getDouble(cnode->get_id());
+      else if (auto vnode = dynamic_cast<VariableNode *>(node))
+        {
+          n.type = NodeType::variable;
+          n.arg1 = vnode->get_symb_id();
+          n.arg2 = vnode->get_lag();
+          n.arg3 = static_cast<int>(vnode->get_type());
+        }
+      else if (auto uop = dynamic_cast<UnaryOpNode *>(node))
+        {
+          n.type = NodeType::unaryOp;
+          n.op_code = static_cast<int>(uop->op_code);
+          n.arg1 = index[uop->arg->idx];
+          n.arg2 = uop->param1_symb_id;
+          n.arg3 = uop->param2_symb_id;
+          n.extra = uop->expectation_information_set;
+        }
+      else if (auto bop = dynamic_cast<BinaryOpNode *>(node))
+        {
+          n.type = NodeType::binaryOp;
+          n.op_code = static_cast<int>(bop->get_op_code());
+          n.arg1 = index[bop->get_arg1()->idx];
+          n.arg2 = index[bop->get_arg2()->idx];
+          n.extra = bop->get_power_deriv_order();
+        }
+      else
+        {
+          auto top = dynamic_cast<TrinaryOpNode *>(node);
+          n.type = NodeType::trinaryOp;
+          n.op_code = static_cast<int>(top->op_code);
+          n.arg1 = index[top->arg1->idx];
+          n.arg2 = index[top->arg2->idx];
+          n.arg3 = index[top->arg3->idx];
+        }
+      index[i] = nodes.size();
+      nodes.push_back(n);
+    }
+  return true;
+}
+
+bool
+DataTree::isReadNode(const vector<expr_t> &nodes, int arg, int i)
+{
+  return arg >= 0 && arg < i && nodes[arg];
+}
+
+bool
+DataTree::isReadSymbol(int symb_id) const
+{
+  return symb_id >= 0 && symb_id <= symbol_table.maxID();
+}
+
+bool
+DataTree::readNodes(istream &input, vector<expr_t> &nodes)
+{
+  int nb_nodes, nb_written;
+  if (!(input >> nb_nodes >> nb_written) || nb_nodes < 0 || nb_written < 0)
+    return false;
+  nodes.assign(nb_nodes, nullptr);
+
+  for (int k = 0; k < nb_written; k++)
+    {
+      int i;
+      char kind;
+      if (!(input >> i >> kind) || i < 0 || i >= nb_nodes)
+        return false;
+      switch (kind)
+        {
+        case 'n':
+          {
+            string value;
+            if (!(input >> value))
+              return false;
+            // Same check as in NumericalConstants::AddNonNegativeConstant(), on the whole string
+            char *end;
+            double val = strtod(value.c_str(), &end);
+            if (*end || !(val >= 0 || isnan(val)))
+              return false;
+            nodes[i] = AddNonNegativeConstant(value);
+          }
+          break;
+        case 'v':
+          {
+            int symb_id, lag;
+            if (!(input >> symb_id >> lag) || !isReadSymbol(symb_id))
+              return false;
+            SymbolType type = symbol_table.getType(symb_id);
+            if (type == SymbolType::externalFunction
+                || (lag != 0 && (type == SymbolType::modelLocalVariable || type == SymbolType::modFileLocalVariable)))
+              return false;
+            nodes[i] = AddVariableInternal(symb_id, lag);
+          }
+          break;
+        case 'u':
+          {
+            int op_code, arg, exp_info_set, param1_symb_id, param2_symb_id;
+            if (!(input >> op_code >> arg >> exp_info_set >> param1_symb_id >> param2_symb_id)
+                || op_code < 0 || op_code > static_cast<int>(UnaryOpcode::adl)
+                || !isReadNode(nodes, arg, i) || !isReadSymbol(param1_symb_id)
+                || !isReadSymbol(param2_symb_id))
+              return false;
+            nodes[i] = AddUnaryOp(static_cast<UnaryOpcode>(op_code), nodes[arg], exp_info_set,
+                                  param1_symb_id, param2_symb_id);
+          }
+          break;
+        case 'b':
+          {
+            int op_code, arg1, arg2, powerDerivOrder;
+            if (!(input >> op_code >> arg1 >> arg2 >> powerDerivOrder)
+                || op_code < 0 || op_code > static_cast<int>(BinaryOpcode::different)
+                || powerDerivOrder < 0
+                || !isReadNode(nodes, arg1, i) || !isReadNode(nodes, arg2, i))
+              return false;
+            nodes[i] = AddBinaryOp(nodes[arg1], static_cast<BinaryOpcode>(op_code), nodes[arg2],
+                                   powerDerivOrder);
+          }
+          break;
+        case 't':
+          {
+            int op_code, arg1, arg2, arg3;
+            if (!(input >> op_code >> arg1 >> arg2 >> arg3)
+                || op_code < 0 || op_code > static_cast<int>(TrinaryOpcode::normpdf)
+                || !isReadNode(nodes, arg1, i) || !isReadNode(nodes, arg2, i)
+                || !isReadNode(nodes, arg3, i))
+              return false;
+            nodes[i] = AddTrinaryOp(nodes[arg1], static_cast<TrinaryOpcode>(op_code), nodes[arg2],
+                                    nodes[arg3]);
+          }
+          break;
+        default:
+          return false;
+        }
+    }
+  return true;
+}
+
+void
+DataTree::removeNodesFrom(int nb_nodes)
+{
+  auto is_removed = [nb_nodes](const ExprNode *node) { return node->idx >= nb_nodes; };
+  for (auto it = num_const_node_map.begin(); it != num_const_node_map.end();)
+    if (is_removed(it->second))
+      it = num_const_node_map.erase(it);
+    else
+      ++it;
+  for (auto it = variable_node_map.begin(); it != variable_node_map.end();)
+    if (is_removed(it->second))
+      it = variable_node_map.erase(it);
+    else
+      ++it;
+  unary_op_node_map.eraseIf(is_removed);
+  binary_op_node_map.eraseIf(is_removed);
+  trinary_op_node_map.eraseIf(is_removed);
+
+  // The memory of the nodes stays in node_arena until the datatree is destroyed
+  for (int i = nb_nodes; i < static_cast<int>(node_list.size()); i++)
+    node_list[i]->~ExprNode();
+  node_list.resize(nb_nodes);
+}
+
 void
 DataTree::writePowerDerivCHeader(ostream &output) const
 {
@@ -29,12 +29,16 @@ using namespace std;
 #include <iomanip>
 #include <cmath>
 #include <utility>
+#include <new>
 
 #include "SymbolTable.hh"
 #include "NumericalConstants.hh"
 #include "ExternalFunctionsTable.hh"
 #include "ExprNode.hh"
 #include "SubModel.hh"
+#include "NodeHashTable.hh"
+#include "NodeArena.hh"
+#include "BinaryDerivatives.hh"
 
 class DataTree
 {
@@ -59,16 +63,16 @@ protected:
   using variable_node_map_t = map<pair<int, int>, VariableNode *>;
   variable_node_map_t variable_node_map;
 
-  //! (arg, op_code, arg_exp_info_set, param1_symb_id, param2_symb_id, adl_param_name, adl_lags) -> UnaryOpNode
-  using unary_op_node_map_t = map<tuple<expr_t, UnaryOpcode, int, int, int, string, vector<int>>, UnaryOpNode *>;
+  //! UnaryOpNodes, indexed by (arg, op_code, arg_exp_info_set, param1_symb_id, param2_symb_id, adl_param_name, adl_lags)
+  using unary_op_node_map_t = NodeHashTable<UnaryOpNode>;
   unary_op_node_map_t unary_op_node_map;
 
-  //! ( arg1, arg2, opCode, order of Power Derivative) -> BinaryOpNode
-  using binary_op_node_map_t = map<tuple<expr_t, expr_t, BinaryOpcode, int>, BinaryOpNode *>;
+  //! BinaryOpNodes, indexed by (arg1, arg2, opCode, order of Power Derivative)
+  using binary_op_node_map_t = NodeHashTable<BinaryOpNode>;
   binary_op_node_map_t binary_op_node_map;
 
-  //! ( arg1, arg2, arg3, opCode) -> TrinaryOpNode
-  using trinary_op_node_map_t = map<tuple<expr_t, expr_t, expr_t, TrinaryOpcode>, TrinaryOpNode *>;
+  //! TrinaryOpNodes, indexed by (arg1, arg2, arg3, opCode)
+  using trinary_op_node_map_t = NodeHashTable<TrinaryOpNode>;
   trinary_op_node_map_t trinary_op_node_map;
 
   // (arguments, symb_id) -> ExternalFunctionNode
@@ -99,6 +103,9 @@ protected:
   //! Internal implementation of AddVariable(), without the check on the lag
   VariableNode *AddVariableInternal(int symb_id, int lag);
 
+  //! Returns the node of the numerical constant of the given ID, creating it if needed
+  expr_t AddNumConstInternal(int id);
+
   //! Internal implementation of ParamUsedWithLeadLag()
   bool ParamUsedWithLeadLagInternal() const;
 
@@ -109,11 +116,30 @@ protected:
     inside +objective subdir). */
   static string packageDir(const string &package);
 
-private:
-  const static int constants_precision{16};
+  //! Marks the given nodes and all the nodes on which they depend (see writeNodes())
+  /*! Returns false if a node other than a constant, a variable or a unary, binary or trinary operator is encountered */
+  bool findNeededNodes(const vector<expr_t> &roots, vector<bool> &needed) const;
 
+  //! Checks that a node read by readNodes() can be used as an argument of the node of index i
+  static bool isReadNode(const vector<expr_t> &nodes, int arg, int i);
+  //! Checks that a symbol ID read by readNodes() exists
+  bool isReadSymbol(int symb_id) const;
+
+private:
+  //! Memory pool in which the nodes are allocated
+  NodeArena node_arena;
   //! The list of nodes
-  vector<unique_ptr<ExprNode>> node_list;
+  vector<ExprNode *> node_list;
+
+  //! Creates a node in node_arena, and appends it to node_list
+  template<typename T, typename... Args>
+  T *
+  newNode(Args &&... args)
+  {
+    T *p = new (node_arena.allocate(sizeof(T), alignof(T))) T(*this, node_list.size(), forward<Args>(args)...);
+    node_list.push_back(p);
+    return p;
+  }
 
   inline expr_t AddUnaryOp(UnaryOpcode op_code, expr_t arg, int arg_exp_info_set = 0, int param1_symb_id = 0, int param2_symb_id = 0, const string &adl_param_name = "", const vector<int> &adl_lags = vector<int>());
   inline expr_t AddBinaryOp(expr_t arg1, BinaryOpcode op_code, expr_t arg2, int powerDerivOrder = 0);
@@ -127,6 +153,8 @@ public:
            VarModelTable &var_model_table_arg);
   virtual
   ~DataTree();
+  DataTree(const DataTree &) = delete;
+  DataTree &operator=(const DataTree &) = delete;
 
   //! Some predefined constants
   expr_t Zero, One, Two, MinusOne, NaN, Infinity, MinusInfinity, Pi;
@@ -148,6 +176,8 @@ public:
   inline expr_t AddPossiblyNegativeConstant(double val);
   //! Adds a non-negative numerical constant (possibly Inf or NaN)
   expr_t AddNonNegativeConstant(const string &value);
+  //! Adds a non-negative numerical constant given in double form (possibly Inf or NaN)
+  expr_t AddNonNegativeConstant(double value);
   //! Adds a variable
   /*! The default implementation of the method refuses any lag != 0 */
   virtual VariableNode *AddVariable(int symb_id, int lag = 0);
@@ -263,9 +293,40 @@ public:
   bool isFirstDerivExternalFunctionUsed(int symb_id) const;
   //! Checks if a given second derivative external function is used somewhere in the data tree
   bool isSecondDerivExternalFunctionUsed(int symb_id) const;
+  //! Returns the number of nodes in the data tree
+  int
+  getNodeCount() const
+  {
+    return node_list.size();
+  }
+  //! Returns the node of the given index (nodes are indexed in their order of creation)
+  expr_t
+  getNodeByIndex(int idx) const
+  {
+    return node_list[idx];
+  }
   //! Returns the minimum lag (as a negative number) of the given symbol in the whole data tree (and not only in the equations !!)
   /*! Returns 0 if the symbol is not used */
   int minLagForSymbol(int symb_id) const;
+  //! Writes the given nodes and all the nodes on which they depend, in a form that can be read back by readNodes()
+  /*! Nodes are identified by their index in the datatree, and are written after their arguments.
+    Only constants, variables and unary, binary and trinary operators are supported: if another
+    kind of node is encountered, nothing is written and false is returned */
+  bool writeNodes(ostream &output, const vector<expr_t> &roots) const;
+  //! Recreates in this datatree the nodes written by writeNodes()
+  /*! On return, nodes[i] is the node which had index i when the nodes were written (or a null
+    pointer if it was not written). Returns false if the input is malformed (including unknown
+    operators or symbols), in which case the nodes already created are left in the datatree:
+    the caller can remove them with removeNodesFrom() */
+  bool readNodes(istream &input, vector<expr_t> &nodes);
+  //! Removes the nodes which were created after the first nb_nodes ones
+  /*! Only constants, variables and unary, binary and trinary operators can be removed (see
+    readNodes()), and no other node must refer to them */
+  void removeNodesFrom(int nb_nodes);
+  //! Flattens the given nodes and all the nodes on which they depend into a table of nodes (see BinaryDerivatives.hh)
+  /*! On return, index[i] is the position in the table of the node of index i in the datatree (or -1 if it is not in the table).
+    The same nodes as in writeNodes() are supported: otherwise, false is returned */
+  bool flattenNodes(const vector<expr_t> &roots, vector<BinaryDerivatives::Node> &nodes, vector<int> &index) const;
   //! Write the C Header for getPowerDeriv when use_dll is used
   void writePowerDerivCHeader(ostream &output) const;
   //! Write getPowerDeriv in C
@@ -342,10 +403,8 @@ DataTree::AddPossiblyNegativeConstant(double v)
       v = -v;
       neg = true;
     }
-  ostringstream ost;
-  ost << setprecision(constants_precision) << v;
 
-  expr_t cnode = AddNonNegativeConstant(ost.str());
+  expr_t cnode = AddNonNegativeConstant(v);
 
   if (neg)
     return AddUMinus(cnode);
@@ -357,83 +416,71 @@ inline expr_t
 DataTree::AddUnaryOp(UnaryOpcode op_code, expr_t arg, int arg_exp_info_set, int param1_symb_id, int param2_symb_id, const string &adl_param_name, const vector<int> &adl_lags)
 {
   // If the node already exists in tree, share it
-  auto it = unary_op_node_map.find({ arg, op_code, arg_exp_info_set, param1_symb_id, param2_symb_id, adl_param_name, adl_lags });
-  if (it != unary_op_node_map.end())
-    return it->second;
+  size_t hash = UnaryOpNode::computeStructuralHash(op_code, arg, arg_exp_info_set, param1_symb_id, param2_symb_id, adl_param_name, adl_lags);
+  UnaryOpNode *node = unary_op_node_map.find(hash, [&](const UnaryOpNode *n)
+                                             {
+                                               return n->arg == arg && n->op_code == op_code
+                                                 && n->expectation_information_set == arg_exp_info_set
+                                                 && n->param1_symb_id == param1_symb_id
+                                                 && n->param2_symb_id == param2_symb_id
+                                                 && n->adl_param_name == adl_param_name
+                                                 && n->adl_lags == adl_lags;
+                                             });
+  if (node)
+    return node;
 
   // Try to reduce to a constant
   // Case where arg is a constant and op_code == UnaryOpcode::uminus (i.e. we're adding a negative constant) is skipped
-  auto *carg = dynamic_cast<NumConstNode *>(arg);
-  if (op_code != UnaryOpcode::uminus || carg == nullptr)
-    {
-      try
-        {
-          double argval = arg->eval(eval_context_t());
-          double val = UnaryOpNode::eval_opcode(op_code, argval);
-          return AddPossiblyNegativeConstant(val);
-        }
-      catch (ExprNode::EvalException &e)
-        {
-        }
-    }
+  if (arg->isConstant() && (op_code != UnaryOpcode::uminus || dynamic_cast<NumConstNode *>(arg) == nullptr))
+    return AddPossiblyNegativeConstant(UnaryOpNode::eval_opcode(op_code, arg->getConstantValue()));
 
-  auto sp = make_unique<UnaryOpNode>(*this, node_list.size(), op_code, arg, arg_exp_info_set, param1_symb_id, param2_symb_id, adl_param_name, adl_lags);
-  auto p = sp.get();
-  node_list.push_back(move(sp));
-  unary_op_node_map[{ arg, op_code, arg_exp_info_set, param1_symb_id, param2_symb_id, adl_param_name, adl_lags }] = p;
+  auto p = newNode<UnaryOpNode>(op_code, arg, arg_exp_info_set, param1_symb_id, param2_symb_id, adl_param_name, adl_lags);
+  unary_op_node_map.insert(hash, p);
   return p;
 }
 
 inline expr_t
 DataTree::AddBinaryOp(expr_t arg1, BinaryOpcode op_code, expr_t arg2, int powerDerivOrder)
 {
-  auto it = binary_op_node_map.find({ arg1, arg2, op_code, powerDerivOrder });
-  if (it != binary_op_node_map.end())
-    return it->second;
-
-  // Try to reduce to a constant
-  try
-    {
-      double argval1 = arg1->eval(eval_context_t());
-      double argval2 = arg2->eval(eval_context_t());
-      double val = BinaryOpNode::eval_opcode(argval1, op_code, argval2, powerDerivOrder);
-      return AddPossiblyNegativeConstant(val);
-    }
-  catch (ExprNode::EvalException &e)
-    {
-    }
-
-  auto sp = make_unique<BinaryOpNode>(*this, node_list.size(), arg1, op_code, arg2, powerDerivOrder);
-  auto p = sp.get();
-  node_list.push_back(move(sp));
-  binary_op_node_map[{ arg1, arg2, op_code, powerDerivOrder }] = p;
+  size_t hash = BinaryOpNode::computeStructuralHash(arg1, op_code, arg2, powerDerivOrder);
+  BinaryOpNode *node = binary_op_node_map.find(hash, [&](const BinaryOpNode *n)
+                                               {
+                                                 return n->get_arg1() == arg1 && n->get_arg2() == arg2
+                                                   && n->get_op_code() == op_code
+                                                   && n->get_power_deriv_order() == powerDerivOrder;
+                                               });
+  if (node)
+    return node;
+
+  // Try to reduce to a constant (equal nodes cannot be evaluated)
+  if (arg1->isConstant() && arg2->isConstant() && op_code != BinaryOpcode::equal)
+    return AddPossiblyNegativeConstant(BinaryOpNode::eval_opcode(arg1->getConstantValue(), op_code,
+                                                                 arg2->getConstantValue(), powerDerivOrder));
+
+  auto p = newNode<BinaryOpNode>(arg1, op_code, arg2, powerDerivOrder);
+  binary_op_node_map.insert(hash, p);
   return p;
 }
 
 inline expr_t
 DataTree::AddTrinaryOp(expr_t arg1, TrinaryOpcode op_code, expr_t arg2, expr_t arg3)
 {
-  auto it = trinary_op_node_map.find({ arg1, arg2, arg3, op_code });
-  if (it != trinary_op_node_map.end())
-    return it->second;
+  size_t hash = TrinaryOpNode::computeStructuralHash(arg1, op_code, arg2, arg3);
+  TrinaryOpNode *node = trinary_op_node_map.find(hash, [&](const TrinaryOpNode *n)
+                                                 {
+                                                   return n->arg1 == arg1 && n->arg2 == arg2
+                                                     && n->arg3 == arg3 && n->op_code == op_code;
+                                                 });
+  if (node)
+    return node;
 
   // Try to reduce to a constant
-  try
-    {
-      double argval1 = arg1->eval(eval_context_t());
-      double argval2 = arg2->eval(eval_context_t());
-      double argval3 = arg3->eval(eval_context_t());
-      double val = TrinaryOpNode::eval_opcode(argval1, op_code, argval2, argval3);
-      return AddPossiblyNegativeConstant(val);
-    }
-  catch (ExprNode::EvalException &e)
-    {
-    }
+  if (arg1->isConstant() && arg2->isConstant() && arg3->isConstant())
+    return AddPossiblyNegativeConstant(TrinaryOpNode::eval_opcode(arg1->getConstantValue(), op_code,
+                                                                  arg2->getConstantValue(), arg3->getConstantValue()));
 
-  auto sp = make_unique<TrinaryOpNode>(*this, node_list.size(), arg1, op_code, arg2, arg3);
-  auto p = sp.get();
-  node_list.push_back(move(sp));
-  trinary_op_node_map[{ arg1, arg2, arg3, op_code }] = p;
+  auto p = newNode<TrinaryOpNode>(arg1, op_code, arg2, arg3);
+  trinary_op_node_map.insert(hash, p);
   return p;
 }
 
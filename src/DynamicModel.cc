@@ -30,6 +30,9 @@
 #include <boost/filesystem.hpp>
 
 #include "DynamicModel.hh"
+#include "Profiler.hh"
+#include "EvalTape.hh"
+#include "SHA256.hh"
 
 DynamicModel::DynamicModel(SymbolTable &symbol_table_arg,
                            NumericalConstants &num_constants_arg,
@@ -58,7 +61,7 @@ DynamicModel::AddVariable(int symb_id, int lag)
 }
 
 void
-DynamicModel::compileDerivative(ofstream &code_file, unsigned int &instruction_number, int eq, int symb_id, int lag, const map_idx_t &map_idx) const
+DynamicModel::compileDerivative(ostream &code_file, unsigned int &instruction_number, int eq, int symb_id, int lag, const map_idx_t &map_idx) const
 {
   auto it = first_derivatives.find({ eq, getDerivID(symbol_table.getID(SymbolType::endogenous, symb_id), lag) });
   if (it != first_derivatives.end())
@@ -71,7 +74,7 @@ DynamicModel::compileDerivative(ofstream &code_file, unsigned int &instruction_n
 }
 
 void
-DynamicModel::compileChainRuleDerivative(ofstream &code_file, unsigned int &instruction_number, int eqr, int varr, int lag, const map_idx_t &map_idx) const
+DynamicModel::compileChainRuleDerivative(ostream &code_file, unsigned int &instruction_number, int eqr, int varr, int lag, const map_idx_t &map_idx) const
 {
   auto it = first_chain_rule_derivatives.find({ eqr, { varr, lag } });
   if (it != first_chain_rule_derivatives.end())
@@ -86,6 +89,8 @@ DynamicModel::compileChainRuleDerivative(ofstream &code_file, unsigned int &inst
 void
 DynamicModel::computeTemporaryTermsOrdered()
 {
+  Profiler::Phase phase("temporary terms");
+
   map<expr_t, pair<int, int>> first_occurence;
   map<expr_t, int> reference_count;
   BinaryOpNode *eq_node;
@@ -791,19 +796,13 @@ DynamicModel::writeModelEquationsCode(const string &basename, const map_idx_t &m
 {
 
   ostringstream tmp_output;
-  ofstream code_file;
+  ostringstream code_file;
   unsigned int instruction_number = 0;
   bool file_open = false;
 
   boost::filesystem::create_directories(basename + "/model/bytecode");
 
   string main_name = basename + "/model/bytecode/dynamic.cod";
-  code_file.open(main_name, ios::out | ios::binary | ios::ate);
-  if (!code_file.is_open())
-    {
-      cerr << "Error : Can't open file \"" << main_name << "\" for writing" << endl;
-      exit(EXIT_FAILURE);
-    }
 
   int count_u;
   int u_count_int = 0;
@@ -1038,7 +1037,7 @@ DynamicModel::writeModelEquationsCode(const string &basename, const map_idx_t &m
   fendblock.write(code_file, instruction_number);
   FEND_ fend;
   fend.write(code_file, instruction_number);
-  code_file.close();
+  writeBytecodeFile(main_name, code_file.str());
 }
 
 void
@@ -1058,7 +1057,7 @@ DynamicModel::writeModelEquationsCode_Block(const string &basename, const map_id
   int i, v;
   string tmp_s;
   ostringstream tmp_output;
-  ofstream code_file;
+  ostringstream code_file;
   unsigned int instruction_number = 0;
   expr_t lhs = nullptr, rhs = nullptr;
   BinaryOpNode *eq_node;
@@ -1071,12 +1070,6 @@ DynamicModel::writeModelEquationsCode_Block(const string &basename, const map_id
   boost::filesystem::create_directories(basename + "/model/bytecode");
 
   string main_name = basename + "/model/bytecode/dynamic.cod";
-  code_file.open(main_name, ios::out | ios::binary | ios::ate);
-  if (!code_file.is_open())
-    {
-      cerr << "Error : Can't open file \"" << main_name << "\" for writing" << endl;
-      exit(EXIT_FAILURE);
-    }
   //Temporary variables declaration
 
   FDIMT_ fdimt(temporary_terms.size());
@@ -1509,7 +1502,7 @@ DynamicModel::writeModelEquationsCode_Block(const string &basename, const map_id
   fendblock.write(code_file, instruction_number);
   FEND_ fend;
   fend.write(code_file, instruction_number);
-  code_file.close();
+  writeBytecodeFile(main_name, code_file.str());
 }
 
 void
@@ -1525,7 +1518,7 @@ DynamicModel::writeDynamicJuliaFile(const string &basename) const
 }
 
 void
-DynamicModel::writeDynamicCFile(const string &basename, const int order) const
+DynamicModel::writeDynamicCFile(const string &basename, const int order, int nshards) const
 {
   boost::filesystem::create_directories(basename + "/model/src");
   string filename = basename + "/model/src/dynamic.c";
@@ -1543,29 +1536,37 @@ DynamicModel::writeDynamicCFile(const string &basename, const int order) const
                     << " *" << endl
                     << " * Warning : this file is generated automatically by Dynare" << endl
                     << " *           from model file (.mod)" << endl
-                    << " */" << endl
+                    << " */" << endl;
+
+  if (nshards > 1)
+    // The includes, macros and prototypes are in dynamic.h (see writeDynamicCShards())
+    mDynamicModelFile << "#include \"dynamic.h\"" << endl << endl;
+  else
+    {
+      mDynamicModelFile
 #if defined(_WIN32) || defined(__CYGWIN32__) || defined(__MINGW32__)
-                    << "#ifdef _MSC_VER" << endl
-                    << "#define _USE_MATH_DEFINES" << endl
-                    << "#endif" << endl
+        << "#ifdef _MSC_VER" << endl
+        << "#define _USE_MATH_DEFINES" << endl
+        << "#endif" << endl
 #endif
-                    << "#include <math.h>" << endl;
+        << "#include <math.h>" << endl;
 
-  if (external_functions_table.get_total_number_of_unique_model_block_external_functions())
-    // External Matlab function, implies Dynamic function will call mex
-    mDynamicModelFile << "#include \"mex.h\"" << endl;
-  else
-    mDynamicModelFile << "#include <stdlib.h>" << endl;
+      if (external_functions_table.get_total_number_of_unique_model_block_external_functions())
+        // External Matlab function, implies Dynamic function will call mex
+        mDynamicModelFile << "#include \"mex.h\"" << endl;
+      else
+        mDynamicModelFile << "#include <stdlib.h>" << endl;
 
-  mDynamicModelFile << "#define max(a, b) (((a) > (b)) ? (a) : (b))" << endl
-                    << "#define min(a, b) (((a) > (b)) ? (b) : (a))" << endl;
+      mDynamicModelFile << "#define max(a, b) (((a) > (b)) ? (a) : (b))" << endl
+                        << "#define min(a, b) (((a) > (b)) ? (b) : (a))" << endl;
 
-  // Write function definition if BinaryOpcode::powerDeriv is used
-  writePowerDerivCHeader(mDynamicModelFile);
-  writeNormcdfCHeader(mDynamicModelFile);
+      // Write function definition if BinaryOpcode::powerDeriv is used
+      writePowerDerivCHeader(mDynamicModelFile);
+      writeNormcdfCHeader(mDynamicModelFile);
+    }
 
   // Writing the function body
-  writeDynamicModel(mDynamicModelFile, true, false);
+  writeDynamicModel(basename, mDynamicModelFile, true, false, nshards);
 
   writePowerDeriv(mDynamicModelFile);
   writeNormcdf(mDynamicModelFile);
@@ -2276,18 +2277,18 @@ DynamicModel::writeDynamicMatlabCompatLayer(const string &basename) const
 void
 DynamicModel::writeDynamicModel(ostream &DynamicOutput, bool use_dll, bool julia) const
 {
-  writeDynamicModel("", DynamicOutput, use_dll, julia);
+  writeDynamicModel("", DynamicOutput, use_dll, julia, 1);
 }
 
 void
 DynamicModel::writeDynamicModel(const string &basename, bool use_dll, bool julia) const
 {
   ofstream DynamicOutput;
-  writeDynamicModel(basename, DynamicOutput, use_dll, julia);
+  writeDynamicModel(basename, DynamicOutput, use_dll, julia, 1);
 }
 
 void
-DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput, bool use_dll, bool julia) const
+DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput, bool use_dll, bool julia, int nshards) const
 {
   ostringstream model_tt_output;             // Used for storing model temp vars
   ostringstream model_output;                // Used for storing model equations
@@ -2298,9 +2299,17 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
   ostringstream third_derivatives_tt_output; // Used for storing third order derivatives temp terms
   ostringstream third_derivatives_output;    // Used for storing third order derivatives equations
 
-  ExprNodeOutputType output_type = (use_dll ? ExprNodeOutputType::CDynamicModel :
+  ExprNodeOutputType output_type = (use_dll ? (nshards > 1 ? ExprNodeOutputType::CDynamicModelSplit : ExprNodeOutputType::CDynamicModel) :
                                     julia ? ExprNodeOutputType::juliaDynamicModel : ExprNodeOutputType::matlabDynamicModel);
 
+  /* The split C model stores the temporary terms in array T, whose slots are
+     assigned before writing any code */
+  temporary_terms_idxs_t tt_slots;
+  map<expr_t, string> tt_digests;
+  if (output_type == ExprNodeOutputType::CDynamicModelSplit)
+    assignTemporaryTermsSlots(basename, tt_slots, tt_digests);
+  const temporary_terms_idxs_t &tt_idxs = (output_type == ExprNodeOutputType::CDynamicModelSplit ? tt_slots : temporary_terms_idxs);
+
   deriv_node_temp_terms_t tef_terms;
   temporary_terms_t temp_term_union;
 
@@ -2311,11 +2320,11 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
 
   writeTemporaryTerms(temporary_terms_res,
                       temp_term_union,
-                      temporary_terms_idxs,
+                      tt_idxs,
                       model_tt_output, output_type, tef_terms);
   temp_term_union.insert(temporary_terms_res.begin(), temporary_terms_res.end());
 
-  writeModelEquations(model_output, output_type, temp_term_union);
+  writeModelEquations(model_output, output_type, temp_term_union, tt_idxs);
 
   int nrows = equations.size();
   int hessianColsNbr = dynJacobianColsNbr * dynJacobianColsNbr;
@@ -2325,7 +2334,7 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
     {
       writeTemporaryTerms(temporary_terms_g1,
                           temp_term_union,
-                          temporary_terms_idxs,
+                          tt_idxs,
                           jacobian_tt_output, output_type, tef_terms);
       temp_term_union.insert(temporary_terms_g1.begin(), temporary_terms_g1.end());
 
@@ -2338,7 +2347,7 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
           jacobianHelper(jacobian_output, eq, getDynJacobianCol(var), output_type);
           jacobian_output << "=";
           d1->writeOutput(jacobian_output, output_type,
-                          temp_term_union, temporary_terms_idxs, tef_terms);
+                          temp_term_union, tt_idxs, tef_terms);
           jacobian_output << ";" << endl;
         }
     }
@@ -2348,7 +2357,7 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
     {
       writeTemporaryTerms(temporary_terms_g2,
                           temp_term_union,
-                          temporary_terms_idxs,
+                          tt_idxs,
                           hessian_tt_output, output_type, tef_terms);
       temp_term_union.insert(temporary_terms_g2.begin(), temporary_terms_g2.end());
 
@@ -2370,7 +2379,7 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
             {
               for_sym << "g2[" << eq + 1 << "," << col_nb + 1 << "]";
               hessian_output << "    @inbounds " << for_sym.str() << " = ";
-              d2->writeOutput(hessian_output, output_type, temp_term_union, temporary_terms_idxs, tef_terms);
+              d2->writeOutput(hessian_output, output_type, temp_term_union, tt_idxs, tef_terms);
               hessian_output << endl;
             }
           else
@@ -2383,7 +2392,7 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
 
               sparseHelper(2, hessian_output, k, 2, output_type);
               hessian_output << "=";
-              d2->writeOutput(hessian_output, output_type, temp_term_union, temporary_terms_idxs, tef_terms);
+              d2->writeOutput(hessian_output, output_type, temp_term_union, tt_idxs, tef_terms);
               hessian_output << ";" << endl;
 
               k++;
@@ -2417,7 +2426,7 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
     {
       writeTemporaryTerms(temporary_terms_g3,
                           temp_term_union,
-                          temporary_terms_idxs,
+                          tt_idxs,
                           third_derivatives_tt_output, output_type, tef_terms);
       temp_term_union.insert(temporary_terms_g3.begin(), temporary_terms_g3.end());
 
@@ -2440,7 +2449,7 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
             {
               for_sym << "g3[" << eq + 1 << "," << ref_col + 1 << "]";
               third_derivatives_output << "    @inbounds " << for_sym.str() << " = ";
-              d3->writeOutput(third_derivatives_output, output_type, temp_term_union, temporary_terms_idxs, tef_terms);
+              d3->writeOutput(third_derivatives_output, output_type, temp_term_union, tt_idxs, tef_terms);
               third_derivatives_output << endl;
             }
           else
@@ -2453,7 +2462,7 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
 
               sparseHelper(3, third_derivatives_output, k, 2, output_type);
               third_derivatives_output << "=";
-              d3->writeOutput(third_derivatives_output, output_type, temp_term_union, temporary_terms_idxs, tef_terms);
+              d3->writeOutput(third_derivatives_output, output_type, temp_term_union, tt_idxs, tef_terms);
               third_derivatives_output << ";" << endl;
             }
 
@@ -2565,6 +2574,9 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
 
       writeDynamicMatlabCompatLayer(basename);
     }
+  else if (output_type == ExprNodeOutputType::CDynamicModelSplit)
+    writeDynamicCShards(basename, nshards, DynamicOutput, tt_slots, tt_digests,
+                        model_output, jacobian_output, hessian_output, third_derivatives_output);
   else if (output_type == ExprNodeOutputType::CDynamicModel)
     {
       DynamicOutput << "void Dynamic(double *y, double *x, int nb_row_x, double *params, double *steady_state, int it_, double *residual, double *g1, double *v2, double *v3)" << endl
@@ -2812,6 +2824,385 @@ DynamicModel::writeDynamicModel(const string &basename, ostream &DynamicOutput,
     }
 }
 
+vector<tuple<int, expr_t, expr_t>>
+DynamicModel::splitTemporaryTerms() const
+{
+  vector<tuple<int, expr_t, expr_t>> result;
+  for (auto it : temporary_terms_mlv)
+    result.emplace_back(0, it.first, it.second);
+
+  const temporary_terms_t *tt_by_order[4] = { &temporary_terms_res, &temporary_terms_g1,
+                                              &temporary_terms_g2, &temporary_terms_g3 };
+  bool order_present[4] = { true, !first_derivatives.empty(),
+                            !second_derivatives.empty(), !third_derivatives.empty() };
+  for (int order = 0; order < 4; order++)
+    if (order_present[order])
+      for (auto it : *tt_by_order[order])
+        result.emplace_back(order, it, it);
+  return result;
+}
+
+map<string, string>
+DynamicModel::readManifest(const string &filename, const string &entry_type)
+{
+  map<string, string> entries;
+  ifstream manifest_input(filename, ios::in | ios::binary);
+  string type, key, value;
+  while (manifest_input >> type >> key >> value)
+    if (type == entry_type)
+      entries[key] = value;
+  return entries;
+}
+
+void
+DynamicModel::assignTemporaryTermsSlots(const string &basename, temporary_terms_idxs_t &tt_slots,
+                                        map<expr_t, string> &tt_digests) const
+{
+  /* The digest of a temporary term is the SHA-256 of its code, in which the
+     temporary terms that it uses are numbered in the order of their own
+     digests, followed by these digests. It thus identifies the computation
+     independently of the numbering of nodes. */
+  vector<expr_t> tt_in_order;
+  temporary_terms_t tt_written;
+  map<int, expr_t> tt_by_idx;
+  deriv_node_temp_terms_t tef_terms;
+  for (const auto &it : splitTemporaryTerms())
+    {
+      expr_t term, expression;
+      tie(ignore, term, expression) = it;
+
+      temporary_terms_inuse_t used_idxs;
+      expression->collectTemporary_terms(tt_written, used_idxs, 0);
+      vector<pair<string, expr_t>> used;
+      for (int idx : used_idxs)
+        {
+          expr_t used_term = tt_by_idx.at(idx);
+          used.emplace_back(tt_digests.at(used_term), used_term);
+        }
+      sort(used.begin(), used.end());
+
+      SHA256 sha;
+      temporary_terms_idxs_t local_idxs;
+      for (size_t i = 0; i < used.size(); i++)
+        local_idxs[used[i].second] = i;
+      ostringstream code;
+      // A model local variable is identified by its name
+      if (term != expression)
+        code << symbol_table.getName(dynamic_cast<VariableNode *>(term)->get_symb_id()) << " = ";
+      expression->writeOutput(code, ExprNodeOutputType::CDynamicModelSplit, tt_written, local_idxs, tef_terms);
+      sha.update(code.str());
+      for (const auto &it2 : used)
+        sha.update(" " + it2.first);
+      tt_digests[term] = sha.hexDigest();
+
+      tt_in_order.push_back(term);
+      tt_written.insert(term);
+      tt_by_idx[term->idx] = term;
+    }
+
+  /* Reuse the slot of the previous run for a term with the same digest, so that
+     the code of unchanged equations is written identically */
+  auto old_tt_slots = readManifest(basename + "/model/src/dynamic.manifest", "temporary");
+  set<int> used_slots;
+  vector<expr_t> tt_without_slot;
+  for (auto term : tt_in_order)
+    {
+      auto it = old_tt_slots.find(tt_digests[term]);
+      if (it != old_tt_slots.end() && used_slots.insert(stoi(it->second)).second)
+        tt_slots[term] = stoi(it->second);
+      else
+        tt_without_slot.push_back(term);
+    }
+  int free_slot = 0;
+  for (auto term : tt_without_slot)
+    {
+      while (used_slots.find(free_slot) != used_slots.end())
+        free_slot++;
+      tt_slots[term] = free_slot;
+      used_slots.insert(free_slot);
+    }
+}
+
+void
+DynamicModel::writeDynamicCShards(const string &basename, int nshards, ostream &DynamicOutput,
+                                  const temporary_terms_idxs_t &tt_slots, const map<expr_t, string> &tt_digests,
+                                  const ostringstream &model_output, const ostringstream &jacobian_output,
+                                  const ostringstream &hessian_output, const ostringstream &third_derivatives_output) const
+{
+  const string dirname = basename + "/model/src";
+  const string manifest_filename = dirname + "/dynamic.manifest";
+  const string function_args = "(double *y, double *x, int nb_row_x, double *params, double *steady_state, int it_, double *T, double *residual, double *g1, double *v2, double *v3)";
+  deriv_node_temp_terms_t tef_terms;
+
+  /* Write the temporary terms as assignments to their slot in T (and not as
+     declarations of local variables, as in writeTemporaryTerms()), since they
+     are shared by several functions */
+  ostringstream tt_output[4];
+  temporary_terms_t tt_written;
+  for (const auto &it : splitTemporaryTerms())
+    {
+      int order;
+      expr_t term, expression;
+      tie(order, term, expression) = it;
+      tt_output[order] << "T[" << tt_slots.at(term) << "] = ";
+      expression->writeOutput(tt_output[order], ExprNodeOutputType::CDynamicModelSplit, tt_written, tt_slots, tef_terms);
+      tt_output[order] << ";" << endl;
+      tt_written.insert(term);
+    }
+  int tt_nbr = 0;
+  for (const auto &it : tt_slots)
+    tt_nbr = max(tt_nbr, it.second + 1);
+
+  auto old_digests = readManifest(manifest_filename, "file");
+  map<string, string> new_digests;
+
+  bool order_present[4] = { true, !first_derivatives.empty(),
+                            !second_derivatives.empty(), !third_derivatives.empty() };
+
+  /* Split each section (temporary terms or equations of a given derivation
+     order) into functions. A function ends after a statement whose checksum is
+     a multiple of a given power of two (or when it becomes much larger than
+     expected), so that a local modification of the model only changes the
+     functions that contain it. Since the functions are called in order,
+     dependencies between statements are preserved. */
+  const string section_names[4] = { "resid", "g1", "g2", "g3" };
+  const string section_outputs[4] = { model_output.str(), jacobian_output.str(),
+                                      hessian_output.str(), third_derivatives_output.str() };
+  size_t total_size = 0, statements_nbr = 0;
+  for (int order = 0; order < 4; order++)
+    if (order_present[order])
+      {
+        string tt_section = tt_output[order].str();
+        total_size += tt_section.size() + section_outputs[order].size();
+        statements_nbr += count(tt_section.begin(), tt_section.end(), '\n')
+          + count(section_outputs[order].begin(), section_outputs[order].end(), '\n');
+      }
+  // Aim at 64 functions per file, so that files have roughly the same size
+  unsigned int statements_per_function = 1;
+  while (2 * statements_per_function * 64 * nshards <= statements_nbr)
+    statements_per_function *= 2;
+  size_t max_function_size = 4 * max<size_t>(total_size / (64 * nshards), 1);
+
+  vector<string> function_names, function_bodies;
+  vector<int> function_orders;
+  vector<bool> function_residuals;
+  set<string> used_function_names;
+  for (int order = 0; order < 4; order++)
+    {
+      if (!order_present[order])
+        continue;
+      for (int is_tt = 1; is_tt >= 0; is_tt--)
+        {
+          istringstream section(is_tt ? tt_output[order].str() : section_outputs[order]);
+          string line, statement, body;
+          while (getline(section, line))
+            {
+              statement += line + "\n";
+              /* The computation of a residual spans several statements, linked
+                 by the lhs and rhs local variables */
+              if (!is_tt && order == 0 && line.compare(0, 8, "residual") != 0)
+                continue;
+              body += statement;
+              if (stringChecksum(statement) % statements_per_function == 0
+                  || body.size() >= max_function_size || section.peek() == EOF)
+                {
+                  // Name the function after its code, so that the name does not depend on the other functions
+                  ostringstream name;
+                  name << "dynamic_" << section_names[order] << (is_tt ? "_tt_" : "_")
+                       << hex << stringChecksum(body);
+                  string unique_name = name.str();
+                  for (int i = 2; !used_function_names.insert(unique_name).second; i++)
+                    unique_name = name.str() + "_" + to_string(i);
+                  function_names.push_back(unique_name);
+                  function_bodies.push_back(body);
+                  function_orders.push_back(order);
+                  function_residuals.push_back(!is_tt && order == 0);
+                  body.clear();
+                }
+              statement.clear();
+            }
+        }
+    }
+
+  // Put each function in a file chosen from its checksum, and write the files that have changed
+  vector<string> shard_contents(nshards);
+  for (size_t i = 0; i < function_names.size(); i++)
+    {
+      string &content = shard_contents[stringChecksum(function_bodies[i]) % nshards];
+      content += "\nvoid\n" + function_names[i] + function_args + "\n{\n";
+      if (function_residuals[i])
+        content += "  double lhs, rhs;\n\n";
+      content += function_bodies[i] + "}\n";
+    }
+
+  vector<string> shard_filenames;
+  for (int shard = 0; shard < nshards; shard++)
+    {
+      string filename = "dynamic_" + to_string(shard + 1) + ".c";
+      if (shard_contents[shard].empty())
+        {
+          boost::filesystem::remove(dirname + "/" + filename);
+          continue;
+        }
+      ostringstream content;
+      content << "/*" << endl
+              << " * " << dirname << "/" << filename << " : Computes part of the dynamic model for Dynare" << endl
+              << " *" << endl
+              << " * Warning : this file is generated automatically by Dynare" << endl
+              << " *           from model file (.mod)" << endl
+              << " */" << endl
+              << "#include \"dynamic.h\"" << endl
+              << shard_contents[shard];
+      writeFileIfChanged(dirname + "/" + filename, content.str(), old_digests, new_digests);
+      shard_filenames.push_back(filename);
+    }
+
+  // Remove the translation units of a previous run, whose number of shards may have been larger
+  for (boost::filesystem::directory_iterator it(dirname), end; it != end; ++it)
+    {
+      string filename = it->path().filename().string();
+      if (filename.size() > 10 && filename.compare(0, 8, "dynamic_") == 0
+          && filename.compare(filename.size() - 2, 2, ".c") == 0
+          && filename.find_first_not_of("0123456789", 8) == filename.size() - 2
+          && stoi(filename.substr(8)) > nshards)
+        boost::filesystem::remove(it->path());
+    }
+
+  // Header shared by all translation units
+  ostringstream header_output;
+  header_output << "/*" << endl
+                << " * " << dirname << "/dynamic.h : Declarations shared by the files of the dynamic model for Dynare" << endl
+                << " *" << endl
+                << " * Warning : this file is generated automatically by Dynare" << endl
+                << " *           from model file (.mod)" << endl
+                << " */" << endl
+                << "#ifndef _DYNAMIC_H" << endl
+                << "#define _DYNAMIC_H" << endl << endl
+#if defined(_WIN32) || defined(__CYGWIN32__) || defined(__MINGW32__)
+                << "#ifdef _MSC_VER" << endl
+                << "#define _USE_MATH_DEFINES" << endl
+                << "#endif" << endl
+#endif
+                << "#include <math.h>" << endl;
+  if (external_functions_table.get_total_number_of_unique_model_block_external_functions())
+    header_output << "#include \"mex.h\"" << endl;
+  header_output << "#include <stdlib.h>" << endl
+                << "#define max(a, b) (((a) > (b)) ? (a) : (b))" << endl
+                << "#define min(a, b) (((a) > (b)) ? (b) : (a))" << endl;
+  writePowerDerivCHeader(header_output);
+  writeNormcdfCHeader(header_output);
+  header_output << endl
+                << "#endif" << endl;
+  writeFileIfChanged(dirname + "/dynamic.h", header_output.str(), old_digests, new_digests);
+
+  /* Makefile building the MEX files from the translation units, with the mex
+     command of MATLAB or Octave (see ModFile::writeOutputFiles()) */
+  ostringstream makefile_output;
+  makefile_output << "# Builds the MEX files of the model, compiling the translation units of the dynamic model in parallel:" << endl
+                  << "#   make -f dynamic.mk -jN MEX=<mex command> MEXOUTPUT=<output option of mex> MEXEXT=<extension of MEX files> [dynamic] [static]" << endl
+                  << "#" << endl
+                  << "# Warning : this file is generated automatically by Dynare" << endl
+                  << "#           from model file (.mod)" << endl << endl
+                  << "MEX ?= mex" << endl
+                  << "MEXOUTPUT ?= -output" << endl
+                  << "MEXEXT ?= mexa64" << endl
+                  << "OUTPUT_DIR = ../../../+" << basename << endl << endl
+                  << "DYNAMIC_SRCS = dynamic.c dynamic_mex.c";
+  for (const auto &shard_filename : shard_filenames)
+    makefile_output << " " << shard_filename;
+  makefile_output << endl
+                  << "DYNAMIC_OBJS = $(DYNAMIC_SRCS:.c=.o)" << endl
+                  << "STATIC_OBJS = static.o static_mex.o" << endl << endl
+                  << "all: dynamic" << endl << endl
+                  << "dynamic: $(OUTPUT_DIR)/dynamic.$(MEXEXT)" << endl << endl
+                  << "static: $(OUTPUT_DIR)/static.$(MEXEXT)" << endl << endl
+                  << "$(OUTPUT_DIR)/dynamic.$(MEXEXT): $(DYNAMIC_OBJS)" << endl
+                  << "	$(MEX) $(MEXOUTPUT) $(OUTPUT_DIR)/dynamic $(DYNAMIC_OBJS)" << endl << endl
+                  << "$(OUTPUT_DIR)/static.$(MEXEXT): $(STATIC_OBJS)" << endl
+                  << "	$(MEX) $(MEXOUTPUT) $(OUTPUT_DIR)/static $(STATIC_OBJS)" << endl << endl
+                  << "%.o: %.c dynamic.h" << endl
+                  << "	$(MEX) -c $<" << endl << endl
+                  << ".PHONY: all dynamic static" << endl;
+  writeFileIfChanged(dirname + "/dynamic.mk", makefile_output.str(), old_digests, new_digests);
+
+  // Manifest for the next run
+  ofstream manifest_output(manifest_filename, ios::out | ios::binary);
+  if (!manifest_output.is_open())
+    {
+      cerr << "Error: Can't open file " << manifest_filename << " for writing" << endl;
+      exit(EXIT_FAILURE);
+    }
+  for (const auto &it : tt_digests)
+    manifest_output << "temporary " << it.second << " " << tt_slots.at(it.first) << endl;
+  for (const auto &it : new_digests)
+    manifest_output << "file " << it.first << " " << it.second << endl;
+  manifest_output.close();
+
+  // The Dynamic() function calls the others, in the order of the single file version
+  for (const auto &function_name : function_names)
+    DynamicOutput << "void " << function_name << function_args << ";" << endl;
+  DynamicOutput << endl
+                << "void Dynamic(double *y, double *x, int nb_row_x, double *params, double *steady_state, int it_, double *residual, double *g1, double *v2, double *v3)" << endl
+                << "{" << endl
+                << "  double *T = (double *) malloc(" << max(tt_nbr, 1) << " * sizeof(double));" << endl;
+  const string guard_comments[4] = { "Residual equations", "Jacobian ",
+                                     "Hessian for endogenous and exogenous variables",
+                                     "Third derivatives for endogenous and exogenous variables" };
+  const string guard_args[4] = { "", "g1", "v2", "v3" };
+  int last_order = -1;
+  for (size_t i = 0; i < function_names.size(); i++)
+    {
+      int order = function_orders[i];
+      if (order != last_order)
+        {
+          DynamicOutput << endl
+                        << "  /* " << guard_comments[order] << " */" << endl;
+          if (order > 0)
+            DynamicOutput << "  if (" << guard_args[order] << " == NULL)" << endl
+                          << "    {" << endl
+                          << "      free(T);" << endl
+                          << "      return;" << endl
+                          << "    }" << endl;
+          last_order = order;
+        }
+      DynamicOutput << "  " << function_names[i] << "(y, x, nb_row_x, params, steady_state, it_, T, residual, g1, v2, v3);" << endl;
+    }
+  DynamicOutput << endl
+                << "  free(T);" << endl
+                << "}" << endl << endl;
+}
+
+unsigned int
+DynamicModel::stringChecksum(const string &str)
+{
+  boost::crc_32_type result;
+  result.process_bytes(str.data(), str.size());
+  return result.checksum();
+}
+
+void
+DynamicModel::writeFileIfChanged(const string &filename, const string &content,
+                                 const map<string, string> &old_digests,
+                                 map<string, string> &new_digests)
+{
+  string name = boost::filesystem::path(filename).filename().string();
+  string digest = SHA256::digest(content);
+  new_digests[name] = digest;
+
+  auto it = old_digests.find(name);
+  if (it != old_digests.end() && it->second == digest && boost::filesystem::exists(filename))
+    return;
+
+  ofstream output(filename, ios::out | ios::binary);
+  if (!output.is_open())
+    {
+      cerr << "Error: Can't open file " << filename << " for writing" << endl;
+      exit(EXIT_FAILURE);
+    }
+  output << content;
+  output.close();
+}
+
 void
 DynamicModel::writeOutput(ostream &output, const string &basename, bool block_decomposition, bool byte_code, bool use_dll, int order, bool estimation_present, bool compute_xrefs, bool julia) const
 {
@@ -4162,6 +4553,21 @@ DynamicModel::computingPass(bool jacobianExo, bool hessian, bool thirdDerivative
         vars.insert(it->second);
     }
 
+  // Try to restore the derivatives and temporary terms from a previous run
+  string cache_key;
+  if (!computing_pass_cache.empty() && !block)
+    {
+      cache_key = computingPassCacheKey(vars, hessian, thirdDerivatives, paramsDerivsOrder, no_tmp_terms, !use_dll);
+      if (readComputingPassCache(cache_key))
+        {
+          if (!nopreprocessoroutput)
+            cout << "Dynamic model derivatives restored from " << computing_pass_cache << endl;
+          if (!no_tmp_terms && bytecode)
+            computeTemporaryTermsMapping();
+          return;
+        }
+    }
+
   // Launch computations
   if (!nopreprocessoroutput)
     cout << "Computing dynamic model derivatives:" << endl
@@ -4192,8 +4598,13 @@ DynamicModel::computingPass(bool jacobianExo, bool hessian, bool thirdDerivative
       computeThirdDerivatives(vars);
     }
 
+  // Free the datatrees used for computing the derivatives in parallel
+  freeDerivationWorkers();
+
   if (block)
     {
+      Profiler::Phase phase("block decomposition");
+
       vector<unsigned int> n_static, n_forward, n_backward, n_mixed;
       jacob_map_t contemporaneous_jacobian, static_jacobian;
 
@@ -4247,12 +4658,16 @@ DynamicModel::computingPass(bool jacobianExo, bool hessian, bool thirdDerivative
         }
     }
   else
-    if (!no_tmp_terms)
-      {
-        computeTemporaryTerms(!use_dll);
-        if (bytecode)
-          computeTemporaryTermsMapping();
-      }
+    {
+      if (!no_tmp_terms)
+        {
+          computeTemporaryTerms(!use_dll);
+          if (bytecode)
+            computeTemporaryTermsMapping();
+        }
+      if (!computing_pass_cache.empty())
+        writeComputingPassCache(cache_key);
+    }
 }
 
 void
@@ -4647,7 +5062,7 @@ DynamicModel::collectBlockVariables()
 }
 
 void
-DynamicModel::writeDynamicFile(const string &basename, bool block, bool bytecode, bool use_dll, int order, bool julia) const
+DynamicModel::writeDynamicFile(const string &basename, bool block, bool bytecode, bool use_dll, int order, bool julia, int dll_shards) const
 {
   if (block && bytecode)
     writeModelEquationsCode_Block(basename, map_idx);
@@ -4656,7 +5071,7 @@ DynamicModel::writeDynamicFile(const string &basename, bool block, bool bytecode
   else if (block && !bytecode)
     writeSparseDynamicMFile(basename);
   else if (use_dll)
-    writeDynamicCFile(basename, order);
+    writeDynamicCFile(basename, order, dll_shards);
   else if (julia)
     writeDynamicJuliaFile(basename);
   else
@@ -4865,6 +5280,7 @@ DynamicModel::toStatic(StaticModel &static_model) const
     static_model.AddLocalVariable(it, local_variables_table.find(it)->second->toStatic(static_model));
 
   // Convert equations
+  ExprNode::expr_memo_t memo;
   int static_only_index = 0;
   for (int i = 0; i < (int) equations.size(); i++)
     {
@@ -4884,11 +5300,11 @@ DynamicModel::toStatic(StaticModel &static_model) const
           // If yes, replace it by an equation marked [static]
           if (is_dynamic_only)
             {
-              static_model.addEquation(static_only_equations[static_only_index]->toStatic(static_model), static_only_equations_lineno[static_only_index], static_only_equations_equation_tags[static_only_index]);
+              static_model.addEquation(static_only_equations[static_only_index]->toStatic(static_model, memo), static_only_equations_lineno[static_only_index], static_only_equations_equation_tags[static_only_index]);
               static_only_index++;
             }
           else
-            static_model.addEquation(equations[i]->toStatic(static_model), equations_lineno[i], eq_tags);
+            static_model.addEquation(equations[i]->toStatic(static_model, memo), equations_lineno[i], eq_tags);
         }
       catch (DataTree::DivisionByZeroException)
         {
@@ -4899,7 +5315,7 @@ DynamicModel::toStatic(StaticModel &static_model) const
 
   // Convert auxiliary equations
   for (auto aux_equation : aux_equations)
-    static_model.addAuxEquation(aux_equation->toStatic(static_model));
+    static_model.addAuxEquation(aux_equation->toStatic(static_model, memo));
 }
 
 bool
@@ -5161,36 +5577,59 @@ DynamicModel::getDynJacobianCol(int deriv_id) const noexcept(false)
 void
 DynamicModel::testTrendDerivativesEqualToZero(const eval_context_t &eval_context)
 {
-  for (deriv_id_table_t::const_iterator it = deriv_id_table.begin();
-       it != deriv_id_table.end(); it++)
-    if (symbol_table.getType(it->first.first) == SymbolType::trend
-        || symbol_table.getType(it->first.first) == SymbolType::logTrend)
-      for (int eq = 0; eq < (int) equations.size(); eq++)
-        {
-          expr_t homogeneq = AddMinus(equations[eq]->get_arg1(),
-                                      equations[eq]->get_arg2());
+  vector<int> trend_deriv_ids;
+  for (const auto &it : deriv_id_table)
+    if (symbol_table.getType(it.first.first) == SymbolType::trend
+        || symbol_table.getType(it.first.first) == SymbolType::logTrend)
+      trend_deriv_ids.push_back(it.second);
+  if (trend_deriv_ids.empty())
+    return;
 
-          // Do not run the test if the term inside the log is zero
-          if (fabs(homogeneq->eval(eval_context)) > zero_band)
-            {
-              expr_t testeq = AddLog(homogeneq); // F = log(lhs-rhs)
-              testeq = testeq->getDerivative(it->second); // d F / d Trend
-              for (deriv_id_table_t::const_iterator endogit = deriv_id_table.begin();
-                   endogit != deriv_id_table.end(); endogit++)
-                if (symbol_table.getType(endogit->first.first) == SymbolType::endogenous)
-                  {
-                    double nearZero = testeq->getDerivative(endogit->second)->eval(eval_context); // eval d F / d Trend d Endog
-                    if (fabs(nearZero) > zero_band)
-                      {
-                        cerr << "WARNING: trends not compatible with balanced growth path; the second-order cross partial of equation " << eq + 1 << " (line "
-                             << equations_lineno[eq] << ") w.r.t. trend variable "
-                             << symbol_table.getName(it->first.first) << " and endogenous variable "
-                             << symbol_table.getName(endogit->first.first) << " is not null. " << endl;
-                        // Changed to warning. See discussion in #1389
-                      }
-                  }
-            }
+  // Evaluate all the equations at once, then all the cross derivatives at once
+  EvalTape homogeneq_tape;
+  vector<expr_t> homogeneqs;
+  vector<int> homogeneq_slots;
+  for (auto equation : equations)
+    {
+      homogeneqs.push_back(AddMinus(equation->get_arg1(), equation->get_arg2()));
+      homogeneq_slots.push_back(homogeneq_tape.add(homogeneqs.back()));
+    }
+  homogeneq_tape.eval(eval_context);
+
+  EvalTape tape;
+  vector<tuple<int, int, int, int>> tests; // Trend deriv_id, equation, endogenous deriv_id, slot
+  for (int trend_deriv_id : trend_deriv_ids)
+    for (int eq = 0; eq < (int) equations.size(); eq++)
+      {
+        expr_t homogeneq = homogeneqs[eq];
+
+        // Do not run the test if the term inside the log is zero
+        if (fabs(homogeneq_tape.getValue(homogeneq_slots[eq])) > zero_band)
+          {
+            expr_t testeq = AddLog(homogeneq); // F = log(lhs-rhs)
+            testeq = testeq->getDerivative(trend_deriv_id); // d F / d Trend
+            for (const auto &endogit : deriv_id_table)
+              if (symbol_table.getType(endogit.first.first) == SymbolType::endogenous)
+                tests.emplace_back(trend_deriv_id, eq, endogit.second,
+                                   tape.add(testeq->getDerivative(endogit.second))); // d F / d Trend d Endog
+          }
+      }
+  tape.eval(eval_context);
+
+  for (const auto &test : tests)
+    {
+      int trend_deriv_id, eq, endo_deriv_id, slot;
+      tie(trend_deriv_id, eq, endo_deriv_id, slot) = test;
+      double nearZero = tape.getValue(slot);
+      if (fabs(nearZero) > zero_band)
+        {
+          cerr << "WARNING: trends not compatible with balanced growth path; the second-order cross partial of equation " << eq + 1 << " (line "
+               << equations_lineno[eq] << ") w.r.t. trend variable "
+               << symbol_table.getName(getSymbIDByDerivID(trend_deriv_id)) << " and endogenous variable "
+               << symbol_table.getName(getSymbIDByDerivID(endo_deriv_id)) << " is not null. " << endl;
+          // Changed to warning. See discussion in #1389
         }
+    }
 }
 
 void
@@ -5513,25 +5952,26 @@ DynamicModel::substituteLeadLagInternal(AuxVarType type, bool deterministic_mode
     }
 
   // Substitute in equations
+  ExprNode::expr_memo_t memo;
   for (auto & equation : equations)
     {
       expr_t subst;
       switch (type)
         {
         case AuxVarType::endoLead:
-          subst = equation->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model);
+          subst = equation->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo);
           break;
         case AuxVarType::endoLag:
-          subst = equation->substituteEndoLagGreaterThanTwo(subst_table, neweqs);
+          subst = equation->substituteEndoLagGreaterThanTwo(subst_table, neweqs, memo);
           break;
         case AuxVarType::exoLead:
-          subst = equation->substituteExoLead(subst_table, neweqs, deterministic_model);
+          subst = equation->substituteExoLead(subst_table, neweqs, deterministic_model, memo);
           break;
         case AuxVarType::exoLag:
-          subst = equation->substituteExoLag(subst_table, neweqs);
+          subst = equation->substituteExoLag(subst_table, neweqs, memo);
           break;
         case AuxVarType::diffForward:
-          subst = equation->differentiateForwardVars(subset, subst_table, neweqs);
+          subst = equation->differentiateForwardVars(subset, subst_table, neweqs, memo);
           break;
         default:
           cerr << "DynamicModel::substituteLeadLagInternal: impossible case" << endl;
@@ -5586,8 +6026,9 @@ DynamicModel::substituteLeadLagInternal(AuxVarType type, bool deterministic_mode
 void
 DynamicModel::substituteAdl()
 {
+  ExprNode::expr_memo_t memo;
   for (auto & equation : equations)
-    equation = dynamic_cast<BinaryOpNode *>(equation->substituteAdl());
+    equation = dynamic_cast<BinaryOpNode *>(equation->substituteAdl(memo));
 }
 
 void
@@ -5648,8 +6089,9 @@ DynamicModel::substituteUnaryOps(StaticModel &static_model, vector<int> &eqnumbe
     if (used_local_vars.find(it.first) != used_local_vars.end())
       it.second->findUnaryOpNodesForAuxVarCreation(static_model, nodes);
 
+  ExprNode::visited_set_t visited;
   for (int eqnumber : eqnumbers)
-    equations[eqnumber]->findUnaryOpNodesForAuxVarCreation(static_model, nodes);
+    equations[eqnumber]->findUnaryOpNodesForAuxVarCreation(static_model, nodes, visited);
 
   // Substitute in model local variables
   ExprNode::subst_table_t subst_table;
@@ -5658,10 +6100,11 @@ DynamicModel::substituteUnaryOps(StaticModel &static_model, vector<int> &eqnumbe
     it.second = it.second->substituteUnaryOpNodes(static_model, nodes, subst_table, neweqs);
 
   // Substitute in equations
+  ExprNode::expr_memo_t memo;
   for (auto & equation : equations)
     {
       auto *substeq = dynamic_cast<BinaryOpNode *>(equation->
-                                                   substituteUnaryOpNodes(static_model, nodes, subst_table, neweqs));
+                                                   substituteUnaryOpNodes(static_model, nodes, subst_table, neweqs, memo));
       assert(substeq != nullptr);
       equation = substeq;
     }
@@ -5689,8 +6132,9 @@ DynamicModel::substituteDiff(StaticModel &static_model, ExprNode::subst_table_t
     if (used_local_vars.find(it.first) != used_local_vars.end())
       it.second->findDiffNodes(static_model, diff_table);
 
+  ExprNode::visited_set_t visited;
   for (const auto & equation : equations)
-    equation->findDiffNodes(static_model, diff_table);
+    equation->findDiffNodes(static_model, diff_table, visited);
 
   /* Ensure that all diff operators appear once with their argument at current
      period (i.e. maxLag=0).
@@ -5721,10 +6165,11 @@ DynamicModel::substituteDiff(StaticModel &static_model, ExprNode::subst_table_t
     it.second = it.second->substituteDiff(static_model, diff_table, diff_subst_table, neweqs);
 
   // Substitute in equations
+  ExprNode::expr_memo_t memo;
   for (auto & equation : equations)
     {
       auto *substeq = dynamic_cast<BinaryOpNode *>(equation->
-                                                   substituteDiff(static_model, diff_table, diff_subst_table, neweqs));
+                                                   substituteDiff(static_model, diff_table, diff_subst_table, neweqs, memo));
       assert(substeq != nullptr);
       equation = substeq;
     }
@@ -5750,9 +6195,10 @@ DynamicModel::substituteExpectation(bool partial_information_model)
     it.second = it.second->substituteExpectation(subst_table, neweqs, partial_information_model);
 
   // Substitute in equations
+  ExprNode::expr_memo_t memo;
   for (auto & equation : equations)
     {
-      auto *substeq = dynamic_cast<BinaryOpNode *>(equation->substituteExpectation(subst_table, neweqs, partial_information_model));
+      auto *substeq = dynamic_cast<BinaryOpNode *>(equation->substituteExpectation(subst_table, neweqs, partial_information_model, memo));
       assert(substeq != nullptr);
       equation = substeq;
     }
@@ -5779,9 +6225,10 @@ DynamicModel::transformPredeterminedVariables()
   for (auto & it : local_variables_table)
     it.second = it.second->decreaseLeadsLagsPredeterminedVariables();
 
+  ExprNode::expr_memo_t memo;
   for (auto & equation : equations)
     {
-      auto *substeq = dynamic_cast<BinaryOpNode *>(equation->decreaseLeadsLagsPredeterminedVariables());
+      auto *substeq = dynamic_cast<BinaryOpNode *>(equation->decreaseLeadsLagsPredeterminedVariables(memo));
       assert(substeq != nullptr);
       equation = substeq;
     }
@@ -5793,16 +6240,20 @@ DynamicModel::detrendEquations()
   // We go backwards in the list of trend_vars, to deal correctly with I(2) processes
   for (nonstationary_symbols_map_t::const_reverse_iterator it = nonstationary_symbols_map.rbegin();
        it != nonstationary_symbols_map.rend(); ++it)
-    for (auto & equation : equations)
-      {
-        auto *substeq = dynamic_cast<BinaryOpNode *>(equation->detrend(it->first, it->second.first, it->second.second));
-        assert(substeq != nullptr);
-        equation = dynamic_cast<BinaryOpNode *>(substeq);
-      }
+    {
+      ExprNode::expr_memo_t memo;
+      for (auto & equation : equations)
+        {
+          auto *substeq = dynamic_cast<BinaryOpNode *>(equation->detrend(it->first, it->second.first, it->second.second, memo));
+          assert(substeq != nullptr);
+          equation = dynamic_cast<BinaryOpNode *>(substeq);
+        }
+    }
 
+  ExprNode::expr_memo_t memo;
   for (auto & equation : equations)
     {
-      BinaryOpNode *substeq = dynamic_cast<BinaryOpNode *>(equation->removeTrendLeadLag(trend_symbols_map));
+      BinaryOpNode *substeq = dynamic_cast<BinaryOpNode *>(equation->removeTrendLeadLag(trend_symbols_map, memo));
       assert(substeq != nullptr);
       equation = dynamic_cast<BinaryOpNode *>(substeq);
     }
@@ -5811,9 +6262,10 @@ DynamicModel::detrendEquations()
 void
 DynamicModel::removeTrendVariableFromEquations()
 {
+  ExprNode::expr_memo_t memo;
   for (auto & equation : equations)
     {
-      auto *substeq = dynamic_cast<BinaryOpNode *>(equation->replaceTrendVar());
+      auto *substeq = dynamic_cast<BinaryOpNode *>(equation->replaceTrendVar(memo));
       assert(substeq != nullptr);
       equation = dynamic_cast<BinaryOpNode *>(substeq);
     }
@@ -5828,43 +6280,31 @@ DynamicModel::differentiateForwardVars(const vector<string> &subset)
 void
 DynamicModel::fillEvalContext(eval_context_t &eval_context) const
 {
+  /* Values that cannot be evaluated are left out of the context. The tape
+     shares the subexpressions common to several of these expressions */
+  EvalTape tape;
+
   // First, auxiliary variables
   for (auto aux_equation : aux_equations)
     {
       assert(aux_equation->get_op_code() == BinaryOpcode::equal);
       auto *auxvar = dynamic_cast<VariableNode *>(aux_equation->get_arg1());
       assert(auxvar != nullptr);
-      try
-        {
-          double val = aux_equation->get_arg2()->eval(eval_context);
-          eval_context[auxvar->get_symb_id()] = val;
-        }
-      catch (ExprNode::EvalException &e)
-        {
-          // Do nothing
-        }
+      tape.addAssignment(auxvar->get_symb_id(), aux_equation->get_arg2());
     }
 
   // Second, model local variables
   for (auto it : local_variables_table)
-    {
-      try
-        {
-          const expr_t expression = it.second;
-          double val = expression->eval(eval_context);
-          eval_context[it.first] = val;
-        }
-      catch (ExprNode::EvalException &e)
-        {
-          // Do nothing
-        }
-    }
+    tape.addAssignment(it.first, it.second);
+
+  tape.eval(eval_context);
+  tape.writeAssignments(eval_context);
 
   //Third, trend variables
   vector <int> trendVars = symbol_table.getTrendVarIds();
   for (vector <int>::const_iterator it = trendVars.begin();
        it != trendVars.end(); it++)
-    eval_context[*it] = 2;                               //not <= 0 bc of log, not 1 bc of powers
+    eval_context.set(*it, 2);                            //not <= 0 bc of log, not 1 bc of powers
 }
 
 bool
@@ -5914,89 +6354,70 @@ DynamicModel::dynamicOnlyEquationsNbr() const
 }
 
 bool
-DynamicModel::isChecksumMatching(const string &basename) const
+DynamicModel::isChecksumMatching(const string &basename, const string &options) const
 {
-  boost::crc_32_type result;
-
-  std::stringstream buffer;
-
-  // Write equation tags
-  for (const auto & equation_tag : equation_tags)
-    buffer << "  " << equation_tag.first + 1
-           << equation_tag.second.first
-           << equation_tag.second.second;
-
-  ExprNodeOutputType buffer_type = ExprNodeOutputType::CDynamicModel;
-
+  /* The entries are SHA-256 digests of the code of the equations, in which
+     the variables appear through the indices under which they are written, and
+     of the symbol table. Reordering the declarations therefore changes the
+     manifest, as does any change of the emitted code. The derivatives follow
+     from the equations, the symbol table and the orders of derivation, which
+     are given by the numbers of derivatives. */
+  ostringstream manifest;
+  manifest << "options " << options << endl;
+
+  SHA256 symbols_sha;
+  for (int id = 0; id < symbol_table.maxID(); id++)
+    symbols_sha.update(to_string(id) + " " + symbol_table.getName(id) + " "
+                       + to_string(static_cast<int>(symbol_table.getType(id))) + "\n");
+  manifest << "symbols " << symbols_sha.hexDigest() << endl;
+
+  ExprNodeOutputType output_type = ExprNodeOutputType::CDynamicModel;
+  vector<string> equations_code(equations.size());
   for (int eq = 0; eq < (int) equations.size(); eq++)
     {
-      BinaryOpNode *eq_node = equations[eq];
-      expr_t lhs = eq_node->get_arg1();
-      expr_t rhs = eq_node->get_arg2();
-
-      // Test if the right hand side of the equation is empty.
-      double vrhs = 1.0;
-      try
-        {
-          vrhs = rhs->eval(eval_context_t());
-        }
-      catch (ExprNode::EvalException &e)
-        {
-        }
-
-      if (vrhs != 0) // The right hand side of the equation is not empty ==> residual=lhs-rhs;
-        {
-          buffer << "lhs =";
-          lhs->writeOutput(buffer, buffer_type, temporary_terms, temporary_terms_idxs);
-          buffer << ";" << endl;
-
-          buffer << "rhs =";
-          rhs->writeOutput(buffer, buffer_type, temporary_terms, temporary_terms_idxs);
-          buffer << ";" << endl;
-
-          buffer << "residual" << LEFT_ARRAY_SUBSCRIPT(buffer_type)
-                 << eq + ARRAY_SUBSCRIPT_OFFSET(buffer_type)
-                 << RIGHT_ARRAY_SUBSCRIPT(buffer_type)
-                 << "= lhs-rhs;" << endl;
-        }
-      else // The right hand side of the equation is empty ==> residual=lhs;
-        {
-          buffer << "residual" << LEFT_ARRAY_SUBSCRIPT(buffer_type)
-                 << eq + ARRAY_SUBSCRIPT_OFFSET(buffer_type)
-                 << RIGHT_ARRAY_SUBSCRIPT(buffer_type)
-                 << " = ";
-          lhs->writeOutput(buffer, buffer_type, temporary_terms, temporary_terms_idxs);
-          buffer << ";" << endl;
-        }
+      ostringstream code;
+      equations[eq]->writeOutput(code, output_type, {}, {}, {});
+      equations_code[eq] = code.str();
     }
+  for (const auto & equation_tag : equation_tags)
+    equations_code[equation_tag.first] += "\n" + equation_tag.second.first + "=" + equation_tag.second.second;
+  for (int eq = 0; eq < (int) equations.size(); eq++)
+    manifest << "equation " << eq + 1 << " " << SHA256::digest(equations_code[eq]) << endl;
 
-  const size_t private_buffer_size{1024};
-  char private_buffer[private_buffer_size];
-  while (buffer)
+  for (const auto & local_variable : local_variables_table)
     {
-      buffer.get(private_buffer, private_buffer_size);
-      result.process_bytes(private_buffer, strlen(private_buffer));
+      ostringstream code;
+      local_variable.second->writeOutput(code, output_type, {}, {});
+      manifest << "local_variable " << symbol_table.getName(local_variable.first)
+               << " " << SHA256::digest(code.str()) << endl;
     }
 
+  manifest << "derivatives " << first_derivatives.size() << " " << second_derivatives.size()
+           << " " << third_derivatives.size() << endl
+           << "params_derivatives " << residuals_params_derivatives.size()
+           << " " << jacobian_params_derivatives.size()
+           << " " << residuals_params_second_derivatives.size()
+           << " " << jacobian_params_second_derivatives.size()
+           << " " << hessian_params_derivatives.size() << endl;
+
   bool basename_dir_exists = !boost::filesystem::create_directory(basename);
 
   // check whether basename directory exist. If not, create it.
-  // If it does, read old checksum if it exist
+  // If it does, read old manifest if it exist
   fstream checksum_file;
   string filename = basename + "/checksum";
-  unsigned int old_checksum = 0;
-  // read old checksum if it exists
+  ostringstream old_manifest;
   if (basename_dir_exists)
     {
       checksum_file.open(filename, ios::in | ios::binary);
       if (checksum_file.is_open())
         {
-          checksum_file >> old_checksum;
+          old_manifest << checksum_file.rdbuf();
           checksum_file.close();
         }
     }
-  // write new checksum file if none or different from old checksum
-  if (old_checksum != result.checksum())
+  // write new manifest if none or different from old manifest
+  if (old_manifest.str() != manifest.str())
     {
       checksum_file.open(filename, ios::out | ios::binary);
       if (!checksum_file.is_open())
@@ -6004,7 +6425,7 @@ DynamicModel::isChecksumMatching(const string &basename) const
           cerr << "ERROR: Can't open file " << filename << endl;
           exit(EXIT_FAILURE);
         }
-      checksum_file << result.checksum();
+      checksum_file << manifest.str();
       checksum_file.close();
       return false;
     }
@@ -6139,12 +6560,6 @@ DynamicModel::writeJsonDynamicModelInfo(ostream &output) const
 void
 DynamicModel::writeJsonComputingPassOutput(ostream &output, bool writeDetails) const
 {
-  ostringstream model_local_vars_output;  // Used for storing model local vars
-  ostringstream model_output;             // Used for storing model temp vars and equations
-  ostringstream jacobian_output;          // Used for storing jacobian equations
-  ostringstream hessian_output;           // Used for storing Hessian equations
-  ostringstream third_derivatives_output; // Used for storing third order derivatives equations
-
   deriv_node_temp_terms_t tef_terms;
   temporary_terms_t temp_term_empty;
   temporary_terms_t temp_term_union = temporary_terms_res;
@@ -6153,26 +6568,33 @@ DynamicModel::writeJsonComputingPassOutput(ostream &output, bool writeDetails) c
   string concat = "";
   int hessianColsNbr = dynJacobianColsNbr * dynJacobianColsNbr;
 
-  writeJsonModelLocalVariables(model_local_vars_output, tef_terms);
+  if (writeDetails)
+    output << "\"dynamic_model\": {";
+  else
+    output << "\"dynamic_model_simple\": {";
+
+  writeJsonModelLocalVariables(output, tef_terms);
 
-  writeJsonTemporaryTerms(temporary_terms_res, temp_term_union_m_1, model_output, tef_terms, concat);
-  model_output << ", ";
-  writeJsonModelEquations(model_output, true);
+  output << ", ";
+  writeJsonTemporaryTerms(temporary_terms_res, temp_term_union_m_1, output, tef_terms, concat);
+  output << ", ";
+  writeJsonModelEquations(output, true);
 
   // Writing Jacobian
   temp_term_union_m_1 = temp_term_union;
   temp_term_union.insert(temporary_terms_g1.begin(), temporary_terms_g1.end());
   concat = "jacobian";
-  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, jacobian_output, tef_terms, concat);
-  jacobian_output << ", \"jacobian\": {"
-                  << "  \"nrows\": " << equations.size()
-                  << ", \"ncols\": " << dynJacobianColsNbr
-                  << ", \"entries\": [";
+  output << ", ";
+  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, output, tef_terms, concat);
+  output << ", \"jacobian\": {"
+         << "  \"nrows\": " << equations.size()
+         << ", \"ncols\": " << dynJacobianColsNbr
+         << ", \"entries\": [";
   for (auto it = first_derivatives.begin();
        it != first_derivatives.end(); it++)
     {
       if (it != first_derivatives.begin())
-        jacobian_output << ", ";
+        output << ", ";
 
       int eq, var;
       tie(eq, var) = it->first;
@@ -6180,36 +6602,37 @@ DynamicModel::writeJsonComputingPassOutput(ostream &output, bool writeDetails) c
       expr_t d1 = it->second;
 
       if (writeDetails)
-        jacobian_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        jacobian_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
-      jacobian_output << ", \"col\": " << col + 1;
+      output << ", \"col\": " << col + 1;
 
       if (writeDetails)
-        jacobian_output << ", \"var\": \"" << symbol_table.getName(getSymbIDByDerivID(var)) << "\""
-                        << ", \"shift\": " << getLagByDerivID(var);
+        output << ", \"var\": \"" << symbol_table.getName(getSymbIDByDerivID(var)) << "\""
+               << ", \"shift\": " << getLagByDerivID(var);
 
-      jacobian_output << ", \"val\": \"";
-      d1->writeJsonOutput(jacobian_output, temp_term_union, tef_terms);
-      jacobian_output << "\"}" << endl;
+      output << ", \"val\": \"";
+      d1->writeJsonOutput(output, temp_term_union, tef_terms);
+      output << "\"}" << endl;
     }
-  jacobian_output << "]}";
+  output << "]}";
 
   // Writing Hessian
   temp_term_union_m_1 = temp_term_union;
   temp_term_union.insert(temporary_terms_g2.begin(), temporary_terms_g2.end());
   concat = "hessian";
-  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, hessian_output, tef_terms, concat);
-  hessian_output << ", \"hessian\": {"
-                 << "  \"nrows\": " << equations.size()
-                 << ", \"ncols\": " << hessianColsNbr
-                 << ", \"entries\": [";
+  output << ", ";
+  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, output, tef_terms, concat);
+  output << ", \"hessian\": {"
+         << "  \"nrows\": " << equations.size()
+         << ", \"ncols\": " << hessianColsNbr
+         << ", \"entries\": [";
   for (auto it = second_derivatives.begin();
        it != second_derivatives.end(); it++)
     {
       if (it != second_derivatives.begin())
-        hessian_output << ", ";
+        output << ", ";
 
       int eq, var1, var2;
       tie(eq, var1, var2) = it->first;
@@ -6220,50 +6643,51 @@ DynamicModel::writeJsonComputingPassOutput(ostream &output, bool writeDetails) c
       int col_nb_sym = id2 * dynJacobianColsNbr + id1;
 
       if (writeDetails)
-        hessian_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        hessian_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
-      hessian_output << ", \"col\": [" << col_nb + 1;
+      output << ", \"col\": [" << col_nb + 1;
       if (id1 != id2)
-        hessian_output << ", " << col_nb_sym + 1;
-      hessian_output << "]";
+        output << ", " << col_nb_sym + 1;
+      output << "]";
 
       if (writeDetails)
-        hessian_output << ", \"var1\": \"" << symbol_table.getName(getSymbIDByDerivID(var1)) << "\""
-                       << ", \"shift1\": " << getLagByDerivID(var1)
-                       << ", \"var2\": \"" << symbol_table.getName(getSymbIDByDerivID(var2)) << "\""
-                       << ", \"shift2\": " << getLagByDerivID(var2);
-
-      hessian_output << ", \"val\": \"";
-      d2->writeJsonOutput(hessian_output, temp_term_union, tef_terms);
-      hessian_output << "\"}" << endl;
+        output << ", \"var1\": \"" << symbol_table.getName(getSymbIDByDerivID(var1)) << "\""
+               << ", \"shift1\": " << getLagByDerivID(var1)
+               << ", \"var2\": \"" << symbol_table.getName(getSymbIDByDerivID(var2)) << "\""
+               << ", \"shift2\": " << getLagByDerivID(var2);
+
+      output << ", \"val\": \"";
+      d2->writeJsonOutput(output, temp_term_union, tef_terms);
+      output << "\"}" << endl;
     }
-  hessian_output << "]}";
+  output << "]}";
 
   // Writing third derivatives
   temp_term_union_m_1 = temp_term_union;
   temp_term_union.insert(temporary_terms_g3.begin(), temporary_terms_g3.end());
   concat = "third_derivatives";
-  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, third_derivatives_output, tef_terms, concat);
-  third_derivatives_output << ", \"third_derivative\": {"
-                           << "  \"nrows\": " << equations.size()
-                           << ", \"ncols\": " << hessianColsNbr * dynJacobianColsNbr
-                           << ", \"entries\": [";
+  output << ", ";
+  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, output, tef_terms, concat);
+  output << ", \"third_derivative\": {"
+         << "  \"nrows\": " << equations.size()
+         << ", \"ncols\": " << hessianColsNbr * dynJacobianColsNbr
+         << ", \"entries\": [";
   for (auto it = third_derivatives.begin();
        it != third_derivatives.end(); it++)
     {
       if (it != third_derivatives.begin())
-        third_derivatives_output << ", ";
+        output << ", ";
 
       int eq, var1, var2, var3;
       tie(eq, var1, var2, var3) = it->first;
       expr_t d3 = it->second;
 
       if (writeDetails)
-        third_derivatives_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        third_derivatives_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
       int id1 = getDynJacobianCol(var1);
       int id2 = getDynJacobianCol(var2);
@@ -6276,74 +6700,68 @@ DynamicModel::writeJsonComputingPassOutput(ostream &output, bool writeDetails) c
       cols.insert(id3 * hessianColsNbr + id1 * dynJacobianColsNbr + id2);
       cols.insert(id3 * hessianColsNbr + id2 * dynJacobianColsNbr + id1);
 
-      third_derivatives_output << ", \"col\": [";
+      output << ", \"col\": [";
       for (auto it2 = cols.begin(); it2 != cols.end(); it2++)
         {
           if (it2 != cols.begin())
-            third_derivatives_output << ", ";
-          third_derivatives_output << *it2 + 1;
+            output << ", ";
+          output << *it2 + 1;
         }
-      third_derivatives_output << "]";
+      output << "]";
 
       if (writeDetails)
-        third_derivatives_output << ", \"var1\": \"" << symbol_table.getName(getSymbIDByDerivID(var1)) << "\""
-                                 << ", \"shift1\": " << getLagByDerivID(var1)
-                                 << ", \"var2\": \"" << symbol_table.getName(getSymbIDByDerivID(var2)) << "\""
-                                 << ", \"shift2\": " << getLagByDerivID(var2)
-                                 << ", \"var3\": \"" << symbol_table.getName(getSymbIDByDerivID(var3)) << "\""
-                                 << ", \"shift3\": " << getLagByDerivID(var3);
-
-      third_derivatives_output << ", \"val\": \"";
-      d3->writeJsonOutput(third_derivatives_output, temp_term_union, tef_terms);
-      third_derivatives_output << "\"}" << endl;
+        output << ", \"var1\": \"" << symbol_table.getName(getSymbIDByDerivID(var1)) << "\""
+               << ", \"shift1\": " << getLagByDerivID(var1)
+               << ", \"var2\": \"" << symbol_table.getName(getSymbIDByDerivID(var2)) << "\""
+               << ", \"shift2\": " << getLagByDerivID(var2)
+               << ", \"var3\": \"" << symbol_table.getName(getSymbIDByDerivID(var3)) << "\""
+               << ", \"shift3\": " << getLagByDerivID(var3);
+
+      output << ", \"val\": \"";
+      d3->writeJsonOutput(output, temp_term_union, tef_terms);
+      output << "\"}" << endl;
     }
-  third_derivatives_output << "]}";
+  output << "]}";
 
-  if (writeDetails)
-    output << "\"dynamic_model\": {";
-  else
-    output << "\"dynamic_model_simple\": {";
-  output << model_local_vars_output.str()
-         << ", " << model_output.str()
-         << ", " << jacobian_output.str()
-         << ", " << hessian_output.str()
-         << ", " << third_derivatives_output.str()
-         << "}";
+  output << "}";
+}
+
+bool
+DynamicModel::writeBinaryDerivatives(const string &filename) const
+{
+  return writeBinaryDerivativesHelper(filename, [this](int var) { return getDynJacobianCol(var); },
+                                      dynJacobianColsNbr);
 }
 
 void
 DynamicModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails) const
 {
-  if (!residuals_params_derivatives.size()
-      && !residuals_params_second_derivatives.size()
-      && !jacobian_params_derivatives.size()
-      && !jacobian_params_second_derivatives.size()
-      && !hessian_params_derivatives.size())
+  if (!hasParamsDerivatives())
     return;
 
-  ostringstream model_local_vars_output;   // Used for storing model local vars
-  ostringstream model_output;              // Used for storing model temp vars and equations
-  ostringstream jacobian_output;           // Used for storing jacobian equations
-  ostringstream hessian_output;            // Used for storing Hessian equations
-  ostringstream hessian1_output;           // Used for storing Hessian equations
-  ostringstream third_derivs_output;       // Used for storing third order derivatives equations
-  ostringstream third_derivs1_output;      // Used for storing third order derivatives equations
-
   deriv_node_temp_terms_t tef_terms;
-  writeJsonModelLocalVariables(model_local_vars_output, tef_terms);
+
+  if (writeDetails)
+    output << "\"dynamic_model_params_derivative\": {";
+  else
+    output << "\"dynamic_model_params_derivatives_simple\": {";
+
+  writeJsonModelLocalVariables(output, tef_terms);
 
   temporary_terms_t temp_terms_empty;
   string concat = "all";
-  writeJsonTemporaryTerms(params_derivs_temporary_terms, temp_terms_empty, model_output, tef_terms, concat);
-  jacobian_output << "\"deriv_wrt_params\": {"
-                  << "  \"neqs\": " << equations.size()
-                  << ", \"nparamcols\": " << symbol_table.param_nbr()
-                  << ", \"entries\": [";
+  output << ", ";
+  writeJsonTemporaryTerms(params_derivs_temporary_terms, temp_terms_empty, output, tef_terms, concat);
+  output << ", ";
+  output << "\"deriv_wrt_params\": {"
+         << "  \"neqs\": " << equations.size()
+         << ", \"nparamcols\": " << symbol_table.param_nbr()
+         << ", \"entries\": [";
   for (auto it = residuals_params_derivatives.begin();
        it != residuals_params_derivatives.end(); it++)
     {
       if (it != residuals_params_derivatives.begin())
-        jacobian_output << ", ";
+        output << ", ";
 
       int eq, param;
       tie(eq, param) = it->first;
@@ -6352,30 +6770,31 @@ DynamicModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails)
       int param_col = symbol_table.getTypeSpecificID(getSymbIDByDerivID(param)) + 1;
 
       if (writeDetails)
-        jacobian_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        jacobian_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
-      jacobian_output << ", \"param_col\": " << param_col + 1;
+      output << ", \"param_col\": " << param_col + 1;
 
       if (writeDetails)
-        jacobian_output << ", \"param\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
-
-      jacobian_output << ", \"val\": \"";
-      d1->writeJsonOutput(jacobian_output, params_derivs_temporary_terms, tef_terms);
-      jacobian_output << "\"}" << endl;
-    }
-  jacobian_output << "]}";
-  hessian_output << "\"deriv_jacobian_wrt_params\": {"
-                 << "  \"neqs\": " << equations.size()
-                 << ", \"nvarcols\": " << dynJacobianColsNbr
-                 << ", \"nparamcols\": " << symbol_table.param_nbr()
-                 << ", \"entries\": [";
+        output << ", \"param\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
+
+      output << ", \"val\": \"";
+      d1->writeJsonOutput(output, params_derivs_temporary_terms, tef_terms);
+      output << "\"}" << endl;
+    }
+  output << "]}";
+  output << ", ";
+  output << "\"deriv_jacobian_wrt_params\": {"
+         << "  \"neqs\": " << equations.size()
+         << ", \"nvarcols\": " << dynJacobianColsNbr
+         << ", \"nparamcols\": " << symbol_table.param_nbr()
+         << ", \"entries\": [";
   for (auto it = jacobian_params_derivatives.begin();
        it != jacobian_params_derivatives.end(); it++)
     {
       if (it != jacobian_params_derivatives.begin())
-        hessian_output << ", ";
+        output << ", ";
 
       int eq, var, param;
       tie(eq, var, param) = it->first;
@@ -6385,34 +6804,35 @@ DynamicModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails)
       int param_col = symbol_table.getTypeSpecificID(getSymbIDByDerivID(param)) + 1;
 
       if (writeDetails)
-        hessian_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        hessian_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
-      hessian_output << ", \"var_col\": " << var_col + 1
-                     << ", \"param_col\": " << param_col + 1;
+      output << ", \"var_col\": " << var_col + 1
+             << ", \"param_col\": " << param_col + 1;
 
       if (writeDetails)
-      hessian_output << ", \"var\": \"" << symbol_table.getName(getSymbIDByDerivID(var)) << "\""
-                     << ", \"lag\": " << getLagByDerivID(var)
-                     << ", \"param\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
+      output << ", \"var\": \"" << symbol_table.getName(getSymbIDByDerivID(var)) << "\""
+             << ", \"lag\": " << getLagByDerivID(var)
+             << ", \"param\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
 
-      hessian_output << ", \"val\": \"";
-      d2->writeJsonOutput(hessian_output, params_derivs_temporary_terms, tef_terms);
-      hessian_output << "\"}" << endl;
+      output << ", \"val\": \"";
+      d2->writeJsonOutput(output, params_derivs_temporary_terms, tef_terms);
+      output << "\"}" << endl;
     }
-  hessian_output << "]}";
+  output << "]}";
 
-  hessian1_output << "\"second_deriv_residuals_wrt_params\": {"
-                  << "  \"nrows\": " << equations.size()
-                  << ", \"nparam1cols\": " << symbol_table.param_nbr()
-                  << ", \"nparam2cols\": " << symbol_table.param_nbr()
-                  << ", \"entries\": [";
+  output << ", ";
+  output << "\"second_deriv_residuals_wrt_params\": {"
+         << "  \"nrows\": " << equations.size()
+         << ", \"nparam1cols\": " << symbol_table.param_nbr()
+         << ", \"nparam2cols\": " << symbol_table.param_nbr()
+         << ", \"entries\": [";
   for (auto it = residuals_params_second_derivatives.begin();
        it != residuals_params_second_derivatives.end(); ++it)
     {
       if (it != residuals_params_second_derivatives.begin())
-        hessian1_output << ", ";
+        output << ", ";
 
       int eq, param1, param2;
       tie(eq, param1, param2) = it->first;
@@ -6422,32 +6842,33 @@ DynamicModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails)
       int param2_col = symbol_table.getTypeSpecificID(getSymbIDByDerivID(param2)) + 1;
 
       if (writeDetails)
-        hessian1_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        hessian1_output << "{\"row\": " << eq + 1;
-      hessian1_output << ", \"param1_col\": " << param1_col + 1
-                      << ", \"param2_col\": " << param2_col + 1;
+        output << "{\"row\": " << eq + 1;
+      output << ", \"param1_col\": " << param1_col + 1
+             << ", \"param2_col\": " << param2_col + 1;
 
       if (writeDetails)
-        hessian1_output << ", \"param1\": \"" << symbol_table.getName(getSymbIDByDerivID(param1)) << "\""
-                        << ", \"param2\": \"" << symbol_table.getName(getSymbIDByDerivID(param2)) << "\"";
-
-      hessian1_output << ", \"val\": \"";
-      d2->writeJsonOutput(hessian1_output, params_derivs_temporary_terms, tef_terms);
-      hessian1_output << "\"}" << endl;
-    }
-  hessian1_output << "]}";
-  third_derivs_output << "\"second_deriv_jacobian_wrt_params\": {"
-                      << "  \"neqs\": " << equations.size()
-                      << ", \"nvarcols\": " << dynJacobianColsNbr
-                      << ", \"nparam1cols\": " << symbol_table.param_nbr()
-                      << ", \"nparam2cols\": " << symbol_table.param_nbr()
-                      << ", \"entries\": [";
+        output << ", \"param1\": \"" << symbol_table.getName(getSymbIDByDerivID(param1)) << "\""
+               << ", \"param2\": \"" << symbol_table.getName(getSymbIDByDerivID(param2)) << "\"";
+
+      output << ", \"val\": \"";
+      d2->writeJsonOutput(output, params_derivs_temporary_terms, tef_terms);
+      output << "\"}" << endl;
+    }
+  output << "]}";
+  output << ", ";
+  output << "\"second_deriv_jacobian_wrt_params\": {"
+         << "  \"neqs\": " << equations.size()
+         << ", \"nvarcols\": " << dynJacobianColsNbr
+         << ", \"nparam1cols\": " << symbol_table.param_nbr()
+         << ", \"nparam2cols\": " << symbol_table.param_nbr()
+         << ", \"entries\": [";
   for (auto it = jacobian_params_second_derivatives.begin();
        it != jacobian_params_second_derivatives.end(); ++it)
     {
       if (it != jacobian_params_second_derivatives.begin())
-        third_derivs_output << ", ";
+        output << ", ";
 
       int eq, var, param1, param2;
       tie(eq, var, param1, param2) = it->first;
@@ -6458,37 +6879,38 @@ DynamicModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails)
       int param2_col = symbol_table.getTypeSpecificID(getSymbIDByDerivID(param2)) + 1;
 
       if (writeDetails)
-        third_derivs_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        third_derivs_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
-      third_derivs_output << ", \"var_col\": " << var_col + 1
-                          << ", \"param1_col\": " << param1_col + 1
-                          << ", \"param2_col\": " << param2_col + 1;
+      output << ", \"var_col\": " << var_col + 1
+             << ", \"param1_col\": " << param1_col + 1
+             << ", \"param2_col\": " << param2_col + 1;
 
       if (writeDetails)
-        third_derivs_output << ", \"var\": \"" << symbol_table.getName(var) << "\""
-                            << ", \"lag\": " << getLagByDerivID(var)
-                            << ", \"param1\": \"" << symbol_table.getName(getSymbIDByDerivID(param1)) << "\""
-                            << ", \"param2\": \"" << symbol_table.getName(getSymbIDByDerivID(param2)) << "\"";
-
-      third_derivs_output << ", \"val\": \"";
-      d2->writeJsonOutput(third_derivs_output, params_derivs_temporary_terms, tef_terms);
-      third_derivs_output << "\"}" << endl;
-    }
-  third_derivs_output << "]}" << endl;
-
-  third_derivs1_output << "\"derivative_hessian_wrt_params\": {"
-                       << "  \"neqs\": " << equations.size()
-                       << ", \"nvar1cols\": " << dynJacobianColsNbr
-                       << ", \"nvar2cols\": " << dynJacobianColsNbr
-                       << ", \"nparamcols\": " << symbol_table.param_nbr()
-                       << ", \"entries\": [";
+        output << ", \"var\": \"" << symbol_table.getName(getSymbIDByDerivID(var)) << "\""
+               << ", \"lag\": " << getLagByDerivID(var)
+               << ", \"param1\": \"" << symbol_table.getName(getSymbIDByDerivID(param1)) << "\""
+               << ", \"param2\": \"" << symbol_table.getName(getSymbIDByDerivID(param2)) << "\"";
+
+      output << ", \"val\": \"";
+      d2->writeJsonOutput(output, params_derivs_temporary_terms, tef_terms);
+      output << "\"}" << endl;
+    }
+  output << "]}" << endl;
+
+  output << ", ";
+  output << "\"derivative_hessian_wrt_params\": {"
+         << "  \"neqs\": " << equations.size()
+         << ", \"nvar1cols\": " << dynJacobianColsNbr
+         << ", \"nvar2cols\": " << dynJacobianColsNbr
+         << ", \"nparamcols\": " << symbol_table.param_nbr()
+         << ", \"entries\": [";
   for (auto it = hessian_params_derivatives.begin();
        it != hessian_params_derivatives.end(); ++it)
     {
       if (it != hessian_params_derivatives.begin())
-        third_derivs1_output << ", ";
+        output << ", ";
 
       int eq, var1, var2, param;
       tie(eq, var1, var2, param) = it->first;
@@ -6499,39 +6921,28 @@ DynamicModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails)
       int param_col = symbol_table.getTypeSpecificID(getSymbIDByDerivID(param)) + 1;
 
       if (writeDetails)
-        third_derivs1_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        third_derivs1_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
-      third_derivs1_output << ", \"var1_col\": " << var1_col + 1
-                           << ", \"var2_col\": " << var2_col + 1
-                           << ", \"param_col\": " << param_col + 1;
+      output << ", \"var1_col\": " << var1_col + 1
+             << ", \"var2_col\": " << var2_col + 1
+             << ", \"param_col\": " << param_col + 1;
 
       if (writeDetails)
-        third_derivs1_output << ", \"var1\": \"" << symbol_table.getName(getSymbIDByDerivID(var1)) << "\""
-                             << ", \"lag1\": " << getLagByDerivID(var1)
-                             << ", \"var2\": \"" << symbol_table.getName(getSymbIDByDerivID(var2)) << "\""
-                             << ", \"lag2\": " << getLagByDerivID(var2)
-                             << ", \"param\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
-
-      third_derivs1_output << ", \"val\": \"";
-      d2->writeJsonOutput(third_derivs1_output, params_derivs_temporary_terms, tef_terms);
-      third_derivs1_output << "\"}" << endl;
+        output << ", \"var1\": \"" << symbol_table.getName(getSymbIDByDerivID(var1)) << "\""
+               << ", \"lag1\": " << getLagByDerivID(var1)
+               << ", \"var2\": \"" << symbol_table.getName(getSymbIDByDerivID(var2)) << "\""
+               << ", \"lag2\": " << getLagByDerivID(var2)
+               << ", \"param\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
+
+      output << ", \"val\": \"";
+      d2->writeJsonOutput(output, params_derivs_temporary_terms, tef_terms);
+      output << "\"}" << endl;
     }
-  third_derivs1_output << "]}" << endl;
+  output << "]}" << endl;
 
-  if (writeDetails)
-    output << "\"dynamic_model_params_derivative\": {";
-  else
-    output << "\"dynamic_model_params_derivatives_simple\": {";
-  output << model_local_vars_output.str()
-         << ", " << model_output.str()
-         << ", " << jacobian_output.str()
-         << ", " << hessian_output.str()
-         << ", " << hessian1_output.str()
-         << ", " << third_derivs_output.str()
-         << ", " << third_derivs1_output.str()
-         << "}";
+  output << "}";
 }
 
 void
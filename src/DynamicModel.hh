@@ -101,15 +101,49 @@ private:
   //! Writes dynamic model file (Julia version)
   void writeDynamicJuliaFile(const string &dynamic_basename) const;
   //! Writes dynamic model file (C version)
-  /*! \todo add third derivatives handling */
-  void writeDynamicCFile(const string &basename, const int order) const;
+  /*! \todo add third derivatives handling
+    \param nshards number of translation units in which the model is split (1 for a single dynamic.c file) */
+  void writeDynamicCFile(const string &basename, const int order, int nshards) const;
   //! Writes dynamic model file when SparseDLL option is on
   void writeSparseDynamicMFile(const string &basename) const;
   //! Writes the dynamic model equations and its derivatives
   /*! \todo add third derivatives handling in C output */
   void writeDynamicModel(ostream &DynamicOutput, bool use_dll, bool julia) const;
   void writeDynamicModel(const string &basename, bool use_dll, bool julia) const;
-  void writeDynamicModel(const string &basename, ostream &DynamicOutput, bool use_dll, bool julia) const;
+  void writeDynamicModel(const string &basename, ostream &DynamicOutput, bool use_dll, bool julia, int nshards) const;
+  //! Returns the temporary terms of the split C dynamic model in the order of their computation
+  /*! Each term is given as a tuple (derivation order, term, expression): for a
+    model local variable, the term is the variable node and the expression its
+    value; otherwise both are the node of the temporary term */
+  vector<tuple<int, expr_t, expr_t>> splitTemporaryTerms() const;
+  //! Assigns a slot of the array T to each temporary term of the split C dynamic model
+  /*! The slots of the previous run, stored in the dynamic.manifest file, are
+    kept for the terms with the same digest. The SHA-256 digests of the terms,
+    which do not depend on the numbering of nodes, are stored in tt_digests. */
+  void assignTemporaryTermsSlots(const string &basename, temporary_terms_idxs_t &tt_slots,
+                                 map<expr_t, string> &tt_digests) const;
+  //! Writes the C dynamic model split into several translation units, given the outputs of writeDynamicModel()
+  /*! The body of the Dynamic() function is written in DynamicOutput, the other
+    functions are spread over nshards files, and the temporary terms are shared
+    through an array T, at the slots given by assignTemporaryTermsSlots().
+    The layout of the files is designed for incremental recompilation: the slots
+    of temporary terms in T are kept from one run to the next, the code is cut
+    into functions at points that only depend on the local content, each
+    function is put in a file chosen from a hash of its code, and a file is
+    only rewritten if its digest has changed. */
+  void writeDynamicCShards(const string &basename, int nshards, ostream &DynamicOutput,
+                           const temporary_terms_idxs_t &tt_slots, const map<expr_t, string> &tt_digests,
+                           const ostringstream &model_output, const ostringstream &jacobian_output,
+                           const ostringstream &hessian_output, const ostringstream &third_derivatives_output) const;
+  //! Reads the entries of a given type ("temporary" or "file") of the manifest of the split C dynamic model
+  static map<string, string> readManifest(const string &filename, const string &entry_type);
+  //! Returns the CRC-32 checksum of a string (used for naming and placing functions)
+  static unsigned int stringChecksum(const string &str);
+  //! Writes a file, unless it already exists with the same SHA-256 digest in the manifest of the previous run
+  /*! The digest of the new content is stored in new_digests */
+  static void writeFileIfChanged(const string &filename, const string &content,
+                                 const map<string, string> &old_digests,
+                                 map<string, string> &new_digests);
   //! Writes the Block reordred structure of the model in M output
   void writeModelEquationsOrdered_M(const string &basename) const;
   //! Writes the code of the Block reordred structure of the model in virtual machine bytecode
@@ -141,9 +175,9 @@ private:
   //! creates a mapping from the index of temporary terms to a natural index
   void computeTemporaryTermsMapping();
   //! Write derivative code of an equation w.r. to a variable
-  void compileDerivative(ofstream &code_file, unsigned int &instruction_number, int eq, int symb_id, int lag, const map_idx_t &map_idx) const;
+  void compileDerivative(ostream &code_file, unsigned int &instruction_number, int eq, int symb_id, int lag, const map_idx_t &map_idx) const;
   //! Write chain rule derivative code of an equation w.r. to a variable
-  void compileChainRuleDerivative(ofstream &code_file, unsigned int &instruction_number, int eq, int var, int lag, const map_idx_t &map_idx) const;
+  void compileChainRuleDerivative(ostream &code_file, unsigned int &instruction_number, int eq, int var, int lag, const map_idx_t &map_idx) const;
 
   //! Get the type corresponding to a derivation ID
   SymbolType getTypeByDerivID(int deriv_id) const noexcept(false) override;
@@ -294,6 +328,9 @@ public:
   //! Write JSON prams derivatives file
   void writeJsonParamsDerivativesFile(ostream &output, bool writeDetails) const;
 
+  //! Write the equations and derivatives of the dynamic model in binary form (see BinaryDerivatives.hh)
+  bool writeBinaryDerivatives(const string &filename) const;
+
   //! Write cross reference output if the xref maps have been filed
   void writeJsonXrefs(ostream &output) const;
   void writeJsonXrefsHelper(ostream &output, const map<pair<int, int>, set<int>> &xrefs) const;
@@ -341,7 +378,8 @@ public:
   void Write_Inf_To_Bin_File_Block(const string &basename,
                                    const int &num, int &u_count_int, bool &file_open, bool is_two_boundaries) const;
   //! Writes dynamic model file
-  void writeDynamicFile(const string &basename, bool block, bool bytecode, bool use_dll, int order, bool julia) const;
+  /*! \param dll_shards number of translation units of the C dynamic model (with use_dll) */
+  void writeDynamicFile(const string &basename, bool block, bool bytecode, bool use_dll, int order, bool julia, int dll_shards) const;
   //! Writes file containing parameters derivatives
   void writeParamsDerivativesFile(const string &basename, bool julia) const;
 
@@ -625,7 +663,11 @@ public:
   //! Returns true if a parameter was used in the model block with a lead or lag
   bool ParamUsedWithLeadLag() const;
 
-  bool isChecksumMatching(const string &basename) const;
+  //! Checks whether the model has changed since the last run, by comparing with the manifest stored in <basename>/checksum
+  /*! The manifest contains the writer options, a SHA-256 digest of the symbol
+    table and of the code of each equation (with its tags) and model local
+    variable, and the numbers of derivatives. It is updated if it does not match */
+  bool isChecksumMatching(const string &basename, const string &options) const;
 };
 
 //! Classes to re-order derivatives for various sparse storage formats
@@ -20,6 +20,8 @@
 #include <iostream>
 #include <sstream>
 #include <fstream>
+#include <thread>
+#include <memory>
 
 #include <cstdlib>
 #include <cstring>
@@ -31,38 +33,63 @@
 #include "ParsingDriver.hh"
 #include "ExtendedPreprocessorTypes.hh"
 #include "ConfigFile.hh"
+#include "Profiler.hh"
+#include "StreamPipe.hh"
 
 /* Prototype for second part of main function
    Splitting main() in two parts was necessary because ParsingDriver.h and MacroDriver.h can't be
    included simultaneously (because of Bison limitations).
 */
-void main2(stringstream &in, string &basename, bool debug, bool clear_all, bool clear_global,
+void main2(istream &in, string &basename, bool debug, bool clear_all, bool clear_global,
            bool no_tmp_terms, bool no_log, bool no_warn, bool warn_uninit, bool console,
            bool nograph, bool nointeractive, bool parallel, ConfigFile &config_file,
            WarningConsolidation &warnings_arg, bool nostrict, bool stochastic, bool check_model_changes,
            bool minimal_workspace, bool compute_xrefs, FileOutputType output_mode,
-           LanguageOutputType lang, int params_derivs_order, bool transform_unary_ops
+           LanguageOutputType lang, int params_derivs_order, int nthreads, int dll_shards, bool computing_pass_cache, bool transform_unary_ops
 #if defined(_WIN32) || defined(__CYGWIN32__) || defined(__MINGW32__)
            , bool cygwin, bool msvc, bool mingw
 #endif
            , JsonOutputPointType json, JsonFileOutputType json_output_mode, bool onlyjson, bool jsonderivsimple
-           , bool nopreprocessoroutput
+           , bool binary_derivs, bool nopreprocessoroutput
            );
 
-void main1(string &modfile, string &basename, string &modfiletxt, bool debug, bool save_macro, string &save_macro_file,
-           bool no_line_macro, bool no_empty_line_macro, map<string, string> &defines, vector<string> &path, stringstream &macro_output);
+/* Returns false if the macro processing failed, after having reported the error.
+   Does not exit by itself, since it may run in its own thread (see the streammacro option) */
+bool main1(string &modfile, string &basename, string &modfiletxt, bool debug, bool save_macro, string &save_macro_file,
+           bool no_line_macro, bool no_empty_line_macro, bool macro_cache, bool macro_cache_debug,
+           map<string, string> &defines, vector<string> &path, ostream &macro_output);
+
+/* The macro processor thread and its pipe, while the macro processor runs in
+   its own thread (see the streammacro option) */
+static StreamPipe *running_macro_pipe = nullptr;
+static thread *running_macro_thread = nullptr;
+
+/* Called at exit: the parser exits the program on the first error, while the
+   macro processor thread may still be running, or blocked on the full pipe.
+   Its output is discarded, so that it finishes without blocking, and it is
+   waited for, before the static objects that it uses are destroyed. */
+static void
+stopMacroThread()
+{
+  if (running_macro_thread && running_macro_thread->joinable()
+      && running_macro_thread->get_id() != this_thread::get_id())
+    {
+      running_macro_pipe->abandon();
+      running_macro_thread->join();
+    }
+}
 
 void
 usage()
 {
-  cerr << "Dynare usage: dynare mod_file [debug] [noclearall] [onlyclearglobals] [savemacro[=macro_file]] [onlymacro] [nolinemacro] [noemptylinemacro] [notmpterms] [nolog] [warn_uninit]"
+  cerr << "Dynare usage: dynare mod_file [debug] [noclearall] [onlyclearglobals] [savemacro[=macro_file]] [onlymacro] [streammacro] [macro_cache[=debug]] [nolinemacro] [noemptylinemacro] [notmpterms] [nolog] [warn_uninit]"
        << " [console] [nograph] [nointeractive] [parallel[=cluster_name]] [conffile=parallel_config_path_and_filename] [parallel_slave_open_mode] [parallel_test]"
        << " [-D<variable>[=<value>]] [-I/path] [nostrict] [stochastic] [fast] [minimal_workspace] [compute_xrefs] [output=dynamic|first|second|third] [language=julia]"
-       << " [params_derivs_order=0|1|2] [transform_unary_ops]"
+       << " [params_derivs_order=0|1|2] [nthreads=N] [dll_shards=N] [computing_pass_cache] [transform_unary_ops] [profile[=json]]"
 #if defined(_WIN32) || defined(__CYGWIN32__) || defined(__MINGW32__)
        << " [cygwin] [msvc] [mingw]"
 #endif
-       << " [json=parse|check|transform|compute] [jsonstdout] [onlyjson] [jsonderivsimple] [nopathchange] [nopreprocessoroutput]"
+       << " [json=parse|check|transform|compute] [jsonstdout] [onlyjson] [jsonderivsimple] [binaryderivs] [nopathchange] [nopreprocessoroutput]"
        << endl;
   exit(EXIT_FAILURE);
 }
@@ -90,11 +117,16 @@ main(int argc, char **argv)
   bool debug = false;
   bool no_tmp_terms = false;
   bool only_macro = false;
+  bool stream_macro = false;
+  bool macro_cache = false;
+  bool macro_cache_debug = false;
   bool no_line_macro = false;
   bool no_empty_line_macro = false;
   bool no_log = false;
   bool no_warn = false;
   int params_derivs_order = 2;
+  int nthreads = 0;
+  int dll_shards = 1;
   bool warn_uninit = false;
   bool console = false;
   bool nograph = false;
@@ -114,6 +146,8 @@ main(int argc, char **argv)
   bool check_model_changes = false;
   bool minimal_workspace = false;
   bool compute_xrefs = false;
+  bool computing_pass_cache = false;
+  ProfileOutputType profile = ProfileOutputType::none;
   bool transform_unary_ops = false;
   map<string, string> defines;
   vector<string> path;
@@ -122,6 +156,7 @@ main(int argc, char **argv)
   JsonFileOutputType json_output_mode{JsonFileOutputType::file};
   bool onlyjson = false;
   bool jsonderivsimple = false;
+  bool binary_derivs = false;
   LanguageOutputType language{LanguageOutputType::matlab};
   bool nopreprocessoroutput = false;
 
@@ -142,6 +177,28 @@ main(int argc, char **argv)
             }
           params_derivs_order = atoi(argv[arg] + 20);
         }
+      else if (strlen(argv[arg]) >= 8 && !strncmp(argv[arg], "nthreads", 8))
+        {
+          if (strlen(argv[arg]) <= 9 || argv[arg][8] != '='
+              || strspn(argv[arg] + 9, "0123456789") != strlen(argv[arg] + 9)
+              || atoi(argv[arg] + 9) <= 0)
+            {
+              cerr << "Incorrect syntax for nthreads option" << endl;
+              usage();
+            }
+          nthreads = atoi(argv[arg] + 9);
+        }
+      else if (strlen(argv[arg]) >= 10 && !strncmp(argv[arg], "dll_shards", 10))
+        {
+          if (strlen(argv[arg]) <= 11 || argv[arg][10] != '='
+              || strspn(argv[arg] + 11, "0123456789") != strlen(argv[arg] + 11)
+              || atoi(argv[arg] + 11) <= 0)
+            {
+              cerr << "Incorrect syntax for dll_shards option" << endl;
+              usage();
+            }
+          dll_shards = atoi(argv[arg] + 11);
+        }
       else if (!strcmp(argv[arg], "onlyclearglobals"))
         {
           clear_all = false;
@@ -149,6 +206,12 @@ main(int argc, char **argv)
         }
       else if (!strcmp(argv[arg], "onlymacro"))
         only_macro = true;
+      else if (!strcmp(argv[arg], "streammacro"))
+        stream_macro = true;
+      else if (!strcmp(argv[arg], "macro_cache"))
+        macro_cache = true;
+      else if (!strcmp(argv[arg], "macro_cache=debug"))
+        macro_cache = macro_cache_debug = true;
       else if (strlen(argv[arg]) >= 9 && !strncmp(argv[arg], "savemacro", 9))
         {
           save_macro = true;
@@ -211,8 +274,14 @@ main(int argc, char **argv)
         minimal_workspace = true;
       else if (!strcmp(argv[arg], "compute_xrefs"))
         compute_xrefs = true;
+      else if (!strcmp(argv[arg], "computing_pass_cache"))
+        computing_pass_cache = true;
       else if (!strcmp(argv[arg], "transform_unary_ops"))
         transform_unary_ops = true;
+      else if (!strcmp(argv[arg], "profile"))
+        profile = ProfileOutputType::text;
+      else if (!strcmp(argv[arg], "profile=json"))
+        profile = ProfileOutputType::json;
       else if (strlen(argv[arg]) >= 8 && !strncmp(argv[arg], "parallel", 8))
         {
           parallel = true;
@@ -311,6 +380,8 @@ main(int argc, char **argv)
         nopreprocessoroutput = true;
       else if (!strcmp(argv[arg], "jsonderivsimple"))
         jsonderivsimple = true;
+      else if (!strcmp(argv[arg], "binaryderivs"))
+        binary_derivs = true;
       else if (strlen(argv[arg]) >= 4 && !strncmp(argv[arg], "json", 4))
         {
           if (strlen(argv[arg]) <= 5 || argv[arg][4] != '=')
@@ -373,6 +444,8 @@ main(int argc, char **argv)
       modfiletxt = buffer.str();
     }
 
+  Profiler::enable(profile, basename);
+
   WarningConsolidation warnings(no_warn);
 
   // Process config file
@@ -390,22 +463,67 @@ main(int argc, char **argv)
 
   // Do macro processing
   stringstream macro_output;
-  main1(modfile, basename, modfiletxt, debug, save_macro, save_macro_file, no_line_macro, no_empty_line_macro,
-        defines, path, macro_output);
+  istream *parser_input = &macro_output;
+  unique_ptr<StreamPipe> macro_pipe;
+  thread macro_thread;
+  if (stream_macro && !only_macro)
+    {
+      /* The macro processor runs in its own thread, and its output is parsed
+         while it is produced, instead of being stored in memory */
+      macro_pipe = make_unique<StreamPipe>();
+      parser_input = &macro_pipe->in;
+      Profiler::PhaseNode *parent_phase = Profiler::getCurrentPhase();
+      macro_thread = thread([&, parent_phase] {
+          Profiler::setCurrentPhase(parent_phase);
+          bool success = false;
+          // An exception must not escape the thread, which would abort the program
+          try
+            {
+              Profiler::Phase phase("macro expansion");
+              success = main1(modfile, basename, modfiletxt, debug, save_macro, save_macro_file, no_line_macro,
+                              no_empty_line_macro, macro_cache, macro_cache_debug, defines, path,
+                              macro_pipe->out);
+            }
+          catch (const exception &e)
+            {
+              cerr << "ERROR: in the macro processor: " << e.what() << endl;
+            }
+          catch (...)
+            {
+              cerr << "ERROR: unexpected error in the macro processor" << endl;
+            }
+          // On failure, the parser exits as soon as it reads from the pipe
+          macro_pipe->close(!success);
+        });
+      running_macro_pipe = macro_pipe.get();
+      running_macro_thread = &macro_thread;
+      atexit(stopMacroThread);
+    }
+  else
+    {
+      Profiler::Phase phase("macro expansion");
+      if (!main1(modfile, basename, modfiletxt, debug, save_macro, save_macro_file, no_line_macro, no_empty_line_macro,
+                 macro_cache, macro_cache_debug, defines, path, macro_output))
+        exit(EXIT_FAILURE);
+    }
 
   if (only_macro)
     return EXIT_SUCCESS;
 
   // Do the rest
-  main2(macro_output, basename, debug, clear_all, clear_global,
+  main2(*parser_input, basename, debug, clear_all, clear_global,
         no_tmp_terms, no_log, no_warn, warn_uninit, console, nograph, nointeractive,
         parallel, config_file, warnings, nostrict, stochastic, check_model_changes, minimal_workspace,
-        compute_xrefs, output_mode, language, params_derivs_order, transform_unary_ops
+        compute_xrefs, output_mode, language, params_derivs_order, nthreads, dll_shards, computing_pass_cache, transform_unary_ops
 #if defined(_WIN32) || defined(__CYGWIN32__) || defined(__MINGW32__)
         , cygwin, msvc, mingw
 #endif
-        , json, json_output_mode, onlyjson, jsonderivsimple, nopreprocessoroutput
+        , json, json_output_mode, onlyjson, jsonderivsimple, binary_derivs, nopreprocessoroutput
         );
 
+  if (macro_thread.joinable())
+    macro_thread.join();
+  running_macro_thread = nullptr;
+
   return EXIT_SUCCESS;
 }
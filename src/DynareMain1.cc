@@ -20,35 +20,89 @@
 #include <sstream>
 #include <fstream>
 
+#include <boost/filesystem.hpp>
+
 #include "macro/MacroDriver.hh"
+#include "BufferedSink.hh"
 
-bool compareNewline (int i, int j) {
-  return i == '\n' && j == '\n';
+//! Writes a chunk of the macro-expanded output to the copy, removing empty lines (see the noemptylinemacro option)
+/*! last_newline tells whether the last character written is a newline, and is updated */
+static void
+writeWithoutEmptyLines(ostream &save, const char *s, streamsize n, bool &last_newline)
+{
+  streamsize begin = 0;
+  for (streamsize i = 0; i < n; i++)
+    {
+      bool newline = s[i] == '\n';
+      if (newline && last_newline)
+        {
+          save.write(s + begin, i - begin);
+          begin = i + 1;
+        }
+      last_newline = newline;
+    }
+  save.write(s + begin, n - begin);
 }
 
-void
+bool
 main1(string &modfile, string &basename, string &modfiletxt, bool debug, bool save_macro, string &save_macro_file,
-      bool no_line_macro, bool no_empty_line_macro, map<string, string> &defines, vector<string> &path, stringstream &macro_output)
+      bool no_line_macro, bool no_empty_line_macro, bool macro_cache, bool macro_cache_debug,
+      map<string, string> &defines, vector<string> &path, ostream &macro_output)
 {
   // Do macro processing
   MacroDriver m;
 
-  m.parse(modfile, basename, modfiletxt, macro_output, debug, no_line_macro, defines, path);
-  if (save_macro)
+  if (macro_cache)
+    {
+      boost::filesystem::create_directories(basename + "/cache");
+      m.cache = basename + "/cache/macro";
+      m.cache_debug = macro_cache_debug;
+    }
+
+  if (!save_macro)
     {
-      if (save_macro_file.empty())
-        save_macro_file = basename + "-macroexp.mod";
-      ofstream macro_output_file(save_macro_file);
-      if (macro_output_file.fail())
+      try
         {
-          cerr << "Cannot open " << save_macro_file << " for macro output" << endl;
-          exit(EXIT_FAILURE);
+          m.parse(modfile, basename, modfiletxt, macro_output, debug, no_line_macro, defines, path);
         }
+      catch (MacroDriver::MacroError &e)
+        {
+          return false;
+        }
+      return true;
+    }
 
-      string str (macro_output.str());
-      if (no_empty_line_macro)
-        str.erase(unique(str.begin(), str.end(), compareNewline), str.end());
-      macro_output_file << str;
-      macro_output_file.close();
+  if (save_macro_file.empty())
+    save_macro_file = basename + "-macroexp.mod";
+  ofstream macro_output_file(save_macro_file);
+  if (macro_output_file.fail())
+    {
+      cerr << "Cannot open " << save_macro_file << " for macro output" << endl;
+      return false;
+    }
+
+  /* The output is forwarded to macro_output and copied to the file by chunks,
+     as it is produced, so that it does not need to be kept in memory */
+  streambuf *dest = macro_output.rdbuf();
+  bool last_newline = false;
+  BufferedSink save_buffer([&](const char *data, streamsize size)
+                           {
+                             if (no_empty_line_macro)
+                               writeWithoutEmptyLines(macro_output_file, data, size, last_newline);
+                             else
+                               macro_output_file.write(data, size);
+                             return dest->sputn(data, size) == size;
+                           });
+  ostream out(&save_buffer);
+  try
+    {
+      m.parse(modfile, basename, modfiletxt, out, debug, no_line_macro, defines, path);
+    }
+  catch (MacroDriver::MacroError &e)
+    {
+      return false;
     }
+  save_buffer.flush();
+  macro_output_file.close();
+  return true;
 }
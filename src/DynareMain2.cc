@@ -25,59 +25,92 @@
 #include "ModFile.hh"
 #include "ConfigFile.hh"
 #include "ExtendedPreprocessorTypes.hh"
+#include "Profiler.hh"
 
 void
-main2(stringstream &in, string &basename, bool debug, bool clear_all, bool clear_global,
+main2(istream &in, string &basename, bool debug, bool clear_all, bool clear_global,
       bool no_tmp_terms, bool no_log, bool no_warn, bool warn_uninit, bool console,
       bool nograph, bool nointeractive, bool parallel, ConfigFile &config_file,
       WarningConsolidation &warnings, bool nostrict, bool stochastic, bool check_model_changes,
       bool minimal_workspace, bool compute_xrefs, FileOutputType output_mode,
-      LanguageOutputType language, int params_derivs_order, bool transform_unary_ops
+      LanguageOutputType language, int params_derivs_order, int nthreads, int dll_shards, bool computing_pass_cache, bool transform_unary_ops
 #if defined(_WIN32) || defined(__CYGWIN32__) || defined(__MINGW32__)
       , bool cygwin, bool msvc, bool mingw
 #endif
       , JsonOutputPointType json, JsonFileOutputType json_output_mode, bool onlyjson, bool jsonderivsimple
-      , bool nopreprocessoroutput
+      , bool binary_derivs, bool nopreprocessoroutput
       )
 {
   ParsingDriver p(warnings, nostrict);
 
   boost::filesystem::remove_all(basename + "/model/json");
+  boost::filesystem::remove_all(basename + "/model/binary");
 
   // Do parsing and construct internal representation of mod file
-  unique_ptr<ModFile> mod_file = p.parse(in, debug);
+  unique_ptr<ModFile> mod_file;
+  {
+    Profiler::Phase phase("parsing");
+    mod_file = p.parse(in, debug);
+  }
   if (json == JsonOutputPointType::parsing)
     mod_file->writeJsonOutput(basename, json, json_output_mode, onlyjson, nopreprocessoroutput);
 
   // Run checking pass
-  mod_file->checkPass(nostrict, stochastic);
+  {
+    Profiler::Phase phase("check pass");
+    mod_file->checkPass(nostrict, stochastic);
+  }
   if (json == JsonOutputPointType::checkpass)
     mod_file->writeJsonOutput(basename, json, json_output_mode, onlyjson, nopreprocessoroutput);
 
   // Perform transformations on the model (creation of auxiliary vars and equations)
-  mod_file->transformPass(nostrict, stochastic, compute_xrefs || json == JsonOutputPointType::transformpass, nopreprocessoroutput, transform_unary_ops);
+  {
+    Profiler::Phase phase("transform pass");
+    mod_file->transformPass(nostrict, stochastic, compute_xrefs || json == JsonOutputPointType::transformpass, nopreprocessoroutput, transform_unary_ops);
+  }
   if (json == JsonOutputPointType::transformpass)
     mod_file->writeJsonOutput(basename, json, json_output_mode, onlyjson, nopreprocessoroutput);
 
   // Evaluate parameters initialization, initval, endval and pounds
-  mod_file->evalAllExpressions(warn_uninit, nopreprocessoroutput);
+  {
+    Profiler::Phase phase("evaluation of expressions");
+    mod_file->evalAllExpressions(warn_uninit, nopreprocessoroutput);
+  }
 
   // Do computations
-  mod_file->computingPass(no_tmp_terms, output_mode, params_derivs_order, nopreprocessoroutput);
+  {
+    Profiler::Phase phase("computing pass");
+    mod_file->computingPass(no_tmp_terms, output_mode, params_derivs_order, nthreads,
+                            computing_pass_cache ? basename + "/cache" : "", nopreprocessoroutput);
+  }
+  if (binary_derivs)
+    {
+      Profiler::Phase phase("binary derivatives output");
+      mod_file->writeBinaryDerivatives(basename, nopreprocessoroutput);
+    }
   if (json == JsonOutputPointType::computingpass)
-    mod_file->writeJsonOutput(basename, json, json_output_mode, onlyjson, nopreprocessoroutput, jsonderivsimple);
+    {
+      Profiler::Phase phase("JSON output");
+      mod_file->writeJsonOutput(basename, json, json_output_mode, onlyjson, nopreprocessoroutput, jsonderivsimple);
+    }
 
   // Write outputs
-  if (output_mode != FileOutputType::none)
-    mod_file->writeExternalFiles(basename, output_mode, language, nopreprocessoroutput);
-  else
-    mod_file->writeOutputFiles(basename, clear_all, clear_global, no_log, no_warn, console, nograph,
-                               nointeractive, config_file, check_model_changes, minimal_workspace, compute_xrefs
+  {
+    Profiler::Phase phase("output files");
+    if (output_mode != FileOutputType::none)
+      mod_file->writeExternalFiles(basename, output_mode, language, nopreprocessoroutput);
+    else
+      mod_file->writeOutputFiles(basename, clear_all, clear_global, no_log, no_warn, console, nograph,
+                                 nointeractive, config_file, check_model_changes, minimal_workspace, compute_xrefs, dll_shards
 #if defined(_WIN32) || defined(__CYGWIN32__) || defined(__MINGW32__)
-                               , cygwin, msvc, mingw
+                                 , cygwin, msvc, mingw
 #endif
-                               , nopreprocessoroutput
-                               );
+                                 , nopreprocessoroutput
+                                 );
+  }
+
+  if (Profiler::isEnabled())
+    mod_file->profileNodeCounts();
 
   if (!nopreprocessoroutput)
     cout << "Preprocessing completed." << endl;
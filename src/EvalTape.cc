@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cassert>
+
+#include "EvalTape.hh"
+
+int
+EvalTape::addInstruction(InstructionType type, int op_code, int arg1, int arg2, int arg3, double value)
+{
+  int slot = instructions.size();
+  instructions.push_back({ type, op_code, arg1, arg2, arg3, value });
+  slot_nodes.emplace_back();
+  slot_users.emplace_back();
+
+  // For variable instructions, arg2 is a register, not a slot
+  if (type != InstructionType::variable)
+    for (int arg : { arg1, arg2, arg3 })
+      if (arg >= 0)
+        slot_users[arg].push_back(slot);
+  return slot;
+}
+
+int
+EvalTape::getRegister(int symb_id)
+{
+  auto it = symbol_registers.find(symb_id);
+  if (it != symbol_registers.end())
+    return it->second;
+
+  int reg = register_symbols.size();
+  register_symbols.push_back(symb_id);
+  assigned_registers.push_back(false);
+  symbol_registers[symb_id] = reg;
+  return reg;
+}
+
+int
+EvalTape::add(expr_t expr)
+{
+  return expr->addToTape(*this, node_slots);
+}
+
+void
+EvalTape::addAssignment(int symb_id, expr_t expr)
+{
+  int slot = add(expr);
+  int reg = getRegister(symb_id);
+  assigned_registers[reg] = true;
+  addInstruction(InstructionType::assignment, 0, slot, reg, -1, 0);
+
+  /* The slots that depend on the old value of the symbol cannot be reused by
+     the expressions added from now on. The other ones can */
+  auto it = variable_slots.find(symb_id);
+  if (it != variable_slots.end())
+    {
+      forgetDependentSlots(it->second);
+      variable_slots.erase(it);
+    }
+}
+
+void
+EvalTape::forgetDependentSlots(int slot)
+{
+  /* A slot whose nodes have been forgotten is never used by the instructions
+     added afterwards, so each slot is visited at most once over all the
+     assignments */
+  vector<int> stack { slot };
+  while (!stack.empty())
+    {
+      int s = stack.back();
+      stack.pop_back();
+      for (auto node : slot_nodes[s])
+        node_slots.erase(node);
+      slot_nodes[s].clear();
+      stack.insert(stack.end(), slot_users[s].begin(), slot_users[s].end());
+      slot_users[s].clear();
+    }
+}
+
+void
+EvalTape::setSlotNode(int slot, const ExprNode *node)
+{
+  slot_nodes[slot].push_back(node);
+}
+
+int
+EvalTape::addConstant(double value)
+{
+  return addInstruction(InstructionType::constant, 0, -1, -1, -1, value);
+}
+
+int
+EvalTape::addVariable(int symb_id)
+{
+  // The lag of variables is ignored by evaluation, so all of them share the same slot
+  auto it = variable_slots.find(symb_id);
+  if (it != variable_slots.end())
+    return it->second;
+
+  int slot = addInstruction(InstructionType::variable, 0, -1, getRegister(symb_id), -1, 0);
+  variable_slots[symb_id] = slot;
+  return slot;
+}
+
+int
+EvalTape::addUnaryOp(UnaryOpcode op_code, int arg)
+{
+  return addInstruction(InstructionType::unaryOp, static_cast<int>(op_code), arg, -1, -1, 0);
+}
+
+int
+EvalTape::addBinaryOp(BinaryOpcode op_code, int arg1, int arg2, int powerDerivOrder)
+{
+  return addInstruction(InstructionType::binaryOp, static_cast<int>(op_code), arg1, arg2, -1, powerDerivOrder);
+}
+
+int
+EvalTape::addTrinaryOp(TrinaryOpcode op_code, int arg1, int arg2, int arg3)
+{
+  return addInstruction(InstructionType::trinaryOp, static_cast<int>(op_code), arg1, arg2, arg3, 0);
+}
+
+int
+EvalTape::addEvalError(bool external_function)
+{
+  return addInstruction(external_function ? InstructionType::externalFunction : InstructionType::evalError,
+                        0, -1, -1, -1, 0);
+}
+
+void
+EvalTape::eval(const eval_context_t &eval_context)
+{
+  register_values.assign(register_symbols.size(), 0);
+  register_known.assign(register_symbols.size(), false);
+  for (int reg = 0; reg < (int) register_symbols.size(); reg++)
+    if (eval_context.isKnown(register_symbols[reg]))
+      {
+        register_values[reg] = eval_context.get(register_symbols[reg]);
+        register_known[reg] = true;
+      }
+
+  values.resize(instructions.size());
+  status.resize(instructions.size());
+  for (int i = 0; i < (int) instructions.size(); i++)
+    {
+      const Instruction &ins = instructions[i];
+      /* An instruction fails as its first failing argument, since the
+         recursive evaluation stops at the first exception */
+      SlotStatus st = SlotStatus::ok;
+      switch (ins.type)
+        {
+        case InstructionType::constant:
+          values[i] = ins.value;
+          break;
+        case InstructionType::variable:
+          if (register_known[ins.arg2])
+            values[i] = register_values[ins.arg2];
+          else
+            st = SlotStatus::evalError;
+          break;
+        case InstructionType::unaryOp:
+          st = status[ins.arg1];
+          if (st == SlotStatus::ok)
+            values[i] = UnaryOpNode::eval_opcode(static_cast<UnaryOpcode>(ins.op_code), values[ins.arg1]);
+          break;
+        case InstructionType::binaryOp:
+          st = status[ins.arg1] != SlotStatus::ok ? status[ins.arg1] : status[ins.arg2];
+          if (st == SlotStatus::ok)
+            try
+              {
+                values[i] = BinaryOpNode::eval_opcode(values[ins.arg1], static_cast<BinaryOpcode>(ins.op_code),
+                                                      values[ins.arg2], static_cast<int>(ins.value));
+              }
+            catch (ExprNode::EvalException &e)
+              {
+                st = SlotStatus::evalError;
+              }
+          break;
+        case InstructionType::trinaryOp:
+          st = status[ins.arg1] != SlotStatus::ok ? status[ins.arg1]
+            : status[ins.arg2] != SlotStatus::ok ? status[ins.arg2] : status[ins.arg3];
+          if (st == SlotStatus::ok)
+            values[i] = TrinaryOpNode::eval_opcode(values[ins.arg1], static_cast<TrinaryOpcode>(ins.op_code),
+                                                   values[ins.arg2], values[ins.arg3]);
+          break;
+        case InstructionType::evalError:
+          st = SlotStatus::evalError;
+          break;
+        case InstructionType::externalFunction:
+          st = SlotStatus::externalFunction;
+          break;
+        case InstructionType::assignment:
+          st = status[ins.arg1];
+          if (st == SlotStatus::ok)
+            {
+              values[i] = values[ins.arg1];
+              register_values[ins.arg2] = values[ins.arg1];
+              register_known[ins.arg2] = true;
+            }
+          break;
+        }
+      status[i] = st;
+    }
+}
+
+double
+EvalTape::getValue(int slot) const noexcept(false)
+{
+  assert(slot >= 0 && slot < (int) status.size());
+  switch (status[slot])
+    {
+    case SlotStatus::ok:
+      break;
+    case SlotStatus::evalError:
+      throw ExprNode::EvalException();
+    case SlotStatus::externalFunction:
+      throw ExprNode::EvalExternalFunctionException();
+    }
+  return values[slot];
+}
+
+void
+EvalTape::writeAssignments(eval_context_t &eval_context) const
+{
+  for (int reg = 0; reg < (int) register_symbols.size(); reg++)
+    if (assigned_registers[reg] && register_known[reg])
+      eval_context.set(register_symbols[reg], register_values[reg]);
+}
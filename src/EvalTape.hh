@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EVAL_TAPE_HH
+#define _EVAL_TAPE_HH
+
+#include <vector>
+#include <map>
+
+using namespace std;
+
+#include "ExprNode.hh"
+
+//! Flat representation of a set of expressions, for their repeated evaluation
+/*! The nodes of the expressions are compiled into an array of instructions
+  sorted in topological order, each of which computes the value of one slot.
+  A node shared by several expressions is compiled, and thus evaluated, only
+  once. The values are those that ExprNode::eval() would have returned, and
+  the errors are reported by getValue() with the same exceptions.
+
+  Expressions can also be assigned to symbols: the expressions added after the
+  assignment then see the new value of the symbol, as would be the case with a
+  sequence of ExprNode::eval() calls updating the evaluation context. Only the
+  slots depending on the old value of the symbol are compiled again; the others
+  remain shared with the expressions added after the assignment. */
+class EvalTape
+{
+private:
+  enum class InstructionType
+    {
+     constant,
+     variable,
+     unaryOp,
+     binaryOp,
+     trinaryOp,
+     evalError,
+     externalFunction,
+     assignment
+    };
+
+  //! Outcome of the evaluation of a slot
+  enum class SlotStatus : unsigned char
+    {
+     ok,
+     //! ExprNode::eval() would have thrown EvalException
+     evalError,
+     //! ExprNode::eval() would have thrown EvalExternalFunctionException
+     externalFunction
+    };
+
+  struct Instruction
+  {
+    InstructionType type;
+    //! Operator code (for unaryOp, binaryOp and trinaryOp)
+    int op_code;
+    //! Slots of the arguments; for variable and assignment, arg2 is the register of the symbol
+    int arg1, arg2, arg3;
+    //! Value of a constant, or derivation order of the powerDeriv operator
+    double value;
+  };
+
+  vector<Instruction> instructions;
+  //! Slots of the nodes already compiled (see ExprNode::addToTape())
+  ExprNode::memo_table_t<int> node_slots;
+  //! Nodes compiled into each slot (several variable nodes of different lags may share a slot)
+  vector<vector<const ExprNode *>> slot_nodes;
+  //! Slots using the value of each slot as argument
+  vector<vector<int>> slot_users;
+  //! Slots holding the current value of symbols (symbol ID -> slot)
+  map<int, int> variable_slots;
+
+  //! Symbol IDs of the registers, which hold the values of the symbols during evaluation
+  vector<int> register_symbols;
+  //! Maps symbol IDs to registers
+  map<int, int> symbol_registers;
+  //! Registers that are targets of an assignment
+  vector<bool> assigned_registers;
+
+  //! Results of the last evaluation
+  vector<double> values;
+  vector<SlotStatus> status;
+  vector<double> register_values;
+  vector<bool> register_known;
+
+  int addInstruction(InstructionType type, int op_code, int arg1, int arg2, int arg3, double value);
+  int getRegister(int symb_id);
+  //! Removes from node_slots the nodes whose slot depends on the given slot
+  void forgetDependentSlots(int slot);
+public:
+  //! Adds an expression to the tape, and returns the index of the slot holding its value
+  int add(expr_t expr);
+  //! Adds an expression whose value is assigned to a symbol
+  /*! If the evaluation of the expression fails, the symbol keeps its value */
+  void addAssignment(int symb_id, expr_t expr);
+
+  //! Instructions used by ExprNode::addToTapeInternal(); they return the slot of their result
+  int addConstant(double value);
+  int addVariable(int symb_id);
+  int addUnaryOp(UnaryOpcode op_code, int arg);
+  int addBinaryOp(BinaryOpcode op_code, int arg1, int arg2, int powerDerivOrder);
+  int addTrinaryOp(TrinaryOpcode op_code, int arg1, int arg2, int arg3);
+  //! Adds a slot whose evaluation fails
+  int addEvalError(bool external_function);
+  //! Records that a node was compiled into a slot (called by ExprNode::addToTape())
+  void setSlotNode(int slot, const ExprNode *node);
+
+  //! Evaluates all the slots of the tape, with the symbol values given by the evaluation context
+  void eval(const eval_context_t &eval_context);
+  //! Returns the value of a slot, as computed by the last call to eval()
+  /*! Throws the exception that ExprNode::eval() would have thrown */
+  double getValue(int slot) const noexcept(false);
+  //! Stores the values of the symbols assigned by the last call to eval() in an evaluation context
+  void writeAssignments(eval_context_t &eval_context) const;
+
+  //! Returns the number of instructions of the tape
+  int
+  size() const
+  {
+    return instructions.size();
+  }
+};
+
+#endif
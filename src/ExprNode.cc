@@ -26,11 +26,14 @@
 
 #include <utility>
 
+#include <boost/functional/hash.hpp>
+
 #include "ExprNode.hh"
 #include "DataTree.hh"
+#include "EvalTape.hh"
 #include "ModFile.hh"
 
-ExprNode::ExprNode(DataTree &datatree_arg, int idx_arg) : datatree{datatree_arg}, idx{idx_arg}, preparedForDerivation{false}
+ExprNode::ExprNode(DataTree &datatree_arg, int idx_arg) : datatree{datatree_arg}, idx{idx_arg}, preparedForDerivation{false}, structural_hash{0}
 {
 }
 
@@ -44,20 +47,51 @@ ExprNode::getDerivative(int deriv_id)
     prepareForDerivation();
 
   // Return zero if derivative is necessarily null (using symbolic a priori)
-  auto it = non_null_derivatives.find(deriv_id);
-  if (it == non_null_derivatives.end())
+  int i = nonNullDerivativeIndex(deriv_id);
+  if (i < 0)
     return datatree.Zero;
 
   // If derivative is stored in cache, use the cached value, otherwise compute it (and cache it)
-  map<int, expr_t>::const_iterator it2 = derivatives.find(deriv_id);
-  if (it2 != derivatives.end())
-    return it2->second;
-  else
+  if (derivatives.empty())
+    derivatives.resize(non_null_derivatives.size(), nullptr);
+  if (!derivatives[i])
+    derivatives[i] = computeDerivative(deriv_id);
+  return derivatives[i];
+}
+
+int
+ExprNode::nonNullDerivativeIndex(int deriv_id) const
+{
+  auto it = lower_bound(non_null_derivatives.begin(), non_null_derivatives.end(), deriv_id);
+  if (it == non_null_derivatives.end() || *it != deriv_id)
+    return -1;
+  return it - non_null_derivatives.begin();
+}
+
+vector<int>
+ExprNode::mergeNonNullDerivatives(const vector<int> &v1, const vector<int> &v2)
+{
+  // Compute the size of the union first, so that the result is allocated only once
+  size_t n = 0;
+  auto it1 = v1.begin(), it2 = v2.begin();
+  while (it1 != v1.end() && it2 != v2.end())
     {
-      expr_t d = computeDerivative(deriv_id);
-      derivatives[deriv_id] = d;
-      return d;
+      if (*it1 <= *it2)
+        {
+          if (*it1 == *it2)
+            ++it2;
+          ++it1;
+        }
+      else
+        ++it2;
+      n++;
     }
+  n += (v1.end() - it1) + (v2.end() - it2);
+
+  vector<int> result;
+  result.reserve(n);
+  set_union(v1.begin(), v1.end(), v2.begin(), v2.end(), back_inserter(result));
+  return result;
 }
 
 int
@@ -107,7 +141,10 @@ ExprNode::checkIfTemporaryTermThenWrite(ostream &output, ExprNodeOutputType outp
   if (output_type == ExprNodeOutputType::matlabDynamicModelSparse)
     output << "T" << idx << "(it_)";
   else
-    if (output_type == ExprNodeOutputType::matlabStaticModelSparse || isCOutput(output_type))
+    if (output_type == ExprNodeOutputType::matlabStaticModelSparse
+        || output_type == ExprNodeOutputType::CDynamicModel
+        || output_type == ExprNodeOutputType::CStaticModel
+        || output_type == ExprNodeOutputType::CDynamicSteadyStateOperator)
       output << "T" << idx;
     else
       {
@@ -121,6 +158,439 @@ ExprNode::checkIfTemporaryTermThenWrite(ostream &output, ExprNodeOutputType outp
   return true;
 }
 
+void
+ExprNode::LeadLagInfo::merge(const LeadLagInfo &other)
+{
+  max_endo_lead = max(max_endo_lead, other.max_endo_lead);
+  max_exo_lead = max(max_exo_lead, other.max_exo_lead);
+  max_endo_lag = max(max_endo_lag, other.max_endo_lag);
+  max_exo_lag = max(max_exo_lag, other.max_exo_lag);
+  max_lead = max(max_lead, other.max_lead);
+  max_lag = max(max_lag, other.max_lag);
+}
+
+void
+ExprNode::mergeLeadLag(const ExprNode *arg)
+{
+  lead_lag.merge(arg->lead_lag);
+  lead_lag_cached = lead_lag_cached && arg->lead_lag_cached;
+}
+
+expr_t
+ExprNode::cloneDynamic(DataTree &dynamic_datatree) const
+{
+  expr_memo_t memo;
+  return cloneDynamic(dynamic_datatree, memo);
+}
+
+expr_t
+ExprNode::cloneDynamic(DataTree &dynamic_datatree, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return cloneDynamicInternal(dynamic_datatree, memo); });
+}
+
+int
+ExprNode::addToTape(EvalTape &tape, memo_table_t<int> &memo) const
+{
+  return memoize(memo, [&]
+                 {
+                   int slot = addToTapeInternal(tape, memo);
+                   tape.setSlotNode(slot, this);
+                   return slot;
+                 });
+}
+
+void
+ExprNode::collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const
+{
+  visited_set_t visited;
+  collectDynamicVariables(type_arg, result, visited);
+}
+
+void
+ExprNode::collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const
+{
+  if (visited.insert(this).second)
+    collectDynamicVariablesInternal(type_arg, result, visited);
+}
+
+expr_t
+ExprNode::toStatic(DataTree &static_datatree) const
+{
+  expr_memo_t memo;
+  return toStatic(static_datatree, memo);
+}
+
+expr_t
+ExprNode::toStatic(DataTree &static_datatree, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return toStaticInternal(static_datatree, memo); });
+}
+
+int
+ExprNode::maxEndoLead() const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_endo_lead;
+  memo_table_t<int> memo;
+  return maxEndoLead(memo);
+}
+
+int
+ExprNode::maxEndoLead(memo_table_t<int> &memo) const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_endo_lead;
+  return memoize(memo, [&] { return maxEndoLeadInternal(memo); });
+}
+
+int
+ExprNode::maxExoLead() const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_exo_lead;
+  memo_table_t<int> memo;
+  return maxExoLead(memo);
+}
+
+int
+ExprNode::maxExoLead(memo_table_t<int> &memo) const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_exo_lead;
+  return memoize(memo, [&] { return maxExoLeadInternal(memo); });
+}
+
+int
+ExprNode::maxEndoLag() const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_endo_lag;
+  memo_table_t<int> memo;
+  return maxEndoLag(memo);
+}
+
+int
+ExprNode::maxEndoLag(memo_table_t<int> &memo) const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_endo_lag;
+  return memoize(memo, [&] { return maxEndoLagInternal(memo); });
+}
+
+int
+ExprNode::maxExoLag() const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_exo_lag;
+  memo_table_t<int> memo;
+  return maxExoLag(memo);
+}
+
+int
+ExprNode::maxExoLag(memo_table_t<int> &memo) const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_exo_lag;
+  return memoize(memo, [&] { return maxExoLagInternal(memo); });
+}
+
+int
+ExprNode::maxLead() const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_lead;
+  memo_table_t<int> memo;
+  return maxLead(memo);
+}
+
+int
+ExprNode::maxLead(memo_table_t<int> &memo) const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_lead;
+  return memoize(memo, [&] { return maxLeadInternal(memo); });
+}
+
+int
+ExprNode::maxLag() const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_lag;
+  memo_table_t<int> memo;
+  return maxLag(memo);
+}
+
+int
+ExprNode::maxLag(memo_table_t<int> &memo) const
+{
+  if (lead_lag_cached)
+    return lead_lag.max_lag;
+  return memoize(memo, [&] { return maxLagInternal(memo); });
+}
+
+expr_t
+ExprNode::undiff() const
+{
+  expr_memo_t memo;
+  return undiff(memo);
+}
+
+expr_t
+ExprNode::undiff(expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return undiffInternal(memo); });
+}
+
+expr_t
+ExprNode::decreaseLeadsLags(int n) const
+{
+  expr_memo_t memo;
+  return decreaseLeadsLags(n, memo);
+}
+
+expr_t
+ExprNode::decreaseLeadsLags(int n, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return decreaseLeadsLagsInternal(n, memo); });
+}
+
+expr_t
+ExprNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+{
+  expr_memo_t memo;
+  return substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo);
+}
+
+expr_t
+ExprNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return substituteEndoLeadGreaterThanTwoInternal(subst_table, neweqs, deterministic_model, memo); });
+}
+
+expr_t
+ExprNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+{
+  expr_memo_t memo;
+  return substituteEndoLagGreaterThanTwo(subst_table, neweqs, memo);
+}
+
+expr_t
+ExprNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return substituteEndoLagGreaterThanTwoInternal(subst_table, neweqs, memo); });
+}
+
+expr_t
+ExprNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+{
+  expr_memo_t memo;
+  return substituteExoLead(subst_table, neweqs, deterministic_model, memo);
+}
+
+expr_t
+ExprNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return substituteExoLeadInternal(subst_table, neweqs, deterministic_model, memo); });
+}
+
+expr_t
+ExprNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+{
+  expr_memo_t memo;
+  return substituteExoLag(subst_table, neweqs, memo);
+}
+
+expr_t
+ExprNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return substituteExoLagInternal(subst_table, neweqs, memo); });
+}
+
+expr_t
+ExprNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const
+{
+  expr_memo_t memo;
+  return substituteExpectation(subst_table, neweqs, partial_information_model, memo);
+}
+
+expr_t
+ExprNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return substituteExpectationInternal(subst_table, neweqs, partial_information_model, memo); });
+}
+
+expr_t
+ExprNode::decreaseLeadsLagsPredeterminedVariables() const
+{
+  expr_memo_t memo;
+  return decreaseLeadsLagsPredeterminedVariables(memo);
+}
+
+expr_t
+ExprNode::decreaseLeadsLagsPredeterminedVariables(expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return decreaseLeadsLagsPredeterminedVariablesInternal(memo); });
+}
+
+expr_t
+ExprNode::differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+{
+  expr_memo_t memo;
+  return differentiateForwardVars(subset, subst_table, neweqs, memo);
+}
+
+expr_t
+ExprNode::differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return differentiateForwardVarsInternal(subset, subst_table, neweqs, memo); });
+}
+
+expr_t
+ExprNode::replaceTrendVar() const
+{
+  expr_memo_t memo;
+  return replaceTrendVar(memo);
+}
+
+expr_t
+ExprNode::replaceTrendVar(expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return replaceTrendVarInternal(memo); });
+}
+
+expr_t
+ExprNode::detrend(int symb_id, bool log_trend, expr_t trend) const
+{
+  expr_memo_t memo;
+  return detrend(symb_id, log_trend, trend, memo);
+}
+
+expr_t
+ExprNode::detrend(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return detrendInternal(symb_id, log_trend, trend, memo); });
+}
+
+expr_t
+ExprNode::substituteAdl() const
+{
+  expr_memo_t memo;
+  return substituteAdl(memo);
+}
+
+expr_t
+ExprNode::substituteAdl(expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return substituteAdlInternal(memo); });
+}
+
+expr_t
+ExprNode::substituteVarExpectation(const map<string, expr_t> &subst_table) const
+{
+  expr_memo_t memo;
+  return substituteVarExpectation(subst_table, memo);
+}
+
+expr_t
+ExprNode::substituteVarExpectation(const map<string, expr_t> &subst_table, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return substituteVarExpectationInternal(subst_table, memo); });
+}
+
+void
+ExprNode::findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const
+{
+  visited_set_t visited;
+  findDiffNodes(static_datatree, diff_table, visited);
+}
+
+void
+ExprNode::findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const
+{
+  if (visited.insert(this).second)
+    findDiffNodesInternal(static_datatree, diff_table, visited);
+}
+
+void
+ExprNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const
+{
+  visited_set_t visited;
+  findUnaryOpNodesForAuxVarCreation(static_datatree, nodes, visited);
+}
+
+void
+ExprNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const
+{
+  if (visited.insert(this).second)
+    findUnaryOpNodesForAuxVarCreationInternal(static_datatree, nodes, visited);
+}
+
+expr_t
+ExprNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+{
+  expr_memo_t memo;
+  return substituteDiff(static_datatree, diff_table, subst_table, neweqs, memo);
+}
+
+expr_t
+ExprNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return substituteDiffInternal(static_datatree, diff_table, subst_table, neweqs, memo); });
+}
+
+expr_t
+ExprNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+{
+  expr_memo_t memo;
+  return substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs, memo);
+}
+
+expr_t
+ExprNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return substituteUnaryOpNodesInternal(static_datatree, nodes, subst_table, neweqs, memo); });
+}
+
+expr_t
+ExprNode::substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table)
+{
+  expr_memo_t memo;
+  return substitutePacExpectation(subst_table, memo);
+}
+
+expr_t
+ExprNode::substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo)
+{
+  return memoize(memo, [&] { return substitutePacExpectationInternal(subst_table, memo); });
+}
+
+expr_t
+ExprNode::removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const
+{
+  expr_memo_t memo;
+  return removeTrendLeadLag(trend_symbols_map, memo);
+}
+
+expr_t
+ExprNode::removeTrendLeadLag(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return removeTrendLeadLagInternal(trend_symbols_map, memo); });
+}
+
+expr_t
+ExprNode::substituteStaticAuxiliaryVariable() const
+{
+  expr_memo_t memo;
+  return substituteStaticAuxiliaryVariable(memo);
+}
+
+expr_t
+ExprNode::substituteStaticAuxiliaryVariable(expr_memo_t &memo) const
+{
+  return memoize(memo, [&] { return substituteStaticAuxiliaryVariableInternal(memo); });
+}
+
 void
 ExprNode::collectVariables(SymbolType type, set<int> &result) const
 {
@@ -320,6 +790,10 @@ NumConstNode::NumConstNode(DataTree &datatree_arg, int idx_arg, int id_arg) :
   ExprNode(datatree_arg, idx_arg),
   id(id_arg)
 {
+  boost::hash_combine(structural_hash, 'n');
+  boost::hash_combine(structural_hash, datatree.num_constants.get(id));
+  constant = true;
+  constant_value = datatree.num_constants.getDouble(id);
 }
 
 int
@@ -380,6 +854,12 @@ NumConstNode::eval(const eval_context_t &eval_context) const noexcept(false)
   return (datatree.num_constants.getDouble(id));
 }
 
+int
+NumConstNode::addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const
+{
+  return tape.addConstant(datatree.num_constants.getDouble(id));
+}
+
 void
 NumConstNode::compile(ostream &CompileCode, unsigned int &instruction_number,
                       bool lhs_rhs, const temporary_terms_t &temporary_terms,
@@ -398,7 +878,7 @@ NumConstNode::collectVARLHSVariable(set<expr_t> &result) const
 }
 
 void
-NumConstNode::collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const
+NumConstNode::collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const
 {
 }
 
@@ -416,7 +896,7 @@ NumConstNode::getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recur
 }
 
 expr_t
-NumConstNode::toStatic(DataTree &static_datatree) const
+NumConstNode::toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const
 {
   return static_datatree.AddNonNegativeConstant(datatree.num_constants.get(id));
 }
@@ -427,49 +907,49 @@ NumConstNode::computeXrefs(EquationInfo &ei) const
 }
 
 expr_t
-NumConstNode::cloneDynamic(DataTree &dynamic_datatree) const
+NumConstNode::cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const
 {
   return dynamic_datatree.AddNonNegativeConstant(datatree.num_constants.get(id));
 }
 
 int
-NumConstNode::maxEndoLead() const
+NumConstNode::maxEndoLeadInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 int
-NumConstNode::maxExoLead() const
+NumConstNode::maxExoLeadInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 int
-NumConstNode::maxEndoLag() const
+NumConstNode::maxEndoLagInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 int
-NumConstNode::maxExoLag() const
+NumConstNode::maxExoLagInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 int
-NumConstNode::maxLead() const
+NumConstNode::maxLeadInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 int
-NumConstNode::maxLag() const
+NumConstNode::maxLagInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 expr_t
-NumConstNode::undiff() const
+NumConstNode::undiffInternal(expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
@@ -493,66 +973,66 @@ NumConstNode::PacMaxLag(int lhs_symb_id) const
 }
 
 expr_t
-NumConstNode::decreaseLeadsLags(int n) const
+NumConstNode::decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::decreaseLeadsLagsPredeterminedVariables() const
+NumConstNode::decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+NumConstNode::substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+NumConstNode::substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+NumConstNode::substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+NumConstNode::substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const
+NumConstNode::substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::substituteAdl() const
+NumConstNode::substituteAdlInternal(expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::substituteVarExpectation(const map<string, expr_t> &subst_table) const
+NumConstNode::substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 void
-NumConstNode::findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const
+NumConstNode::findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const
 {
 }
 
 void
-NumConstNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const
+NumConstNode::findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const
 {
 }
 
@@ -563,25 +1043,25 @@ NumConstNode::findTrendVariable(int lhs_symb_id) const
 }
 
 expr_t
-NumConstNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+NumConstNode::substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+NumConstNode::substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table)
+NumConstNode::substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo)
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+NumConstNode::differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
@@ -625,19 +1105,19 @@ NumConstNode::containsExogenous() const
 }
 
 expr_t
-NumConstNode::replaceTrendVar() const
+NumConstNode::replaceTrendVarInternal(expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::detrend(int symb_id, bool log_trend, expr_t trend) const
+NumConstNode::detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
 
 expr_t
-NumConstNode::removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const
+NumConstNode::removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
@@ -690,7 +1170,7 @@ NumConstNode::isVarModelReferenced(const string &model_info_name) const
 }
 
 expr_t
-NumConstNode::substituteStaticAuxiliaryVariable() const
+NumConstNode::substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const
 {
   return const_cast<NumConstNode *>(this);
 }
@@ -709,6 +1189,31 @@ VariableNode::VariableNode(DataTree &datatree_arg, int idx_arg, int symb_id_arg,
   // It makes sense to allow a lead/lag on parameters: during steady state calibration, endogenous and parameters can be swapped
   assert(type != SymbolType::externalFunction
          && (lag == 0 || (type != SymbolType::modelLocalVariable && type != SymbolType::modFileLocalVariable)));
+
+  boost::hash_combine(structural_hash, 'v');
+  boost::hash_combine(structural_hash, datatree.symbol_table.getName(symb_id));
+  boost::hash_combine(structural_hash, lag);
+
+  switch (type)
+    {
+    case SymbolType::endogenous:
+      lead_lag.max_endo_lead = max(lag, 0);
+      lead_lag.max_endo_lag = max(-lag, 0);
+      lead_lag.max_lead = lag;
+      lead_lag.max_lag = -lag;
+      break;
+    case SymbolType::exogenous:
+      lead_lag.max_exo_lead = max(lag, 0);
+      lead_lag.max_exo_lag = max(-lag, 0);
+      lead_lag.max_lead = lag;
+      lead_lag.max_lag = -lag;
+      break;
+    case SymbolType::modelLocalVariable:
+      lead_lag_cached = false;
+      break;
+    default:
+      break;
+    }
 }
 
 void
@@ -729,7 +1234,7 @@ VariableNode::prepareForDerivation()
     case SymbolType::trend:
     case SymbolType::logTrend:
       // For a variable or a parameter, the only non-null derivative is with respect to itself
-      non_null_derivatives.insert(datatree.getDerivID(symb_id, lag));
+      non_null_derivatives.push_back(datatree.getDerivID(symb_id, lag));
       break;
     case SymbolType::modelLocalVariable:
       datatree.getLocalVariable(symb_id)->prepareForDerivation();
@@ -868,7 +1373,8 @@ VariableNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
     case SymbolType::modelLocalVariable:
       if (output_type == ExprNodeOutputType::matlabDynamicModelSparse || output_type == ExprNodeOutputType::matlabStaticModelSparse
           || output_type == ExprNodeOutputType::matlabDynamicSteadyStateOperator || output_type == ExprNodeOutputType::matlabDynamicSparseSteadyStateOperator
-          || output_type == ExprNodeOutputType::CDynamicSteadyStateOperator)
+          || output_type == ExprNodeOutputType::CDynamicSteadyStateOperator
+          || output_type == ExprNodeOutputType::CDynamicSplitSteadyStateOperator)
         {
           output << "(";
           datatree.getLocalVariable(symb_id)->writeOutput(output, output_type, temporary_terms, temporary_terms_idxs, tef_terms);
@@ -890,6 +1396,7 @@ VariableNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
         case ExprNodeOutputType::juliaDynamicModel:
         case ExprNodeOutputType::matlabDynamicModel:
         case ExprNodeOutputType::CDynamicModel:
+        case ExprNodeOutputType::CDynamicModelSplit:
           i = datatree.getDynJacobianCol(datatree.getDerivID(symb_id, lag)) + ARRAY_SUBSCRIPT_OFFSET(output_type);
           output <<  "y" << LEFT_ARRAY_SUBSCRIPT(output_type) << i << RIGHT_ARRAY_SUBSCRIPT(output_type);
           break;
@@ -918,6 +1425,7 @@ VariableNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
           output << "steady_state" << LEFT_ARRAY_SUBSCRIPT(output_type) << tsid + 1 << RIGHT_ARRAY_SUBSCRIPT(output_type);
           break;
         case ExprNodeOutputType::CDynamicSteadyStateOperator:
+        case ExprNodeOutputType::CDynamicSplitSteadyStateOperator:
           output << "steady_state[" << tsid << "]";
           break;
         case ExprNodeOutputType::juliaSteadyStateFile:
@@ -960,6 +1468,7 @@ VariableNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
                    << RIGHT_ARRAY_SUBSCRIPT(output_type);
           break;
         case ExprNodeOutputType::CDynamicModel:
+        case ExprNodeOutputType::CDynamicModelSplit:
           if (lag == 0)
             output <<  "x[it_+" << i << "*nb_row_x]";
           else if (lag > 0)
@@ -1020,6 +1529,7 @@ VariableNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
                    << RIGHT_ARRAY_SUBSCRIPT(output_type);
           break;
         case ExprNodeOutputType::CDynamicModel:
+        case ExprNodeOutputType::CDynamicModelSplit:
           if (lag == 0)
             output <<  "x[it_+" << i << "*nb_row_x]";
           else if (lag > 0)
@@ -1081,13 +1591,13 @@ VariableNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
 }
 
 expr_t
-VariableNode::substituteStaticAuxiliaryVariable() const
+VariableNode::substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const
 {
   if (type == SymbolType::endogenous)
     {
       try
         {
-          return datatree.symbol_table.getAuxiliaryVarsExprNode(symb_id)->substituteStaticAuxiliaryVariable();
+          return datatree.symbol_table.getAuxiliaryVarsExprNode(symb_id)->substituteStaticAuxiliaryVariable(memo);
         }
       catch (SymbolTable::SearchFailedException &e)
         {
@@ -1099,11 +1609,16 @@ VariableNode::substituteStaticAuxiliaryVariable() const
 double
 VariableNode::eval(const eval_context_t &eval_context) const noexcept(false)
 {
-  auto it = eval_context.find(symb_id);
-  if (it == eval_context.end())
+  if (!eval_context.isKnown(symb_id))
     throw EvalException();
 
-  return it->second;
+  return eval_context.get(symb_id);
+}
+
+int
+VariableNode::addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const
+{
+  return tape.addVariable(symb_id);
 }
 
 void
@@ -1205,12 +1720,12 @@ VariableNode::collectVARLHSVariable(set<expr_t> &result) const
 }
 
 void
-VariableNode::collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const
+VariableNode::collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const
 {
   if (type == type_arg)
     result.emplace(symb_id, lag);
   if (type == SymbolType::modelLocalVariable)
-    datatree.getLocalVariable(symb_id)->collectDynamicVariables(type_arg, result);
+    datatree.getLocalVariable(symb_id)->collectDynamicVariables(type_arg, result, visited);
 }
 
 pair<int, expr_t>
@@ -1264,8 +1779,8 @@ VariableNode::getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recur
           auto it = recursive_variables.find(datatree.getDerivID(symb_id, lag));
           if (it != recursive_variables.end())
             {
-              map<int, expr_t>::const_iterator it2 = derivatives.find(deriv_id);
-              if (it2 != derivatives.end())
+              auto it2 = chain_rule_derivatives.find(deriv_id);
+              if (it2 != chain_rule_derivatives.end())
                 return it2->second;
               else
                 {
@@ -1274,7 +1789,7 @@ VariableNode::getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recur
                   //expr_t c = datatree.AddNonNegativeConstant("1");
                   expr_t d = datatree.AddUMinus(it->second->getChainRuleDerivative(deriv_id, recursive_vars2));
                   //d = datatree.AddTimes(c, d);
-                  derivatives[deriv_id] = d;
+                  chain_rule_derivatives[deriv_id] = d;
                   return d;
                 }
             }
@@ -1305,7 +1820,7 @@ VariableNode::getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recur
 }
 
 expr_t
-VariableNode::toStatic(DataTree &static_datatree) const
+VariableNode::toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const
 {
   return static_datatree.AddVariable(symb_id);
 }
@@ -1343,69 +1858,69 @@ VariableNode::computeXrefs(EquationInfo &ei) const
 }
 
 expr_t
-VariableNode::cloneDynamic(DataTree &dynamic_datatree) const
+VariableNode::cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const
 {
   return dynamic_datatree.AddVariable(symb_id, lag);
 }
 
 int
-VariableNode::maxEndoLead() const
+VariableNode::maxEndoLeadInternal(memo_table_t<int> &memo) const
 {
   switch (type)
     {
     case SymbolType::endogenous:
       return max(lag, 0);
     case SymbolType::modelLocalVariable:
-      return datatree.getLocalVariable(symb_id)->maxEndoLead();
+      return datatree.getLocalVariable(symb_id)->maxEndoLead(memo);
     default:
       return 0;
     }
 }
 
 int
-VariableNode::maxExoLead() const
+VariableNode::maxExoLeadInternal(memo_table_t<int> &memo) const
 {
   switch (type)
     {
     case SymbolType::exogenous:
       return max(lag, 0);
     case SymbolType::modelLocalVariable:
-      return datatree.getLocalVariable(symb_id)->maxExoLead();
+      return datatree.getLocalVariable(symb_id)->maxExoLead(memo);
     default:
       return 0;
     }
 }
 
 int
-VariableNode::maxEndoLag() const
+VariableNode::maxEndoLagInternal(memo_table_t<int> &memo) const
 {
   switch (type)
     {
     case SymbolType::endogenous:
       return max(-lag, 0);
     case SymbolType::modelLocalVariable:
-      return datatree.getLocalVariable(symb_id)->maxEndoLag();
+      return datatree.getLocalVariable(symb_id)->maxEndoLag(memo);
     default:
       return 0;
     }
 }
 
 int
-VariableNode::maxExoLag() const
+VariableNode::maxExoLagInternal(memo_table_t<int> &memo) const
 {
   switch (type)
     {
     case SymbolType::exogenous:
       return max(-lag, 0);
     case SymbolType::modelLocalVariable:
-      return datatree.getLocalVariable(symb_id)->maxExoLag();
+      return datatree.getLocalVariable(symb_id)->maxExoLag(memo);
     default:
       return 0;
     }
 }
 
 int
-VariableNode::maxLead() const
+VariableNode::maxLeadInternal(memo_table_t<int> &memo) const
 {
   switch (type)
     {
@@ -1414,7 +1929,7 @@ VariableNode::maxLead() const
     case SymbolType::exogenous:
       return lag;
     case SymbolType::modelLocalVariable:
-      return datatree.getLocalVariable(symb_id)->maxLead();
+      return datatree.getLocalVariable(symb_id)->maxLead(memo);
     default:
       return 0;
     }
@@ -1440,7 +1955,7 @@ VariableNode::VarMinLag() const
 }
 
 int
-VariableNode::maxLag() const
+VariableNode::maxLagInternal(memo_table_t<int> &memo) const
 {
   switch (type)
     {
@@ -1449,14 +1964,14 @@ VariableNode::maxLag() const
     case SymbolType::exogenous:
       return -lag;
     case SymbolType::modelLocalVariable:
-      return datatree.getLocalVariable(symb_id)->maxLag();
+      return datatree.getLocalVariable(symb_id)->maxLag(memo);
     default:
       return 0;
     }
 }
 
 expr_t
-VariableNode::undiff() const
+VariableNode::undiffInternal(expr_memo_t &memo) const
 {
   return const_cast<VariableNode *>(this);
 }
@@ -1479,24 +1994,24 @@ VariableNode::PacMaxLag(int lhs_symb_id) const
 }
 
 expr_t
-VariableNode::substituteAdl() const
+VariableNode::substituteAdlInternal(expr_memo_t &memo) const
 {
   return const_cast<VariableNode *>(this);
 }
 
 expr_t
-VariableNode::substituteVarExpectation(const map<string, expr_t> &subst_table) const
+VariableNode::substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const
 {
   return const_cast<VariableNode *>(this);
 }
 
 void
-VariableNode::findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const
+VariableNode::findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const
 {
 }
 
 void
-VariableNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const
+VariableNode::findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const
 {
 }
 
@@ -1507,26 +2022,26 @@ VariableNode::findTrendVariable(int lhs_symb_id) const
 }
 
 expr_t
-VariableNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
-                             vector<BinaryOpNode *> &neweqs) const
+VariableNode::substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
+                             vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<VariableNode *>(this);
 }
 
 expr_t
-VariableNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+VariableNode::substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<VariableNode *>(this);
 }
 
 expr_t
-VariableNode::substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table)
+VariableNode::substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo)
 {
   return const_cast<VariableNode *>(this);
 }
 
 expr_t
-VariableNode::decreaseLeadsLags(int n) const
+VariableNode::decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const
 {
   switch (type)
     {
@@ -1537,14 +2052,14 @@ VariableNode::decreaseLeadsLags(int n) const
     case SymbolType::logTrend:
       return datatree.AddVariable(symb_id, lag-n);
     case SymbolType::modelLocalVariable:
-      return datatree.getLocalVariable(symb_id)->decreaseLeadsLags(n);
+      return datatree.getLocalVariable(symb_id)->decreaseLeadsLags(n, memo);
     default:
       return const_cast<VariableNode *>(this);
     }
 }
 
 expr_t
-VariableNode::decreaseLeadsLagsPredeterminedVariables() const
+VariableNode::decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const
 {
   if (datatree.symbol_table.isPredetermined(symb_id))
     return decreaseLeadsLags(1);
@@ -1553,7 +2068,7 @@ VariableNode::decreaseLeadsLagsPredeterminedVariables() const
 }
 
 expr_t
-VariableNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+VariableNode::substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   expr_t value;
   switch (type)
@@ -1568,14 +2083,14 @@ VariableNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vecto
       if (value->maxEndoLead() <= 1)
         return const_cast<VariableNode *>(this);
       else
-        return value->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model);
+        return value->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo);
     default:
       return const_cast<VariableNode *>(this);
     }
 }
 
 expr_t
-VariableNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+VariableNode::substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   VariableNode *substexpr;
   expr_t value;
@@ -1619,14 +2134,14 @@ VariableNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector
       if (value->maxEndoLag() <= 1)
         return const_cast<VariableNode *>(this);
       else
-        return value->substituteEndoLagGreaterThanTwo(subst_table, neweqs);
+        return value->substituteEndoLagGreaterThanTwo(subst_table, neweqs, memo);
     default:
       return const_cast<VariableNode *>(this);
     }
 }
 
 expr_t
-VariableNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+VariableNode::substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   expr_t value;
   switch (type)
@@ -1641,14 +2156,14 @@ VariableNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode
       if (value->maxExoLead() == 0)
         return const_cast<VariableNode *>(this);
       else
-        return value->substituteExoLead(subst_table, neweqs, deterministic_model);
+        return value->substituteExoLead(subst_table, neweqs, deterministic_model, memo);
     default:
       return const_cast<VariableNode *>(this);
     }
 }
 
 expr_t
-VariableNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+VariableNode::substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   VariableNode *substexpr;
   expr_t value;
@@ -1692,20 +2207,20 @@ VariableNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *
       if (value->maxExoLag() == 0)
         return const_cast<VariableNode *>(this);
       else
-        return value->substituteExoLag(subst_table, neweqs);
+        return value->substituteExoLag(subst_table, neweqs, memo);
     default:
       return const_cast<VariableNode *>(this);
     }
 }
 
 expr_t
-VariableNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const
+VariableNode::substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const
 {
   return const_cast<VariableNode *>(this);
 }
 
 expr_t
-VariableNode::differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+VariableNode::differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   expr_t value;
   switch (type)
@@ -1738,7 +2253,7 @@ VariableNode::differentiateForwardVars(const vector<string> &subset, subst_table
       if (value->maxEndoLead() <= 0)
         return const_cast<VariableNode *>(this);
       else
-        return value->differentiateForwardVars(subset, subst_table, neweqs);
+        return value->differentiateForwardVars(subset, subst_table, neweqs, memo);
     default:
       return const_cast<VariableNode *>(this);
     }
@@ -1781,7 +2296,7 @@ VariableNode::containsExogenous() const
 }
 
 expr_t
-VariableNode::replaceTrendVar() const
+VariableNode::replaceTrendVarInternal(expr_memo_t &memo) const
 {
   if (get_type() == SymbolType::trend)
     return datatree.One;
@@ -1792,7 +2307,7 @@ VariableNode::replaceTrendVar() const
 }
 
 expr_t
-VariableNode::detrend(int symb_id, bool log_trend, expr_t trend) const
+VariableNode::detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const
 {
   if (get_symb_id() != symb_id)
     return const_cast<VariableNode *>(this);
@@ -1820,7 +2335,7 @@ VariableNode::countDiffs() const
 }
 
 expr_t
-VariableNode::removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const
+VariableNode::removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const
 {
   if ((get_type() != SymbolType::trend && get_type() != SymbolType::logTrend) || get_lag() == 0)
     return const_cast<VariableNode *>(this);
@@ -1948,6 +2463,35 @@ UnaryOpNode::UnaryOpNode(DataTree &datatree_arg, int idx_arg, UnaryOpcode op_cod
   adl_param_name(move(adl_param_name_arg)),
   adl_lags(move(adl_lags_arg))
 {
+  structural_hash = computeStructuralHash(op_code, arg, expectation_information_set, param1_symb_id,
+                                          param2_symb_id, adl_param_name, adl_lags);
+  lead_lag = arg->lead_lag;
+  lead_lag_cached = arg->lead_lag_cached;
+  if (op_code == UnaryOpcode::diff)
+    lead_lag.max_lag++;
+  // diff and adl operators cannot be evaluated
+  if (arg->constant && op_code != UnaryOpcode::diff && op_code != UnaryOpcode::adl)
+    {
+      constant = true;
+      constant_value = eval_opcode(op_code, arg->constant_value);
+    }
+}
+
+size_t
+UnaryOpNode::computeStructuralHash(UnaryOpcode op_code, const expr_t arg, int expectation_information_set, int param1_symb_id, int param2_symb_id, const string &adl_param_name, const vector<int> &adl_lags)
+{
+  size_t h = 0;
+  boost::hash_combine(h, 'u');
+  boost::hash_combine(h, static_cast<int>(op_code));
+  boost::hash_combine(h, arg->getStructuralHash());
+  boost::hash_combine(h, expectation_information_set);
+  boost::hash_combine(h, param1_symb_id);
+  boost::hash_combine(h, param2_symb_id);
+  if (!adl_param_name.empty())
+    boost::hash_combine(h, adl_param_name);
+  for (int lag : adl_lags)
+    boost::hash_combine(h, lag);
+  return h;
 }
 
 void
@@ -1964,7 +2508,11 @@ UnaryOpNode::prepareForDerivation()
   non_null_derivatives = arg->non_null_derivatives;
   if (op_code == UnaryOpcode::steadyState || op_code == UnaryOpcode::steadyStateParamDeriv
       || op_code == UnaryOpcode::steadyStateParam2ndDeriv)
-    datatree.addAllParamDerivId(non_null_derivatives);
+    {
+      set<int> deriv_id_set(non_null_derivatives.begin(), non_null_derivatives.end());
+      datatree.addAllParamDerivId(deriv_id_set);
+      non_null_derivatives.assign(deriv_id_set.begin(), deriv_id_set.end());
+    }
 }
 
 expr_t
@@ -2531,7 +3079,8 @@ UnaryOpNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
       output << "abs";
       break;
     case UnaryOpcode::sign:
-      if (output_type == ExprNodeOutputType::CDynamicModel || output_type == ExprNodeOutputType::CStaticModel)
+      if (output_type == ExprNodeOutputType::CDynamicModel || output_type == ExprNodeOutputType::CDynamicModelSplit
+          || output_type == ExprNodeOutputType::CStaticModel)
         output << "copysign";
       else
         output << "sign";
@@ -2549,6 +3098,9 @@ UnaryOpNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
         case ExprNodeOutputType::CDynamicModel:
           new_output_type = ExprNodeOutputType::CDynamicSteadyStateOperator;
           break;
+        case ExprNodeOutputType::CDynamicModelSplit:
+          new_output_type = ExprNodeOutputType::CDynamicSplitSteadyStateOperator;
+          break;
         case ExprNodeOutputType::juliaDynamicModel:
           new_output_type = ExprNodeOutputType::juliaDynamicSteadyStateOperator;
           break;
@@ -2627,7 +3179,8 @@ UnaryOpNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
           && arg->precedence(output_type, temporary_terms) < precedence(output_type, temporary_terms)))
     {
       output << LEFT_PAR(output_type);
-      if (op_code == UnaryOpcode::sign && (output_type == ExprNodeOutputType::CDynamicModel || output_type == ExprNodeOutputType::CStaticModel))
+      if (op_code == UnaryOpcode::sign && (output_type == ExprNodeOutputType::CDynamicModel || output_type == ExprNodeOutputType::CDynamicModelSplit
+                                           || output_type == ExprNodeOutputType::CStaticModel))
         output << "1.0,";
       close_parenthesis = true;
     }
@@ -2740,6 +3293,12 @@ UnaryOpNode::eval(const eval_context_t &eval_context) const noexcept(false)
   return eval_opcode(op_code, v);
 }
 
+int
+UnaryOpNode::addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const
+{
+  return tape.addUnaryOp(op_code, arg->addToTape(tape, memo));
+}
+
 void
 UnaryOpNode::compile(ostream &CompileCode, unsigned int &instruction_number,
                      bool lhs_rhs, const temporary_terms_t &temporary_terms,
@@ -2783,9 +3342,9 @@ UnaryOpNode::collectVARLHSVariable(set<expr_t> &result) const
 }
 
 void
-UnaryOpNode::collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const
+UnaryOpNode::collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const
 {
-  arg->collectDynamicVariables(type_arg, result);
+  arg->collectDynamicVariables(type_arg, result, visited);
 }
 
 pair<int, expr_t>
@@ -2995,9 +3554,9 @@ UnaryOpNode::buildSimilarUnaryOpNode(expr_t alt_arg, DataTree &alt_datatree) con
 }
 
 expr_t
-UnaryOpNode::toStatic(DataTree &static_datatree) const
+UnaryOpNode::toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const
 {
-  expr_t sarg = arg->toStatic(static_datatree);
+  expr_t sarg = arg->toStatic(static_datatree, memo);
   return buildSimilarUnaryOpNode(sarg, static_datatree);
 }
 
@@ -3008,56 +3567,56 @@ UnaryOpNode::computeXrefs(EquationInfo &ei) const
 }
 
 expr_t
-UnaryOpNode::cloneDynamic(DataTree &dynamic_datatree) const
+UnaryOpNode::cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const
 {
-  expr_t substarg = arg->cloneDynamic(dynamic_datatree);
+  expr_t substarg = arg->cloneDynamic(dynamic_datatree, memo);
   return buildSimilarUnaryOpNode(substarg, dynamic_datatree);
 }
 
 int
-UnaryOpNode::maxEndoLead() const
+UnaryOpNode::maxEndoLeadInternal(memo_table_t<int> &memo) const
 {
-  return arg->maxEndoLead();
+  return arg->maxEndoLead(memo);
 }
 
 int
-UnaryOpNode::maxExoLead() const
+UnaryOpNode::maxExoLeadInternal(memo_table_t<int> &memo) const
 {
-  return arg->maxExoLead();
+  return arg->maxExoLead(memo);
 }
 
 int
-UnaryOpNode::maxEndoLag() const
+UnaryOpNode::maxEndoLagInternal(memo_table_t<int> &memo) const
 {
-  return arg->maxEndoLag();
+  return arg->maxEndoLag(memo);
 }
 
 int
-UnaryOpNode::maxExoLag() const
+UnaryOpNode::maxExoLagInternal(memo_table_t<int> &memo) const
 {
-  return arg->maxExoLag();
+  return arg->maxExoLag(memo);
 }
 
 int
-UnaryOpNode::maxLead() const
+UnaryOpNode::maxLeadInternal(memo_table_t<int> &memo) const
 {
-  return arg->maxLead();
+  return arg->maxLead(memo);
 }
 
 int
-UnaryOpNode::maxLag() const
+UnaryOpNode::maxLagInternal(memo_table_t<int> &memo) const
 {
   if (op_code == UnaryOpcode::diff)
-    return arg->maxLag() + 1;
-  return arg->maxLag();
+    return arg->maxLag(memo) + 1;
+  return arg->maxLag(memo);
 }
 
 expr_t
-UnaryOpNode::undiff() const
+UnaryOpNode::undiffInternal(expr_memo_t &memo) const
 {
   if (op_code == UnaryOpcode::diff)
     return arg;
-  return arg->undiff();
+  return arg->undiff(memo);
 }
 
 int
@@ -3083,15 +3642,15 @@ UnaryOpNode::PacMaxLag(int lhs_symb_id) const
 }
 
 expr_t
-UnaryOpNode::substituteAdl() const
+UnaryOpNode::substituteAdlInternal(expr_memo_t &memo) const
 {
   if (op_code != UnaryOpcode::adl)
     {
-      expr_t argsubst = arg->substituteAdl();
+      expr_t argsubst = arg->substituteAdl(memo);
       return buildSimilarUnaryOpNode(argsubst, datatree);
     }
 
-  expr_t arg1subst = arg->substituteAdl();
+  expr_t arg1subst = arg->substituteAdl(memo);
   expr_t retval = nullptr;
   ostringstream inttostr;
 
@@ -3116,9 +3675,9 @@ UnaryOpNode::substituteAdl() const
 }
 
 expr_t
-UnaryOpNode::substituteVarExpectation(const map<string, expr_t> &subst_table) const
+UnaryOpNode::substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->substituteVarExpectation(subst_table);
+  expr_t argsubst = arg->substituteVarExpectation(subst_table, memo);
   return buildSimilarUnaryOpNode(argsubst, datatree);
 }
 
@@ -3161,9 +3720,9 @@ UnaryOpNode::createAuxVarForUnaryOpNode() const
 }
 
 void
-UnaryOpNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const
+UnaryOpNode::findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const
 {
-  arg->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes);
+  arg->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes, visited);
 
   if (!this->createAuxVarForUnaryOpNode())
     return;
@@ -3185,9 +3744,9 @@ UnaryOpNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_t
 }
 
 void
-UnaryOpNode::findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const
+UnaryOpNode::findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const
 {
-  arg->findDiffNodes(static_datatree, diff_table);
+  arg->findDiffNodes(static_datatree, diff_table, visited);
 
   if (op_code != UnaryOpcode::diff)
     return;
@@ -3215,10 +3774,10 @@ UnaryOpNode::findTrendVariable(int lhs_symb_id) const
 }
 
 expr_t
-UnaryOpNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
-                            vector<BinaryOpNode *> &neweqs) const
+UnaryOpNode::substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
+                            vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->substituteDiff(static_datatree, diff_table, subst_table, neweqs);
+  expr_t argsubst = arg->substituteDiff(static_datatree, diff_table, subst_table, neweqs, memo);
   if (op_code != UnaryOpcode::diff)
     return buildSimilarUnaryOpNode(argsubst, datatree);
 
@@ -3249,7 +3808,7 @@ UnaryOpNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table,
        rit != it->second.rend(); rit++)
     {
       expr_t argsubst = dynamic_cast<UnaryOpNode *>(rit->second)->
-          get_arg()->substituteDiff(static_datatree, diff_table, subst_table, neweqs);
+          get_arg()->substituteDiff(static_datatree, diff_table, subst_table, neweqs, memo);
       auto *vn = dynamic_cast<VariableNode *>(argsubst);
       if (rit == it->second.rbegin())
         {
@@ -3293,7 +3852,7 @@ UnaryOpNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table,
 }
 
 expr_t
-UnaryOpNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+UnaryOpNode::substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   subst_table_t::const_iterator sit = subst_table.find(this);
   if (sit != subst_table.end())
@@ -3301,7 +3860,7 @@ UnaryOpNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nod
 
   auto *sthis = dynamic_cast<UnaryOpNode *>(this->toStatic(static_datatree));
   auto it = nodes.find(sthis);
-  expr_t argsubst = arg->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs);
+  expr_t argsubst = arg->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs, memo);
   if (it == nodes.end())
     return buildSimilarUnaryOpNode(argsubst, datatree);
 
@@ -3331,32 +3890,32 @@ UnaryOpNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nod
 }
 
 expr_t
-UnaryOpNode::substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table)
+UnaryOpNode::substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo)
 {
-  expr_t argsubst = arg->substitutePacExpectation(subst_table);
+  expr_t argsubst = arg->substitutePacExpectation(subst_table, memo);
   return buildSimilarUnaryOpNode(argsubst, datatree);
 }
 
 expr_t
-UnaryOpNode::decreaseLeadsLags(int n) const
+UnaryOpNode::decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->decreaseLeadsLags(n);
+  expr_t argsubst = arg->decreaseLeadsLags(n, memo);
   return buildSimilarUnaryOpNode(argsubst, datatree);
 }
 
 expr_t
-UnaryOpNode::decreaseLeadsLagsPredeterminedVariables() const
+UnaryOpNode::decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->decreaseLeadsLagsPredeterminedVariables();
+  expr_t argsubst = arg->decreaseLeadsLagsPredeterminedVariables(memo);
   return buildSimilarUnaryOpNode(argsubst, datatree);
 }
 
 expr_t
-UnaryOpNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+UnaryOpNode::substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   if (op_code == UnaryOpcode::uminus || deterministic_model)
     {
-      expr_t argsubst = arg->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model);
+      expr_t argsubst = arg->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo);
       return buildSimilarUnaryOpNode(argsubst, datatree);
     }
   else
@@ -3369,18 +3928,18 @@ UnaryOpNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector
 }
 
 expr_t
-UnaryOpNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+UnaryOpNode::substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->substituteEndoLagGreaterThanTwo(subst_table, neweqs);
+  expr_t argsubst = arg->substituteEndoLagGreaterThanTwo(subst_table, neweqs, memo);
   return buildSimilarUnaryOpNode(argsubst, datatree);
 }
 
 expr_t
-UnaryOpNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+UnaryOpNode::substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   if (op_code == UnaryOpcode::uminus || deterministic_model)
     {
-      expr_t argsubst = arg->substituteExoLead(subst_table, neweqs, deterministic_model);
+      expr_t argsubst = arg->substituteExoLead(subst_table, neweqs, deterministic_model, memo);
       return buildSimilarUnaryOpNode(argsubst, datatree);
     }
   else
@@ -3393,14 +3952,14 @@ UnaryOpNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *
 }
 
 expr_t
-UnaryOpNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+UnaryOpNode::substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->substituteExoLag(subst_table, neweqs);
+  expr_t argsubst = arg->substituteExoLag(subst_table, neweqs, memo);
   return buildSimilarUnaryOpNode(argsubst, datatree);
 }
 
 expr_t
-UnaryOpNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const
+UnaryOpNode::substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const
 {
   if (op_code == UnaryOpcode::expectation)
     {
@@ -3424,7 +3983,7 @@ UnaryOpNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNo
 
       //take care of any nested expectation operators by calling arg->substituteExpectation(.), then decreaseLeadsLags for this UnaryOpcode::expectation operator
       //arg(lag-period) (holds entire subtree of arg(lag-period)
-      expr_t substexpr = (arg->substituteExpectation(subst_table, neweqs, partial_information_model))->decreaseLeadsLags(expectation_information_set);
+      expr_t substexpr = (arg->substituteExpectation(subst_table, neweqs, partial_information_model, memo))->decreaseLeadsLags(expectation_information_set);
       assert(substexpr != nullptr);
       neweqs.push_back(dynamic_cast<BinaryOpNode *>(datatree.AddEqual(newAuxE, substexpr))); //AUXE_period_arg.idx = arg(lag-period)
       newAuxE = datatree.AddVariable(symb_id, expectation_information_set);
@@ -3435,15 +3994,15 @@ UnaryOpNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNo
     }
   else
     {
-      expr_t argsubst = arg->substituteExpectation(subst_table, neweqs, partial_information_model);
+      expr_t argsubst = arg->substituteExpectation(subst_table, neweqs, partial_information_model, memo);
       return buildSimilarUnaryOpNode(argsubst, datatree);
     }
 }
 
 expr_t
-UnaryOpNode::differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+UnaryOpNode::differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->differentiateForwardVars(subset, subst_table, neweqs);
+  expr_t argsubst = arg->differentiateForwardVars(subset, subst_table, neweqs, memo);
   return buildSimilarUnaryOpNode(argsubst, datatree);
 }
 
@@ -3478,23 +4037,23 @@ UnaryOpNode::containsExogenous() const
 }
 
 expr_t
-UnaryOpNode::replaceTrendVar() const
+UnaryOpNode::replaceTrendVarInternal(expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->replaceTrendVar();
+  expr_t argsubst = arg->replaceTrendVar(memo);
   return buildSimilarUnaryOpNode(argsubst, datatree);
 }
 
 expr_t
-UnaryOpNode::detrend(int symb_id, bool log_trend, expr_t trend) const
+UnaryOpNode::detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->detrend(symb_id, log_trend, trend);
+  expr_t argsubst = arg->detrend(symb_id, log_trend, trend, memo);
   return buildSimilarUnaryOpNode(argsubst, datatree);
 }
 
 expr_t
-UnaryOpNode::removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const
+UnaryOpNode::removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->removeTrendLeadLag(trend_symbols_map);
+  expr_t argsubst = arg->removeTrendLeadLag(trend_symbols_map, memo);
   return buildSimilarUnaryOpNode(argsubst, datatree);
 }
 
@@ -3562,9 +4121,9 @@ UnaryOpNode::getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const
 }
 
 expr_t
-UnaryOpNode::substituteStaticAuxiliaryVariable() const
+UnaryOpNode::substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const
 {
-  expr_t argsubst = arg->substituteStaticAuxiliaryVariable();
+  expr_t argsubst = arg->substituteStaticAuxiliaryVariable(memo);
   if (op_code == UnaryOpcode::expectation)
     return argsubst;
   else
@@ -3586,6 +4145,28 @@ BinaryOpNode::BinaryOpNode(DataTree &datatree_arg, int idx_arg, const expr_t arg
   powerDerivOrder(powerDerivOrder_arg)
 {
   assert(powerDerivOrder >= 0);
+  structural_hash = computeStructuralHash(arg1, op_code, arg2, powerDerivOrder);
+  lead_lag = arg1->lead_lag;
+  lead_lag_cached = arg1->lead_lag_cached;
+  mergeLeadLag(arg2);
+  // Equal nodes cannot be evaluated
+  if (arg1->constant && arg2->constant && op_code != BinaryOpcode::equal)
+    {
+      constant = true;
+      constant_value = eval_opcode(arg1->constant_value, op_code, arg2->constant_value, powerDerivOrder);
+    }
+}
+
+size_t
+BinaryOpNode::computeStructuralHash(const expr_t arg1, BinaryOpcode op_code, const expr_t arg2, int powerDerivOrder)
+{
+  size_t h = 0;
+  boost::hash_combine(h, 'b');
+  boost::hash_combine(h, static_cast<int>(op_code));
+  boost::hash_combine(h, arg1->getStructuralHash());
+  boost::hash_combine(h, arg2->getStructuralHash());
+  boost::hash_combine(h, powerDerivOrder);
+  return h;
 }
 
 void
@@ -3600,12 +4181,8 @@ BinaryOpNode::prepareForDerivation()
   arg2->prepareForDerivation();
 
   // Non-null derivatives are the union of those of the arguments
-  // Compute set union of arg1->non_null_derivatives and arg2->non_null_derivatives
-  set_union(arg1->non_null_derivatives.begin(),
-            arg1->non_null_derivatives.end(),
-            arg2->non_null_derivatives.begin(),
-            arg2->non_null_derivatives.end(),
-            inserter(non_null_derivatives, non_null_derivatives.begin()));
+  non_null_derivatives = mergeNonNullDerivatives(arg1->non_null_derivatives,
+                                                 arg2->non_null_derivatives);
 }
 
 expr_t
@@ -4033,6 +4610,14 @@ BinaryOpNode::eval(const eval_context_t &eval_context) const noexcept(false)
   return eval_opcode(v1, op_code, v2, powerDerivOrder);
 }
 
+int
+BinaryOpNode::addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const
+{
+  int slot1 = arg1->addToTape(tape, memo);
+  int slot2 = arg2->addToTape(tape, memo);
+  return tape.addBinaryOp(op_code, slot1, slot2, powerDerivOrder);
+}
+
 void
 BinaryOpNode::compile(ostream &CompileCode, unsigned int &instruction_number,
                       bool lhs_rhs, const temporary_terms_t &temporary_terms,
@@ -4446,10 +5031,10 @@ BinaryOpNode::collectVARLHSVariable(set<expr_t> &result) const
 }
 
 void
-BinaryOpNode::collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const
+BinaryOpNode::collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const
 {
-  arg1->collectDynamicVariables(type_arg, result);
-  arg2->collectDynamicVariables(type_arg, result);
+  arg1->collectDynamicVariables(type_arg, result, visited);
+  arg2->collectDynamicVariables(type_arg, result, visited);
 }
 
 expr_t
@@ -4791,10 +5376,10 @@ BinaryOpNode::buildSimilarBinaryOpNode(expr_t alt_arg1, expr_t alt_arg2, DataTre
 }
 
 expr_t
-BinaryOpNode::toStatic(DataTree &static_datatree) const
+BinaryOpNode::toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const
 {
-  expr_t sarg1 = arg1->toStatic(static_datatree);
-  expr_t sarg2 = arg2->toStatic(static_datatree);
+  expr_t sarg1 = arg1->toStatic(static_datatree, memo);
+  expr_t sarg2 = arg2->toStatic(static_datatree, memo);
   return buildSimilarBinaryOpNode(sarg1, sarg2, static_datatree);
 }
 
@@ -4806,54 +5391,54 @@ BinaryOpNode::computeXrefs(EquationInfo &ei) const
 }
 
 expr_t
-BinaryOpNode::cloneDynamic(DataTree &dynamic_datatree) const
+BinaryOpNode::cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const
 {
-  expr_t substarg1 = arg1->cloneDynamic(dynamic_datatree);
-  expr_t substarg2 = arg2->cloneDynamic(dynamic_datatree);
+  expr_t substarg1 = arg1->cloneDynamic(dynamic_datatree, memo);
+  expr_t substarg2 = arg2->cloneDynamic(dynamic_datatree, memo);
   return buildSimilarBinaryOpNode(substarg1, substarg2, dynamic_datatree);
 }
 
 int
-BinaryOpNode::maxEndoLead() const
+BinaryOpNode::maxEndoLeadInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxEndoLead(), arg2->maxEndoLead());
+  return max(arg1->maxEndoLead(memo), arg2->maxEndoLead(memo));
 }
 
 int
-BinaryOpNode::maxExoLead() const
+BinaryOpNode::maxExoLeadInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxExoLead(), arg2->maxExoLead());
+  return max(arg1->maxExoLead(memo), arg2->maxExoLead(memo));
 }
 
 int
-BinaryOpNode::maxEndoLag() const
+BinaryOpNode::maxEndoLagInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxEndoLag(), arg2->maxEndoLag());
+  return max(arg1->maxEndoLag(memo), arg2->maxEndoLag(memo));
 }
 
 int
-BinaryOpNode::maxExoLag() const
+BinaryOpNode::maxExoLagInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxExoLag(), arg2->maxExoLag());
+  return max(arg1->maxExoLag(memo), arg2->maxExoLag(memo));
 }
 
 int
-BinaryOpNode::maxLead() const
+BinaryOpNode::maxLeadInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxLead(), arg2->maxLead());
+  return max(arg1->maxLead(memo), arg2->maxLead(memo));
 }
 
 int
-BinaryOpNode::maxLag() const
+BinaryOpNode::maxLagInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxLag(), arg2->maxLag());
+  return max(arg1->maxLag(memo), arg2->maxLag(memo));
 }
 
 expr_t
-BinaryOpNode::undiff() const
+BinaryOpNode::undiffInternal(expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->undiff();
-  expr_t arg2subst = arg2->undiff();
+  expr_t arg1subst = arg1->undiff(memo);
+  expr_t arg2subst = arg2->undiff(memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
@@ -4864,23 +5449,23 @@ BinaryOpNode::PacMaxLag(int lhs_symb_id) const
 }
 
 expr_t
-BinaryOpNode::decreaseLeadsLags(int n) const
+BinaryOpNode::decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->decreaseLeadsLags(n);
-  expr_t arg2subst = arg2->decreaseLeadsLags(n);
+  expr_t arg1subst = arg1->decreaseLeadsLags(n, memo);
+  expr_t arg2subst = arg2->decreaseLeadsLags(n, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 expr_t
-BinaryOpNode::decreaseLeadsLagsPredeterminedVariables() const
+BinaryOpNode::decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->decreaseLeadsLagsPredeterminedVariables();
-  expr_t arg2subst = arg2->decreaseLeadsLagsPredeterminedVariables();
+  expr_t arg1subst = arg1->decreaseLeadsLagsPredeterminedVariables(memo);
+  expr_t arg2subst = arg2->decreaseLeadsLagsPredeterminedVariables(memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 expr_t
-BinaryOpNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+BinaryOpNode::substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   expr_t arg1subst, arg2subst;
   int maxendolead1 = arg1->maxEndoLead(), maxendolead2 = arg2->maxEndoLead();
@@ -4889,8 +5474,8 @@ BinaryOpNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vecto
     return const_cast<BinaryOpNode *>(this);
   if (deterministic_model)
     {
-      arg1subst = maxendolead1 >= 2 ? arg1->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model) : arg1;
-      arg2subst = maxendolead2 >= 2 ? arg2->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model) : arg2;
+      arg1subst = maxendolead1 >= 2 ? arg1->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo) : arg1;
+      arg2subst = maxendolead2 >= 2 ? arg2->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo) : arg2;
       return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
     }
   else
@@ -4900,20 +5485,20 @@ BinaryOpNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vecto
         case BinaryOpcode::plus:
         case BinaryOpcode::minus:
         case BinaryOpcode::equal:
-          arg1subst = maxendolead1 >= 2 ? arg1->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model) : arg1;
-          arg2subst = maxendolead2 >= 2 ? arg2->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model) : arg2;
+          arg1subst = maxendolead1 >= 2 ? arg1->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo) : arg1;
+          arg2subst = maxendolead2 >= 2 ? arg2->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo) : arg2;
           return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
         case BinaryOpcode::times:
         case BinaryOpcode::divide:
           if (maxendolead1 >= 2 && maxendolead2 == 0 && arg2->maxExoLead() == 0)
             {
-              arg1subst = arg1->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model);
+              arg1subst = arg1->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo);
               return buildSimilarBinaryOpNode(arg1subst, arg2, datatree);
             }
           if (maxendolead1 == 0 && arg1->maxExoLead() == 0
               && maxendolead2 >= 2 && op_code == BinaryOpcode::times)
             {
-              arg2subst = arg2->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model);
+              arg2subst = arg2->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo);
               return buildSimilarBinaryOpNode(arg1, arg2subst, datatree);
             }
           return createEndoLeadAuxiliaryVarForMyself(subst_table, neweqs);
@@ -4924,15 +5509,15 @@ BinaryOpNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vecto
 }
 
 expr_t
-BinaryOpNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+BinaryOpNode::substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteEndoLagGreaterThanTwo(subst_table, neweqs);
-  expr_t arg2subst = arg2->substituteEndoLagGreaterThanTwo(subst_table, neweqs);
+  expr_t arg1subst = arg1->substituteEndoLagGreaterThanTwo(subst_table, neweqs, memo);
+  expr_t arg2subst = arg2->substituteEndoLagGreaterThanTwo(subst_table, neweqs, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 expr_t
-BinaryOpNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+BinaryOpNode::substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   expr_t arg1subst, arg2subst;
   int maxexolead1 = arg1->maxExoLead(), maxexolead2 = arg2->maxExoLead();
@@ -4941,8 +5526,8 @@ BinaryOpNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode
     return const_cast<BinaryOpNode *>(this);
   if (deterministic_model)
     {
-      arg1subst = maxexolead1 >= 1 ? arg1->substituteExoLead(subst_table, neweqs, deterministic_model) : arg1;
-      arg2subst = maxexolead2 >= 1 ? arg2->substituteExoLead(subst_table, neweqs, deterministic_model) : arg2;
+      arg1subst = maxexolead1 >= 1 ? arg1->substituteExoLead(subst_table, neweqs, deterministic_model, memo) : arg1;
+      arg2subst = maxexolead2 >= 1 ? arg2->substituteExoLead(subst_table, neweqs, deterministic_model, memo) : arg2;
       return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
     }
   else
@@ -4952,20 +5537,20 @@ BinaryOpNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode
         case BinaryOpcode::plus:
         case BinaryOpcode::minus:
         case BinaryOpcode::equal:
-          arg1subst = maxexolead1 >= 1 ? arg1->substituteExoLead(subst_table, neweqs, deterministic_model) : arg1;
-          arg2subst = maxexolead2 >= 1 ? arg2->substituteExoLead(subst_table, neweqs, deterministic_model) : arg2;
+          arg1subst = maxexolead1 >= 1 ? arg1->substituteExoLead(subst_table, neweqs, deterministic_model, memo) : arg1;
+          arg2subst = maxexolead2 >= 1 ? arg2->substituteExoLead(subst_table, neweqs, deterministic_model, memo) : arg2;
           return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
         case BinaryOpcode::times:
         case BinaryOpcode::divide:
           if (maxexolead1 >= 1 && maxexolead2 == 0 && arg2->maxEndoLead() == 0)
             {
-              arg1subst = arg1->substituteExoLead(subst_table, neweqs, deterministic_model);
+              arg1subst = arg1->substituteExoLead(subst_table, neweqs, deterministic_model, memo);
               return buildSimilarBinaryOpNode(arg1subst, arg2, datatree);
             }
           if (maxexolead1 == 0 && arg1->maxEndoLead() == 0
               && maxexolead2 >= 1 && op_code == BinaryOpcode::times)
             {
-              arg2subst = arg2->substituteExoLead(subst_table, neweqs, deterministic_model);
+              arg2subst = arg2->substituteExoLead(subst_table, neweqs, deterministic_model, memo);
               return buildSimilarBinaryOpNode(arg1, arg2subst, datatree);
             }
           return createExoLeadAuxiliaryVarForMyself(subst_table, neweqs);
@@ -4976,66 +5561,66 @@ BinaryOpNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode
 }
 
 expr_t
-BinaryOpNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+BinaryOpNode::substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteExoLag(subst_table, neweqs);
-  expr_t arg2subst = arg2->substituteExoLag(subst_table, neweqs);
+  expr_t arg1subst = arg1->substituteExoLag(subst_table, neweqs, memo);
+  expr_t arg2subst = arg2->substituteExoLag(subst_table, neweqs, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 expr_t
-BinaryOpNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const
+BinaryOpNode::substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteExpectation(subst_table, neweqs, partial_information_model);
-  expr_t arg2subst = arg2->substituteExpectation(subst_table, neweqs, partial_information_model);
+  expr_t arg1subst = arg1->substituteExpectation(subst_table, neweqs, partial_information_model, memo);
+  expr_t arg2subst = arg2->substituteExpectation(subst_table, neweqs, partial_information_model, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 expr_t
-BinaryOpNode::substituteAdl() const
+BinaryOpNode::substituteAdlInternal(expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteAdl();
-  expr_t arg2subst = arg2->substituteAdl();
+  expr_t arg1subst = arg1->substituteAdl(memo);
+  expr_t arg2subst = arg2->substituteAdl(memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 
 expr_t
-BinaryOpNode::substituteVarExpectation(const map<string, expr_t> &subst_table) const
+BinaryOpNode::substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteVarExpectation(subst_table);
-  expr_t arg2subst = arg2->substituteVarExpectation(subst_table);
+  expr_t arg1subst = arg1->substituteVarExpectation(subst_table, memo);
+  expr_t arg2subst = arg2->substituteVarExpectation(subst_table, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 void
-BinaryOpNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const
+BinaryOpNode::findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const
 {
-  arg1->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes);
-  arg2->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes);
+  arg1->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes, visited);
+  arg2->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes, visited);
 }
 
 void
-BinaryOpNode::findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const
+BinaryOpNode::findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const
 {
-  arg1->findDiffNodes(static_datatree, diff_table);
-  arg2->findDiffNodes(static_datatree, diff_table);
+  arg1->findDiffNodes(static_datatree, diff_table, visited);
+  arg2->findDiffNodes(static_datatree, diff_table, visited);
 }
 
 expr_t
-BinaryOpNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
-                             vector<BinaryOpNode *> &neweqs) const
+BinaryOpNode::substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
+                             vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteDiff(static_datatree, diff_table, subst_table, neweqs);
-  expr_t arg2subst = arg2->substituteDiff(static_datatree, diff_table, subst_table, neweqs);
+  expr_t arg1subst = arg1->substituteDiff(static_datatree, diff_table, subst_table, neweqs, memo);
+  expr_t arg2subst = arg2->substituteDiff(static_datatree, diff_table, subst_table, neweqs, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 expr_t
-BinaryOpNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+BinaryOpNode::substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs);
-  expr_t arg2subst = arg2->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs);
+  expr_t arg1subst = arg1->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs, memo);
+  expr_t arg2subst = arg2->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
@@ -5046,18 +5631,18 @@ BinaryOpNode::countDiffs() const
 }
 
 expr_t
-BinaryOpNode::substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table)
+BinaryOpNode::substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo)
 {
-  expr_t arg1subst = arg1->substitutePacExpectation(subst_table);
-  expr_t arg2subst = arg2->substitutePacExpectation(subst_table);
+  expr_t arg1subst = arg1->substitutePacExpectation(subst_table, memo);
+  expr_t arg2subst = arg2->substitutePacExpectation(subst_table, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 expr_t
-BinaryOpNode::differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+BinaryOpNode::differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->differentiateForwardVars(subset, subst_table, neweqs);
-  expr_t arg2subst = arg2->differentiateForwardVars(subset, subst_table, neweqs);
+  expr_t arg1subst = arg1->differentiateForwardVars(subset, subst_table, neweqs, memo);
+  expr_t arg2subst = arg2->differentiateForwardVars(subset, subst_table, neweqs, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
@@ -5100,26 +5685,26 @@ BinaryOpNode::containsExogenous() const
 }
 
 expr_t
-BinaryOpNode::replaceTrendVar() const
+BinaryOpNode::replaceTrendVarInternal(expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->replaceTrendVar();
-  expr_t arg2subst = arg2->replaceTrendVar();
+  expr_t arg1subst = arg1->replaceTrendVar(memo);
+  expr_t arg2subst = arg2->replaceTrendVar(memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 expr_t
-BinaryOpNode::detrend(int symb_id, bool log_trend, expr_t trend) const
+BinaryOpNode::detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->detrend(symb_id, log_trend, trend);
-  expr_t arg2subst = arg2->detrend(symb_id, log_trend, trend);
+  expr_t arg1subst = arg1->detrend(symb_id, log_trend, trend, memo);
+  expr_t arg2subst = arg2->detrend(symb_id, log_trend, trend, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
 expr_t
-BinaryOpNode::removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const
+BinaryOpNode::removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->removeTrendLeadLag(trend_symbols_map);
-  expr_t arg2subst = arg2->removeTrendLeadLag(trend_symbols_map);
+  expr_t arg1subst = arg1->removeTrendLeadLag(trend_symbols_map, memo);
+  expr_t arg2subst = arg2->removeTrendLeadLag(trend_symbols_map, memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
@@ -5272,7 +5857,7 @@ BinaryOpNode::getPacNonOptimizingPartHelper(const expr_t arg1, const expr_t arg2
            << endl;
       exit(EXIT_FAILURE);
     }
-  ec[(*(vars.begin())).first] = 1.0;
+  ec.set((*(vars.begin())).first, 1.0);
 
   arg2->collectVariables(SymbolType::parameter, params);
   if (params.size() > 1)
@@ -5286,7 +5871,7 @@ BinaryOpNode::getPacNonOptimizingPartHelper(const expr_t arg1, const expr_t arg2
   if (params.size() == 1)
     {
       param_idx = *(params.begin());
-      ec[param_idx] = 1.0;
+      ec.set(param_idx, 1.0);
     }
   else
     param_idx = -1;
@@ -5513,10 +6098,10 @@ BinaryOpNode::getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const
 }
 
 expr_t
-BinaryOpNode::substituteStaticAuxiliaryVariable() const
+BinaryOpNode::substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteStaticAuxiliaryVariable();
-  expr_t arg2subst = arg2->substituteStaticAuxiliaryVariable();
+  expr_t arg1subst = arg1->substituteStaticAuxiliaryVariable(memo);
+  expr_t arg2subst = arg2->substituteStaticAuxiliaryVariable(memo);
   return buildSimilarBinaryOpNode(arg1subst, arg2subst, datatree);
 }
 
@@ -5535,6 +6120,28 @@ TrinaryOpNode::TrinaryOpNode(DataTree &datatree_arg, int idx_arg, const expr_t a
   arg3(arg3_arg),
   op_code(op_code_arg)
 {
+  structural_hash = computeStructuralHash(arg1, op_code, arg2, arg3);
+  lead_lag = arg1->lead_lag;
+  lead_lag_cached = arg1->lead_lag_cached;
+  mergeLeadLag(arg2);
+  mergeLeadLag(arg3);
+  if (arg1->constant && arg2->constant && arg3->constant)
+    {
+      constant = true;
+      constant_value = eval_opcode(arg1->constant_value, op_code, arg2->constant_value, arg3->constant_value);
+    }
+}
+
+size_t
+TrinaryOpNode::computeStructuralHash(const expr_t arg1, TrinaryOpcode op_code, const expr_t arg2, const expr_t arg3)
+{
+  size_t h = 0;
+  boost::hash_combine(h, 't');
+  boost::hash_combine(h, static_cast<int>(op_code));
+  boost::hash_combine(h, arg1->getStructuralHash());
+  boost::hash_combine(h, arg2->getStructuralHash());
+  boost::hash_combine(h, arg3->getStructuralHash());
+  return h;
 }
 
 void
@@ -5550,18 +6157,9 @@ TrinaryOpNode::prepareForDerivation()
   arg3->prepareForDerivation();
 
   // Non-null derivatives are the union of those of the arguments
-  // Compute set union of arg{1,2,3}->non_null_derivatives
-  set<int> non_null_derivatives_tmp;
-  set_union(arg1->non_null_derivatives.begin(),
-            arg1->non_null_derivatives.end(),
-            arg2->non_null_derivatives.begin(),
-            arg2->non_null_derivatives.end(),
-            inserter(non_null_derivatives_tmp, non_null_derivatives_tmp.begin()));
-  set_union(non_null_derivatives_tmp.begin(),
-            non_null_derivatives_tmp.end(),
-            arg3->non_null_derivatives.begin(),
-            arg3->non_null_derivatives.end(),
-            inserter(non_null_derivatives, non_null_derivatives.begin()));
+  non_null_derivatives = mergeNonNullDerivatives(mergeNonNullDerivatives(arg1->non_null_derivatives,
+                                                                         arg2->non_null_derivatives),
+                                                 arg3->non_null_derivatives);
 }
 
 expr_t
@@ -5790,6 +6388,15 @@ TrinaryOpNode::eval(const eval_context_t &eval_context) const noexcept(false)
   return eval_opcode(v1, op_code, v2, v3);
 }
 
+int
+TrinaryOpNode::addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const
+{
+  int slot1 = arg1->addToTape(tape, memo);
+  int slot2 = arg2->addToTape(tape, memo);
+  int slot3 = arg3->addToTape(tape, memo);
+  return tape.addTrinaryOp(op_code, slot1, slot2, slot3);
+}
+
 void
 TrinaryOpNode::compile(ostream &CompileCode, unsigned int &instruction_number,
                        bool lhs_rhs, const temporary_terms_t &temporary_terms,
@@ -5981,11 +6588,11 @@ TrinaryOpNode::collectVARLHSVariable(set<expr_t> &result) const
 }
 
 void
-TrinaryOpNode::collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const
+TrinaryOpNode::collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const
 {
-  arg1->collectDynamicVariables(type_arg, result);
-  arg2->collectDynamicVariables(type_arg, result);
-  arg3->collectDynamicVariables(type_arg, result);
+  arg1->collectDynamicVariables(type_arg, result, visited);
+  arg2->collectDynamicVariables(type_arg, result, visited);
+  arg3->collectDynamicVariables(type_arg, result, visited);
 }
 
 pair<int, expr_t>
@@ -6030,11 +6637,11 @@ TrinaryOpNode::buildSimilarTrinaryOpNode(expr_t alt_arg1, expr_t alt_arg2, expr_
 }
 
 expr_t
-TrinaryOpNode::toStatic(DataTree &static_datatree) const
+TrinaryOpNode::toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const
 {
-  expr_t sarg1 = arg1->toStatic(static_datatree);
-  expr_t sarg2 = arg2->toStatic(static_datatree);
-  expr_t sarg3 = arg3->toStatic(static_datatree);
+  expr_t sarg1 = arg1->toStatic(static_datatree, memo);
+  expr_t sarg2 = arg2->toStatic(static_datatree, memo);
+  expr_t sarg3 = arg3->toStatic(static_datatree, memo);
   return buildSimilarTrinaryOpNode(sarg1, sarg2, sarg3, static_datatree);
 }
 
@@ -6047,56 +6654,56 @@ TrinaryOpNode::computeXrefs(EquationInfo &ei) const
 }
 
 expr_t
-TrinaryOpNode::cloneDynamic(DataTree &dynamic_datatree) const
+TrinaryOpNode::cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const
 {
-  expr_t substarg1 = arg1->cloneDynamic(dynamic_datatree);
-  expr_t substarg2 = arg2->cloneDynamic(dynamic_datatree);
-  expr_t substarg3 = arg3->cloneDynamic(dynamic_datatree);
+  expr_t substarg1 = arg1->cloneDynamic(dynamic_datatree, memo);
+  expr_t substarg2 = arg2->cloneDynamic(dynamic_datatree, memo);
+  expr_t substarg3 = arg3->cloneDynamic(dynamic_datatree, memo);
   return buildSimilarTrinaryOpNode(substarg1, substarg2, substarg3, dynamic_datatree);
 }
 
 int
-TrinaryOpNode::maxEndoLead() const
+TrinaryOpNode::maxEndoLeadInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxEndoLead(), max(arg2->maxEndoLead(), arg3->maxEndoLead()));
+  return max(arg1->maxEndoLead(memo), max(arg2->maxEndoLead(memo), arg3->maxEndoLead(memo)));
 }
 
 int
-TrinaryOpNode::maxExoLead() const
+TrinaryOpNode::maxExoLeadInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxExoLead(), max(arg2->maxExoLead(), arg3->maxExoLead()));
+  return max(arg1->maxExoLead(memo), max(arg2->maxExoLead(memo), arg3->maxExoLead(memo)));
 }
 
 int
-TrinaryOpNode::maxEndoLag() const
+TrinaryOpNode::maxEndoLagInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxEndoLag(), max(arg2->maxEndoLag(), arg3->maxEndoLag()));
+  return max(arg1->maxEndoLag(memo), max(arg2->maxEndoLag(memo), arg3->maxEndoLag(memo)));
 }
 
 int
-TrinaryOpNode::maxExoLag() const
+TrinaryOpNode::maxExoLagInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxExoLag(), max(arg2->maxExoLag(), arg3->maxExoLag()));
+  return max(arg1->maxExoLag(memo), max(arg2->maxExoLag(memo), arg3->maxExoLag(memo)));
 }
 
 int
-TrinaryOpNode::maxLead() const
+TrinaryOpNode::maxLeadInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxLead(), max(arg2->maxLead(), arg3->maxLead()));
+  return max(arg1->maxLead(memo), max(arg2->maxLead(memo), arg3->maxLead(memo)));
 }
 
 int
-TrinaryOpNode::maxLag() const
+TrinaryOpNode::maxLagInternal(memo_table_t<int> &memo) const
 {
-  return max(arg1->maxLag(), max(arg2->maxLag(), arg3->maxLag()));
+  return max(arg1->maxLag(memo), max(arg2->maxLag(memo), arg3->maxLag(memo)));
 }
 
 expr_t
-TrinaryOpNode::undiff() const
+TrinaryOpNode::undiffInternal(expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->undiff();
-  expr_t arg2subst = arg2->undiff();
-  expr_t arg3subst = arg3->undiff();
+  expr_t arg1subst = arg1->undiff(memo);
+  expr_t arg2subst = arg2->undiff(memo);
+  expr_t arg3subst = arg3->undiff(memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
@@ -6121,33 +6728,33 @@ TrinaryOpNode::PacMaxLag(int lhs_symb_id) const
 }
 
 expr_t
-TrinaryOpNode::decreaseLeadsLags(int n) const
+TrinaryOpNode::decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->decreaseLeadsLags(n);
-  expr_t arg2subst = arg2->decreaseLeadsLags(n);
-  expr_t arg3subst = arg3->decreaseLeadsLags(n);
+  expr_t arg1subst = arg1->decreaseLeadsLags(n, memo);
+  expr_t arg2subst = arg2->decreaseLeadsLags(n, memo);
+  expr_t arg3subst = arg3->decreaseLeadsLags(n, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 expr_t
-TrinaryOpNode::decreaseLeadsLagsPredeterminedVariables() const
+TrinaryOpNode::decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->decreaseLeadsLagsPredeterminedVariables();
-  expr_t arg2subst = arg2->decreaseLeadsLagsPredeterminedVariables();
-  expr_t arg3subst = arg3->decreaseLeadsLagsPredeterminedVariables();
+  expr_t arg1subst = arg1->decreaseLeadsLagsPredeterminedVariables(memo);
+  expr_t arg2subst = arg2->decreaseLeadsLagsPredeterminedVariables(memo);
+  expr_t arg3subst = arg3->decreaseLeadsLagsPredeterminedVariables(memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 expr_t
-TrinaryOpNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+TrinaryOpNode::substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   if (maxEndoLead() < 2)
     return const_cast<TrinaryOpNode *>(this);
   else if (deterministic_model)
     {
-      expr_t arg1subst = arg1->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model);
-      expr_t arg2subst = arg2->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model);
-      expr_t arg3subst = arg3->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model);
+      expr_t arg1subst = arg1->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo);
+      expr_t arg2subst = arg2->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo);
+      expr_t arg3subst = arg3->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo);
       return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
     }
   else
@@ -6155,24 +6762,24 @@ TrinaryOpNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vect
 }
 
 expr_t
-TrinaryOpNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+TrinaryOpNode::substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteEndoLagGreaterThanTwo(subst_table, neweqs);
-  expr_t arg2subst = arg2->substituteEndoLagGreaterThanTwo(subst_table, neweqs);
-  expr_t arg3subst = arg3->substituteEndoLagGreaterThanTwo(subst_table, neweqs);
+  expr_t arg1subst = arg1->substituteEndoLagGreaterThanTwo(subst_table, neweqs, memo);
+  expr_t arg2subst = arg2->substituteEndoLagGreaterThanTwo(subst_table, neweqs, memo);
+  expr_t arg3subst = arg3->substituteEndoLagGreaterThanTwo(subst_table, neweqs, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 expr_t
-TrinaryOpNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+TrinaryOpNode::substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   if (maxExoLead() == 0)
     return const_cast<TrinaryOpNode *>(this);
   else if (deterministic_model)
     {
-      expr_t arg1subst = arg1->substituteExoLead(subst_table, neweqs, deterministic_model);
-      expr_t arg2subst = arg2->substituteExoLead(subst_table, neweqs, deterministic_model);
-      expr_t arg3subst = arg3->substituteExoLead(subst_table, neweqs, deterministic_model);
+      expr_t arg1subst = arg1->substituteExoLead(subst_table, neweqs, deterministic_model, memo);
+      expr_t arg2subst = arg2->substituteExoLead(subst_table, neweqs, deterministic_model, memo);
+      expr_t arg3subst = arg3->substituteExoLead(subst_table, neweqs, deterministic_model, memo);
       return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
     }
   else
@@ -6180,56 +6787,56 @@ TrinaryOpNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode
 }
 
 expr_t
-TrinaryOpNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+TrinaryOpNode::substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteExoLag(subst_table, neweqs);
-  expr_t arg2subst = arg2->substituteExoLag(subst_table, neweqs);
-  expr_t arg3subst = arg3->substituteExoLag(subst_table, neweqs);
+  expr_t arg1subst = arg1->substituteExoLag(subst_table, neweqs, memo);
+  expr_t arg2subst = arg2->substituteExoLag(subst_table, neweqs, memo);
+  expr_t arg3subst = arg3->substituteExoLag(subst_table, neweqs, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 expr_t
-TrinaryOpNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const
+TrinaryOpNode::substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteExpectation(subst_table, neweqs, partial_information_model);
-  expr_t arg2subst = arg2->substituteExpectation(subst_table, neweqs, partial_information_model);
-  expr_t arg3subst = arg3->substituteExpectation(subst_table, neweqs, partial_information_model);
+  expr_t arg1subst = arg1->substituteExpectation(subst_table, neweqs, partial_information_model, memo);
+  expr_t arg2subst = arg2->substituteExpectation(subst_table, neweqs, partial_information_model, memo);
+  expr_t arg3subst = arg3->substituteExpectation(subst_table, neweqs, partial_information_model, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 expr_t
-TrinaryOpNode::substituteAdl() const
+TrinaryOpNode::substituteAdlInternal(expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteAdl();
-  expr_t arg2subst = arg2->substituteAdl();
-  expr_t arg3subst = arg3->substituteAdl();
+  expr_t arg1subst = arg1->substituteAdl(memo);
+  expr_t arg2subst = arg2->substituteAdl(memo);
+  expr_t arg3subst = arg3->substituteAdl(memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 
 expr_t
-TrinaryOpNode::substituteVarExpectation(const map<string, expr_t> &subst_table) const
+TrinaryOpNode::substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteVarExpectation(subst_table);
-  expr_t arg2subst = arg2->substituteVarExpectation(subst_table);
-  expr_t arg3subst = arg3->substituteVarExpectation(subst_table);
+  expr_t arg1subst = arg1->substituteVarExpectation(subst_table, memo);
+  expr_t arg2subst = arg2->substituteVarExpectation(subst_table, memo);
+  expr_t arg3subst = arg3->substituteVarExpectation(subst_table, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 void
-TrinaryOpNode::findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const
+TrinaryOpNode::findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const
 {
-  arg1->findDiffNodes(static_datatree, diff_table);
-  arg2->findDiffNodes(static_datatree, diff_table);
-  arg3->findDiffNodes(static_datatree, diff_table);
+  arg1->findDiffNodes(static_datatree, diff_table, visited);
+  arg2->findDiffNodes(static_datatree, diff_table, visited);
+  arg3->findDiffNodes(static_datatree, diff_table, visited);
 }
 
 void
-TrinaryOpNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const
+TrinaryOpNode::findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const
 {
-  arg1->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes);
-  arg2->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes);
-  arg3->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes);
+  arg1->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes, visited);
+  arg2->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes, visited);
+  arg3->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes, visited);
 }
 
 int
@@ -6244,21 +6851,21 @@ TrinaryOpNode::findTrendVariable(int lhs_symb_id) const
 }
 
 expr_t
-TrinaryOpNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
-                              vector<BinaryOpNode *> &neweqs) const
+TrinaryOpNode::substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
+                              vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteDiff(static_datatree, diff_table, subst_table, neweqs);
-  expr_t arg2subst = arg2->substituteDiff(static_datatree, diff_table, subst_table, neweqs);
-  expr_t arg3subst = arg3->substituteDiff(static_datatree, diff_table, subst_table, neweqs);
+  expr_t arg1subst = arg1->substituteDiff(static_datatree, diff_table, subst_table, neweqs, memo);
+  expr_t arg2subst = arg2->substituteDiff(static_datatree, diff_table, subst_table, neweqs, memo);
+  expr_t arg3subst = arg3->substituteDiff(static_datatree, diff_table, subst_table, neweqs, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 expr_t
-TrinaryOpNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+TrinaryOpNode::substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs);
-  expr_t arg2subst = arg2->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs);
-  expr_t arg3subst = arg3->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs);
+  expr_t arg1subst = arg1->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs, memo);
+  expr_t arg2subst = arg2->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs, memo);
+  expr_t arg3subst = arg3->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
@@ -6269,20 +6876,20 @@ TrinaryOpNode::countDiffs() const
 }
 
 expr_t
-TrinaryOpNode::substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table)
+TrinaryOpNode::substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo)
 {
-  expr_t arg1subst = arg1->substitutePacExpectation(subst_table);
-  expr_t arg2subst = arg2->substitutePacExpectation(subst_table);
-  expr_t arg3subst = arg3->substitutePacExpectation(subst_table);
+  expr_t arg1subst = arg1->substitutePacExpectation(subst_table, memo);
+  expr_t arg2subst = arg2->substitutePacExpectation(subst_table, memo);
+  expr_t arg3subst = arg3->substitutePacExpectation(subst_table, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 expr_t
-TrinaryOpNode::differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+TrinaryOpNode::differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->differentiateForwardVars(subset, subst_table, neweqs);
-  expr_t arg2subst = arg2->differentiateForwardVars(subset, subst_table, neweqs);
-  expr_t arg3subst = arg3->differentiateForwardVars(subset, subst_table, neweqs);
+  expr_t arg1subst = arg1->differentiateForwardVars(subset, subst_table, neweqs, memo);
+  expr_t arg2subst = arg2->differentiateForwardVars(subset, subst_table, neweqs, memo);
+  expr_t arg3subst = arg3->differentiateForwardVars(subset, subst_table, neweqs, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
@@ -6317,29 +6924,29 @@ TrinaryOpNode::containsExogenous() const
 }
 
 expr_t
-TrinaryOpNode::replaceTrendVar() const
+TrinaryOpNode::replaceTrendVarInternal(expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->replaceTrendVar();
-  expr_t arg2subst = arg2->replaceTrendVar();
-  expr_t arg3subst = arg3->replaceTrendVar();
+  expr_t arg1subst = arg1->replaceTrendVar(memo);
+  expr_t arg2subst = arg2->replaceTrendVar(memo);
+  expr_t arg3subst = arg3->replaceTrendVar(memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 expr_t
-TrinaryOpNode::detrend(int symb_id, bool log_trend, expr_t trend) const
+TrinaryOpNode::detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->detrend(symb_id, log_trend, trend);
-  expr_t arg2subst = arg2->detrend(symb_id, log_trend, trend);
-  expr_t arg3subst = arg3->detrend(symb_id, log_trend, trend);
+  expr_t arg1subst = arg1->detrend(symb_id, log_trend, trend, memo);
+  expr_t arg2subst = arg2->detrend(symb_id, log_trend, trend, memo);
+  expr_t arg3subst = arg3->detrend(symb_id, log_trend, trend, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
 expr_t
-TrinaryOpNode::removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const
+TrinaryOpNode::removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->removeTrendLeadLag(trend_symbols_map);
-  expr_t arg2subst = arg2->removeTrendLeadLag(trend_symbols_map);
-  expr_t arg3subst = arg3->removeTrendLeadLag(trend_symbols_map);
+  expr_t arg1subst = arg1->removeTrendLeadLag(trend_symbols_map, memo);
+  expr_t arg2subst = arg2->removeTrendLeadLag(trend_symbols_map, memo);
+  expr_t arg3subst = arg3->removeTrendLeadLag(trend_symbols_map, memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
@@ -6418,11 +7025,11 @@ TrinaryOpNode::getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const
 }
 
 expr_t
-TrinaryOpNode::substituteStaticAuxiliaryVariable() const
+TrinaryOpNode::substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const
 {
-  expr_t arg1subst = arg1->substituteStaticAuxiliaryVariable();
-  expr_t arg2subst = arg2->substituteStaticAuxiliaryVariable();
-  expr_t arg3subst = arg3->substituteStaticAuxiliaryVariable();
+  expr_t arg1subst = arg1->substituteStaticAuxiliaryVariable(memo);
+  expr_t arg2subst = arg2->substituteStaticAuxiliaryVariable(memo);
+  expr_t arg3subst = arg3->substituteStaticAuxiliaryVariable(memo);
   return buildSimilarTrinaryOpNode(arg1subst, arg2subst, arg3subst, datatree);
 }
 
@@ -6442,6 +7049,12 @@ AbstractExternalFunctionNode::AbstractExternalFunctionNode(DataTree &datatree_ar
   symb_id(symb_id_arg),
   arguments(move(arguments_arg))
 {
+  boost::hash_combine(structural_hash, datatree.symbol_table.getName(symb_id));
+  for (auto argument : arguments)
+    {
+      boost::hash_combine(structural_hash, argument->getStructuralHash());
+      mergeLeadLag(argument);
+    }
 }
 
 void
@@ -6455,11 +7068,8 @@ AbstractExternalFunctionNode::prepareForDerivation()
 
   non_null_derivatives = arguments.at(0)->non_null_derivatives;
   for (int i = 1; i < (int) arguments.size(); i++)
-    set_union(non_null_derivatives.begin(),
-              non_null_derivatives.end(),
-              arguments.at(i)->non_null_derivatives.begin(),
-              arguments.at(i)->non_null_derivatives.end(),
-              inserter(non_null_derivatives, non_null_derivatives.begin()));
+    non_null_derivatives = mergeNonNullDerivatives(non_null_derivatives,
+                                                   arguments.at(i)->non_null_derivatives);
 
   preparedForDerivation = true;
 }
@@ -6504,10 +7114,10 @@ AbstractExternalFunctionNode::collectVARLHSVariable(set<expr_t> &result) const
 }
 
 void
-AbstractExternalFunctionNode::collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const
+AbstractExternalFunctionNode::collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const
 {
   for (auto argument : arguments)
-    argument->collectDynamicVariables(type_arg, result);
+    argument->collectDynamicVariables(type_arg, result, visited);
 }
 
 void
@@ -6530,65 +7140,71 @@ AbstractExternalFunctionNode::eval(const eval_context_t &eval_context) const noe
 }
 
 int
-AbstractExternalFunctionNode::maxEndoLead() const
+AbstractExternalFunctionNode::addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const
+{
+  return tape.addEvalError(true);
+}
+
+int
+AbstractExternalFunctionNode::maxEndoLeadInternal(memo_table_t<int> &memo) const
 {
   int val = 0;
   for (auto argument : arguments)
-    val = max(val, argument->maxEndoLead());
+    val = max(val, argument->maxEndoLead(memo));
   return val;
 }
 
 int
-AbstractExternalFunctionNode::maxExoLead() const
+AbstractExternalFunctionNode::maxExoLeadInternal(memo_table_t<int> &memo) const
 {
   int val = 0;
   for (auto argument : arguments)
-    val = max(val, argument->maxExoLead());
+    val = max(val, argument->maxExoLead(memo));
   return val;
 }
 
 int
-AbstractExternalFunctionNode::maxEndoLag() const
+AbstractExternalFunctionNode::maxEndoLagInternal(memo_table_t<int> &memo) const
 {
   int val = 0;
   for (auto argument : arguments)
-    val = max(val, argument->maxEndoLag());
+    val = max(val, argument->maxEndoLag(memo));
   return val;
 }
 
 int
-AbstractExternalFunctionNode::maxExoLag() const
+AbstractExternalFunctionNode::maxExoLagInternal(memo_table_t<int> &memo) const
 {
   int val = 0;
   for (auto argument : arguments)
-    val = max(val, argument->maxExoLag());
+    val = max(val, argument->maxExoLag(memo));
   return val;
 }
 
 int
-AbstractExternalFunctionNode::maxLead() const
+AbstractExternalFunctionNode::maxLeadInternal(memo_table_t<int> &memo) const
 {
   int val = 0;
   for (auto argument : arguments)
-    val = max(val, argument->maxLead());
+    val = max(val, argument->maxLead(memo));
   return val;
 }
 
 int
-AbstractExternalFunctionNode::maxLag() const
+AbstractExternalFunctionNode::maxLagInternal(memo_table_t<int> &memo) const
 {
   int val = 0;
   for (auto argument : arguments)
-    val = max(val, argument->maxLag());
+    val = max(val, argument->maxLag(memo));
   return val;
 }
 
 expr_t
-AbstractExternalFunctionNode::undiff() const
+AbstractExternalFunctionNode::undiffInternal(expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->undiff());
+    arguments_subst.push_back(argument->undiff(memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
@@ -6620,98 +7236,98 @@ AbstractExternalFunctionNode::PacMaxLag(int lhs_symb_id) const
 }
 
 expr_t
-AbstractExternalFunctionNode::decreaseLeadsLags(int n) const
+AbstractExternalFunctionNode::decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->decreaseLeadsLags(n));
+    arguments_subst.push_back(argument->decreaseLeadsLags(n, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::decreaseLeadsLagsPredeterminedVariables() const
+AbstractExternalFunctionNode::decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->decreaseLeadsLagsPredeterminedVariables());
+    arguments_subst.push_back(argument->decreaseLeadsLagsPredeterminedVariables(memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+AbstractExternalFunctionNode::substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model));
+    arguments_subst.push_back(argument->substituteEndoLeadGreaterThanTwo(subst_table, neweqs, deterministic_model, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+AbstractExternalFunctionNode::substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substituteEndoLagGreaterThanTwo(subst_table, neweqs));
+    arguments_subst.push_back(argument->substituteEndoLagGreaterThanTwo(subst_table, neweqs, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+AbstractExternalFunctionNode::substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substituteExoLead(subst_table, neweqs, deterministic_model));
+    arguments_subst.push_back(argument->substituteExoLead(subst_table, neweqs, deterministic_model, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+AbstractExternalFunctionNode::substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substituteExoLag(subst_table, neweqs));
+    arguments_subst.push_back(argument->substituteExoLag(subst_table, neweqs, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const
+AbstractExternalFunctionNode::substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substituteExpectation(subst_table, neweqs, partial_information_model));
+    arguments_subst.push_back(argument->substituteExpectation(subst_table, neweqs, partial_information_model, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::substituteAdl() const
+AbstractExternalFunctionNode::substituteAdlInternal(expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substituteAdl());
+    arguments_subst.push_back(argument->substituteAdl(memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::substituteVarExpectation(const map<string, expr_t> &subst_table) const
+AbstractExternalFunctionNode::substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substituteVarExpectation(subst_table));
+    arguments_subst.push_back(argument->substituteVarExpectation(subst_table, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 void
-AbstractExternalFunctionNode::findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const
+AbstractExternalFunctionNode::findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const
 {
   for (auto argument : arguments)
-    argument->findDiffNodes(static_datatree, diff_table);
+    argument->findDiffNodes(static_datatree, diff_table, visited);
 }
 
 void
-AbstractExternalFunctionNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const
+AbstractExternalFunctionNode::findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const
 {
   for (auto argument : arguments)
-    argument->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes);
+    argument->findUnaryOpNodesForAuxVarCreation(static_datatree, nodes, visited);
 }
 
 int
@@ -6727,21 +7343,21 @@ AbstractExternalFunctionNode::findTrendVariable(int lhs_symb_id) const
 }
 
 expr_t
-AbstractExternalFunctionNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
-                                             vector<BinaryOpNode *> &neweqs) const
+AbstractExternalFunctionNode::substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
+                                             vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substituteDiff(static_datatree, diff_table, subst_table, neweqs));
+    arguments_subst.push_back(argument->substituteDiff(static_datatree, diff_table, subst_table, neweqs, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+AbstractExternalFunctionNode::substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs));
+    arguments_subst.push_back(argument->substituteUnaryOpNodes(static_datatree, nodes, subst_table, neweqs, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
@@ -6755,20 +7371,20 @@ AbstractExternalFunctionNode::countDiffs() const
 }
 
 expr_t
-AbstractExternalFunctionNode::substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table)
+AbstractExternalFunctionNode::substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo)
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substitutePacExpectation(subst_table));
+    arguments_subst.push_back(argument->substitutePacExpectation(subst_table, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+AbstractExternalFunctionNode::differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->differentiateForwardVars(subset, subst_table, neweqs));
+    arguments_subst.push_back(argument->differentiateForwardVars(subset, subst_table, neweqs, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
@@ -6862,29 +7478,29 @@ AbstractExternalFunctionNode::containsExogenous() const
 }
 
 expr_t
-AbstractExternalFunctionNode::replaceTrendVar() const
+AbstractExternalFunctionNode::replaceTrendVarInternal(expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->replaceTrendVar());
+    arguments_subst.push_back(argument->replaceTrendVar(memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::detrend(int symb_id, bool log_trend, expr_t trend) const
+AbstractExternalFunctionNode::detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->detrend(symb_id, log_trend, trend));
+    arguments_subst.push_back(argument->detrend(symb_id, log_trend, trend, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
 expr_t
-AbstractExternalFunctionNode::removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const
+AbstractExternalFunctionNode::removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->removeTrendLeadLag(trend_symbols_map));
+    arguments_subst.push_back(argument->removeTrendLeadLag(trend_symbols_map, memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
@@ -7032,11 +7648,11 @@ AbstractExternalFunctionNode::containsExternalFunction() const
 }
 
 expr_t
-AbstractExternalFunctionNode::substituteStaticAuxiliaryVariable() const
+AbstractExternalFunctionNode::substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const
 {
   vector<expr_t> arguments_subst;
   for (auto argument : arguments)
-    arguments_subst.push_back(argument->substituteStaticAuxiliaryVariable());
+    arguments_subst.push_back(argument->substituteStaticAuxiliaryVariable(memo));
   return buildSimilarExternalFunctionNode(arguments_subst, datatree);
 }
 
@@ -7053,6 +7669,7 @@ ExternalFunctionNode::ExternalFunctionNode(DataTree &datatree_arg,
                                            const vector<expr_t> &arguments_arg) :
   AbstractExternalFunctionNode(datatree_arg, idx_arg, symb_id_arg, arguments_arg)
 {
+  boost::hash_combine(structural_hash, 'e');
 }
 
 expr_t
@@ -7327,11 +7944,11 @@ ExternalFunctionNode::writeJsonExternalFunctionOutput(vector<string> &efout,
 }
 
 expr_t
-ExternalFunctionNode::toStatic(DataTree &static_datatree) const
+ExternalFunctionNode::toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const
 {
   vector<expr_t> static_arguments;
   for (auto argument : arguments)
-    static_arguments.push_back(argument->toStatic(static_datatree));
+    static_arguments.push_back(argument->toStatic(static_datatree, memo));
   return static_datatree.AddExternalFunction(symb_id, static_arguments);
 }
 
@@ -7344,11 +7961,11 @@ ExternalFunctionNode::computeXrefs(EquationInfo &ei) const
 }
 
 expr_t
-ExternalFunctionNode::cloneDynamic(DataTree &dynamic_datatree) const
+ExternalFunctionNode::cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const
 {
   vector<expr_t> dynamic_arguments;
   for (auto argument : arguments)
-    dynamic_arguments.push_back(argument->cloneDynamic(dynamic_datatree));
+    dynamic_arguments.push_back(argument->cloneDynamic(dynamic_datatree, memo));
   return dynamic_datatree.AddExternalFunction(symb_id, dynamic_arguments);
 }
 
@@ -7375,6 +7992,8 @@ FirstDerivExternalFunctionNode::FirstDerivExternalFunctionNode(DataTree &datatre
   AbstractExternalFunctionNode(datatree_arg, idx_arg, top_level_symb_id_arg, arguments_arg),
   inputIndex(inputIndex_arg)
 {
+  boost::hash_combine(structural_hash, 'f');
+  boost::hash_combine(structural_hash, inputIndex);
 }
 
 void
@@ -7701,11 +8320,11 @@ FirstDerivExternalFunctionNode::compileExternalFunctionOutput(ostream &CompileCo
 }
 
 expr_t
-FirstDerivExternalFunctionNode::cloneDynamic(DataTree &dynamic_datatree) const
+FirstDerivExternalFunctionNode::cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const
 {
   vector<expr_t> dynamic_arguments;
   for (auto argument : arguments)
-    dynamic_arguments.push_back(argument->cloneDynamic(dynamic_datatree));
+    dynamic_arguments.push_back(argument->cloneDynamic(dynamic_datatree, memo));
   return dynamic_datatree.AddFirstDerivExternalFunction(symb_id, dynamic_arguments,
                                                         inputIndex);
 }
@@ -7717,11 +8336,11 @@ FirstDerivExternalFunctionNode::buildSimilarExternalFunctionNode(vector<expr_t>
 }
 
 expr_t
-FirstDerivExternalFunctionNode::toStatic(DataTree &static_datatree) const
+FirstDerivExternalFunctionNode::toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const
 {
   vector<expr_t> static_arguments;
   for (auto argument : arguments)
-    static_arguments.push_back(argument->toStatic(static_datatree));
+    static_arguments.push_back(argument->toStatic(static_datatree, memo));
   return static_datatree.AddFirstDerivExternalFunction(symb_id, static_arguments,
                                                        inputIndex);
 }
@@ -7760,6 +8379,9 @@ SecondDerivExternalFunctionNode::SecondDerivExternalFunctionNode(DataTree &datat
   inputIndex1(inputIndex1_arg),
   inputIndex2(inputIndex2_arg)
 {
+  boost::hash_combine(structural_hash, 's');
+  boost::hash_combine(structural_hash, inputIndex1);
+  boost::hash_combine(structural_hash, inputIndex2);
 }
 
 void
@@ -8015,11 +8637,11 @@ SecondDerivExternalFunctionNode::writeJsonExternalFunctionOutput(vector<string>
 }
 
 expr_t
-SecondDerivExternalFunctionNode::cloneDynamic(DataTree &dynamic_datatree) const
+SecondDerivExternalFunctionNode::cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const
 {
   vector<expr_t> dynamic_arguments;
   for (auto argument : arguments)
-    dynamic_arguments.push_back(argument->cloneDynamic(dynamic_datatree));
+    dynamic_arguments.push_back(argument->cloneDynamic(dynamic_datatree, memo));
   return dynamic_datatree.AddSecondDerivExternalFunction(symb_id, dynamic_arguments,
                                                          inputIndex1, inputIndex2);
 }
@@ -8031,11 +8653,11 @@ SecondDerivExternalFunctionNode::buildSimilarExternalFunctionNode(vector<expr_t>
 }
 
 expr_t
-SecondDerivExternalFunctionNode::toStatic(DataTree &static_datatree) const
+SecondDerivExternalFunctionNode::toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const
 {
   vector<expr_t> static_arguments;
   for (auto argument : arguments)
-    static_arguments.push_back(argument->toStatic(static_datatree));
+    static_arguments.push_back(argument->toStatic(static_datatree, memo));
   return static_datatree.AddSecondDerivExternalFunction(symb_id, static_arguments,
                                                         inputIndex1, inputIndex2);
 }
@@ -8090,6 +8712,10 @@ VarExpectationNode::VarExpectationNode(DataTree &datatree_arg,
   ExprNode(datatree_arg, idx_arg),
   model_name{move(model_name_arg)}
 {
+  boost::hash_combine(structural_hash, 'x');
+  boost::hash_combine(structural_hash, model_name);
+  // Leads and lags are not implemented for this node
+  lead_lag_cached = false;
 }
 
 void
@@ -8114,14 +8740,14 @@ VarExpectationNode::computeTemporaryTerms(map<expr_t, int> &reference_count,
 }
 
 expr_t
-VarExpectationNode::toStatic(DataTree &static_datatree) const
+VarExpectationNode::toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::toStatic not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 expr_t
-VarExpectationNode::cloneDynamic(DataTree &dynamic_datatree) const
+VarExpectationNode::cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const
 {
   return dynamic_datatree.AddVarExpectation(model_name);
 }
@@ -8145,49 +8771,49 @@ VarExpectationNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
 }
 
 int
-VarExpectationNode::maxEndoLead() const
+VarExpectationNode::maxEndoLeadInternal(memo_table_t<int> &memo) const
 {
   cerr << "VarExpectationNode::maxEndoLead not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 int
-VarExpectationNode::maxExoLead() const
+VarExpectationNode::maxExoLeadInternal(memo_table_t<int> &memo) const
 {
   cerr << "VarExpectationNode::maxExoLead not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 int
-VarExpectationNode::maxEndoLag() const
+VarExpectationNode::maxEndoLagInternal(memo_table_t<int> &memo) const
 {
   cerr << "VarExpectationNode::maxEndoLead not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 int
-VarExpectationNode::maxExoLag() const
+VarExpectationNode::maxExoLagInternal(memo_table_t<int> &memo) const
 {
   cerr << "VarExpectationNode::maxExoLead not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 int
-VarExpectationNode::maxLead() const
+VarExpectationNode::maxLeadInternal(memo_table_t<int> &memo) const
 {
   cerr << "VarExpectationNode::maxLead not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 int
-VarExpectationNode::maxLag() const
+VarExpectationNode::maxLagInternal(memo_table_t<int> &memo) const
 {
   cerr << "VarExpectationNode::maxLag not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 expr_t
-VarExpectationNode::undiff() const
+VarExpectationNode::undiffInternal(expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::undiff not implemented." << endl;
   exit(EXIT_FAILURE);
@@ -8215,7 +8841,7 @@ VarExpectationNode::PacMaxLag(int lhs_symb_id) const
 }
 
 expr_t
-VarExpectationNode::decreaseLeadsLags(int n) const
+VarExpectationNode::decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::decreaseLeadsLags not implemented." << endl;
   exit(EXIT_FAILURE);
@@ -8254,6 +8880,12 @@ VarExpectationNode::eval(const eval_context_t &eval_context) const noexcept(fals
   throw EvalException();
 }
 
+int
+VarExpectationNode::addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const
+{
+  return tape.addEvalError(false);
+}
+
 int
 VarExpectationNode::countDiffs() const
 {
@@ -8274,7 +8906,7 @@ VarExpectationNode::collectVARLHSVariable(set<expr_t> &result) const
 }
 
 void
-VarExpectationNode::collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const
+VarExpectationNode::collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const
 {
 }
 
@@ -8303,47 +8935,47 @@ VarExpectationNode::normalizeEquation(int var_endo, vector<pair<int, pair<expr_t
 }
 
 expr_t
-VarExpectationNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+VarExpectationNode::substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::substituteEndoLeadGreaterThanTwo not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 expr_t
-VarExpectationNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+VarExpectationNode::substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::substituteEndoLagGreaterThanTwo not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 expr_t
-VarExpectationNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+VarExpectationNode::substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::substituteExoLead not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 expr_t
-VarExpectationNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+VarExpectationNode::substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::substituteExoLag not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 expr_t
-VarExpectationNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const
+VarExpectationNode::substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const
 {
   return const_cast<VarExpectationNode *>(this);
 }
 
 expr_t
-VarExpectationNode::substituteAdl() const
+VarExpectationNode::substituteAdlInternal(expr_memo_t &memo) const
 {
   return const_cast<VarExpectationNode *>(this);
 }
 
 expr_t
-VarExpectationNode::substituteVarExpectation(const map<string, expr_t> &subst_table) const
+VarExpectationNode::substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const
 {
   auto it = subst_table.find(model_name);
   if (it == subst_table.end())
@@ -8355,12 +8987,12 @@ VarExpectationNode::substituteVarExpectation(const map<string, expr_t> &subst_ta
 }
 
 void
-VarExpectationNode::findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const
+VarExpectationNode::findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const
 {
 }
 
 void
-VarExpectationNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const
+VarExpectationNode::findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const
 {
 }
 
@@ -8371,26 +9003,26 @@ VarExpectationNode::findTrendVariable(int lhs_symb_id) const
 }
 
 expr_t
-VarExpectationNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
-                                   vector<BinaryOpNode *> &neweqs) const
+VarExpectationNode::substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
+                                   vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<VarExpectationNode *>(this);
 }
 
 expr_t
-VarExpectationNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+VarExpectationNode::substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<VarExpectationNode *>(this);
 }
 
 expr_t
-VarExpectationNode::substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table)
+VarExpectationNode::substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo)
 {
   return const_cast<VarExpectationNode *>(this);
 }
 
 expr_t
-VarExpectationNode::differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+VarExpectationNode::differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::differentiateForwardVars not implemented." << endl;
   exit(EXIT_FAILURE);
@@ -8423,7 +9055,7 @@ VarExpectationNode::isNumConstNodeEqualTo(double value) const
 }
 
 expr_t
-VarExpectationNode::decreaseLeadsLagsPredeterminedVariables() const
+VarExpectationNode::decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::decreaseLeadsLagsPredeterminedVariables not implemented." << endl;
   exit(EXIT_FAILURE);
@@ -8436,21 +9068,21 @@ VarExpectationNode::isVariableNodeEqualTo(SymbolType type_arg, int variable_id,
 }
 
 expr_t
-VarExpectationNode::replaceTrendVar() const
+VarExpectationNode::replaceTrendVarInternal(expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::replaceTrendVar not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 expr_t
-VarExpectationNode::detrend(int symb_id, bool log_trend, expr_t trend) const
+VarExpectationNode::detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::detrend not implemented." << endl;
   exit(EXIT_FAILURE);
 }
 
 expr_t
-VarExpectationNode::removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const
+VarExpectationNode::removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const
 {
   cerr << "VarExpectationNode::removeTrendLeadLag not implemented." << endl;
   exit(EXIT_FAILURE);
@@ -8515,7 +9147,7 @@ VarExpectationNode::fillPacExpectationVarInfo(string &model_name_arg, vector<int
 }
 
 expr_t
-VarExpectationNode::substituteStaticAuxiliaryVariable() const
+VarExpectationNode::substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const
 {
   return const_cast<VarExpectationNode *>(this);
 }
@@ -8542,6 +9174,8 @@ PacExpectationNode::PacExpectationNode(DataTree &datatree_arg,
   ExprNode(datatree_arg, idx_arg),
   model_name(move(model_name_arg))
 {
+  boost::hash_combine(structural_hash, 'p');
+  boost::hash_combine(structural_hash, model_name);
 }
 
 void
@@ -8567,13 +9201,13 @@ PacExpectationNode::computeTemporaryTerms(map<expr_t, int> &reference_count,
 }
 
 expr_t
-PacExpectationNode::toStatic(DataTree &static_datatree) const
+PacExpectationNode::toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const
 {
   return static_datatree.AddPacExpectation(string(model_name));
 }
 
 expr_t
-PacExpectationNode::cloneDynamic(DataTree &dynamic_datatree) const
+PacExpectationNode::cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const
 {
   return dynamic_datatree.AddPacExpectation(string(model_name));
 }
@@ -8704,43 +9338,43 @@ PacExpectationNode::writeOutput(ostream &output, ExprNodeOutputType output_type,
 }
 
 int
-PacExpectationNode::maxEndoLead() const
+PacExpectationNode::maxEndoLeadInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 int
-PacExpectationNode::maxExoLead() const
+PacExpectationNode::maxExoLeadInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 int
-PacExpectationNode::maxEndoLag() const
+PacExpectationNode::maxEndoLagInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 int
-PacExpectationNode::maxExoLag() const
+PacExpectationNode::maxExoLagInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 int
-PacExpectationNode::maxLead() const
+PacExpectationNode::maxLeadInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 int
-PacExpectationNode::maxLag() const
+PacExpectationNode::maxLagInternal(memo_table_t<int> &memo) const
 {
   return 0;
 }
 
 expr_t
-PacExpectationNode::undiff() const
+PacExpectationNode::undiffInternal(expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
@@ -8764,7 +9398,7 @@ PacExpectationNode::PacMaxLag(int lhs_symb_id) const
 }
 
 expr_t
-PacExpectationNode::decreaseLeadsLags(int n) const
+PacExpectationNode::decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
@@ -8802,6 +9436,12 @@ PacExpectationNode::eval(const eval_context_t &eval_context) const noexcept(fals
   throw EvalException();
 }
 
+int
+PacExpectationNode::addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const
+{
+  return tape.addEvalError(false);
+}
+
 void
 PacExpectationNode::computeXrefs(EquationInfo &ei) const
 {
@@ -8815,7 +9455,7 @@ PacExpectationNode::collectVARLHSVariable(set<expr_t> &result) const
 }
 
 void
-PacExpectationNode::collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const
+PacExpectationNode::collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const
 {
 }
 
@@ -8851,54 +9491,54 @@ PacExpectationNode::normalizeEquation(int var_endo, vector<pair<int, pair<expr_t
 }
 
 expr_t
-PacExpectationNode::substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+PacExpectationNode::substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 expr_t
-PacExpectationNode::substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+PacExpectationNode::substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 expr_t
-PacExpectationNode::substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const
+PacExpectationNode::substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 expr_t
-PacExpectationNode::substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+PacExpectationNode::substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 expr_t
-PacExpectationNode::substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const
+PacExpectationNode::substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 expr_t
-PacExpectationNode::substituteAdl() const
+PacExpectationNode::substituteAdlInternal(expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 expr_t
-PacExpectationNode::substituteVarExpectation(const map<string, expr_t> &subst_table) const
+PacExpectationNode::substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 void
-PacExpectationNode::findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const
+PacExpectationNode::findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const
 {
 }
 
 void
-PacExpectationNode::findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const
+PacExpectationNode::findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const
 {
 }
 
@@ -8909,20 +9549,20 @@ PacExpectationNode::findTrendVariable(int lhs_symb_id) const
 }
 
 expr_t
-PacExpectationNode::substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
-                                   vector<BinaryOpNode *> &neweqs) const
+PacExpectationNode::substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table,
+                                   vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 expr_t
-PacExpectationNode::substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+PacExpectationNode::substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 expr_t
-PacExpectationNode::differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const
+PacExpectationNode::differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
@@ -8955,7 +9595,7 @@ PacExpectationNode::isNumConstNodeEqualTo(double value) const
 }
 
 expr_t
-PacExpectationNode::decreaseLeadsLagsPredeterminedVariables() const
+PacExpectationNode::decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
@@ -8967,19 +9607,19 @@ PacExpectationNode::isVariableNodeEqualTo(SymbolType type_arg, int variable_id,
 }
 
 expr_t
-PacExpectationNode::replaceTrendVar() const
+PacExpectationNode::replaceTrendVarInternal(expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 expr_t
-PacExpectationNode::detrend(int symb_id, bool log_trend, expr_t trend) const
+PacExpectationNode::detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
 
 expr_t
-PacExpectationNode::removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const
+PacExpectationNode::removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
@@ -9002,7 +9642,7 @@ PacExpectationNode::getEndosAndMaxLags(map<string, int> &model_endos_and_lags) c
 }
 
 expr_t
-PacExpectationNode::substituteStaticAuxiliaryVariable() const
+PacExpectationNode::substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const
 {
   return const_cast<PacExpectationNode *>(this);
 }
@@ -9098,7 +9738,7 @@ PacExpectationNode::fillPacExpectationVarInfo(string &model_name_arg, vector<int
 }
 
 expr_t
-PacExpectationNode::substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table)
+PacExpectationNode::substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo)
 {
   map<const PacExpectationNode *, const BinaryOpNode *>::const_iterator myit =
     subst_table.find(const_cast<PacExpectationNode *>(this));
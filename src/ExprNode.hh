@@ -22,6 +22,8 @@
 
 #include <set>
 #include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include <ostream>
 #include <functional>
@@ -34,6 +36,7 @@ using namespace std;
 #include "SymbolList.hh"
 
 class DataTree;
+class EvalTape;
 class VariableNode;
 class UnaryOpNode;
 class BinaryOpNode;
@@ -55,9 +58,43 @@ using temporary_terms_inuse_t = set<int>;
 
 using map_idx_t = map<int, int>;
 
+//! Evaluation context, giving the values of symbols
+/*! Values are stored in a vector indexed by symbol ID, with a bitmap telling
+  which symbols have a value. Lags are assumed to be null */
+class EvalContext
+{
+private:
+  vector<double> values;
+  vector<bool> known;
+public:
+  //! Returns whether the symbol has a value
+  bool
+  isKnown(int symb_id) const
+  {
+    return symb_id < (int) known.size() && known[symb_id];
+  }
+  //! Returns the value of a symbol, which must be known
+  double
+  get(int symb_id) const
+  {
+    return values[symb_id];
+  }
+  //! Sets the value of a symbol
+  void
+  set(int symb_id, double value)
+  {
+    if (symb_id >= (int) known.size())
+      {
+        values.resize(symb_id+1, 0);
+        known.resize(symb_id+1, false);
+      }
+    values[symb_id] = value;
+    known[symb_id] = true;
+  }
+};
+
 //! Type for evaluation contexts
-/*! The key is a symbol id. Lags are assumed to be null */
-using eval_context_t = map<int, double>;
+using eval_context_t = EvalContext;
 
 //! Type for tracking first/second derivative functions that have already been written as temporary terms
 using deriv_node_temp_terms_t = map<pair<int, vector<expr_t>>, int>;
@@ -75,6 +112,7 @@ enum class ExprNodeOutputType
     matlabDynamicModelSparse,                    //!< Matlab code, dynamic block decomposed model
     CDynamicModel,                               //!< C code, dynamic model
     CStaticModel,                                //!< C code, static model
+    CDynamicModelSplit,                          //!< C code, dynamic model split into several files (temporary terms in array T)
     juliaStaticModel,                            //!< Julia code, static model
     juliaDynamicModel,                           //!< Julia code, dynamic model
     matlabOutsideModel,                          //!< Matlab code, outside model block (for example in initval)
@@ -84,6 +122,7 @@ enum class ExprNodeOutputType
     matlabDynamicSteadyStateOperator,            //!< Matlab code, dynamic model, inside a steady state operator
     matlabDynamicSparseSteadyStateOperator,      //!< Matlab code, dynamic block decomposed model, inside a steady state operator
     CDynamicSteadyStateOperator,                 //!< C code, dynamic model, inside a steady state operator
+    CDynamicSplitSteadyStateOperator,            //!< C code, split dynamic model, inside a steady state operator
     juliaDynamicSteadyStateOperator,             //!< Julia code, dynamic model, inside a steady state operator
     steadyStateFile,                             //!< Matlab code, in the generated steady state file
     juliaSteadyStateFile,                        //!< Julia code, in the generated steady state file
@@ -120,7 +159,9 @@ isCOutput(ExprNodeOutputType output_type)
 {
   return output_type == ExprNodeOutputType::CDynamicModel
     || output_type == ExprNodeOutputType::CStaticModel
-    || output_type == ExprNodeOutputType::CDynamicSteadyStateOperator;
+    || output_type == ExprNodeOutputType::CDynamicModelSplit
+    || output_type == ExprNodeOutputType::CDynamicSteadyStateOperator
+    || output_type == ExprNodeOutputType::CDynamicSplitSteadyStateOperator;
 }
 
 inline bool
@@ -159,6 +200,26 @@ class ExprNode
       friend class AbstractExternalFunctionNode;
       friend class VarExpectationNode;
       friend class PacExpectationNode;
+    public:
+      //! Type for the substitution map used in the process of creating auxiliary vars for leads >= 2
+      using subst_table_t = map<const ExprNode *, const VariableNode *>;
+
+      //! Type for the substitution map used in the process of substituting adl expressions
+      using subst_table_adl_t = map<const ExprNode *, const expr_t>;
+
+      //! Type for the memo tables of the traversals of the expression DAG
+      /*! Maps the nodes already visited by a traversal to its result on them,
+        so that shared subexpressions are only traversed once, and the cost of
+        a traversal is linear in the number of distinct nodes. Every traversal
+        foo() comes with an overload taking a memo table, which must only be
+        shared between calls with the same arguments, and a virtual
+        fooInternal() implementing it, called on memo table misses. */
+      template<typename T>
+      using memo_table_t = unordered_map<const ExprNode *, T>;
+      //! Type for the memo tables of the traversals returning an expression (cloneDynamic(), toStatic(), substitute*()...)
+      using expr_memo_t = memo_table_t<expr_t>;
+      //! Type for the set of nodes already visited by the traversals filling a result argument (collectDynamicVariables(), find*Nodes())
+      using visited_set_t = unordered_set<const ExprNode *>;
     private:
       //! Computes derivative w.r. to a derivation ID (but doesn't store it in derivatives map)
       /*! You shoud use getDerivative() to get the benefit of symbolic a priori and of caching */
@@ -174,11 +235,52 @@ class ExprNode
       //! Is the data member non_null_derivatives initialized ?
       bool preparedForDerivation;
 
-      //! Set of derivation IDs with respect to which the derivative is potentially non-null
-      set<int> non_null_derivatives;
+      //! Sorted vector of derivation IDs with respect to which the derivative is potentially non-null
+      vector<int> non_null_derivatives;
 
       //! Used for caching of first order derivatives (when non-null)
-      map<int, expr_t> derivatives;
+      /*! derivatives[i] is the derivative w.r. to non_null_derivatives[i], or
+        nullptr if it has not yet been computed. It is allocated on first use. */
+      vector<expr_t> derivatives;
+
+      //! Returns the position of a derivation ID in non_null_derivatives, or -1 if it is not there
+      int nonNullDerivativeIndex(int deriv_id) const;
+
+      //! Computes the union of two sorted vectors of derivation IDs
+      static vector<int> mergeNonNullDerivatives(const vector<int> &v1, const vector<int> &v2);
+
+      //! Structural hash of the node
+      /*! It only depends on the expression represented by the node (operators,
+        symbol names, values of constants), and not on node indices or on the
+        datatree. It is set by the constructors of derived classes, and used for
+        sharing nodes within a datatree (see NodeHashTable). */
+      size_t structural_hash;
+
+      //! Does the node evaluate to a constant? (see isConstant())
+      /*! It is set by the constructors of derived classes, from the attributes of their arguments */
+      bool constant{false};
+      //! Value of the node, if it is constant
+      double constant_value{0};
+
+      //! Maximum leads and lags of a node (see maxEndoLead() and friends)
+      struct LeadLagInfo
+      {
+        int max_endo_lead{0}, max_exo_lead{0}, max_endo_lag{0}, max_exo_lag{0}, max_lead{0}, max_lag{0};
+        //! Takes, for each lead and lag, the maximum with that of another node
+        void merge(const LeadLagInfo &other);
+      };
+      //! Maximum leads and lags of the node
+      /*! Since nodes are immutable, they are set once by the constructors of
+        derived classes, from those of their arguments. */
+      LeadLagInfo lead_lag;
+      //! Is lead_lag valid?
+      /*! False for nodes which depend on a model local variable, whose
+        expression can be replaced by the transformation passes, and for
+        VarExpectationNode. maxEndoLead() and friends then fall back on a
+        traversal. */
+      bool lead_lag_cached{true};
+      //! Merges the leads and lags of an argument of the node into lead_lag and lead_lag_cached
+      void mergeLeadLag(const ExprNode *arg);
 
       const static int min_cost_matlab{40*90};
       const static int min_cost_c{40*4};
@@ -205,11 +307,78 @@ class ExprNode
       bool checkIfTemporaryTermThenWrite(ostream &output, ExprNodeOutputType output_type,
                                          const temporary_terms_t &temporary_terms,
                                          const temporary_terms_idxs_t &temporary_terms_idxs) const;
+
+      //! Returns the result of a traversal on this node, calling compute() on memo table misses
+      template<typename T, typename F>
+      T
+      memoize(memo_table_t<T> &memo, F compute) const
+      {
+        auto it = memo.find(this);
+        if (it != memo.end())
+          return it->second;
+        T result = compute();
+        memo.emplace(this, result);
+        return result;
+      }
+
+      //! Internal implementations of the traversals, called on memo table misses (see memo_table_t)
+      virtual expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const = 0;
+      virtual void collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const = 0;
+      virtual expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const = 0;
+      virtual int maxEndoLeadInternal(memo_table_t<int> &memo) const = 0;
+      virtual int maxExoLeadInternal(memo_table_t<int> &memo) const = 0;
+      virtual int maxEndoLagInternal(memo_table_t<int> &memo) const = 0;
+      virtual int maxExoLagInternal(memo_table_t<int> &memo) const = 0;
+      virtual int maxLeadInternal(memo_table_t<int> &memo) const = 0;
+      virtual int maxLagInternal(memo_table_t<int> &memo) const = 0;
+      virtual expr_t undiffInternal(expr_memo_t &memo) const = 0;
+      virtual expr_t decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const = 0;
+      virtual expr_t substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const = 0;
+      virtual expr_t substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const = 0;
+      virtual expr_t substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const = 0;
+      virtual expr_t substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const = 0;
+      virtual expr_t substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const = 0;
+      virtual expr_t decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const = 0;
+      virtual expr_t differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const = 0;
+      virtual expr_t replaceTrendVarInternal(expr_memo_t &memo) const = 0;
+      virtual expr_t detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const = 0;
+      virtual expr_t substituteAdlInternal(expr_memo_t &memo) const = 0;
+      virtual expr_t substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const = 0;
+      virtual void findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const = 0;
+      virtual void findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const = 0;
+      virtual expr_t substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const = 0;
+      virtual expr_t substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const = 0;
+      virtual expr_t substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo) = 0;
+      virtual expr_t removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const = 0;
+      virtual expr_t substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const = 0;
+      virtual int addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const = 0;
     public:
       ExprNode(DataTree &datatree_arg, int idx_arg);
       virtual
       ~ExprNode();
 
+      //! Returns the structural hash of the node
+      size_t
+      getStructuralHash() const
+      {
+        return structural_hash;
+      };
+
+      //! Returns true if the node evaluates to a constant, i.e. if eval() succeeds with an empty evaluation context
+      /*! This is an O(1) test, which does not involve any evaluation nor exception */
+      bool
+      isConstant() const
+      {
+        return constant;
+      };
+
+      //! Returns the value of the node, which must be constant (see isConstant())
+      double
+      getConstantValue() const
+      {
+        return constant_value;
+      };
+
       //! Initializes data member non_null_derivatives
       virtual void prepareForDerivation() = 0;
 
@@ -289,7 +458,8 @@ class ExprNode
         Note that model local variables are substituted by their expression in the computation
         (and added if type_arg = ModelLocalVariable).
       */
-      virtual void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const = 0;
+      void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const;
+      void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const;
 
       //! Find lowest lag for VAR
       virtual int VarMinLag() const = 0;
@@ -345,6 +515,9 @@ class ExprNode
       };
 
       virtual double eval(const eval_context_t &eval_context) const noexcept(false) = 0;
+      //! Adds the instructions computing this expression to an evaluation tape (see EvalTape::add())
+      /*! Returns the index of the slot holding the value of the expression */
+      int addToTape(EvalTape &tape, memo_table_t<int> &memo) const;
       virtual void compile(ostream &CompileCode, unsigned int &instruction_number, bool lhs_rhs, const temporary_terms_t &temporary_terms, const map_idx_t &map_idx, bool dynamic, bool steady_dynamic, const deriv_node_temp_terms_t &tef_terms) const = 0;
       void compile(ostream &CompileCode, unsigned int &instruction_number, bool lhs_rhs, const temporary_terms_t &temporary_terms, const map_idx_t &map_idx, bool dynamic, bool steady_dynamic) const;
       //! Creates a static version of this node
@@ -352,7 +525,8 @@ class ExprNode
         This method duplicates the current node by creating a similar node from which all leads/lags have been stripped,
         adds the result in the static_datatree argument (and not in the original datatree), and returns it.
       */
-      virtual expr_t toStatic(DataTree &static_datatree) const = 0;
+      expr_t toStatic(DataTree &static_datatree) const;
+      expr_t toStatic(DataTree &static_datatree, expr_memo_t &memo) const;
 
       /*!
         Compute cross references for equations
@@ -364,33 +538,40 @@ class ExprNode
 
       //! Returns the maximum lead of endogenous in this expression
       /*! Always returns a non-negative value */
-      virtual int maxEndoLead() const = 0;
+      int maxEndoLead() const;
+      int maxEndoLead(memo_table_t<int> &memo) const;
 
       //! Returns the maximum lead of exogenous in this expression
       /*! Always returns a non-negative value */
-      virtual int maxExoLead() const = 0;
+      int maxExoLead() const;
+      int maxExoLead(memo_table_t<int> &memo) const;
 
       //! Returns the maximum lag of endogenous in this expression
       /*! Always returns a non-negative value */
-      virtual int maxEndoLag() const = 0;
+      int maxEndoLag() const;
+      int maxEndoLag(memo_table_t<int> &memo) const;
 
       //! Returns the maximum lag of exogenous in this expression
       /*! Always returns a non-negative value */
-      virtual int maxExoLag() const = 0;
+      int maxExoLag() const;
+      int maxExoLag(memo_table_t<int> &memo) const;
 
       //! Returns the relative period of the most forward term in this expression
       /*! A negative value means that the expression contains only lagged variables */
-      virtual int maxLead() const = 0;
+      int maxLead() const;
+      int maxLead(memo_table_t<int> &memo) const;
 
       //! Returns the relative period of the most backward term in this expression
       /*! A negative value means that the expression contains only leaded variables */
-      virtual int maxLag() const = 0;
+      int maxLag() const;
+      int maxLag(memo_table_t<int> &memo) const;
 
       //! Get Max lag of var associated with Pac model
       //! Takes account of undiffed LHS variables in calculating the max lag
       virtual int PacMaxLag(int lhs_symb_id) const = 0;
 
-      virtual expr_t undiff() const = 0;
+      expr_t undiff() const;
+      expr_t undiff(expr_memo_t &memo) const;
 
       //! Returns a new expression where all the leads/lags have been shifted backwards by the same amount
       /*!
@@ -398,13 +579,8 @@ class ExprNode
         \param[in] n The number of lags by which to shift
         \return The same expression except that leads/lags have been shifted backwards
       */
-      virtual expr_t decreaseLeadsLags(int n) const = 0;
-
-      //! Type for the substitution map used in the process of creating auxiliary vars for leads >= 2
-      using subst_table_t = map<const ExprNode *, const VariableNode *>;
-
-      //! Type for the substitution map used in the process of substituting adl expressions
-      using subst_table_adl_t = map<const ExprNode *, const expr_t>;
+      expr_t decreaseLeadsLags(int n) const;
+      expr_t decreaseLeadsLags(int n, expr_memo_t &memo) const;
 
       //! Creates auxiliary endo lead variables corresponding to this expression
       /*!
@@ -437,27 +613,31 @@ class ExprNode
 
         \return A new equivalent expression where sub-expressions with max endo lead >= 2 have been replaced by auxiliary variables
       */
-      virtual expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const = 0;
+      expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const;
+      expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const;
 
       //! Constructs a new expression where endo variables with max endo lag >= 2 have been replaced by auxiliary variables
       /*!
         \param[in,out] subst_table Map used to store expressions that have already be substituted and their corresponding variable, in order to avoid creating two auxiliary variables for the same sub-expr.
         \param[out] neweqs Equations to be added to the model to match the creation of auxiliary variables.
       */
-      virtual expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const = 0;
+      expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const;
+      expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const;
 
       //! Constructs a new expression where exogenous variables with a lead have been replaced by auxiliary variables
       /*!
         \param[in,out] subst_table Map used to store expressions that have already be substituted and their corresponding variable, in order to avoid creating two auxiliary variables for the same sub-expr.
         \param[out] neweqs Equations to be added to the model to match the creation of auxiliary variables.
       */
-      virtual expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const = 0;
+      expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const;
+      expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const;
       //! Constructs a new expression where exogenous variables with a lag have been replaced by auxiliary variables
       /*!
         \param[in,out] subst_table Map used to store expressions that have already be substituted and their corresponding variable, in order to avoid creating two auxiliary variables for the same sub-expr.
         \param[out] neweqs Equations to be added to the model to match the creation of auxiliary variables.
       */
-      virtual expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const = 0;
+      expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const;
+      expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const;
 
       //! Constructs a new expression where the expectation operator has been replaced by auxiliary variables
       /*!
@@ -465,9 +645,11 @@ class ExprNode
         \param[out] neweqs Equations to be added to the model to match the creation of auxiliary variables.
         \param[in] partial_information_model Are we substituting in a partial information model?
       */
-      virtual expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const = 0;
+      expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const;
+      expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const;
 
-      virtual expr_t decreaseLeadsLagsPredeterminedVariables() const = 0;
+      expr_t decreaseLeadsLagsPredeterminedVariables() const;
+      expr_t decreaseLeadsLagsPredeterminedVariables(expr_memo_t &memo) const;
 
       //! Constructs a new expression where forward variables (supposed to be at most in t+1) have been replaced by themselves at t, plus a new aux var representing their (time) differentiate
       /*!
@@ -477,7 +659,8 @@ class ExprNode
         forward variable and the aux var that contains its differentiate
         \param[out] neweqs Equations to be added to the model to match the creation of auxiliary variables.
       */
-      virtual expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const = 0;
+      expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const;
+      expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const;
 
       //! Return true if the nodeID is a numerical constant equal to value and false otherwise
       /*!
@@ -503,7 +686,8 @@ class ExprNode
       virtual bool isVariableNodeEqualTo(SymbolType type_arg, int variable_id, int lag_arg) const = 0;
 
       //! Replaces the Trend var with datatree.One
-      virtual expr_t replaceTrendVar() const = 0;
+      expr_t replaceTrendVar() const;
+      expr_t replaceTrendVar(expr_memo_t &memo) const;
 
       //! Constructs a new expression where the variable indicated by symb_id has been detrended
       /*!
@@ -512,35 +696,49 @@ class ExprNode
         \param[in] trend indicating the trend
         \return the new binary op pointing to a detrended variable
       */
-      virtual expr_t detrend(int symb_id, bool log_trend, expr_t trend) const = 0;
+      expr_t detrend(int symb_id, bool log_trend, expr_t trend) const;
+      expr_t detrend(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const;
 
       //! Substitute adl operator
-      virtual expr_t substituteAdl() const = 0;
+      expr_t substituteAdl() const;
+      expr_t substituteAdl(expr_memo_t &memo) const;
 
       //! Substitute VarExpectation nodes
-      virtual expr_t substituteVarExpectation(const map<string, expr_t> &subst_table) const = 0;
+      expr_t substituteVarExpectation(const map<string, expr_t> &subst_table) const;
+      expr_t substituteVarExpectation(const map<string, expr_t> &subst_table, expr_memo_t &memo) const;
 
       //! Substitute diff operator
-      virtual void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const = 0;
-      virtual void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const = 0;
+      void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const;
+      void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const;
+      void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const;
+      void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const;
       virtual int findTrendVariable(int lhs_symb_id) const = 0;
-      virtual expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const = 0;
-      virtual expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const = 0;
+      expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const;
+      expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const;
+      expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const;
+      expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const;
 
       //! Substitute pac_expectation operator
-      virtual expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table) = 0;
+      expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table);
+      expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo);
 
       //! Add ExprNodes to the provided datatree
-      virtual expr_t cloneDynamic(DataTree &dynamic_datatree) const = 0;
+      expr_t cloneDynamic(DataTree &dynamic_datatree) const;
+
+      //! Add ExprNodes to the provided datatree, reusing (and filling) a memo table of already cloned nodes
+      /*! Shared subexpressions are therefore only cloned once, even across several calls using the same memo table */
+      expr_t cloneDynamic(DataTree &dynamic_datatree, expr_memo_t &memo) const;
 
       //! Move a trend variable with lag/lead to time t by dividing/multiplying by its growth factor
-      virtual expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const = 0;
+      expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const;
+      expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const;
 
       //! Returns true if the expression is in static form (no lead, no lag, no expectation, no STEADY_STATE)
       virtual bool isInStaticForm() const = 0;
 
       //! Substitute auxiliary variables by their expression in static model
-      virtual expr_t substituteStaticAuxiliaryVariable() const = 0;
+      expr_t substituteStaticAuxiliaryVariable() const;
+      expr_t substituteStaticAuxiliaryVariable(expr_memo_t &memo) const;
 
       //! Returns true if model_info_name is referenced by a VarExpectationNode
       virtual bool isVarModelReferenced(const string &model_info_name) const = 0;
@@ -611,49 +809,50 @@ public:
   void writeJsonOutput(ostream &output, const temporary_terms_t &temporary_terms, const deriv_node_temp_terms_t &tef_terms, const bool isdynamic) const override;
   bool containsExternalFunction() const override;
   void collectVARLHSVariable(set<expr_t> &result) const override;
-  void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const override;
+  void collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const override;
   void collectTemporary_terms(const temporary_terms_t &temporary_terms, temporary_terms_inuse_t &temporary_terms_inuse, int Curr_Block) const override;
   double eval(const eval_context_t &eval_context) const noexcept(false) override;
+  int addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const override;
   void compile(ostream &CompileCode, unsigned int &instruction_number, bool lhs_rhs, const temporary_terms_t &temporary_terms, const map_idx_t &map_idx, bool dynamic, bool steady_dynamic, const deriv_node_temp_terms_t &tef_terms) const override;
-  expr_t toStatic(DataTree &static_datatree) const override;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override;
   void computeXrefs(EquationInfo &ei) const override;
   pair<int, expr_t> normalizeEquation(int symb_id_endo, vector<pair<int, pair<expr_t, expr_t>>>  &List_of_Op_RHS) const override;
   expr_t getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recursive_variables) override;
-  int maxEndoLead() const override;
-  int maxExoLead() const override;
-  int maxEndoLag() const override;
-  int maxExoLag() const override;
-  int maxLead() const override;
-  int maxLag() const override;
+  int maxEndoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxExoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxEndoLagInternal(memo_table_t<int> &memo) const override;
+  int maxExoLagInternal(memo_table_t<int> &memo) const override;
+  int maxLeadInternal(memo_table_t<int> &memo) const override;
+  int maxLagInternal(memo_table_t<int> &memo) const override;
   int VarMinLag() const override;
   int VarMaxLag(DataTree &static_datatree, set<expr_t> &static_lhs) const override;
   int PacMaxLag(int lhs_symb_id) const override;
-  expr_t undiff() const override;
-  expr_t decreaseLeadsLags(int n) const override;
-  expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const override;
-  expr_t substituteAdl() const override;
-  expr_t substituteVarExpectation(const map<string, expr_t> &subst_table) const override;
-  void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const override;
-  void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const override;
+  expr_t undiffInternal(expr_memo_t &memo) const override;
+  expr_t decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const override;
+  expr_t substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const override;
+  expr_t substituteAdlInternal(expr_memo_t &memo) const override;
+  expr_t substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const override;
+  void findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const override;
+  void findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const override;
   int findTrendVariable(int lhs_symb_id) const override;
-  expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table) override;
-  expr_t decreaseLeadsLagsPredeterminedVariables() const override;
-  expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
+  expr_t substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo) override;
+  expr_t decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const override;
+  expr_t differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
   bool isNumConstNodeEqualTo(double value) const override;
   bool containsEndogenous() const override;
   bool containsExogenous() const override;
   int countDiffs() const override;
   bool isVariableNodeEqualTo(SymbolType type_arg, int variable_id, int lag_arg) const override;
-  expr_t replaceTrendVar() const override;
-  expr_t detrend(int symb_id, bool log_trend, expr_t trend) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override;
-  expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const override;
+  expr_t replaceTrendVarInternal(expr_memo_t &memo) const override;
+  expr_t detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override;
+  expr_t removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const override;
   bool isInStaticForm() const override;
   void addParamInfoToPac(pair<int, int> &lhs_arg, int optim_share_arg, pair<int, pair<vector<int>, vector<bool>>> &ec_params_and_vars_arg, set<pair<int, pair<int, int>>> &params_and_vars_arg, set<pair<int, pair<pair<int, int>, double>>> &params_vars_and_scaling_factor_arg) override;
   void fillPacExpectationVarInfo(string &model_name_arg, vector<int> &lhs_arg, int max_lag_arg, int pac_max_lag_arg, vector<bool> &nonstationary_arg, int growth_symb_id_arg, int equation_number_arg) override;
@@ -669,7 +868,7 @@ public:
   bool isParamTimesEndogExpr() const override;
   bool isVarModelReferenced(const string &model_info_name) const override;
   void getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const override;
-  expr_t substituteStaticAuxiliaryVariable() const override;
+  expr_t substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const override;
 };
 
 //! Symbol or variable node
@@ -682,6 +881,8 @@ private:
   const SymbolType type;
   //! A positive value is a lead, a negative is a lag
   const int lag;
+  //! Used for caching the derivatives computed by getChainRuleDerivative() through recursive variables
+  map<int, expr_t> chain_rule_derivatives;
   expr_t computeDerivative(int deriv_id) override;
 public:
   VariableNode(DataTree &datatree_arg, int idx_arg, int symb_id_arg, int lag_arg);
@@ -690,7 +891,7 @@ public:
   void writeJsonOutput(ostream &output, const temporary_terms_t &temporary_terms, const deriv_node_temp_terms_t &tef_terms, const bool isdynamic) const override;
   bool containsExternalFunction() const override;
   void collectVARLHSVariable(set<expr_t> &result) const override;
-  void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const override;
+  void collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const override;
   void computeTemporaryTerms(map<expr_t, int > &reference_count,
                                      temporary_terms_t &temporary_terms,
                                      map<expr_t, pair<int, int>> &first_occurence,
@@ -699,8 +900,9 @@ public:
                                      int equation) const override;
   void collectTemporary_terms(const temporary_terms_t &temporary_terms, temporary_terms_inuse_t &temporary_terms_inuse, int Curr_Block) const override;
   double eval(const eval_context_t &eval_context) const noexcept(false) override;
+  int addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const override;
   void compile(ostream &CompileCode, unsigned int &instruction_number, bool lhs_rhs, const temporary_terms_t &temporary_terms, const map_idx_t &map_idx, bool dynamic, bool steady_dynamic, const deriv_node_temp_terms_t &tef_terms) const override;
-  expr_t toStatic(DataTree &static_datatree) const override;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override;
   void computeXrefs(EquationInfo &ei) const override;
   SymbolType
   get_type() const
@@ -719,41 +921,41 @@ public:
   };
   pair<int, expr_t> normalizeEquation(int symb_id_endo, vector<pair<int, pair<expr_t, expr_t>>>  &List_of_Op_RHS) const override;
   expr_t getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recursive_variables) override;
-  int maxEndoLead() const override;
-  int maxExoLead() const override;
-  int maxEndoLag() const override;
-  int maxExoLag() const override;
-  int maxLead() const override;
-  int maxLag() const override;
+  int maxEndoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxExoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxEndoLagInternal(memo_table_t<int> &memo) const override;
+  int maxExoLagInternal(memo_table_t<int> &memo) const override;
+  int maxLeadInternal(memo_table_t<int> &memo) const override;
+  int maxLagInternal(memo_table_t<int> &memo) const override;
   int VarMinLag() const override;
   int VarMaxLag(DataTree &static_datatree, set<expr_t> &static_lhs) const override;
   int PacMaxLag(int lhs_symb_id) const override;
-  expr_t undiff() const override;
-  expr_t decreaseLeadsLags(int n) const override;
-  expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const override;
-  expr_t substituteAdl() const override;
-  expr_t substituteVarExpectation(const map<string, expr_t> &subst_table) const override;
-  void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const override;
-  void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const override;
+  expr_t undiffInternal(expr_memo_t &memo) const override;
+  expr_t decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const override;
+  expr_t substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const override;
+  expr_t substituteAdlInternal(expr_memo_t &memo) const override;
+  expr_t substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const override;
+  void findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const override;
+  void findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const override;
   int findTrendVariable(int lhs_symb_id) const override;
-  expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table) override;
-  expr_t decreaseLeadsLagsPredeterminedVariables() const override;
-  expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
+  expr_t substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo) override;
+  expr_t decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const override;
+  expr_t differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
   bool isNumConstNodeEqualTo(double value) const override;
   bool containsEndogenous() const override;
   bool containsExogenous() const override;
   int countDiffs() const override;
   bool isVariableNodeEqualTo(SymbolType type_arg, int variable_id, int lag_arg) const override;
-  expr_t replaceTrendVar() const override;
-  expr_t detrend(int symb_id, bool log_trend, expr_t trend) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override;
-  expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const override;
+  expr_t replaceTrendVarInternal(expr_memo_t &memo) const override;
+  expr_t detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override;
+  expr_t removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const override;
   bool isInStaticForm() const override;
   void addParamInfoToPac(pair<int, int> &lhs_arg, int optim_share_arg, pair<int, pair<vector<int>, vector<bool>>> &ec_params_and_vars_arg, set<pair<int, pair<int, int>>> &params_and_vars_arg, set<pair<int, pair<pair<int, int>, double>>> &params_vars_and_scaling_factor_arg) override;
   void fillPacExpectationVarInfo(string &model_name_arg, vector<int> &lhs_arg, int max_lag_arg, int pac_max_lag_arg, vector<bool> &nonstationary_arg, int growth_symb_id_arg, int equation_number_arg) override;
@@ -770,12 +972,13 @@ public:
   bool isVarModelReferenced(const string &model_info_name) const override;
   void getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const override;
   //! Substitute auxiliary variables by their expression in static model
-  expr_t substituteStaticAuxiliaryVariable() const override;
+  expr_t substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const override;
 };
 
 //! Unary operator node
 class UnaryOpNode : public ExprNode
 {
+  friend class DataTree;
 private:
   const expr_t arg;
   //! Stores the information set. Only used for expectation operator
@@ -793,6 +996,8 @@ private:
   expr_t composeDerivatives(expr_t darg, int deriv_id);
 public:
   UnaryOpNode(DataTree &datatree_arg, int idx_arg, UnaryOpcode op_code_arg, const expr_t arg_arg, int expectation_information_set_arg, int param1_symb_id_arg, int param2_symb_id_arg, string adl_param_name_arg, vector<int> adl_lags_arg);
+  //! Computes the structural hash of a node with the given arguments
+  static size_t computeStructuralHash(UnaryOpcode op_code, const expr_t arg, int expectation_information_set, int param1_symb_id, int param2_symb_id, const string &adl_param_name, const vector<int> &adl_lags);
   void prepareForDerivation() override;
   void computeTemporaryTerms(map<expr_t, pair<int, NodeTreeReference>> &reference_count,
                                      map<NodeTreeReference, temporary_terms_t> &temp_terms_map,
@@ -819,10 +1024,11 @@ public:
                                      vector< vector<temporary_terms_t>> &v_temporary_terms,
                                      int equation) const override;
   void collectVARLHSVariable(set<expr_t> &result) const override;
-  void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const override;
+  void collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const override;
   void collectTemporary_terms(const temporary_terms_t &temporary_terms, temporary_terms_inuse_t &temporary_terms_inuse, int Curr_Block) const override;
   static double eval_opcode(UnaryOpcode op_code, double v) noexcept(false);
   double eval(const eval_context_t &eval_context) const noexcept(false) override;
+  int addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const override;
   void compile(ostream &CompileCode, unsigned int &instruction_number, bool lhs_rhs, const temporary_terms_t &temporary_terms, const map_idx_t &map_idx, bool dynamic, bool steady_dynamic, const deriv_node_temp_terms_t &tef_terms) const override;
   //! Returns operand
   expr_t
@@ -836,48 +1042,48 @@ public:
   {
     return (op_code);
   };
-  expr_t toStatic(DataTree &static_datatree) const override;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override;
   void computeXrefs(EquationInfo &ei) const override;
   pair<int, expr_t> normalizeEquation(int symb_id_endo, vector<pair<int, pair<expr_t, expr_t>>>  &List_of_Op_RHS) const override;
   expr_t getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recursive_variables) override;
-  int maxEndoLead() const override;
-  int maxExoLead() const override;
-  int maxEndoLag() const override;
-  int maxExoLag() const override;
-  int maxLead() const override;
-  int maxLag() const override;
+  int maxEndoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxExoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxEndoLagInternal(memo_table_t<int> &memo) const override;
+  int maxExoLagInternal(memo_table_t<int> &memo) const override;
+  int maxLeadInternal(memo_table_t<int> &memo) const override;
+  int maxLagInternal(memo_table_t<int> &memo) const override;
   int VarMinLag() const override;
   int VarMaxLag(DataTree &static_datatree, set<expr_t> &static_lhs) const override;
   int PacMaxLag(int lhs_symb_id) const override;
-  expr_t undiff() const override;
-  expr_t decreaseLeadsLags(int n) const override;
-  expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
+  expr_t undiffInternal(expr_memo_t &memo) const override;
+  expr_t decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const override;
+  expr_t substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
   //! Creates another UnaryOpNode with the same opcode, but with a possibly different datatree and argument
   expr_t buildSimilarUnaryOpNode(expr_t alt_arg, DataTree &alt_datatree) const;
-  expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const override;
-  expr_t substituteAdl() const override;
-  expr_t substituteVarExpectation(const map<string, expr_t> &subst_table) const override;
-  void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const override;
+  expr_t substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const override;
+  expr_t substituteAdlInternal(expr_memo_t &memo) const override;
+  expr_t substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const override;
+  void findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const override;
   bool createAuxVarForUnaryOpNode() const;
-  void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const override;
+  void findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const override;
   int findTrendVariable(int lhs_symb_id) const override;
-  expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table) override;
-  expr_t decreaseLeadsLagsPredeterminedVariables() const override;
-  expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
+  expr_t substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo) override;
+  expr_t decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const override;
+  expr_t differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
   bool isNumConstNodeEqualTo(double value) const override;
   bool containsEndogenous() const override;
   bool containsExogenous() const override;
   int countDiffs() const override;
   bool isVariableNodeEqualTo(SymbolType type_arg, int variable_id, int lag_arg) const override;
-  expr_t replaceTrendVar() const override;
-  expr_t detrend(int symb_id, bool log_trend, expr_t trend) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override;
-  expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const override;
+  expr_t replaceTrendVarInternal(expr_memo_t &memo) const override;
+  expr_t detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override;
+  expr_t removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const override;
   bool isInStaticForm() const override;
   void addParamInfoToPac(pair<int, int> &lhs_arg, int optim_share_arg, pair<int, pair<vector<int>, vector<bool>>> &ec_params_and_vars_arg, set<pair<int, pair<int, int>>> &params_and_vars_arg, set<pair<int, pair<pair<int, int>, double>>> &params_vars_and_scaling_factor_arg) override;
   void fillPacExpectationVarInfo(string &model_name_arg, vector<int> &lhs_arg, int max_lag_arg, int pac_max_lag_arg, vector<bool> &nonstationary_arg, int growth_symb_id_arg, int equation_number_arg) override;
@@ -894,7 +1100,7 @@ public:
   bool isVarModelReferenced(const string &model_info_name) const override;
   void getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const override;
   //! Substitute auxiliary variables by their expression in static model
-  expr_t substituteStaticAuxiliaryVariable() const override;
+  expr_t substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const override;
 };
 
 //! Binary operator node
@@ -914,6 +1120,8 @@ private:
 public:
   BinaryOpNode(DataTree &datatree_arg, int idx_arg, const expr_t arg1_arg,
                BinaryOpcode op_code_arg, const expr_t arg2_arg, int powerDerivOrder);
+  //! Computes the structural hash of a node with the given arguments
+  static size_t computeStructuralHash(const expr_t arg1, BinaryOpcode op_code, const expr_t arg2, int powerDerivOrder);
   void prepareForDerivation() override;
   int precedenceJson(const temporary_terms_t &temporary_terms) const override;
   int precedence(ExprNodeOutputType output_type, const temporary_terms_t &temporary_terms) const override;
@@ -942,10 +1150,11 @@ public:
                                      vector< vector<temporary_terms_t>> &v_temporary_terms,
                                      int equation) const override;
   void collectVARLHSVariable(set<expr_t> &result) const override;
-  void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const override;
+  void collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const override;
   void collectTemporary_terms(const temporary_terms_t &temporary_terms, temporary_terms_inuse_t &temporary_terms_inuse, int Curr_Block) const override;
   static double eval_opcode(double v1, BinaryOpcode op_code, double v2, int derivOrder) noexcept(false);
   double eval(const eval_context_t &eval_context) const noexcept(false) override;
+  int addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const override;
   void compile(ostream &CompileCode, unsigned int &instruction_number, bool lhs_rhs, const temporary_terms_t &temporary_terms, const map_idx_t &map_idx, bool dynamic, bool steady_dynamic, const deriv_node_temp_terms_t &tef_terms) const override;
   virtual expr_t Compute_RHS(expr_t arg1, expr_t arg2, int op, int op_type) const;
   //! Returns first operand
@@ -981,49 +1190,49 @@ public:
                                   pair<int, pair<vector<int>, vector<bool>>> &ec_params_and_vars,
                                   set<pair<int, pair<int, int>>> &ar_params_and_vars) const;
   void getPacLHS(pair<int, int> &lhs);
-  expr_t toStatic(DataTree &static_datatree) const override;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override;
   void computeXrefs(EquationInfo &ei) const override;
   pair<int, expr_t> normalizeEquation(int symb_id_endo, vector<pair<int, pair<expr_t, expr_t>>>  &List_of_Op_RHS) const override;
   expr_t getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recursive_variables) override;
-  int maxEndoLead() const override;
-  int maxExoLead() const override;
-  int maxEndoLag() const override;
-  int maxExoLag() const override;
-  int maxLead() const override;
-  int maxLag() const override;
+  int maxEndoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxExoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxEndoLagInternal(memo_table_t<int> &memo) const override;
+  int maxExoLagInternal(memo_table_t<int> &memo) const override;
+  int maxLeadInternal(memo_table_t<int> &memo) const override;
+  int maxLagInternal(memo_table_t<int> &memo) const override;
   int VarMinLag() const override;
   int VarMaxLag(DataTree &static_datatree, set<expr_t> &static_lhs) const override;
   int PacMaxLag(int lhs_symb_id) const override;
-  expr_t undiff() const override;
-  expr_t decreaseLeadsLags(int n) const override;
-  expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
+  expr_t undiffInternal(expr_memo_t &memo) const override;
+  expr_t decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const override;
+  expr_t substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
   //! Creates another BinaryOpNode with the same opcode, but with a possibly different datatree and arguments
   expr_t buildSimilarBinaryOpNode(expr_t alt_arg1, expr_t alt_arg2, DataTree &alt_datatree) const;
-  expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const override;
-  expr_t substituteAdl() const override;
-  expr_t substituteVarExpectation(const map<string, expr_t> &subst_table) const override;
-  void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const override;
-  void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const override;
+  expr_t substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const override;
+  expr_t substituteAdlInternal(expr_memo_t &memo) const override;
+  expr_t substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const override;
+  void findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const override;
+  void findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const override;
   bool findTrendVariableHelper1(int lhs_symb_id, int rhs_symb_id) const;
   int findTrendVariableHelper(const expr_t arg1, const expr_t arg2, int lhs_symb_id) const;
   int findTrendVariable(int lhs_symb_id) const override;
-  expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table) override;
-  expr_t decreaseLeadsLagsPredeterminedVariables() const override;
-  expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
+  expr_t substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo) override;
+  expr_t decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const override;
+  expr_t differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
   bool isNumConstNodeEqualTo(double value) const override;
   bool containsEndogenous() const override;
   bool containsExogenous() const override;
   int countDiffs() const override;
   bool isVariableNodeEqualTo(SymbolType type_arg, int variable_id, int lag_arg) const override;
-  expr_t replaceTrendVar() const override;
-  expr_t detrend(int symb_id, bool log_trend, expr_t trend) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override;
-  expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const override;
+  expr_t replaceTrendVarInternal(expr_memo_t &memo) const override;
+  expr_t detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override;
+  expr_t removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const override;
   //! Function to write out the oPowerNode in expr_t terms as opposed to writing out the function itself
   expr_t unpackPowerDeriv() const;
   //! Returns MULT_i*(lhs-rhs) = 0, creating multiplier MULT_i
@@ -1046,7 +1255,7 @@ public:
   bool isVarModelReferenced(const string &model_info_name) const override;
   void getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const override;
   //! Substitute auxiliary variables by their expression in static model
-  expr_t substituteStaticAuxiliaryVariable() const override;
+  expr_t substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const override;
   //! Substitute auxiliary variables by their expression in static model auxiliary variable definition
   virtual expr_t substituteStaticAuxiliaryDefinition() const;
 };
@@ -1055,6 +1264,7 @@ public:
 class TrinaryOpNode : public ExprNode
 {
   friend class ModelTree;
+  friend class DataTree;
 private:
   const expr_t arg1, arg2, arg3;
   const TrinaryOpcode op_code;
@@ -1067,6 +1277,8 @@ private:
 public:
   TrinaryOpNode(DataTree &datatree_arg, int idx_arg, const expr_t arg1_arg,
                 TrinaryOpcode op_code_arg, const expr_t arg2_arg, const expr_t arg3_arg);
+  //! Computes the structural hash of a node with the given arguments
+  static size_t computeStructuralHash(const expr_t arg1, TrinaryOpcode op_code, const expr_t arg2, const expr_t arg3);
   void prepareForDerivation() override;
   int precedence(ExprNodeOutputType output_type, const temporary_terms_t &temporary_terms) const override;
   void computeTemporaryTerms(map<expr_t, pair<int, NodeTreeReference>> &reference_count,
@@ -1094,52 +1306,53 @@ public:
                                      vector< vector<temporary_terms_t>> &v_temporary_terms,
                                      int equation) const override;
   void collectVARLHSVariable(set<expr_t> &result) const override;
-  void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const override;
+  void collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const override;
   void collectTemporary_terms(const temporary_terms_t &temporary_terms, temporary_terms_inuse_t &temporary_terms_inuse, int Curr_Block) const override;
   static double eval_opcode(double v1, TrinaryOpcode op_code, double v2, double v3) noexcept(false);
   double eval(const eval_context_t &eval_context) const noexcept(false) override;
+  int addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const override;
   void compile(ostream &CompileCode, unsigned int &instruction_number, bool lhs_rhs, const temporary_terms_t &temporary_terms, const map_idx_t &map_idx, bool dynamic, bool steady_dynamic, const deriv_node_temp_terms_t &tef_terms) const override;
-  expr_t toStatic(DataTree &static_datatree) const override;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override;
   void computeXrefs(EquationInfo &ei) const override;
   pair<int, expr_t> normalizeEquation(int symb_id_endo, vector<pair<int, pair<expr_t, expr_t>>>  &List_of_Op_RHS) const override;
   expr_t getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recursive_variables) override;
-  int maxEndoLead() const override;
-  int maxExoLead() const override;
-  int maxEndoLag() const override;
-  int maxExoLag() const override;
-  int maxLead() const override;
-  int maxLag() const override;
+  int maxEndoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxExoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxEndoLagInternal(memo_table_t<int> &memo) const override;
+  int maxExoLagInternal(memo_table_t<int> &memo) const override;
+  int maxLeadInternal(memo_table_t<int> &memo) const override;
+  int maxLagInternal(memo_table_t<int> &memo) const override;
   int VarMinLag() const override;
   int VarMaxLag(DataTree &static_datatree, set<expr_t> &static_lhs) const override;
   int PacMaxLag(int lhs_symb_id) const override;
-  expr_t undiff() const override;
-  expr_t decreaseLeadsLags(int n) const override;
-  expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
+  expr_t undiffInternal(expr_memo_t &memo) const override;
+  expr_t decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const override;
+  expr_t substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
   //! Creates another TrinaryOpNode with the same opcode, but with a possibly different datatree and arguments
   expr_t buildSimilarTrinaryOpNode(expr_t alt_arg1, expr_t alt_arg2, expr_t alt_arg3, DataTree &alt_datatree) const;
-  expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const override;
-  expr_t substituteAdl() const override;
-  expr_t substituteVarExpectation(const map<string, expr_t> &subst_table) const override;
-  void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const override;
-  void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const override;
+  expr_t substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const override;
+  expr_t substituteAdlInternal(expr_memo_t &memo) const override;
+  expr_t substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const override;
+  void findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const override;
+  void findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const override;
   int findTrendVariable(int lhs_symb_id) const override;
-  expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table) override;
-  expr_t decreaseLeadsLagsPredeterminedVariables() const override;
-  expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
+  expr_t substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo) override;
+  expr_t decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const override;
+  expr_t differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
   bool isNumConstNodeEqualTo(double value) const override;
   bool containsEndogenous() const override;
   bool containsExogenous() const override;
   int countDiffs() const override;
   bool isVariableNodeEqualTo(SymbolType type_arg, int variable_id, int lag_arg) const override;
-  expr_t replaceTrendVar() const override;
-  expr_t detrend(int symb_id, bool log_trend, expr_t trend) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override;
-  expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const override;
+  expr_t replaceTrendVarInternal(expr_memo_t &memo) const override;
+  expr_t detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override;
+  expr_t removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const override;
   bool isInStaticForm() const override;
   void addParamInfoToPac(pair<int, int> &lhs_arg, int optim_share_arg, pair<int, pair<vector<int>, vector<bool>>> &ec_params_and_vars_arg, set<pair<int, pair<int, int>>> &params_and_vars_arg, set<pair<int, pair<pair<int, int>, double>>> &params_vars_and_scaling_factor_arg) override;
   void fillPacExpectationVarInfo(string &model_name_arg, vector<int> &lhs_arg, int max_lag_arg, int pac_max_lag_arg, vector<bool> &nonstationary_arg, int growth_symb_id_arg, int equation_number_arg) override;
@@ -1156,7 +1369,7 @@ public:
   bool isVarModelReferenced(const string &model_info_name) const override;
   void getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const override;
   //! Substitute auxiliary variables by their expression in static model
-  expr_t substituteStaticAuxiliaryVariable() const override;
+  expr_t substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const override;
 };
 
 //! External function node
@@ -1212,56 +1425,57 @@ public:
                                      vector< vector<temporary_terms_t>> &v_temporary_terms,
                                      int equation) const override = 0;
   void collectVARLHSVariable(set<expr_t> &result) const override;
-  void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const override;
+  void collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const override;
   void collectTemporary_terms(const temporary_terms_t &temporary_terms, temporary_terms_inuse_t &temporary_terms_inuse, int Curr_Block) const override;
   double eval(const eval_context_t &eval_context) const noexcept(false) override;
+  int addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const override;
   unsigned int compileExternalFunctionArguments(ostream &CompileCode, unsigned int &instruction_number,
                                                 bool lhs_rhs, const temporary_terms_t &temporary_terms,
                                                 const map_idx_t &map_idx, bool dynamic, bool steady_dynamic,
                                                 const deriv_node_temp_terms_t &tef_terms) const;
 
   void compile(ostream &CompileCode, unsigned int &instruction_number, bool lhs_rhs, const temporary_terms_t &temporary_terms, const map_idx_t &map_idx, bool dynamic, bool steady_dynamic, const deriv_node_temp_terms_t &tef_terms) const override = 0;
-  expr_t toStatic(DataTree &static_datatree) const override = 0;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override = 0;
   void computeXrefs(EquationInfo &ei) const override = 0;
   pair<int, expr_t> normalizeEquation(int symb_id_endo, vector<pair<int, pair<expr_t, expr_t>>>  &List_of_Op_RHS) const override;
   expr_t getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recursive_variables) override;
-  int maxEndoLead() const override;
-  int maxExoLead() const override;
-  int maxEndoLag() const override;
-  int maxExoLag() const override;
-  int maxLead() const override;
-  int maxLag() const override;
+  int maxEndoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxExoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxEndoLagInternal(memo_table_t<int> &memo) const override;
+  int maxExoLagInternal(memo_table_t<int> &memo) const override;
+  int maxLeadInternal(memo_table_t<int> &memo) const override;
+  int maxLagInternal(memo_table_t<int> &memo) const override;
   int VarMinLag() const override;
   int VarMaxLag(DataTree &static_datatree, set<expr_t> &static_lhs) const override;
   int PacMaxLag(int lhs_symb_id) const override;
-  expr_t undiff() const override;
-  expr_t decreaseLeadsLags(int n) const override;
-  expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const override;
-  expr_t substituteAdl() const override;
-  expr_t substituteVarExpectation(const map<string, expr_t> &subst_table) const override;
-  void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const override;
-  void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const override;
+  expr_t undiffInternal(expr_memo_t &memo) const override;
+  expr_t decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const override;
+  expr_t substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const override;
+  expr_t substituteAdlInternal(expr_memo_t &memo) const override;
+  expr_t substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const override;
+  void findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const override;
+  void findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const override;
   int findTrendVariable(int lhs_symb_id) const override;
-  expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table) override;
+  expr_t substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo) override;
   virtual expr_t buildSimilarExternalFunctionNode(vector<expr_t> &alt_args, DataTree &alt_datatree) const = 0;
-  expr_t decreaseLeadsLagsPredeterminedVariables() const override;
-  expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
+  expr_t decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const override;
+  expr_t differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
   bool isNumConstNodeEqualTo(double value) const override;
   bool containsEndogenous() const override;
   bool containsExogenous() const override;
   int countDiffs() const override;
   bool isVariableNodeEqualTo(SymbolType type_arg, int variable_id, int lag_arg) const override;
   virtual void writePrhs(ostream &output, ExprNodeOutputType output_type, const temporary_terms_t &temporary_terms, const temporary_terms_idxs_t &temporary_terms_idxs, const deriv_node_temp_terms_t &tef_terms, const string &ending) const;
-  expr_t replaceTrendVar() const override;
-  expr_t detrend(int symb_id, bool log_trend, expr_t trend) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override = 0;
-  expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const override;
+  expr_t replaceTrendVarInternal(expr_memo_t &memo) const override;
+  expr_t detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override = 0;
+  expr_t removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const override;
   bool isInStaticForm() const override;
   void addParamInfoToPac(pair<int, int> &lhs_arg, int optim_share_arg, pair<int, pair<vector<int>, vector<bool>>> &ec_params_and_vars_arg, set<pair<int, pair<int, int>>> &params_and_vars_arg, set<pair<int, pair<pair<int, int>, double>>> &params_vars_and_scaling_factor_arg) override;
   void fillPacExpectationVarInfo(string &model_name_arg, vector<int> &lhs_arg, int max_lag_arg, int pac_max_lag_arg, vector<bool> &nonstationary_arg, int growth_symb_id_arg, int equation_number_arg) override;
@@ -1278,7 +1492,7 @@ public:
   bool isVarModelReferenced(const string &model_info_name) const override;
   void getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const override;
   //! Substitute auxiliary variables by their expression in static model
-  expr_t substituteStaticAuxiliaryVariable() const override;
+  expr_t substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const override;
 };
 
 class ExternalFunctionNode : public AbstractExternalFunctionNode
@@ -1313,10 +1527,10 @@ public:
                                      vector< vector<temporary_terms_t>> &v_temporary_terms,
                                      int equation) const override;
   void compile(ostream &CompileCode, unsigned int &instruction_number, bool lhs_rhs, const temporary_terms_t &temporary_terms, const map_idx_t &map_idx, bool dynamic, bool steady_dynamic, const deriv_node_temp_terms_t &tef_terms) const override;
-  expr_t toStatic(DataTree &static_datatree) const override;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override;
   void computeXrefs(EquationInfo &ei) const override;
   expr_t buildSimilarExternalFunctionNode(vector<expr_t> &alt_args, DataTree &alt_datatree) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override;
 };
 
 class FirstDerivExternalFunctionNode : public AbstractExternalFunctionNode
@@ -1355,10 +1569,10 @@ public:
                                              bool lhs_rhs, const temporary_terms_t &temporary_terms,
                                              const map_idx_t &map_idx, bool dynamic, bool steady_dynamic,
                                              deriv_node_temp_terms_t &tef_terms) const override;
-  expr_t toStatic(DataTree &static_datatree) const override;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override;
   void computeXrefs(EquationInfo &ei) const override;
   expr_t buildSimilarExternalFunctionNode(vector<expr_t> &alt_args, DataTree &alt_datatree) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override;
 };
 
 class SecondDerivExternalFunctionNode : public AbstractExternalFunctionNode
@@ -1399,10 +1613,10 @@ public:
                                              bool lhs_rhs, const temporary_terms_t &temporary_terms,
                                              const map_idx_t &map_idx, bool dynamic, bool steady_dynamic,
                                              deriv_node_temp_terms_t &tef_terms) const override;
-  expr_t toStatic(DataTree &static_datatree) const override;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override;
   void computeXrefs(EquationInfo &ei) const override;
   expr_t buildSimilarExternalFunctionNode(vector<expr_t> &alt_args, DataTree &alt_datatree) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override;
 };
 
 class VarExpectationNode : public ExprNode
@@ -1421,38 +1635,39 @@ public:
                                      int Curr_block,
                                      vector< vector<temporary_terms_t>> &v_temporary_terms,
                                      int equation) const override;
-  expr_t toStatic(DataTree &static_datatree) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override;
-  int maxEndoLead() const override;
-  int maxExoLead() const override;
-  int maxEndoLag() const override;
-  int maxExoLag() const override;
-  int maxLead() const override;
-  int maxLag() const override;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override;
+  int maxEndoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxExoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxEndoLagInternal(memo_table_t<int> &memo) const override;
+  int maxExoLagInternal(memo_table_t<int> &memo) const override;
+  int maxLeadInternal(memo_table_t<int> &memo) const override;
+  int maxLagInternal(memo_table_t<int> &memo) const override;
   int VarMinLag() const override;
   int VarMaxLag(DataTree &static_datatree, set<expr_t> &static_lhs) const override;
   int PacMaxLag(int lhs_symb_id) const override;
-  expr_t undiff() const override;
-  expr_t decreaseLeadsLags(int n) const override;
+  expr_t undiffInternal(expr_memo_t &memo) const override;
+  expr_t decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const override;
   void prepareForDerivation() override;
   expr_t computeDerivative(int deriv_id) override;
   expr_t getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recursive_variables) override;
   bool containsExternalFunction() const override;
   double eval(const eval_context_t &eval_context) const noexcept(false) override;
+  int addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const override;
   void computeXrefs(EquationInfo &ei) const override;
-  expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const override;
-  expr_t substituteAdl() const override;
-  expr_t substituteVarExpectation(const map<string, expr_t> &subst_table) const override;
-  void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const override;
-  void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const override;
+  expr_t substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const override;
+  expr_t substituteAdlInternal(expr_memo_t &memo) const override;
+  expr_t substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const override;
+  void findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const override;
+  void findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const override;
   int findTrendVariable(int lhs_symb_id) const override;
-  expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table) override;
+  expr_t substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo) override;
   pair<int, expr_t> normalizeEquation(int symb_id_endo, vector<pair<int, pair<expr_t, expr_t>>>  &List_of_Op_RHS) const override;
   void compile(ostream &CompileCode, unsigned int &instruction_number,
                        bool lhs_rhs, const temporary_terms_t &temporary_terms,
@@ -1460,17 +1675,17 @@ public:
                        const deriv_node_temp_terms_t &tef_terms) const override;
   void collectTemporary_terms(const temporary_terms_t &temporary_terms, temporary_terms_inuse_t &temporary_terms_inuse, int Curr_Block) const override;
   void collectVARLHSVariable(set<expr_t> &result) const override;
-  void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const override;
+  void collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const override;
   bool containsEndogenous() const override;
   bool containsExogenous() const override;
   int countDiffs() const override;
   bool isNumConstNodeEqualTo(double value) const override;
-  expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t decreaseLeadsLagsPredeterminedVariables() const override;
+  expr_t differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const override;
   bool isVariableNodeEqualTo(SymbolType type_arg, int variable_id, int lag_arg) const override;
-  expr_t replaceTrendVar() const override;
-  expr_t detrend(int symb_id, bool log_trend, expr_t trend) const override;
-  expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const override;
+  expr_t replaceTrendVarInternal(expr_memo_t &memo) const override;
+  expr_t detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const override;
+  expr_t removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const override;
   bool isInStaticForm() const override;
   void addParamInfoToPac(pair<int, int> &lhs_arg, int optim_share_arg, pair<int, pair<vector<int>, vector<bool>>> &ec_params_and_vars_arg, set<pair<int, pair<int, int>>> &params_and_vars_arg, set<pair<int, pair<pair<int, int>, double>>> &params_vars_and_scaling_factor_arg) override;
   void fillPacExpectationVarInfo(string &model_name_arg, vector<int> &lhs_arg, int max_lag_arg, int pac_max_lag_arg, vector<bool> &nonstationary_arg, int growth_symb_id_arg, int equation_number_arg) override;
@@ -1486,7 +1701,7 @@ public:
   bool isParamTimesEndogExpr() const override;
   bool isVarModelReferenced(const string &model_info_name) const override;
   void getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const override;
-  expr_t substituteStaticAuxiliaryVariable() const override;
+  expr_t substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const override;
   void writeJsonOutput(ostream &output, const temporary_terms_t &temporary_terms, const deriv_node_temp_terms_t &tef_terms, const bool isdynamic) const override;
 };
 
@@ -1518,38 +1733,39 @@ public:
                                      int Curr_block,
                                      vector< vector<temporary_terms_t>> &v_temporary_terms,
                                      int equation) const override;
-  expr_t toStatic(DataTree &static_datatree) const override;
-  expr_t cloneDynamic(DataTree &dynamic_datatree) const override;
-  int maxEndoLead() const override;
-  int maxExoLead() const override;
-  int maxEndoLag() const override;
-  int maxExoLag() const override;
-  int maxLead() const override;
-  int maxLag() const override;
+  expr_t toStaticInternal(DataTree &static_datatree, expr_memo_t &memo) const override;
+  expr_t cloneDynamicInternal(DataTree &dynamic_datatree, expr_memo_t &memo) const override;
+  int maxEndoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxExoLeadInternal(memo_table_t<int> &memo) const override;
+  int maxEndoLagInternal(memo_table_t<int> &memo) const override;
+  int maxExoLagInternal(memo_table_t<int> &memo) const override;
+  int maxLeadInternal(memo_table_t<int> &memo) const override;
+  int maxLagInternal(memo_table_t<int> &memo) const override;
   int VarMinLag() const override;
   int VarMaxLag(DataTree &static_datatree, set<expr_t> &static_lhs) const override;
   int PacMaxLag(int lhs_symb_id) const override;
-  expr_t undiff() const override;
-  expr_t decreaseLeadsLags(int n) const override;
+  expr_t undiffInternal(expr_memo_t &memo) const override;
+  expr_t decreaseLeadsLagsInternal(int n, expr_memo_t &memo) const override;
   void prepareForDerivation() override;
   expr_t computeDerivative(int deriv_id) override;
   expr_t getChainRuleDerivative(int deriv_id, const map<int, expr_t> &recursive_variables) override;
   bool containsExternalFunction() const override;
   double eval(const eval_context_t &eval_context) const noexcept(false) override;
+  int addToTapeInternal(EvalTape &tape, memo_table_t<int> &memo) const override;
   void computeXrefs(EquationInfo &ei) const override;
-  expr_t substituteEndoLeadGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteEndoLagGreaterThanTwo(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExoLead(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model) const override;
-  expr_t substituteExoLag(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteExpectation(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model) const override;
-  expr_t substituteAdl() const override;
-  expr_t substituteVarExpectation(const map<string, expr_t> &subst_table) const override;
-  void findDiffNodes(DataTree &static_datatree, diff_table_t &diff_table) const override;
-  void findUnaryOpNodesForAuxVarCreation(DataTree &static_datatree, diff_table_t &nodes) const override;
+  expr_t substituteEndoLeadGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteEndoLagGreaterThanTwoInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExoLeadInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool deterministic_model, expr_memo_t &memo) const override;
+  expr_t substituteExoLagInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteExpectationInternal(subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, bool partial_information_model, expr_memo_t &memo) const override;
+  expr_t substituteAdlInternal(expr_memo_t &memo) const override;
+  expr_t substituteVarExpectationInternal(const map<string, expr_t> &subst_table, expr_memo_t &memo) const override;
+  void findDiffNodesInternal(DataTree &static_datatree, diff_table_t &diff_table, visited_set_t &visited) const override;
+  void findUnaryOpNodesForAuxVarCreationInternal(DataTree &static_datatree, diff_table_t &nodes, visited_set_t &visited) const override;
   int findTrendVariable(int lhs_symb_id) const override;
-  expr_t substituteDiff(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substituteUnaryOpNodes(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t substitutePacExpectation(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table) override;
+  expr_t substituteDiffInternal(DataTree &static_datatree, diff_table_t &diff_table, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substituteUnaryOpNodesInternal(DataTree &static_datatree, diff_table_t &nodes, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t substitutePacExpectationInternal(map<const PacExpectationNode *, const BinaryOpNode *> &subst_table, expr_memo_t &memo) override;
   pair<int, expr_t> normalizeEquation(int symb_id_endo, vector<pair<int, pair<expr_t, expr_t>>>  &List_of_Op_RHS) const override;
   void compile(ostream &CompileCode, unsigned int &instruction_number,
                        bool lhs_rhs, const temporary_terms_t &temporary_terms,
@@ -1557,17 +1773,17 @@ public:
                        const deriv_node_temp_terms_t &tef_terms) const override;
   void collectTemporary_terms(const temporary_terms_t &temporary_terms, temporary_terms_inuse_t &temporary_terms_inuse, int Curr_Block) const override;
   void collectVARLHSVariable(set<expr_t> &result) const override;
-  void collectDynamicVariables(SymbolType type_arg, set<pair<int, int>> &result) const override;
+  void collectDynamicVariablesInternal(SymbolType type_arg, set<pair<int, int>> &result, visited_set_t &visited) const override;
   bool containsEndogenous() const override;
   bool containsExogenous() const override;
   int countDiffs() const override;
   bool isNumConstNodeEqualTo(double value) const override;
-  expr_t differentiateForwardVars(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs) const override;
-  expr_t decreaseLeadsLagsPredeterminedVariables() const override;
+  expr_t differentiateForwardVarsInternal(const vector<string> &subset, subst_table_t &subst_table, vector<BinaryOpNode *> &neweqs, expr_memo_t &memo) const override;
+  expr_t decreaseLeadsLagsPredeterminedVariablesInternal(expr_memo_t &memo) const override;
   bool isVariableNodeEqualTo(SymbolType type_arg, int variable_id, int lag_arg) const override;
-  expr_t replaceTrendVar() const override;
-  expr_t detrend(int symb_id, bool log_trend, expr_t trend) const override;
-  expr_t removeTrendLeadLag(map<int, expr_t> trend_symbols_map) const override;
+  expr_t replaceTrendVarInternal(expr_memo_t &memo) const override;
+  expr_t detrendInternal(int symb_id, bool log_trend, expr_t trend, expr_memo_t &memo) const override;
+  expr_t removeTrendLeadLagInternal(map<int, expr_t> trend_symbols_map, expr_memo_t &memo) const override;
   bool isInStaticForm() const override;
   void addParamInfoToPac(pair<int, int> &lhs_arg, int optim_share_arg, pair<int, pair<vector<int>, vector<bool>>> &ec_params_and_vars_arg, set<pair<int, pair<int, int>>> &params_and_vars_arg, set<pair<int, pair<pair<int, int>, double>>> &params_vars_and_scaling_factor_arg) override;
   void fillPacExpectationVarInfo(string &model_name_arg, vector<int> &lhs_arg, int max_lag_arg, int pac_max_lag_arg, vector<bool> &nonstationary_arg, int growth_symb_id_arg, int equation_number_arg) override;
@@ -1583,7 +1799,7 @@ public:
   bool isParamTimesEndogExpr() const override;
   bool isVarModelReferenced(const string &model_info_name) const override;
   void getEndosAndMaxLags(map<string, int> &model_endos_and_lags) const override;
-  expr_t substituteStaticAuxiliaryVariable() const override;
+  expr_t substituteStaticAuxiliaryVariableInternal(expr_memo_t &memo) const override;
   void writeJsonOutput(ostream &output, const temporary_terms_t &temporary_terms, const deriv_node_temp_terms_t &tef_terms, const bool isdynamic) const override;
 };
 
@@ -51,4 +51,11 @@ enum class JsonOutputPointType
     transformpass,                     // output JSON after the transform pass
     computingpass                      // output JSON after the computing pass
   };
+
+enum class ProfileOutputType
+  {
+    none,                             // don't profile
+    text,                             // print a human-readable profile on the standard output
+    json                              // write the profile to <basename>/profile.json
+  };
 #endif
@@ -28,6 +28,7 @@
 #include "ModFile.hh"
 #include "ConfigFile.hh"
 #include "ComputingTasks.hh"
+#include "BufferedSink.hh"
 
 ModFile::ModFile(WarningConsolidation &warnings_arg)
   : var_model_table(symbol_table),
@@ -92,12 +93,12 @@ ModFile::evalAllExpressions(bool warn_uninit, const bool nopreprocessoroutput)
       SymbolType type = symbol_table.getType(id);
       if ((type == SymbolType::endogenous || type == SymbolType::exogenous || type == SymbolType::exogenousDet
            || type == SymbolType::parameter || type == SymbolType::modelLocalVariable)
-          && global_eval_context.find(id) == global_eval_context.end())
+          && !global_eval_context.isKnown(id))
         {
           if (warn_uninit)
             warnings << "WARNING: Can't find a numeric initial value for "
                      << symbol_table.getName(id) << ", using zero" << endl;
-          global_eval_context[id] = 0;
+          global_eval_context.set(id, 0);
         }
     }
 }
@@ -676,8 +677,20 @@ ModFile::transformPass(bool nostrict, bool stochastic, bool compute_xrefs, const
 }
 
 void
-ModFile::computingPass(bool no_tmp_terms, FileOutputType output, int params_derivs_order, const bool nopreprocessoroutput)
+ModFile::computingPass(bool no_tmp_terms, FileOutputType output, int params_derivs_order, int nthreads,
+                       const string &computing_pass_cache_dir, const bool nopreprocessoroutput)
 {
+  static_model.nthreads = nthreads;
+  dynamic_model.nthreads = nthreads;
+
+  if (!computing_pass_cache_dir.empty())
+    {
+      boost::filesystem::create_directories(computing_pass_cache_dir);
+      static_model.computing_pass_cache = computing_pass_cache_dir + "/static";
+      dynamic_model.computing_pass_cache = computing_pass_cache_dir + "/dynamic";
+      orig_ramsey_dynamic_model.computing_pass_cache = computing_pass_cache_dir + "/orig_ramsey_dynamic";
+    }
+
   // Mod file may have no equation (for example in a standalone BVAR estimation)
   if (dynamic_model.equation_number() > 0)
     {
@@ -699,6 +712,7 @@ ModFile::computingPass(bool no_tmp_terms, FileOutputType output, int params_deri
           int paramsDerivsOrder = 0;
           if (mod_file_struct.identification_present || mod_file_struct.estimation_analytic_derivation)
             paramsDerivsOrder = params_derivs_order;
+          Profiler::Phase phase("static model");
           static_model.computingPass(global_eval_context, no_tmp_terms, static_hessian,
                                      false, paramsDerivsOrder, block, byte_code, nopreprocessoroutput);
         }
@@ -710,7 +724,10 @@ ModFile::computingPass(bool no_tmp_terms, FileOutputType output, int params_deri
           || mod_file_struct.calib_smoother_present)
         {
           if (mod_file_struct.perfect_foresight_solver_present)
-            dynamic_model.computingPass(true, false, false, 0, global_eval_context, no_tmp_terms, block, use_dll, byte_code, nopreprocessoroutput);
+            {
+              Profiler::Phase phase("dynamic model");
+              dynamic_model.computingPass(true, false, false, 0, global_eval_context, no_tmp_terms, block, use_dll, byte_code, nopreprocessoroutput);
+            }
           else
             {
               if (mod_file_struct.stoch_simul_present
@@ -735,13 +752,22 @@ ModFile::computingPass(bool no_tmp_terms, FileOutputType output, int params_deri
               int paramsDerivsOrder = 0;
               if (mod_file_struct.identification_present || mod_file_struct.estimation_analytic_derivation)
                 paramsDerivsOrder = params_derivs_order;
-              dynamic_model.computingPass(true, hessian, thirdDerivatives, paramsDerivsOrder, global_eval_context, no_tmp_terms, block, use_dll, byte_code, nopreprocessoroutput);
+              {
+                Profiler::Phase phase("dynamic model");
+                dynamic_model.computingPass(true, hessian, thirdDerivatives, paramsDerivsOrder, global_eval_context, no_tmp_terms, block, use_dll, byte_code, nopreprocessoroutput);
+              }
               if (linear && mod_file_struct.ramsey_model_present)
-                orig_ramsey_dynamic_model.computingPass(true, true, false, paramsDerivsOrder, global_eval_context, no_tmp_terms, block, use_dll, byte_code, nopreprocessoroutput);
+                {
+                  Profiler::Phase phase("original Ramsey model");
+                  orig_ramsey_dynamic_model.computingPass(true, true, false, paramsDerivsOrder, global_eval_context, no_tmp_terms, block, use_dll, byte_code, nopreprocessoroutput);
+                }
             }
         }
       else // No computing task requested, compute derivatives up to 2nd order by default
-        dynamic_model.computingPass(true, true, false, 0, global_eval_context, no_tmp_terms, block, use_dll, byte_code, nopreprocessoroutput);
+        {
+          Profiler::Phase phase("dynamic model");
+          dynamic_model.computingPass(true, true, false, 0, global_eval_context, no_tmp_terms, block, use_dll, byte_code, nopreprocessoroutput);
+        }
 
       map<int, string> eqs;
       if (mod_file_struct.ramsey_model_present)
@@ -767,20 +793,42 @@ ModFile::computingPass(bool no_tmp_terms, FileOutputType output, int params_deri
   for (auto & statement : statements)
     statement->computingPass();
 
+  Profiler::Phase phase("epilogue");
   epilogue.computingPass(true, true, false, 0, global_eval_context, true, false, false, false, true);
 }
 
 void
 ModFile::writeOutputFiles(const string &basename, bool clear_all, bool clear_global, bool no_log, bool no_warn,
                           bool console, bool nograph, bool nointeractive, const ConfigFile &config_file,
-                          bool check_model_changes, bool minimal_workspace, bool compute_xrefs
+                          bool check_model_changes, bool minimal_workspace, bool compute_xrefs, int dll_shards
 #if defined(_WIN32) || defined(__CYGWIN32__)
                           , bool cygwin, bool msvc, bool mingw
 #endif
                           , const bool nopreprocessoroutput
                           ) const
 {
-  bool hasModelChanged = !dynamic_model.isChecksumMatching(basename);
+  /* The calls to external functions declare local variables that are used
+     across derivation orders, so the C dynamic model cannot be split */
+  if (use_dll && dll_shards > 1
+      && external_functions_table.get_total_number_of_unique_model_block_external_functions())
+    {
+      warnings << "WARNING: the dll_shards option is ignored because the model uses external functions" << endl;
+      dll_shards = 1;
+    }
+#if defined(_WIN32) || defined(__CYGWIN32__) || defined(__MINGW32__)
+  // The translation units are compiled by make, with the object file suffix of Unix compilers
+  if (use_dll && dll_shards > 1)
+    {
+      warnings << "WARNING: the dll_shards option is not supported under Windows, and is ignored" << endl;
+      dll_shards = 1;
+    }
+#endif
+
+  ostringstream writer_options;
+  writer_options << PACKAGE_VERSION << " block=" << block << " bytecode=" << byte_code
+                 << " use_dll=" << use_dll << " no_static=" << no_static
+                 << " order=" << mod_file_struct.order_option << " dll_shards=" << dll_shards;
+  bool hasModelChanged = !dynamic_model.isChecksumMatching(basename, writer_options.str());
   if (!check_model_changes)
     hasModelChanged = true;
 
@@ -798,7 +846,10 @@ ModFile::writeOutputFiles(const string &basename, bool clear_all, bool clear_glo
 	  boost::filesystem::rename("+" + basename, tmp);
 	  boost::filesystem::remove_all(tmp);
 	}
-      boost::filesystem::remove_all(basename + "/model/src");
+      /* With the fast option, the translation units of a split C dynamic model
+         are kept, and only rewritten if they have changed */
+      if (!(check_model_changes && use_dll && dll_shards > 1))
+        boost::filesystem::remove_all(basename + "/model/src");
       boost::filesystem::remove_all(basename + "/model/bytecode");
     }
 
@@ -821,6 +872,7 @@ ModFile::writeOutputFiles(const string &basename, bool clear_all, bool clear_glo
       exit(EXIT_FAILURE);
     }
 
+  Profiler::Phase driver_phase("driver file");
   mOutputFile << "%" << endl
               << "% Status : main Dynare file" << endl
               << "%" << endl
@@ -964,7 +1016,26 @@ ModFile::writeOutputFiles(const string &basename, bool clear_all, bool clear_glo
 
   // Compile the dynamic MEX file for use_dll option
   // When check_model_changes is true, don't force compile if MEX is fresher than source
-  if (use_dll)
+  if (use_dll && dll_shards > 1)
+    {
+      /* dyn_mex only knows dynamic.c and dynamic_mex.c, so the MEX files are
+         built with the makefile written along with the translation units, which
+         compiles them in parallel and links all of them */
+      mOutputFile << "if isoctave" << endl
+                  << "    setenv('MEX', ['\"' fullfile(OCTAVE_HOME, 'bin', 'mkoctfile') '\" --mex']);" << endl
+                  << "    setenv('MEXOUTPUT', '-o');" << endl
+                  << "else" << endl
+                  << "    setenv('MEX', ['\"' fullfile(matlabroot, 'bin', 'mex') '\" -O']);" << endl
+                  << "    setenv('MEXOUTPUT', '-output');" << endl
+                  << "end" << endl
+                  << "setenv('MEXEXT', mexext);" << endl
+                  << "[status, output] = system('make -C " << basename << "/model/src -f dynamic.mk -j" << dll_shards
+                  << (check_model_changes ? "" : " -B") << " dynamic" << (no_static ? "" : " static") << "');" << endl
+                  << "if status ~= 0" << endl
+                  << "    error(['Compilation of the MEX files of the model failed:' char(10) output])" << endl
+                  << "end" << endl;
+    }
+  else if (use_dll)
     {
 #if defined(_WIN32) || defined(__CYGWIN32__) || defined(__MINGW32__)
       if (msvc)
@@ -1057,6 +1128,7 @@ ModFile::writeOutputFiles(const string &basename, bool clear_all, bool clear_glo
     mOutputFile << "diary off" << endl;
 
   mOutputFile.close();
+  driver_phase.stop();
 
   if (hasModelChanged)
     {
@@ -1065,14 +1137,17 @@ ModFile::writeOutputFiles(const string &basename, bool clear_all, bool clear_glo
         {
           if (!no_static)
             {
+              Profiler::Phase phase("static model files");
               static_model.writeStaticFile(basename, block, byte_code, use_dll, false);
               static_model.writeParamsDerivativesFile(basename, false);
             }
 
-          dynamic_model.writeDynamicFile(basename, block, byte_code, use_dll, mod_file_struct.order_option, false);
+          Profiler::Phase phase("dynamic model files");
+          dynamic_model.writeDynamicFile(basename, block, byte_code, use_dll, mod_file_struct.order_option, false, dll_shards);
           dynamic_model.writeParamsDerivativesFile(basename, false);
         }
 
+      Profiler::Phase phase("steady state and epilogue files");
       // Create steady state file
       steady_state_model.writeSteadyStateFile(basename, mod_file_struct.ramsey_model_present, false);
 
@@ -1187,11 +1262,13 @@ ModFile::writeExternalFilesJulia(const string &basename, FileOutputType output,
                                 mod_file_struct.estimation_present, false, true);
       if (!no_static)
         {
+          Profiler::Phase phase("static model files");
           static_model.writeStaticFile(basename, false, false, false, true);
           static_model.writeParamsDerivativesFile(basename, true);
         }
+      Profiler::Phase phase("dynamic model files");
       dynamic_model.writeDynamicFile(basename, block, byte_code, use_dll,
-                                     mod_file_struct.order_option, true);
+                                     mod_file_struct.order_option, true, 1);
       dynamic_model.writeParamsDerivativesFile(basename, true);
     }
   steady_state_model.writeSteadyStateFile(basename, mod_file_struct.ramsey_model_present, true);
@@ -1416,6 +1493,25 @@ ModFile::writeJsonOutputParsingCheck(const string &basename, JsonFileOutputType
     }
 }
 
+void
+ModFile::writeBinaryDerivatives(const string &basename, const bool nopreprocessoroutput) const
+{
+  boost::filesystem::create_directories(basename + "/model/binary");
+
+  bool static_written = static_model.writeBinaryDerivatives(basename + "/model/binary/static.derivs");
+  bool dynamic_written = dynamic_model.writeBinaryDerivatives(basename + "/model/binary/dynamic.derivs");
+
+  if (!static_written || !dynamic_written)
+    {
+      boost::filesystem::remove_all(basename + "/model/binary");
+      cerr << "ERROR: the binaryderivs option cannot be used, because the model contains "
+           << "external functions or operators which cannot be stored in binary form" << endl;
+      exit(EXIT_FAILURE);
+    }
+  if (!nopreprocessoroutput)
+    cout << "Binary derivatives written after Computing step." << endl;
+}
+
 void
 ModFile::writeJsonComputingPassOutput(const string &basename, JsonFileOutputType json_output_mode, bool jsonderivsimple) const
 {
@@ -1425,56 +1521,79 @@ ModFile::writeJsonComputingPassOutput(const string &basename, JsonFileOutputType
       exit(EXIT_FAILURE);
     }
 
-  ostringstream tmp_out, static_output, dynamic_output, static_paramsd_output, dynamic_paramsd_output;
-
-  static_output << "{";
-  static_model.writeJsonComputingPassOutput(static_output, !jsonderivsimple);
-  static_output << "}";
-
-  dynamic_output << "{";
-  dynamic_model.writeJsonComputingPassOutput(dynamic_output, !jsonderivsimple);
-  dynamic_output << "}";
-
-  tmp_out << "";
-  static_paramsd_output << "";
-  static_model.writeJsonParamsDerivativesFile(tmp_out, !jsonderivsimple);
-  if (!tmp_out.str().empty())
-    static_paramsd_output << "{" << tmp_out.str() << "}" << endl;
-
-  tmp_out.str("");
-  dynamic_paramsd_output << "";
-  dynamic_model.writeJsonParamsDerivativesFile(tmp_out, !jsonderivsimple);
-  if (!tmp_out.str().empty())
-    dynamic_paramsd_output << "{" << tmp_out.str() << "}" << endl;
+  /* Each output is streamed to its destination while being written, so that
+     the memory needed does not grow with the size of the output */
+  struct JsonComputingPassOutput
+  {
+    //! Name of the writer in the profile, key on the standard output, and file name
+    string phase, key, filename;
+    function<void(ostream &)> writer;
+  };
+  vector<JsonComputingPassOutput> outputs;
+  outputs.push_back({ "static model JSON", "static_model", "static.json", [&](ostream &output)
+                      {
+                        output << "{";
+                        static_model.writeJsonComputingPassOutput(output, !jsonderivsimple);
+                        output << "}";
+                      } });
+  outputs.push_back({ "dynamic model JSON", "dynamic_model", "dynamic.json", [&](ostream &output)
+                      {
+                        output << "{";
+                        dynamic_model.writeJsonComputingPassOutput(output, !jsonderivsimple);
+                        output << "}";
+                      } });
+  if (static_model.hasParamsDerivatives())
+    outputs.push_back({ "static params derivatives JSON", "static_params_deriv", "static_params_derivs.json",
+                        [&](ostream &output)
+                        {
+                          output << "{";
+                          static_model.writeJsonParamsDerivativesFile(output, !jsonderivsimple);
+                          output << "}" << endl;
+                        } });
+  if (dynamic_model.hasParamsDerivatives())
+    outputs.push_back({ "dynamic params derivatives JSON", "dynamic_params_deriv", "params_derivs.json",
+                        [&](ostream &output)
+                        {
+                          output << "{";
+                          dynamic_model.writeJsonParamsDerivativesFile(output, !jsonderivsimple);
+                          output << "}" << endl;
+                        } });
 
   if (json_output_mode == JsonFileOutputType::standardout)
     {
-      cout << ", \"static_model\": " << static_output.str() << endl
-           << ", \"dynamic_model\": " << dynamic_output.str() << endl;
-
-      if (!static_paramsd_output.str().empty())
-        cout << ", \"static_params_deriv\": " << static_paramsd_output.str() << endl;
-
-      if (!dynamic_paramsd_output.str().empty())
-        cout << ", \"dynamic_params_deriv\": " << dynamic_paramsd_output.str() << endl;
+      // The outputs follow each other on the standard output, so they are written sequentially
+      BufferedSink buffer([](const char *data, streamsize size)
+                          {
+                            return cout.rdbuf()->sputn(data, size) == size;
+                          });
+      ostream output(&buffer);
+      for (const auto &it : outputs)
+        {
+          Profiler::Phase phase(it.phase);
+          output << ", \"" << it.key << "\": ";
+          it.writer(output);
+          output << endl;
+        }
+      if (!buffer.flush() || !output || !cout.flush())
+        {
+          cerr << "ERROR: Can't write the JSON output to the standard output" << endl;
+          exit(EXIT_FAILURE);
+        }
     }
   else
     {
       boost::filesystem::create_directories(basename + "/model/json");
 
-      writeJsonFileHelper(basename + "/model/json/static.json", static_output);
-      writeJsonFileHelper(basename + "/model/json/dynamic.json", dynamic_output);
-
-      if (!static_paramsd_output.str().empty())
-        writeJsonFileHelper(basename + "/model/json/static_params_derivs.json", static_paramsd_output);
-
-      if (!dynamic_paramsd_output.str().empty())
-        writeJsonFileHelper(basename + "/model/json/params_derivs.json", dynamic_paramsd_output);
+      for (const auto &it : outputs)
+        {
+          Profiler::Phase phase(it.phase);
+          writeJsonFileHelper(basename + "/model/json/" + it.filename, it.writer);
+        }
     }
 }
 
 void
-ModFile::writeJsonFileHelper(const string &fname, ostringstream &output) const
+ModFile::writeJsonFileHelper(const string &fname, const function<void(ostream &)> &writer) const
 {
   ofstream jsonOutput;
   jsonOutput.open(fname, ios::out | ios::binary);
@@ -1483,6 +1602,32 @@ ModFile::writeJsonFileHelper(const string &fname, ostringstream &output) const
       cerr << "ERROR: Can't open file " << fname << " for writing" << endl;
       exit(EXIT_FAILURE);
     }
-  jsonOutput << output.str();
+  BufferedSink buffer([&](const char *data, streamsize size)
+                      {
+                        return jsonOutput.rdbuf()->sputn(data, size) == size;
+                      });
+  ostream output(&buffer);
+  writer(output);
+  bool written = buffer.flush() && output;
   jsonOutput.close();
+  if (!written || jsonOutput.fail())
+    {
+      cerr << "ERROR: Can't write file " << fname << endl;
+      exit(EXIT_FAILURE);
+    }
+}
+
+void
+ModFile::profileNodeCounts() const
+{
+  Profiler::setCounter("nodes in expressions_tree", expressions_tree.getNodeCount());
+  Profiler::setCounter("nodes in original_model", original_model.getNodeCount());
+  Profiler::setCounter("nodes in dynamic_model", dynamic_model.getNodeCount());
+  Profiler::setCounter("nodes in trend_dynamic_model", trend_dynamic_model.getNodeCount());
+  Profiler::setCounter("nodes in ramsey_FOC_equations_dynamic_model", ramsey_FOC_equations_dynamic_model.getNodeCount());
+  Profiler::setCounter("nodes in orig_ramsey_dynamic_model", orig_ramsey_dynamic_model.getNodeCount());
+  Profiler::setCounter("nodes in epilogue", epilogue.getNodeCount());
+  Profiler::setCounter("nodes in static_model", static_model.getNodeCount());
+  Profiler::setCounter("nodes in steady_state_model", steady_state_model.getNodeCount());
+  Profiler::setCounter("nodes in diff_static_model", diff_static_model.getNodeCount());
 }
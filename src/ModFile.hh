@@ -26,6 +26,8 @@ using namespace std;
 #include <ctime>
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include <functional>
 
 #include "SymbolTable.hh"
 #include "NumericalConstants.hh"
@@ -37,6 +39,7 @@ using namespace std;
 #include "ExternalFunctionsTable.hh"
 #include "ConfigFile.hh"
 #include "WarningConsolidation.hh"
+#include "Profiler.hh"
 #include "ExtendedPreprocessorTypes.hh"
 #include "SubModel.hh"
 
@@ -124,7 +127,8 @@ private:
   //! Functions used in writing of JSON outut. See writeJsonOutput
   void writeJsonOutputParsingCheck(const string &basename, JsonFileOutputType json_output_mode, bool transformpass, bool computingpass) const;
   void writeJsonComputingPassOutput(const string &basename, JsonFileOutputType json_output_mode, bool jsonderivsimple) const;
-  void writeJsonFileHelper(const string &fname, ostringstream &output) const;
+  //! Writes a JSON file, whose content is streamed to it by the writer
+  void writeJsonFileHelper(const string &fname, const function<void(ostream &)> &writer) const;
 public:
   //! Add a statement
   void addStatement(unique_ptr<Statement> st);
@@ -142,7 +146,10 @@ public:
   //! Execute computations
   /*! \param no_tmp_terms if true, no temporary terms will be computed in the static and dynamic files */
   /*! \param params_derivs_order compute this order of derivs wrt parameters */
-  void computingPass(bool no_tmp_terms, FileOutputType output, int params_derivs_order, const bool nopreprocessoroutput);
+  /*! \param nthreads number of threads used for computing the derivatives (0 or 1 for sequential computation) */
+  /*! \param computing_pass_cache_dir directory in which the derivatives are cached from one run to the next (empty to disable the cache) */
+  void computingPass(bool no_tmp_terms, FileOutputType output, int params_derivs_order, int nthreads,
+                     const string &computing_pass_cache_dir, const bool nopreprocessoroutput);
   //! Writes Matlab/Octave output files
   /*!
     \param basename The base name used for writing output files. Should be the name of the mod file without its extension
@@ -154,10 +161,11 @@ public:
     \param msvc Should the MEX command of use_dll be adapted for MSVC?
     \param mingw Should the MEX command of use_dll be adapted for MinGW?
     \param compute_xrefs if true, equation cross references will be computed
+    \param dll_shards number of translation units in which the C dynamic model of use_dll is split
   */
   void writeOutputFiles(const string &basename, bool clear_all, bool clear_global, bool no_log, bool no_warn,
                         bool console, bool nograph, bool nointeractive, const ConfigFile &config_file,
-                        bool check_model_changes, bool minimal_workspace, bool compute_xrefs
+                        bool check_model_changes, bool minimal_workspace, bool compute_xrefs, int dll_shards
 #if defined(_WIN32) || defined(__CYGWIN32__) || defined(__MINGW32__)
                         , bool cygwin, bool msvc, bool mingw
 #endif
@@ -165,6 +173,8 @@ public:
                         ) const;
   void writeExternalFiles(const string &basename, FileOutputType output, LanguageOutputType language, const bool nopreprocessoroutput) const;
   void writeExternalFilesJulia(const string &basename, FileOutputType output, const bool nopreprocessoroutput) const;
+  //! Reports the number of nodes of each datatree to the profiler
+  void profileNodeCounts() const;
 
   void computeChecksum();
   //! Write JSON representation of ModFile object
@@ -172,6 +182,9 @@ public:
   //! Potentially outputs ModFile after the various parts of processing (parsing, checkPass, transformPass, computingPass)
   //! Allows user of other host language platforms (python, fortran, etc) to provide support for dynare .mod files
   void writeJsonOutput(const string &basename, JsonOutputPointType json, JsonFileOutputType json_output_mode, bool onlyjson, const bool nopreprocessoroutput, bool jsonderivsimple = false);
+  //! Writes the results of the computing pass in binary form, in <basename>/model/binary (see BinaryDerivatives.hh)
+  /*! Exits with an error if the model contains external functions, which the format cannot store */
+  void writeBinaryDerivatives(const string &basename, const bool nopreprocessoroutput) const;
 };
 
 #endif // ! MOD_FILE_HH
@@ -22,9 +22,17 @@
 #include <cmath>
 #include <iostream>
 #include <fstream>
+#include <thread>
+#include <array>
+#include <exception>
+#include <cstring>
 
 #include "ModelTree.hh"
 #include "MinimumFeedbackSet.hh"
+#include "Profiler.hh"
+#include "EvalTape.hh"
+#include "BytecodeOptimizer.hh"
+#include "SHA256.hh"
 #include <boost/graph/adjacency_list.hpp>
 #include <boost/graph/max_cardinality_matching.hpp>
 #include <boost/graph/strong_components.hpp>
@@ -256,6 +264,16 @@ ModelTree::evaluateAndReduceJacobian(const eval_context_t &eval_context, jacob_m
 {
   int nb_elements_contemparenous_Jacobian = 0;
   set<pair<int, int>> jacobian_elements_to_delete;
+
+  // Evaluate all the derivatives w.r.t. endogenous at once, so that shared subexpressions are only evaluated once
+  EvalTape tape;
+  vector<int> slots;
+  for (const auto &it : first_derivatives)
+    if (getTypeByDerivID(it.first.second) == SymbolType::endogenous)
+      slots.push_back(tape.add(it.second));
+  tape.eval(eval_context);
+
+  auto slot_it = slots.begin();
   for (first_derivatives_t::const_iterator it = first_derivatives.begin();
        it != first_derivatives.end(); it++)
     {
@@ -270,7 +288,7 @@ ModelTree::evaluateAndReduceJacobian(const eval_context_t &eval_context, jacob_m
           double val = 0;
           try
             {
-              val = Id->eval(eval_context);
+              val = tape.getValue(*slot_it++);
             }
           catch (ExprNode::EvalExternalFunctionException &e)
             {
@@ -306,8 +324,10 @@ ModelTree::evaluateAndReduceJacobian(const eval_context_t &eval_context, jacob_m
     }
 
   // Get rid of the elements of the Jacobian matrix below the cutoff
-  for (const auto & it : jacobian_elements_to_delete)
-    first_derivatives.erase(it);
+  first_derivatives.eraseIf([&](const first_derivatives_t::value_type &it)
+                            {
+                              return jacobian_elements_to_delete.find(it.first) != jacobian_elements_to_delete.end();
+                            });
 
   if (jacobian_elements_to_delete.size() > 0)
     {
@@ -1009,13 +1029,197 @@ ModelTree::ModelTree(SymbolTable &symbol_table_arg,
   DataTree(symbol_table_arg, num_constants_arg, external_functions_table_arg,
            trend_component_model_table_arg, var_model_table_arg),
   cutoff(1e-15),
-  mfs(0)
+  mfs(0),
+  nthreads(0),
+  optimize_bytecode(true)
 
 {
   for (int & NNZDerivative : NNZDerivatives)
     NNZDerivative = 0;
 }
 
+//! Private datatree of a derivation worker
+/*! Derivation IDs (and the information attached to them) are forwarded to the
+  model whose derivatives are computed, so that the derivatives computed in this
+  datatree are identical to those that would be computed in the model */
+class DerivationWorkerTree : public DataTree
+{
+private:
+  ModelTree &model;
+public:
+  DerivationWorkerTree(ModelTree &model_arg, NumericalConstants &num_constants_arg) :
+    DataTree(model_arg.symbol_table, num_constants_arg, model_arg.external_functions_table,
+             model_arg.trend_component_model_table, model_arg.var_model_table),
+    model(model_arg)
+  {
+  }
+
+  VariableNode *
+  AddVariable(int symb_id, int lag = 0) override
+  {
+    return AddVariableInternal(symb_id, lag);
+  }
+
+  int
+  getDerivID(int symb_id, int lag) const noexcept(false) override
+  {
+    return model.getDerivID(symb_id, lag);
+  }
+
+  SymbolType
+  getTypeByDerivID(int deriv_id) const noexcept(false) override
+  {
+    return model.getTypeByDerivID(deriv_id);
+  }
+
+  int
+  getLagByDerivID(int deriv_id) const noexcept(false) override
+  {
+    return model.getLagByDerivID(deriv_id);
+  }
+
+  int
+  getSymbIDByDerivID(int deriv_id) const noexcept(false) override
+  {
+    return model.getSymbIDByDerivID(deriv_id);
+  }
+
+  int
+  getDynJacobianCol(int deriv_id) const noexcept(false) override
+  {
+    return model.getDynJacobianCol(deriv_id);
+  }
+
+  void
+  addAllParamDerivId(set<int> &deriv_id_set) override
+  {
+    model.addAllParamDerivId(deriv_id_set);
+  }
+
+  bool
+  isDynamic() const override
+  {
+    return model.isDynamic();
+  }
+};
+
+//! Computes the derivatives of a subset of the equations of a model, in a private datatree
+/*! The nodes created by each computation of a derivative are recorded, so that
+  they can be recreated in the model datatree in the order in which the
+  sequential algorithm would have created them (see
+  ModelTree::computeDerivativesInParallel()) */
+class ModelTree::DerivationWorker
+{
+public:
+  //! The nodes created in the private datatree while computing one derivative
+  struct Segment
+  {
+    //! Position of the derivative in the iteration order of the sequential algorithm
+    array<int, 4> key;
+    //! Range of the created nodes in the private datatree
+    int first_node, last_node;
+  };
+
+  NumericalConstants num_constants;
+  DerivationWorkerTree tree;
+  //! Equations handled by this worker
+  vector<int> equations;
+  //! Clones of the equations handled by this worker, indexed by equation number in the model
+  map<int, expr_t> equation_clones;
+  //! Derivatives of the equations handled by this worker (in the private datatree)
+  first_derivatives_t first_derivatives;
+  second_derivatives_t second_derivatives;
+  third_derivatives_t third_derivatives;
+  //! Nodes created at the current order, in order of creation (derivatives which did not create any node are omitted)
+  vector<Segment> segments;
+  //! Cache used for importing the derivatives into the model datatree
+  ExprNode::expr_memo_t import_cache;
+  //! Exception raised while computing the derivatives, if any
+  exception_ptr error;
+
+  explicit DerivationWorker(ModelTree &model) : tree(model, num_constants)
+  {
+  }
+
+  //! Computes the derivatives of the given order
+  /*! At order 1, the worker derives its equations. At higher orders, it
+    derives the lower order derivatives that it has itself computed. Within a
+    worker, derivatives are computed in the same order as in the sequential
+    algorithm */
+  void
+  computeDerivatives(int order, const set<int> &vars, const ModelTree &model)
+  {
+    segments.clear();
+    auto derive = [&](expr_t e, int var, const array<int, 4> &key)
+      {
+        int first_node = tree.getNodeCount();
+        expr_t d = e->getDerivative(var);
+        if (tree.getNodeCount() > first_node)
+          segments.push_back({ key, first_node, tree.getNodeCount() });
+        return d;
+      };
+
+    switch (order)
+      {
+      case 1:
+        {
+          ExprNode::expr_memo_t cache;
+          for (int symb_id : model.local_variables_vector)
+            tree.AddLocalVariable(symb_id, model.local_variables_table.find(symb_id)->second->cloneDynamic(tree, cache));
+          for (int eq : equations)
+            equation_clones[eq] = model.equations[eq]->cloneDynamic(tree, cache);
+
+          for (int var : vars)
+            for (int eq : equations)
+              {
+                expr_t d1 = derive(equation_clones[eq], var, { var, eq, 0, 0 });
+                if (d1 != tree.Zero)
+                  first_derivatives.insert({ eq, var }, d1);
+              }
+          first_derivatives.finalize();
+        }
+        break;
+      case 2:
+        for (const auto &it : first_derivatives)
+          {
+            int eq, var1;
+            tie(eq, var1) = it.first;
+            for (int var2 : vars)
+              {
+                if (var2 > var1)
+                  continue;
+                expr_t d2 = derive(it.second, var2, { eq, var1, var2, 0 });
+                if (d2 != tree.Zero)
+                  second_derivatives.insert({ eq, var1, var2 }, d2);
+              }
+          }
+        second_derivatives.finalize();
+        break;
+      case 3:
+        for (const auto &it : second_derivatives)
+          {
+            int eq, var1, var2;
+            tie(eq, var1, var2) = it.first;
+            for (int var3 : vars)
+              {
+                if (var3 > var2)
+                  continue;
+                expr_t d3 = derive(it.second, var3, { eq, var1, var2, var3 });
+                if (d3 != tree.Zero)
+                  third_derivatives.insert({ eq, var1, var2, var3 }, d3);
+              }
+          }
+        third_derivatives.finalize();
+        break;
+      default:
+        cerr << "ModelTree::DerivationWorker::computeDerivatives: unsupported order " << order << endl;
+        exit(EXIT_FAILURE);
+      }
+  }
+};
+
+ModelTree::~ModelTree() = default;
+
 int
 ModelTree::equation_number() const
 {
@@ -1037,6 +1241,14 @@ ModelTree::writeDerivative(ostream &output, int eq, int symb_id, int lag,
 void
 ModelTree::computeJacobian(const set<int> &vars)
 {
+  Profiler::Phase phase("first order derivatives");
+
+  if (nthreads > 1)
+    {
+      computeDerivativesInParallel(1, vars);
+      return;
+    }
+
   for (int var : vars)
     {
       for (int eq = 0; eq < (int) equations.size(); eq++)
@@ -1044,15 +1256,24 @@ ModelTree::computeJacobian(const set<int> &vars)
           expr_t d1 = equations[eq]->getDerivative(var);
           if (d1 == Zero)
             continue;
-          first_derivatives[{ eq, var }] = d1;
+          first_derivatives.insert({ eq, var }, d1);
           ++NNZDerivatives[0];
         }
     }
+  first_derivatives.finalize();
 }
 
 void
 ModelTree::computeHessian(const set<int> &vars)
 {
+  Profiler::Phase phase("second order derivatives");
+
+  if (nthreads > 1)
+    {
+      computeDerivativesInParallel(2, vars);
+      return;
+    }
+
   for (const auto &it : first_derivatives)
     {
       int eq, var1;
@@ -1068,18 +1289,27 @@ ModelTree::computeHessian(const set<int> &vars)
           expr_t d2 = d1->getDerivative(var2);
           if (d2 == Zero)
             continue;
-          second_derivatives[{ eq, var1, var2 }] = d2;
+          second_derivatives.insert({ eq, var1, var2 }, d2);
           if (var2 == var1)
             ++NNZDerivatives[1];
           else
             NNZDerivatives[1] += 2;
         }
     }
+  second_derivatives.finalize();
 }
 
 void
 ModelTree::computeThirdDerivatives(const set<int> &vars)
 {
+  Profiler::Phase phase("third order derivatives");
+
+  if (nthreads > 1)
+    {
+      computeDerivativesInParallel(3, vars);
+      return;
+    }
+
   for (const auto &it : second_derivatives)
     {
       int eq, var1, var2;
@@ -1097,7 +1327,7 @@ ModelTree::computeThirdDerivatives(const set<int> &vars)
           expr_t d3 = d2->getDerivative(var3);
           if (d3 == Zero)
             continue;
-          third_derivatives[{ eq, var1, var2, var3 }] = d3;
+          third_derivatives.insert({ eq, var1, var2, var3 }, d3);
           if (var3 == var2 && var2 == var1)
             ++NNZDerivatives[2];
           else if (var3 == var2 || var2 == var1)
@@ -1106,11 +1336,124 @@ ModelTree::computeThirdDerivatives(const set<int> &vars)
             NNZDerivatives[2] += 6;
         }
     }
+  third_derivatives.finalize();
+}
+
+void
+ModelTree::computeDerivativesInParallel(int order, const set<int> &vars)
+{
+  if (order == 1)
+    {
+      derivation_workers.clear();
+      for (int i = 0; i < nthreads; i++)
+        derivation_workers.push_back(make_unique<DerivationWorker>(*this));
+      for (int eq = 0; eq < (int) equations.size(); eq++)
+        derivation_workers[eq % nthreads]->equations.push_back(eq);
+    }
+  assert((int) derivation_workers.size() == nthreads);
+
+  vector<thread> threads;
+  for (auto &worker : derivation_workers)
+    threads.emplace_back([&, w = worker.get()]
+                         {
+                           try
+                             {
+                               w->computeDerivatives(order, vars, *this);
+                             }
+                           catch (...)
+                             {
+                               w->error = current_exception();
+                             }
+                         });
+  for (auto &t : threads)
+    t.join();
+
+  for (auto &worker : derivation_workers)
+    if (worker->error)
+      rethrow_exception(worker->error);
+
+  /* Recreate the nodes created by the workers in this datatree, in the order
+     in which the sequential algorithm computes the derivatives. Within the
+     computation of a derivative, a worker creates the same nodes, in the same
+     order, as the sequential algorithm, except those that the sequential
+     algorithm has already created for another derivative (in which case they
+     have been recreated here when replaying that other derivative). Hence the
+     nodes of this datatree, and their indices, are those of the sequential
+     algorithm, and so is the output. */
+  vector<pair<DerivationWorker *, const DerivationWorker::Segment *>> segments;
+  for (auto &worker : derivation_workers)
+    for (const auto &segment : worker->segments)
+      segments.emplace_back(worker.get(), &segment);
+  sort(segments.begin(), segments.end(),
+       [](const pair<DerivationWorker *, const DerivationWorker::Segment *> &a,
+          const pair<DerivationWorker *, const DerivationWorker::Segment *> &b)
+       {
+         return a.second->key < b.second->key;
+       });
+  for (const auto &it : segments)
+    for (int i = it.second->first_node; i < it.second->last_node; i++)
+      it.first->tree.getNodeByIndex(i)->cloneDynamic(*this, it.first->import_cache);
+
+  // The derivatives themselves are now found in this datatree
+  for (auto &worker : derivation_workers)
+    {
+      DerivationWorker &w = *worker;
+      switch (order)
+        {
+        case 1:
+          for (const auto &it : w.first_derivatives)
+            {
+              first_derivatives.insert(it.first, it.second->cloneDynamic(*this, w.import_cache));
+              ++NNZDerivatives[0];
+            }
+          break;
+        case 2:
+          for (const auto &it : w.second_derivatives)
+            {
+              int var1, var2;
+              tie(ignore, var1, var2) = it.first;
+              second_derivatives.insert(it.first, it.second->cloneDynamic(*this, w.import_cache));
+              if (var2 == var1)
+                ++NNZDerivatives[1];
+              else
+                NNZDerivatives[1] += 2;
+            }
+          break;
+        case 3:
+          for (const auto &it : w.third_derivatives)
+            {
+              int var1, var2, var3;
+              tie(ignore, var1, var2, var3) = it.first;
+              third_derivatives.insert(it.first, it.second->cloneDynamic(*this, w.import_cache));
+              if (var3 == var2 && var2 == var1)
+                ++NNZDerivatives[2];
+              else if (var3 == var2 || var2 == var1)
+                NNZDerivatives[2] += 3;
+              else
+                NNZDerivatives[2] += 6;
+            }
+          break;
+        default:
+          cerr << "ModelTree::computeDerivativesInParallel: unsupported order " << order << endl;
+          exit(EXIT_FAILURE);
+        }
+    }
+  first_derivatives.finalize();
+  second_derivatives.finalize();
+  third_derivatives.finalize();
+}
+
+void
+ModelTree::freeDerivationWorkers()
+{
+  derivation_workers.clear();
 }
 
 void
 ModelTree::computeTemporaryTerms(bool is_matlab)
 {
+  Profiler::Phase phase("temporary terms");
+
   map<expr_t, pair<int, NodeTreeReference>> reference_count;
   temporary_terms.clear();
   temporary_terms_mlv.clear();
@@ -1509,6 +1852,14 @@ ModelTree::writeModelEquations(ostream &output, ExprNodeOutputType output_type)
 void
 ModelTree::writeModelEquations(ostream &output, ExprNodeOutputType output_type,
                                const temporary_terms_t &temporary_terms) const
+{
+  writeModelEquations(output, output_type, temporary_terms, temporary_terms_idxs);
+}
+
+void
+ModelTree::writeModelEquations(ostream &output, ExprNodeOutputType output_type,
+                               const temporary_terms_t &temporary_terms,
+                               const temporary_terms_idxs_t &tt_idxs) const
 {
   for (int eq = 0; eq < (int) equations.size(); eq++)
     {
@@ -1517,14 +1868,7 @@ ModelTree::writeModelEquations(ostream &output, ExprNodeOutputType output_type,
       expr_t rhs = eq_node->get_arg2();
 
       // Test if the right hand side of the equation is empty.
-      double vrhs = 1.0;
-      try
-        {
-          vrhs = rhs->eval(eval_context_t());
-        }
-      catch (ExprNode::EvalException &e)
-        {
-        }
+      double vrhs = rhs->isConstant() ? rhs->getConstantValue() : 1.0;
 
       if (vrhs != 0) // The right hand side of the equation is not empty ==> residual=lhs-rhs;
         if (isJuliaOutput(output_type))
@@ -1533,18 +1877,18 @@ ModelTree::writeModelEquations(ostream &output, ExprNodeOutputType output_type,
                    << eq + ARRAY_SUBSCRIPT_OFFSET(output_type)
                    << RIGHT_ARRAY_SUBSCRIPT(output_type)
                    << " = (";
-            lhs->writeOutput(output, output_type, temporary_terms, temporary_terms_idxs);
+            lhs->writeOutput(output, output_type, temporary_terms, tt_idxs);
             output << ") - (";
-            rhs->writeOutput(output, output_type, temporary_terms, temporary_terms_idxs);
+            rhs->writeOutput(output, output_type, temporary_terms, tt_idxs);
             output << ")" << endl;
           }
         else
           {
             output << "lhs = ";
-            lhs->writeOutput(output, output_type, temporary_terms, temporary_terms_idxs);
+            lhs->writeOutput(output, output_type, temporary_terms, tt_idxs);
             output << ";" << endl
                    << "rhs = ";
-            rhs->writeOutput(output, output_type, temporary_terms, temporary_terms_idxs);
+            rhs->writeOutput(output, output_type, temporary_terms, tt_idxs);
             output << ";" << endl
                    << "residual" << LEFT_ARRAY_SUBSCRIPT(output_type)
                    << eq + ARRAY_SUBSCRIPT_OFFSET(output_type)
@@ -1559,7 +1903,7 @@ ModelTree::writeModelEquations(ostream &output, ExprNodeOutputType output_type,
                  << eq + ARRAY_SUBSCRIPT_OFFSET(output_type)
                  << RIGHT_ARRAY_SUBSCRIPT(output_type)
                  << " = ";
-          lhs->writeOutput(output, output_type, temporary_terms, temporary_terms_idxs);
+          lhs->writeOutput(output, output_type, temporary_terms, tt_idxs);
           output << ";" << endl;
         }
     }
@@ -1576,14 +1920,7 @@ ModelTree::compileModelEquations(ostream &code_file, unsigned int &instruction_n
       FNUMEXPR_ fnumexpr(ModelEquation, eq);
       fnumexpr.write(code_file, instruction_number);
       // Test if the right hand side of the equation is empty.
-      double vrhs = 1.0;
-      try
-        {
-          vrhs = rhs->eval(eval_context_t());
-        }
-      catch (ExprNode::EvalException &e)
-        {
-        }
+      double vrhs = rhs->isConstant() ? rhs->getConstantValue() : 1.0;
 
       if (vrhs != 0) // The right hand side of the equation is not empty ==> residual=lhs-rhs;
         {
@@ -1605,6 +1942,28 @@ ModelTree::compileModelEquations(ostream &code_file, unsigned int &instruction_n
     }
 }
 
+void
+ModelTree::writeBytecodeFile(const string &filename, string code) const
+{
+  BytecodeOptimizer::Statistics stats;
+  if (optimize_bytecode && BytecodeOptimizer::optimize(code, stats))
+    {
+      Profiler::setCounter("bytecode instructions in " + filename + " before optimization", stats.instructions_before);
+      Profiler::setCounter("bytecode instructions in " + filename + " after optimization", stats.instructions_after);
+      Profiler::setCounter("temporary terms in " + filename + " before optimization", stats.temporary_terms_before);
+      Profiler::setCounter("temporary terms in " + filename + " after optimization", stats.temporary_terms_after);
+    }
+
+  ofstream code_file(filename, ios::out | ios::binary);
+  if (!code_file.is_open())
+    {
+      cerr << "Error : Can't open file \"" << filename << "\" for writing" << endl;
+      exit(EXIT_FAILURE);
+    }
+  code_file.write(code.data(), code.size());
+  code_file.close();
+}
+
 void
 ModelTree::Write_Inf_To_Bin_File(const string &filename,
                                  int &u_count_int, bool &file_open, bool is_two_boundaries, int block_mfs) const
@@ -1825,6 +2184,8 @@ ModelTree::sparseHelper(int order, ostream &output, int row_nb, int col_nb, Expr
 void
 ModelTree::computeParamsDerivatives(int paramsDerivsOrder)
 {
+  Profiler::Phase phase("parameter derivatives");
+
   if (!(paramsDerivsOrder == 1 || paramsDerivsOrder == 2))
     return;
   set<int> deriv_id_set;
@@ -1837,7 +2198,7 @@ ModelTree::computeParamsDerivatives(int paramsDerivsOrder)
           expr_t d1 = equations[eq]->getDerivative(param);
           if (d1 == Zero)
             continue;
-          residuals_params_derivatives[{ eq, param }] = d1;
+          residuals_params_derivatives.insert({ eq, param }, d1);
         }
 
       if (paramsDerivsOrder == 2)
@@ -1850,7 +2211,7 @@ ModelTree::computeParamsDerivatives(int paramsDerivsOrder)
             expr_t d2 = d1->getDerivative(param);
             if (d2 == Zero)
               continue;
-            residuals_params_second_derivatives[{ eq, param1, param }] = d2;
+            residuals_params_second_derivatives.insert({ eq, param1, param }, d2);
           }
 
       for (const auto &it : first_derivatives)
@@ -1862,7 +2223,7 @@ ModelTree::computeParamsDerivatives(int paramsDerivsOrder)
           expr_t d2 = d1->getDerivative(param);
           if (d2 == Zero)
             continue;
-          jacobian_params_derivatives[{ eq, var, param }] = d2;
+          jacobian_params_derivatives.insert({ eq, var, param }, d2);
         }
 
       if (paramsDerivsOrder == 2)
@@ -1876,7 +2237,7 @@ ModelTree::computeParamsDerivatives(int paramsDerivsOrder)
               expr_t d2 = d1->getDerivative(param);
               if (d2 == Zero)
                 continue;
-              jacobian_params_second_derivatives[{ eq, var, param1, param }] = d2;
+              jacobian_params_second_derivatives.insert({ eq, var, param1, param }, d2);
             }
 
           for (const auto &it : second_derivatives)
@@ -1888,15 +2249,23 @@ ModelTree::computeParamsDerivatives(int paramsDerivsOrder)
               expr_t d2 = d1->getDerivative(param);
               if (d2 == Zero)
                 continue;
-              hessian_params_derivatives[{ eq, var1, var2, param }] = d2;
+              hessian_params_derivatives.insert({ eq, var1, var2, param }, d2);
             }
         }
     }
+
+  residuals_params_derivatives.finalize();
+  residuals_params_second_derivatives.finalize();
+  jacobian_params_derivatives.finalize();
+  jacobian_params_second_derivatives.finalize();
+  hessian_params_derivatives.finalize();
 }
 
 void
 ModelTree::computeParamsDerivativesTemporaryTerms()
 {
+  Profiler::Phase phase("parameter derivatives temporary terms");
+
   map<expr_t, pair<int, NodeTreeReference >> reference_count;
   params_derivs_temporary_terms.clear();
   map<NodeTreeReference, temporary_terms_t> temp_terms_map;
@@ -1961,6 +2330,506 @@ ModelTree::computeParamsDerivativesTemporaryTerms()
     params_derivs_temporary_terms_idxs[tt] = idx++;
 }
 
+string
+ModelTree::computingPassCacheKey(const set<int> &vars, bool hessian, bool thirdDerivatives, int paramsDerivsOrder,
+                                 bool no_tmp_terms, bool is_matlab) const
+{
+  // The equations and model local variables are identified by their full serialization
+  vector<expr_t> roots(equations.begin(), equations.end());
+  for (const auto &it : local_variables_table)
+    roots.push_back(it.second);
+  ostringstream nodes;
+  if (!writeNodes(nodes, roots))
+    return "";
+
+  SHA256 sha;
+  sha.update(nodes.str());
+  ostringstream key;
+  key << equations.size();
+  for (auto equation : equations)
+    key << " " << equation->idx;
+  key << endl;
+  for (const auto &it : local_variables_table)
+    key << it.first << " " << it.second->idx << endl;
+  for (int symb_id = 0; symb_id <= symbol_table.maxID(); symb_id++)
+    key << symb_id << " " << symbol_table.getName(symb_id) << " "
+        << static_cast<int>(symbol_table.getType(symb_id)) << endl;
+  for (int var : vars)
+    key << var << " " << getSymbIDByDerivID(var) << " " << getLagByDerivID(var) << endl;
+  key << hessian << " " << thirdDerivatives << " " << paramsDerivsOrder << " " << no_tmp_terms
+      << " " << is_matlab
+    // The distribution of the equations among the derivation workers (0 and 1 both mean sequential)
+      << " " << max(nthreads, 1)
+    // The derivation code itself may change from one version of the preprocessor to the next
+      << " " << PACKAGE_VERSION << endl;
+  sha.update(key.str());
+  return sha.hexDigest();
+}
+
+void
+ModelTree::writeCacheKey(ostream &output, const pair<int, int> &key)
+{
+  output << key.first << " " << key.second;
+}
+
+void
+ModelTree::writeCacheKey(ostream &output, const tuple<int, int, int> &key)
+{
+  output << get<0>(key) << " " << get<1>(key) << " " << get<2>(key);
+}
+
+void
+ModelTree::writeCacheKey(ostream &output, const tuple<int, int, int, int> &key)
+{
+  output << get<0>(key) << " " << get<1>(key) << " " << get<2>(key) << " " << get<3>(key);
+}
+
+bool
+ModelTree::readCacheKey(istream &input, pair<int, int> &key)
+{
+  return static_cast<bool>(input >> key.first >> key.second);
+}
+
+bool
+ModelTree::readCacheKey(istream &input, tuple<int, int, int> &key)
+{
+  return static_cast<bool>(input >> get<0>(key) >> get<1>(key) >> get<2>(key));
+}
+
+bool
+ModelTree::readCacheKey(istream &input, tuple<int, int, int, int> &key)
+{
+  return static_cast<bool>(input >> get<0>(key) >> get<1>(key) >> get<2>(key) >> get<3>(key));
+}
+
+bool
+ModelTree::readCacheNode(istream &input, const vector<expr_t> &nodes, expr_t &node)
+{
+  int i;
+  if (!(input >> i) || i < 0 || i >= static_cast<int>(nodes.size()) || !nodes[i])
+    return false;
+  node = nodes[i];
+  return true;
+}
+
+template<typename Key>
+void
+ModelTree::writeCacheTensor(ostream &output, const SparseTensor<Key, expr_t> &tensor)
+{
+  output << tensor.size() << endl;
+  for (const auto &it : tensor)
+    {
+      writeCacheKey(output, it.first);
+      output << " " << it.second->idx << endl;
+    }
+}
+
+template<typename Key>
+bool
+ModelTree::readCacheTensor(istream &input, const vector<expr_t> &nodes, SparseTensor<Key, expr_t> &tensor)
+{
+  size_t size;
+  if (!(input >> size))
+    return false;
+  tensor.clear();
+  for (size_t i = 0; i < size; i++)
+    {
+      Key key;
+      expr_t d;
+      if (!readCacheKey(input, key) || !readCacheNode(input, nodes, d))
+        return false;
+      tensor.insert(key, d);
+    }
+  tensor.finalize();
+  return true;
+}
+
+void
+ModelTree::writeCacheNodeSet(ostream &output, const temporary_terms_t &tt)
+{
+  output << tt.size();
+  for (auto it : tt)
+    output << " " << it->idx;
+  output << endl;
+}
+
+bool
+ModelTree::readCacheNodeSet(istream &input, const vector<expr_t> &nodes, temporary_terms_t &tt)
+{
+  size_t size;
+  if (!(input >> size))
+    return false;
+  tt.clear();
+  for (size_t i = 0; i < size; i++)
+    {
+      expr_t node;
+      if (!readCacheNode(input, nodes, node))
+        return false;
+      tt.insert(tt.end(), node);
+    }
+  return true;
+}
+
+void
+ModelTree::writeCacheIdxs(ostream &output, const temporary_terms_idxs_t &tt_idxs)
+{
+  output << tt_idxs.size() << endl;
+  for (const auto &it : tt_idxs)
+    output << it.first->idx << " " << it.second << endl;
+}
+
+bool
+ModelTree::readCacheIdxs(istream &input, const vector<expr_t> &nodes, temporary_terms_idxs_t &tt_idxs)
+{
+  size_t size;
+  if (!(input >> size))
+    return false;
+  tt_idxs.clear();
+  for (size_t i = 0; i < size; i++)
+    {
+      expr_t node;
+      int idx;
+      if (!readCacheNode(input, nodes, node) || !(input >> idx))
+        return false;
+      tt_idxs[node] = idx;
+    }
+  return true;
+}
+
+void
+ModelTree::writeComputingPassCache(const string &key) const
+{
+  Profiler::Phase phase("computing pass cache write");
+
+  // All the nodes referenced below (the temporary terms are subexpressions of the equations and derivatives)
+  vector<expr_t> roots(equations.begin(), equations.end());
+  for (const auto &it : temporary_terms_mlv)
+    {
+      roots.push_back(it.first);
+      roots.push_back(it.second);
+    }
+  for (const auto &it : first_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : second_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : third_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : residuals_params_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : residuals_params_second_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : jacobian_params_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : jacobian_params_second_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : hessian_params_derivatives)
+    roots.push_back(it.second);
+
+  ostringstream output;
+  output << "dynare_computing_pass_cache " << key << endl;
+  if (!writeNodes(output, roots))
+    return;
+
+  output << equations.size();
+  for (auto equation : equations)
+    output << " " << equation->idx;
+  output << endl
+         << NNZDerivatives[0] << " " << NNZDerivatives[1] << " " << NNZDerivatives[2] << endl;
+
+  writeCacheTensor(output, first_derivatives);
+  writeCacheTensor(output, second_derivatives);
+  writeCacheTensor(output, third_derivatives);
+  writeCacheTensor(output, residuals_params_derivatives);
+  writeCacheTensor(output, residuals_params_second_derivatives);
+  writeCacheTensor(output, jacobian_params_derivatives);
+  writeCacheTensor(output, jacobian_params_second_derivatives);
+  writeCacheTensor(output, hessian_params_derivatives);
+
+  writeCacheNodeSet(output, temporary_terms);
+  output << temporary_terms_mlv.size() << endl;
+  for (const auto &it : temporary_terms_mlv)
+    output << it.first->idx << " " << it.second->idx << endl;
+  writeCacheNodeSet(output, temporary_terms_res);
+  writeCacheNodeSet(output, temporary_terms_g1);
+  writeCacheNodeSet(output, temporary_terms_g2);
+  writeCacheNodeSet(output, temporary_terms_g3);
+  writeCacheIdxs(output, temporary_terms_idxs);
+
+  writeCacheNodeSet(output, params_derivs_temporary_terms);
+  writeCacheNodeSet(output, params_derivs_temporary_terms_res);
+  writeCacheNodeSet(output, params_derivs_temporary_terms_g1);
+  writeCacheNodeSet(output, params_derivs_temporary_terms_res2);
+  writeCacheNodeSet(output, params_derivs_temporary_terms_g12);
+  writeCacheNodeSet(output, params_derivs_temporary_terms_g2);
+  writeCacheIdxs(output, params_derivs_temporary_terms_idxs);
+
+  ofstream cache_file(computing_pass_cache, ios::out | ios::binary);
+  if (!cache_file.is_open())
+    {
+      cerr << "ERROR: Can't open file " << computing_pass_cache << " for writing" << endl;
+      exit(EXIT_FAILURE);
+    }
+  cache_file << output.str();
+  cache_file.close();
+}
+
+bool
+ModelTree::readComputingPassCache(const string &key)
+{
+  Profiler::Phase phase("computing pass cache read");
+
+  if (key.empty())
+    return false;
+  ifstream input(computing_pass_cache, ios::in | ios::binary);
+  if (!input.is_open())
+    return false;
+
+  string header, cache_key;
+  if (!(input >> header >> cache_key) || header != "dynare_computing_pass_cache" || cache_key != key)
+    return false;
+
+  // The nodes created from a cache which turns out not to match are removed
+  int nb_nodes = getNodeCount();
+  vector<expr_t> nodes;
+  bool ok = readNodes(input, nodes);
+
+  /* Hash-consing guarantees that the equations are recreated as the same
+     nodes, unless the file has been altered */
+  size_t nb_equations = 0;
+  ok = ok && (input >> nb_equations) && nb_equations == equations.size();
+  for (size_t eq = 0; ok && eq < nb_equations; eq++)
+    {
+      expr_t node;
+      ok = readCacheNode(input, nodes, node) && node == equations[eq];
+    }
+
+  ok = ok && (input >> NNZDerivatives[0] >> NNZDerivatives[1] >> NNZDerivatives[2])
+    && readCacheTensor(input, nodes, first_derivatives)
+    && readCacheTensor(input, nodes, second_derivatives)
+    && readCacheTensor(input, nodes, third_derivatives)
+    && readCacheTensor(input, nodes, residuals_params_derivatives)
+    && readCacheTensor(input, nodes, residuals_params_second_derivatives)
+    && readCacheTensor(input, nodes, jacobian_params_derivatives)
+    && readCacheTensor(input, nodes, jacobian_params_second_derivatives)
+    && readCacheTensor(input, nodes, hessian_params_derivatives)
+    && readCacheNodeSet(input, nodes, temporary_terms);
+
+  size_t nb_mlv = 0;
+  ok = ok && (input >> nb_mlv);
+  temporary_terms_mlv.clear();
+  for (size_t i = 0; ok && i < nb_mlv; i++)
+    {
+      expr_t mlv, value;
+      ok = readCacheNode(input, nodes, mlv) && readCacheNode(input, nodes, value);
+      if (ok)
+        temporary_terms_mlv[mlv] = value;
+    }
+
+  ok = ok && readCacheNodeSet(input, nodes, temporary_terms_res)
+    && readCacheNodeSet(input, nodes, temporary_terms_g1)
+    && readCacheNodeSet(input, nodes, temporary_terms_g2)
+    && readCacheNodeSet(input, nodes, temporary_terms_g3)
+    && readCacheIdxs(input, nodes, temporary_terms_idxs)
+    && readCacheNodeSet(input, nodes, params_derivs_temporary_terms)
+    && readCacheNodeSet(input, nodes, params_derivs_temporary_terms_res)
+    && readCacheNodeSet(input, nodes, params_derivs_temporary_terms_g1)
+    && readCacheNodeSet(input, nodes, params_derivs_temporary_terms_res2)
+    && readCacheNodeSet(input, nodes, params_derivs_temporary_terms_g12)
+    && readCacheNodeSet(input, nodes, params_derivs_temporary_terms_g2)
+    && readCacheIdxs(input, nodes, params_derivs_temporary_terms_idxs);
+
+  if (!ok)
+    {
+      cerr << "WARNING: ignoring the content of " << computing_pass_cache
+           << ", which does not match the model" << endl;
+      NNZDerivatives[0] = NNZDerivatives[1] = NNZDerivatives[2] = 0;
+      first_derivatives.clear();
+      second_derivatives.clear();
+      third_derivatives.clear();
+      residuals_params_derivatives.clear();
+      residuals_params_second_derivatives.clear();
+      jacobian_params_derivatives.clear();
+      jacobian_params_second_derivatives.clear();
+      hessian_params_derivatives.clear();
+      temporary_terms.clear();
+      temporary_terms_mlv.clear();
+      temporary_terms_res.clear();
+      temporary_terms_g1.clear();
+      temporary_terms_g2.clear();
+      temporary_terms_g3.clear();
+      temporary_terms_idxs.clear();
+      params_derivs_temporary_terms.clear();
+      params_derivs_temporary_terms_res.clear();
+      params_derivs_temporary_terms_g1.clear();
+      params_derivs_temporary_terms_res2.clear();
+      params_derivs_temporary_terms_g12.clear();
+      params_derivs_temporary_terms_g2.clear();
+      params_derivs_temporary_terms_idxs.clear();
+      removeNodesFrom(nb_nodes);
+    }
+  return ok;
+}
+
+void
+ModelTree::appendBinaryKey(vector<int32_t> &indices, const pair<int, int> &key)
+{
+  indices.push_back(key.first);
+  indices.push_back(key.second);
+}
+
+void
+ModelTree::appendBinaryKey(vector<int32_t> &indices, const tuple<int, int, int> &key)
+{
+  indices.push_back(get<0>(key));
+  indices.push_back(get<1>(key));
+  indices.push_back(get<2>(key));
+}
+
+void
+ModelTree::appendBinaryKey(vector<int32_t> &indices, const tuple<int, int, int, int> &key)
+{
+  indices.push_back(get<0>(key));
+  indices.push_back(get<1>(key));
+  indices.push_back(get<2>(key));
+  indices.push_back(get<3>(key));
+}
+
+template<typename Key>
+void
+ModelTree::flattenBinaryTensor(const SparseTensor<Key, expr_t> &tensor, const string &columns, const function<int(int)> &var_col,
+                               const vector<int> &index, vector<int32_t> &indices, vector<int32_t> &values) const
+{
+  indices.reserve(tensor.size() * columns.size());
+  values.reserve(tensor.size());
+  for (const auto &it : tensor)
+    {
+      size_t start = indices.size();
+      appendBinaryKey(indices, it.first);
+      // The equation number is kept as is, the derivation IDs are replaced by columns
+      for (size_t k = 1; k < columns.size(); k++)
+        if (columns[k] == 'v')
+          indices[start + k] = var_col(indices[start + k]);
+        else
+          indices[start + k] = symbol_table.getTypeSpecificID(getSymbIDByDerivID(indices[start + k]));
+      values.push_back(index[it.second->idx]);
+    }
+}
+
+bool
+ModelTree::writeBinaryDerivativesHelper(const string &filename, const function<int(int)> &var_col, int nb_var_cols) const
+{
+  // Model local variables appearing in the equations (see writeJsonModelLocalVariables())
+  set<int> used_local_vars;
+  for (auto equation : equations)
+    equation->collectVariables(SymbolType::modelLocalVariable, used_local_vars);
+
+  vector<expr_t> roots(equations.begin(), equations.end());
+  for (int it : local_variables_vector)
+    if (used_local_vars.find(it) != used_local_vars.end())
+      roots.push_back(local_variables_table.find(it)->second);
+  for (const auto &it : first_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : second_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : third_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : residuals_params_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : jacobian_params_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : residuals_params_second_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : jacobian_params_second_derivatives)
+    roots.push_back(it.second);
+  for (const auto &it : hessian_params_derivatives)
+    roots.push_back(it.second);
+
+  vector<BinaryDerivatives::Node> nodes;
+  vector<int> index;
+  if (!flattenNodes(roots, nodes, index))
+    return false;
+
+  vector<int32_t> eqs;
+  for (auto equation : equations)
+    eqs.push_back(index[equation->idx]);
+
+  vector<int32_t> local_vars;
+  for (int it : local_variables_vector)
+    if (used_local_vars.find(it) != used_local_vars.end())
+      {
+        local_vars.push_back(it);
+        local_vars.push_back(index[local_variables_table.find(it)->second->idx]);
+      }
+
+  // In the order of BinaryDerivatives::Tensor
+  vector<int32_t> indices[BinaryDerivatives::nb_tensors], values[BinaryDerivatives::nb_tensors];
+  flattenBinaryTensor(first_derivatives, "ev", var_col, index, indices[0], values[0]);
+  flattenBinaryTensor(second_derivatives, "evv", var_col, index, indices[1], values[1]);
+  flattenBinaryTensor(third_derivatives, "evvv", var_col, index, indices[2], values[2]);
+  flattenBinaryTensor(residuals_params_derivatives, "ep", var_col, index, indices[3], values[3]);
+  flattenBinaryTensor(jacobian_params_derivatives, "evp", var_col, index, indices[4], values[4]);
+  flattenBinaryTensor(residuals_params_second_derivatives, "epp", var_col, index, indices[5], values[5]);
+  flattenBinaryTensor(jacobian_params_second_derivatives, "evpp", var_col, index, indices[6], values[6]);
+  flattenBinaryTensor(hessian_params_derivatives, "evvp", var_col, index, indices[7], values[7]);
+
+  BinaryDerivatives::Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BinaryDerivatives::magic, sizeof(header.magic));
+  header.version = BinaryDerivatives::version;
+  header.nb_equations = equations.size();
+  header.nb_var_cols = nb_var_cols;
+  header.nb_params = symbol_table.param_nbr();
+
+  // Sections are laid out after the header, in the order in which they are added
+  vector<pair<const char *, int64_t>> contents;
+  int64_t offset = BinaryDerivatives::align(sizeof(header));
+  auto add_section = [&](BinaryDerivatives::Section &section, const void *data, size_t size, size_t element_size)
+                     {
+                       section.offset = offset;
+                       section.size = size;
+                       contents.emplace_back(static_cast<const char *>(data), size * element_size);
+                       offset = BinaryDerivatives::align(offset + size * element_size);
+                     };
+  add_section(header.nodes, nodes.data(), nodes.size(), sizeof(BinaryDerivatives::Node));
+  add_section(header.equations, eqs.data(), eqs.size(), sizeof(int32_t));
+  add_section(header.local_variables, local_vars.data(), local_vars.size() / 2, 2 * sizeof(int32_t));
+  for (int i = 0; i < BinaryDerivatives::nb_tensors; i++)
+    {
+      size_t rank = BinaryDerivatives::tensorRank(static_cast<BinaryDerivatives::Tensor>(i));
+      add_section(header.tensor_indices[i], indices[i].data(), values[i].size(), rank * sizeof(int32_t));
+      add_section(header.tensor_values[i], values[i].data(), values[i].size(), sizeof(int32_t));
+    }
+
+  ofstream output(filename, ios::out | ios::binary);
+  if (!output.is_open())
+    {
+      cerr << "ERROR: Can't open file " << filename << " for writing" << endl;
+      exit(EXIT_FAILURE);
+    }
+  const char padding[8] = { 0 };
+  output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  int64_t written = sizeof(header);
+  for (const auto &it : contents)
+    {
+      output.write(padding, BinaryDerivatives::align(written) - written);
+      output.write(it.first, it.second);
+      written = BinaryDerivatives::align(written) + it.second;
+    }
+  output.write(padding, BinaryDerivatives::align(written) - written);
+  output.close();
+  return true;
+}
+
+bool
+ModelTree::hasParamsDerivatives() const
+{
+  return residuals_params_derivatives.size()
+    || residuals_params_second_derivatives.size()
+    || jacobian_params_derivatives.size()
+    || jacobian_params_second_derivatives.size()
+    || hessian_params_derivatives.size();
+}
+
 bool
 ModelTree::isNonstationary(int symb_id) const
 {
@@ -1996,18 +2865,12 @@ ModelTree::writeJsonModelEquations(ostream &output, bool residuals) const
           output << ", \"rhs\": \"";
           rhs->writeJsonOutput(output, temporary_terms, {});
           output << "\"";
-          try
-            {
-              // Test if the right hand side of the equation is empty.
-              if (rhs->eval(eval_context_t()) != 0)
-                {
-                  output << ", \"rhs\": \"";
-                  rhs->writeJsonOutput(output, temporary_terms, {});
-                  output << "\"";
-                }
-            }
-          catch (ExprNode::EvalException &e)
+          // Test if the right hand side of the equation is empty.
+          if (rhs->isConstant() && rhs->getConstantValue() != 0)
             {
+              output << ", \"rhs\": \"";
+              rhs->writeJsonOutput(output, temporary_terms, {});
+              output << "\"";
             }
           output << "}";
         }
@@ -27,9 +27,13 @@ using namespace std;
 #include <deque>
 #include <map>
 #include <ostream>
+#include <memory>
+#include <functional>
+#include <cstdint>
 
 #include "DataTree.hh"
 #include "ExtendedPreprocessorTypes.hh"
+#include "SparseTensor.hh"
 
 //! Vector describing equations: BlockSimulationType, if BlockSimulationType == EVALUATE_s then a expr_t on the new normalized equation
 using equation_type_and_normalized_equation_t = vector<pair<EquationType, expr_t >>;
@@ -76,7 +80,7 @@ protected:
   //! Number of non-zero derivatives
   int NNZDerivatives[3];
 
-  using first_derivatives_t = map<pair<int, int>, expr_t>;
+  using first_derivatives_t = SparseTensor<pair<int, int>, expr_t>;
   //! First order derivatives
   /*! First index is equation number, second is variable w.r. to which is computed the derivative.
     Only non-null derivatives are stored in the map.
@@ -84,7 +88,7 @@ protected:
   */
   first_derivatives_t first_derivatives;
 
-  using second_derivatives_t = map<tuple<int, int, int>, expr_t>;
+  using second_derivatives_t = SparseTensor<tuple<int, int, int>, expr_t>;
   //! Second order derivatives
   /*! First index is equation number, second and third are variables w.r. to which is computed the derivative.
     Only non-null derivatives are stored in the map.
@@ -93,7 +97,7 @@ protected:
   */
   second_derivatives_t second_derivatives;
 
-  using third_derivatives_t = map<tuple<int, int, int, int>, expr_t>;
+  using third_derivatives_t = SparseTensor<tuple<int, int, int, int>, expr_t>;
   //! Third order derivatives
   /*! First index is equation number, second, third and fourth are variables w.r. to which is computed the derivative.
     Only non-null derivatives are stored in the map.
@@ -172,6 +176,11 @@ protected:
   //! the file containing the model and the derivatives code
   ofstream code_file;
 
+  class DerivationWorker;
+  //! Worker datatrees used when computing derivatives in parallel (see computeDerivativesInParallel())
+  /*! They are created by computeJacobian() and kept until the end of the computing pass, since higher order derivatives are computed from the lower order ones stored in each worker */
+  vector<unique_ptr<DerivationWorker>> derivation_workers;
+
   //! Computes 1st derivatives
   /*! \param vars the derivation IDs w.r. to which compute the derivatives */
   void computeJacobian(const set<int> &vars);
@@ -181,6 +190,13 @@ protected:
   //! Computes 3rd derivatives
   /*! \param vars the derivation IDs w.r. to which derive the 2nd derivatives */
   void computeThirdDerivatives(const set<int> &vars);
+  //! Computes derivatives of the given order (1 to 3) using nthreads worker threads
+  /*! Each equation is assigned to a worker, which computes its derivatives in a private datatree.
+    The nodes created by the workers are then recreated in this datatree in the order of the
+    sequential algorithm, so that the output is identical to that of the sequential algorithm */
+  void computeDerivativesInParallel(int order, const set<int> &vars);
+  //! Frees the worker datatrees used by computeDerivativesInParallel()
+  void freeDerivationWorkers();
   //! Computes derivatives of the Jacobian and Hessian w.r. to parameters
   void computeParamsDerivatives(int paramsDerivsOrder);
   //! Write derivative of an equation w.r. to a variable
@@ -189,11 +205,57 @@ protected:
   void computeTemporaryTerms(bool is_matlab);
   //! Computes temporary terms for the file containing parameters derivatives
   void computeParamsDerivativesTemporaryTerms();
+  //! Computes the key under which the results of the computing pass are stored in computing_pass_cache
+  /*! It is a SHA-256 digest of everything on which the cached results depend: the serialization of the
+    equations and of the model local variables (see DataTree::writeNodes()), the symbol table, the
+    derivation IDs w.r. to which the model is derived (which reflect whether exogenous variables are
+    included), the other arguments, which describe which derivatives and temporary terms are computed,
+    the number of threads used for the derivation, and the version of the preprocessor.
+    Returns an empty string if the equations cannot be serialized, in which case nothing is cached */
+  string computingPassCacheKey(const set<int> &vars, bool hessian, bool thirdDerivatives, int paramsDerivsOrder,
+                               bool no_tmp_terms, bool is_matlab) const;
+  //! Restores the derivatives and temporary terms from computing_pass_cache
+  /*! Returns false if the cache file does not exist, or was written for another key. If the file
+    is malformed, a warning is issued, and the nodes created while reading it are removed */
+  bool readComputingPassCache(const string &key);
+  //! Stores the derivatives and temporary terms in computing_pass_cache
+  /*! Nothing is written if the derivatives contain nodes which cannot be stored (see DataTree::writeNodes()) */
+  void writeComputingPassCache(const string &key) const;
+  //! Helpers for reading and writing computing_pass_cache, where nodes are designated by their index
+  static void writeCacheKey(ostream &output, const pair<int, int> &key);
+  static void writeCacheKey(ostream &output, const tuple<int, int, int> &key);
+  static void writeCacheKey(ostream &output, const tuple<int, int, int, int> &key);
+  static bool readCacheKey(istream &input, pair<int, int> &key);
+  static bool readCacheKey(istream &input, tuple<int, int, int> &key);
+  static bool readCacheKey(istream &input, tuple<int, int, int, int> &key);
+  static bool readCacheNode(istream &input, const vector<expr_t> &nodes, expr_t &node);
+  template<typename Key>
+  static void writeCacheTensor(ostream &output, const SparseTensor<Key, expr_t> &tensor);
+  template<typename Key>
+  static bool readCacheTensor(istream &input, const vector<expr_t> &nodes, SparseTensor<Key, expr_t> &tensor);
+  static void writeCacheNodeSet(ostream &output, const temporary_terms_t &tt);
+  static bool readCacheNodeSet(istream &input, const vector<expr_t> &nodes, temporary_terms_t &tt);
+  static void writeCacheIdxs(ostream &output, const temporary_terms_idxs_t &tt_idxs);
+  static bool readCacheIdxs(istream &input, const vector<expr_t> &nodes, temporary_terms_idxs_t &tt_idxs);
+  //! Writes the equations and derivatives in the format described in BinaryDerivatives.hh
+  /*! var_col gives the column of the Jacobian of a derivation ID, and nb_var_cols the number of columns.
+    Returns false, without writing anything, if the model contains nodes which cannot be stored (see DataTree::flattenNodes()) */
+  bool writeBinaryDerivativesHelper(const string &filename, const function<int(int)> &var_col, int nb_var_cols) const;
+  //! Helpers for writeBinaryDerivativesHelper(), appending the indices of an element of a tensor
+  static void appendBinaryKey(vector<int32_t> &indices, const pair<int, int> &key);
+  static void appendBinaryKey(vector<int32_t> &indices, const tuple<int, int, int> &key);
+  static void appendBinaryKey(vector<int32_t> &indices, const tuple<int, int, int, int> &key);
+  //! Appends the indices and values of a tensor, where columns tells whether each index is an equation ('e'), a variable ('v') or a parameter ('p')
+  template<typename Key>
+  void flattenBinaryTensor(const SparseTensor<Key, expr_t> &tensor, const string &columns, const function<int(int)> &var_col,
+                           const vector<int> &index, vector<int32_t> &indices, vector<int32_t> &values) const;
   //! Writes temporary terms
   void writeTemporaryTerms(const temporary_terms_t &tt, const temporary_terms_t &ttm1, const temporary_terms_idxs_t &tt_idxs, ostream &output, ExprNodeOutputType output_type, deriv_node_temp_terms_t &tef_terms) const;
   void writeJsonTemporaryTerms(const temporary_terms_t &tt, const temporary_terms_t &ttm1, ostream &output, deriv_node_temp_terms_t &tef_terms, string &concat) const;
   //! Compiles temporary terms
   void compileTemporaryTerms(ostream &code_file, unsigned int &instruction_number, const temporary_terms_t &tt, map_idx_t map_idx, bool dynamic, bool steady_dynamic) const;
+  //! Writes a bytecode file, after having optimized its code if optimize_bytecode is true (see BytecodeOptimizer)
+  void writeBytecodeFile(const string &filename, string code) const;
   //! Adds informations for simulation in a binary file
   void Write_Inf_To_Bin_File(const string &filename, int &u_count_int, bool &file_open, bool is_two_boundaries, int block_mfs) const;
   //! Fixes output when there are more than 32 nested parens, Issue #1201
@@ -207,6 +269,9 @@ protected:
   void writeModelEquations(ostream &output, ExprNodeOutputType output_type) const;
   void writeModelEquations(ostream &output, ExprNodeOutputType output_type,
                            const temporary_terms_t &temporary_terms) const;
+  void writeModelEquations(ostream &output, ExprNodeOutputType output_type,
+                           const temporary_terms_t &temporary_terms,
+                           const temporary_terms_idxs_t &tt_idxs) const;
   //! Writes JSON model equations
   //! if residuals = true, we are writing the dynamic/static model.
   //! Otherwise, just the model equations (with line numbers, no tmp terms)
@@ -326,6 +391,7 @@ public:
             ExternalFunctionsTable &external_functions_table_arg,
             TrendComponentModelTable &trend_component_model_table_arg,
             VarModelTable &var_model_table_arg);
+  ~ModelTree() override;
   //! Absolute value under which a number is considered to be zero
   double cutoff;
   //! Compute the minimum feedback set
@@ -335,6 +401,15 @@ public:
     3 : the variables belonging to a non normalizable non linear equation are considered as feedback variables
     default value = 0 */
   int mfs;
+  //! Number of threads used for computing the derivatives
+  /*! 0 or 1 means that the derivatives are computed sequentially, directly in the model datatree */
+  int nthreads;
+  //! File in which the results of the computing pass are cached from one run to the next
+  /*! Empty if the cache is disabled. Only the derivatives and the temporary terms of the
+    non-block case are cached (see computingPassCacheKey()) */
+  string computing_pass_cache;
+  //! Whether the code of the .cod files is optimized (see BytecodeOptimizer); true by default
+  bool optimize_bytecode;
   //! Declare a node as an equation of the model; also give its line number
   void addEquation(expr_t eq, int lineno);
   //! Declare a node as an equation of the model, also giving its tags
@@ -350,6 +425,8 @@ public:
   //! Is a given variable non-stationary?
   bool isNonstationary(int symb_id) const;
   void set_cutoff_to_zero();
+  //! Whether some derivatives w.r. to parameters have been computed
+  bool hasParamsDerivatives() const;
   //! Helper for writing the Jacobian elements in MATLAB and C
   /*! Writes either (i+1,j+1) or [i+j*no_eq] */
   void jacobianHelper(ostream &output, int eq_nb, int col_nb, ExprNodeOutputType output_type) const;
@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _NODE_ARENA_HH
+#define _NODE_ARENA_HH
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+using namespace std;
+
+//! Bump allocator for the nodes of a DataTree
+/*! Memory is taken from large chunks, and is only given back when the arena is
+  destroyed. The arena does not call destructors: this is the job of its owner. */
+class NodeArena
+{
+private:
+  //! Size of a chunk (larger requests get their own chunk)
+  static const size_t chunk_size{64*1024};
+  vector<unique_ptr<char[]>> chunks;
+  //! Free space in the current chunk
+  char *free_ptr{nullptr};
+  size_t free_size{0};
+public:
+  //! Returns uninitialized memory for an object of the given size and alignment
+  void *
+  allocate(size_t size, size_t alignment)
+  {
+    size_t padding = (alignment - reinterpret_cast<uintptr_t>(free_ptr) % alignment) % alignment;
+    if (padding + size > free_size)
+      {
+        // Memory returned by new[] is suitably aligned for any fundamental type
+        size_t new_size = max(size, chunk_size);
+        chunks.emplace_back(new char[new_size]);
+        free_ptr = chunks.back().get();
+        free_size = new_size;
+        padding = 0;
+      }
+    void *p = free_ptr + padding;
+    free_ptr += padding + size;
+    free_size -= padding + size;
+    return p;
+  }
+};
+
+#endif
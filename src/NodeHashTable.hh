@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _NODE_HASH_TABLE_HH
+#define _NODE_HASH_TABLE_HH
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+//! Hash table used for sharing nodes in a DataTree (hash-consing)
+/*! Nodes are indexed by their structural hash (see ExprNode::getStructuralHash()).
+  The table uses open addressing with linear probing, and only stores the hash and
+  a pointer to the node in each slot: the key of a node is made of its own fields, and
+  is compared by the predicate given to find().
+  Nodes are never removed individually: the table can only be cleared, or purged
+  of a set of nodes with eraseIf(). */
+template<typename T>
+class NodeHashTable
+{
+private:
+  struct Slot
+  {
+    size_t hash;
+    //! Null for an empty slot
+    T *node;
+  };
+  //! The number of slots is always a power of two
+  vector<Slot> slots;
+  //! Number of nodes stored in the table
+  size_t nb_nodes{0};
+  static const size_t initial_size{64};
+
+  //! Index of the first slot to probe for a given hash
+  /*! Structural hashes are combinations of small integers, so their bits are mixed
+    again before masking (using the finalizer of MurmurHash3) */
+  size_t
+  firstSlot(size_t hash) const
+  {
+    uint64_t h = hash;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h) & (slots.size() - 1);
+  }
+
+  //! Doubles the number of slots
+  void
+  grow()
+  {
+    vector<Slot> old_slots(slots.size() * 2, Slot{0, nullptr});
+    old_slots.swap(slots);
+    for (const auto &slot : old_slots)
+      if (slot.node)
+        insertInternal(slot.hash, slot.node);
+  }
+
+  void
+  insertInternal(size_t hash, T *node)
+  {
+    size_t mask = slots.size() - 1;
+    size_t i = firstSlot(hash);
+    while (slots[i].node)
+      i = (i + 1) & mask;
+    slots[i] = { hash, node };
+  }
+public:
+  NodeHashTable() : slots(initial_size, Slot{0, nullptr})
+  {
+  }
+
+  //! Returns the node with the given hash for which is_same(node) is true, or a null pointer
+  template<typename Predicate>
+  T *
+  find(size_t hash, Predicate is_same) const
+  {
+    size_t mask = slots.size() - 1;
+    for (size_t i = firstSlot(hash); slots[i].node; i = (i + 1) & mask)
+      if (slots[i].hash == hash && is_same(slots[i].node))
+        return slots[i].node;
+    return nullptr;
+  }
+
+  //! Adds a node to the table (which must not already contain an identical node)
+  void
+  insert(size_t hash, T *node)
+  {
+    // Keep the load factor under 1/2, so that probe sequences remain short
+    if (2 * (nb_nodes + 1) > slots.size())
+      grow();
+    insertInternal(hash, node);
+    nb_nodes++;
+  }
+
+  //! Removes the nodes for which pred(node) is true, by rebuilding the table
+  template<typename Predicate>
+  void
+  eraseIf(Predicate pred)
+  {
+    vector<Slot> old_slots(slots.size(), Slot{0, nullptr});
+    old_slots.swap(slots);
+    nb_nodes = 0;
+    for (const auto &slot : old_slots)
+      if (slot.node && !pred(slot.node))
+        {
+          insertInternal(slot.hash, slot.node);
+          nb_nodes++;
+        }
+  }
+
+  void
+  clear()
+  {
+    slots.assign(initial_size, Slot{0, nullptr});
+    nb_nodes = 0;
+  }
+
+  size_t
+  size() const
+  {
+    return nb_nodes;
+  }
+
+  //! Iterates over the nodes of the table (in no particular order)
+  class const_iterator
+  {
+  private:
+    typename vector<Slot>::const_iterator it, end;
+    void
+    skipEmpty()
+    {
+      while (it != end && !it->node)
+        ++it;
+    }
+  public:
+    const_iterator(typename vector<Slot>::const_iterator it_arg, typename vector<Slot>::const_iterator end_arg) :
+      it{it_arg}, end{end_arg}
+    {
+      skipEmpty();
+    }
+    T *
+    operator*() const
+    {
+      return it->node;
+    }
+    const_iterator &
+    operator++()
+    {
+      ++it;
+      skipEmpty();
+      return *this;
+    }
+    bool
+    operator!=(const const_iterator &other) const
+    {
+      return it != other.it;
+    }
+  };
+
+  const_iterator
+  begin() const
+  {
+    return const_iterator(slots.begin(), slots.end());
+  }
+
+  const_iterator
+  end() const
+  {
+    return const_iterator(slots.end(), slots.end());
+  }
+};
+
+#endif
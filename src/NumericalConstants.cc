@@ -22,6 +22,9 @@
 #include <cerrno>
 #include <cmath>
 #include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
 
 #include "NumericalConstants.hh"
 
@@ -49,6 +52,33 @@ NumericalConstants::AddNonNegativeConstant(const string &iConst)
   return id;
 }
 
+int
+NumericalConstants::AddNonNegativeConstant(double val)
+{
+  assert(val >= 0 || isnan(val)); // Check we have a positive constant or a NaN
+
+  uint64_t bin = toBinary(val);
+  auto iter = binaryIndex.find(bin);
+  if (iter != binaryIndex.end())
+    return iter->second;
+
+  ostringstream ost;
+  ost << setprecision(precision) << val;
+  int id = AddNonNegativeConstant(ost.str());
+  binaryIndex[bin] = id;
+
+  return id;
+}
+
+uint64_t
+NumericalConstants::toBinary(double val)
+{
+  static_assert(sizeof(double) == sizeof(uint64_t), "double is not 64-bit wide");
+  uint64_t bin;
+  memcpy(&bin, &val, sizeof(double));
+  return bin;
+}
+
 string
 NumericalConstants::get(int ID) const
 {
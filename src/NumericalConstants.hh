@@ -25,6 +25,8 @@ using namespace std;
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <cstdint>
 
 //! Handles non-negative numerical constants
 class NumericalConstants
@@ -36,9 +38,21 @@ private:
   vector<double> double_vals;
   //! Map matching constants to their id
   map<string, int> numConstantsIndex;
+  //! Number of significant digits of the string form of constants added in double form
+  const static int precision{16};
+  //! Map matching the binary representation of the constants added in double form to their id
+  /*! Memoizes the rounding to the string form, which is the key of the constant */
+  unordered_map<uint64_t, int> binaryIndex;
+  //! Returns the binary representation of a double
+  static uint64_t toBinary(double val);
 public:
   //! Adds a non-negative constant (possibly Inf or NaN) and returns its ID
   int AddNonNegativeConstant(const string &iConst);
+  //! Adds a non-negative constant (possibly Inf or NaN) in double form and returns its ID
+  /*! The constant is identified by its string form with 16 significant
+    digits, so that two values that only differ beyond that precision share
+    the same ID */
+  int AddNonNegativeConstant(double val);
   //! Get a constant in string form
   string get(int ID) const;
   //! Get a constant in double form
@@ -87,7 +87,7 @@ InitParamStatement::fillEvalContext(eval_context_t &eval_context) const
 {
   try
     {
-      eval_context[symb_id] = param_value->eval(eval_context);
+      eval_context.set(symb_id, param_value->eval(eval_context));
     }
   catch (ExprNode::EvalException &e)
     {
@@ -111,7 +111,7 @@ InitOrEndValStatement::fillEvalContext(eval_context_t &eval_context) const
     {
       try
         {
-          eval_context[init_value.first] = (init_value.second)->eval(eval_context);
+          eval_context.set(init_value.first, (init_value.second)->eval(eval_context));
         }
       catch (ExprNode::EvalException &e)
         {
@@ -633,5 +633,5 @@ void
 LoadParamsAndSteadyStateStatement::fillEvalContext(eval_context_t &eval_context) const
 {
   for (const auto & it : content)
-    eval_context[it.first] = stod(it.second);
+    eval_context.set(it.first, stod(it.second));
 }
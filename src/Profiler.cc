@@ -0,0 +1,247 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <cstdlib>
+
+#include <boost/filesystem.hpp>
+
+#if !defined(_WIN32) || defined(__CYGWIN32__)
+# include <sys/resource.h>
+#endif
+
+#include "Profiler.hh"
+
+bool Profiler::enabled{false};
+ProfileOutputType Profiler::output_type{ProfileOutputType::none};
+string Profiler::report_file;
+Profiler::PhaseNode Profiler::root{"total"};
+chrono::steady_clock::time_point Profiler::root_start{chrono::steady_clock::now()};
+thread_local Profiler::PhaseNode *Profiler::current{&Profiler::root};
+vector<pair<string, long>> Profiler::counters;
+mutex Profiler::profiler_mutex;
+
+Profiler::Phase::Phase(const string &name)
+{
+  if (!enabled)
+    return;
+
+  parent = current;
+  auto p = make_unique<PhaseNode>();
+  p->name = name;
+  node = p.get();
+  {
+    lock_guard<mutex> lock(profiler_mutex);
+    parent->subphases.push_back(move(p));
+  }
+  current = node;
+  start = chrono::steady_clock::now();
+}
+
+Profiler::Phase::~Phase()
+{
+  stop();
+}
+
+void
+Profiler::Phase::stop()
+{
+  if (!node)
+    return;
+
+  node->wall_time = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  node->peak_rss = getPeakRSS();
+  current = parent;
+  node = nullptr;
+}
+
+void
+Profiler::enable(ProfileOutputType output_type_arg, const string &basename)
+{
+  if (output_type_arg == ProfileOutputType::none || enabled)
+    return;
+
+  enabled = true;
+  output_type = output_type_arg;
+  report_file = basename + "/profile.json";
+  atexit(writeReportAtExit);
+}
+
+bool
+Profiler::isEnabled()
+{
+  return enabled;
+}
+
+Profiler::PhaseNode *
+Profiler::getCurrentPhase()
+{
+  return current;
+}
+
+void
+Profiler::setCurrentPhase(PhaseNode *phase)
+{
+  current = phase;
+}
+
+void
+Profiler::setCounter(const string &name, long value)
+{
+  if (!enabled)
+    return;
+
+  lock_guard<mutex> lock(profiler_mutex);
+  counters.emplace_back(name, value);
+}
+
+long
+Profiler::getPeakRSS()
+{
+#if !defined(_WIN32) || defined(__CYGWIN32__)
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+# ifdef __APPLE__
+  // Under macOS, the value is in bytes
+  return usage.ru_maxrss / 1024;
+# else
+  return usage.ru_maxrss;
+# endif
+#else
+  return 0;
+#endif
+}
+
+void
+Profiler::finalizeRoot()
+{
+  root.wall_time = chrono::duration<double>(chrono::steady_clock::now() - root_start).count();
+  root.peak_rss = getPeakRSS();
+}
+
+void
+Profiler::writePhase(ostream &output, const PhaseNode &phase, int depth)
+{
+  output << "  " << left << setw(50) << string(2*depth, ' ') + phase.name << right
+         << fixed << setprecision(3) << setw(10) << phase.wall_time << " s"
+         << setprecision(1) << setw(10) << phase.peak_rss / 1024.0 << " MB" << endl;
+  for (const auto &subphase : phase.subphases)
+    writePhase(output, *subphase, depth + 1);
+}
+
+void
+Profiler::writeReport(ostream &output)
+{
+  finalizeRoot();
+  ios_base::fmtflags flags = output.flags();
+  output << "Preprocessor profile (wall time, and peak memory usage at the end of each phase):" << endl;
+  writePhase(output, root, 0);
+  if (!counters.empty())
+    {
+      output << "Counters:" << endl;
+      for (const auto &it : counters)
+        output << "  " << left << setw(50) << it.first << right << setw(10) << it.second << endl;
+    }
+  output.flags(flags);
+}
+
+void
+Profiler::writeJsonPhase(ostream &output, const PhaseNode &phase)
+{
+  output << "{\"name\": ";
+  writeJsonString(output, phase.name);
+  output << ", \"wall_time\": " << phase.wall_time
+         << ", \"peak_rss_kb\": " << phase.peak_rss
+         << ", \"subphases\": [";
+  for (auto it = phase.subphases.begin(); it != phase.subphases.end(); ++it)
+    {
+      if (it != phase.subphases.begin())
+        output << ", ";
+      writeJsonPhase(output, **it);
+    }
+  output << "]}";
+}
+
+void
+Profiler::writeJsonString(ostream &output, const string &str)
+{
+  output << '"';
+  for (char c : str)
+    switch (c)
+      {
+      case '"':
+        output << "\\\"";
+        break;
+      case '\\':
+        output << "\\\\";
+        break;
+      case '\n':
+        output << "\\n";
+        break;
+      case '\t':
+        output << "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20)
+          output << "\\u" << hex << setw(4) << setfill('0') << static_cast<int>(c) << dec << setfill(' ');
+        else
+          output << c;
+      }
+  output << '"';
+}
+
+void
+Profiler::writeJsonReport(ostream &output)
+{
+  finalizeRoot();
+  output << "{\"profile\": ";
+  writeJsonPhase(output, root);
+  output << ", \"counters\": {";
+  for (auto it = counters.begin(); it != counters.end(); ++it)
+    {
+      if (it != counters.begin())
+        output << ", ";
+      writeJsonString(output, it->first);
+      output << ": " << it->second;
+    }
+  output << "}}" << endl;
+}
+
+void
+Profiler::writeReportAtExit()
+{
+  if (output_type == ProfileOutputType::text)
+    {
+      writeReport(cout);
+      return;
+    }
+
+  boost::filesystem::create_directories(boost::filesystem::path(report_file).parent_path());
+  ofstream output(report_file, ios::out | ios::binary);
+  if (!output.is_open())
+    {
+      cerr << "ERROR: Can't open file " << report_file << " for writing" << endl;
+      return;
+    }
+  writeJsonReport(output);
+  output.close();
+}
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _PROFILER_HH
+#define _PROFILER_HH
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <ostream>
+#include <chrono>
+#include <mutex>
+
+using namespace std;
+
+#include "ExtendedPreprocessorTypes.hh"
+
+//! Measures the wall time and the memory usage of the phases of the preprocessor (see the profile option)
+/*! Measures are only collected once enable() has been called; otherwise phases cost a single test.
+  The report is written when the preprocessor exits, so that it is also available when it stops early
+  (for example with the onlyjson option) */
+class Profiler
+{
+public:
+  //! A phase of the preprocessor, with its subphases
+  struct PhaseNode
+  {
+    string name{};
+    //! Wall time, in seconds
+    double wall_time{0};
+    //! Peak resident set size of the process at the end of the phase, in kilobytes
+    long peak_rss{0};
+    vector<unique_ptr<PhaseNode>> subphases{};
+  };
+
+  //! Measures a phase, from the construction of the object to its destruction
+  /*! A phase started while another one is running in the same thread is one of its subphases */
+  class Phase
+  {
+  private:
+    PhaseNode *node{nullptr}, *parent{nullptr};
+    chrono::steady_clock::time_point start;
+  public:
+    explicit Phase(const string &name);
+    ~Phase();
+    //! Ends the phase before the destruction of the object
+    void stop();
+    Phase(const Phase &) = delete;
+    Phase &operator=(const Phase &) = delete;
+  };
+
+  //! Enables the profiling; the report is written on exit, to the standard output or to <basename>/profile.json
+  static void enable(ProfileOutputType output_type, const string &basename);
+  static bool isEnabled();
+  //! Returns the phase in which the phases started by the current thread are nested
+  static PhaseNode *getCurrentPhase();
+  //! Nests the phases subsequently started by the current thread in the given one
+  /*! Used by threads working on behalf of another thread */
+  static void setCurrentPhase(PhaseNode *phase);
+  //! Records a counter (for example, the number of nodes of a datatree)
+  static void setCounter(const string &name, long value);
+  //! Writes a human-readable report
+  static void writeReport(ostream &output);
+  //! Writes the report in JSON
+  static void writeJsonReport(ostream &output);
+private:
+  static bool enabled;
+  static ProfileOutputType output_type;
+  static string report_file;
+  //! The whole run of the preprocessor
+  static PhaseNode root;
+  static chrono::steady_clock::time_point root_start;
+  static thread_local PhaseNode *current;
+  static vector<pair<string, long>> counters;
+  //! Protects the lists of subphases and the counters
+  static mutex profiler_mutex;
+
+  //! Returns the peak resident set size of the process, in kilobytes (0 if unavailable)
+  static long getPeakRSS();
+  //! Updates the measures of the root phase
+  static void finalizeRoot();
+  static void writePhase(ostream &output, const PhaseNode &phase, int depth);
+  static void writeJsonPhase(ostream &output, const PhaseNode &phase);
+  //! Writes a string as a JSON string literal, escaping the characters that need to be
+  static void writeJsonString(ostream &output, const string &str);
+  //! Writes the report to its destination (registered with atexit())
+  static void writeReportAtExit();
+};
+
+#endif
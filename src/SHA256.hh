@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SHA256_HH
+#define _SHA256_HH
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+//! Computes the SHA-256 digest (FIPS 180-4) of a sequence of bytes
+/*! Used wherever the preprocessor decides from a digest that some content has
+  not changed since a previous run, so that collisions can be ruled out */
+class SHA256
+{
+private:
+  uint32_t state[8];
+  unsigned char block[64];
+  //! Number of bytes in block
+  size_t block_size{0};
+  //! Total number of bytes processed
+  uint64_t length{0};
+  void processBlock(const unsigned char *data);
+public:
+  SHA256();
+  //! Appends data to the message
+  void update(const char *data, size_t size);
+  void update(const string &data);
+  //! Returns the digest of the message as 64 hexadecimal digits
+  /*! The object must not be updated afterwards */
+  string hexDigest();
+  //! Returns the digest of a string as 64 hexadecimal digits
+  static string digest(const string &data);
+};
+
+#endif
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _SPARSE_TENSOR_HH
+#define _SPARSE_TENSOR_HH
+
+#include <vector>
+#include <utility>
+#include <tuple>
+#include <algorithm>
+#include <cassert>
+
+using namespace std;
+
+//! Sparse tensor stored as a sorted list of (indices, value) pairs (coordinate format)
+/*! Key is a pair or a tuple of indices, whose first element is an equation number.
+  Elements are stored contiguously in the lexicographic order of their indices,
+  so iteration is cache-friendly, and the elements of a given equation form a
+  contiguous range (see beginEquation() and endEquation()).
+
+  The interface mimics that of a map from Key to T. Elements whose indices are
+  known to be absent from the tensor should be added with insert(): elements
+  added in increasing order are appended directly, the others are left pending
+  until the next call to finalize(), or to a non-const lookup or iteration.
+  The const methods never sort the tensor (they require it to be finalized), so
+  that a finalized tensor can be read concurrently from several threads.
+  operator[] and erase() keep the storage sorted, and therefore cost a linear
+  time when used in the middle of the tensor; several elements should rather be
+  removed at once with eraseIf(). */
+template<typename Key, typename T>
+class SparseTensor
+{
+public:
+  using value_type = pair<Key, T>;
+  using iterator = typename vector<value_type>::iterator;
+  using const_iterator = typename vector<value_type>::const_iterator;
+private:
+  //! The elements; the first nb_sorted ones are sorted, the others are pending
+  vector<value_type> elements;
+  size_t nb_sorted{0};
+
+  static bool
+  keyLess(const value_type &a, const value_type &b)
+  {
+    return a.first < b.first;
+  }
+
+  //! Sorts the pending elements and merges them with the others
+  void
+  sortPending()
+  {
+    if (nb_sorted == elements.size())
+      return;
+    auto middle = elements.begin() + nb_sorted;
+    sort(middle, elements.end(), keyLess);
+    inplace_merge(elements.begin(), middle, elements.end(), keyLess);
+    assert(adjacent_find(elements.begin(), elements.end(),
+                         [](const value_type &a, const value_type &b) { return a.first == b.first; })
+           == elements.end());
+    nb_sorted = elements.size();
+  }
+
+  struct EquationLess
+  {
+    bool
+    operator()(const value_type &a, int eq) const
+    {
+      return get<0>(a.first) < eq;
+    }
+    bool
+    operator()(int eq, const value_type &a) const
+    {
+      return eq < get<0>(a.first);
+    }
+  };
+public:
+  //! Adds an element, whose indices must not already be in the tensor
+  void
+  insert(const Key &key, T value)
+  {
+    if (nb_sorted == elements.size()
+        && (elements.empty() || elements.back().first < key))
+      nb_sorted++;
+    elements.emplace_back(key, value);
+  }
+
+  //! Returns the element with the given indices, adding it (with a default value) if needed
+  T &
+  operator[](const Key &key)
+  {
+    sortPending();
+    auto it = lower_bound(elements.begin(), elements.end(), value_type{key, T{}}, keyLess);
+    if (it == elements.end() || it->first != key)
+      {
+        it = elements.emplace(it, key, T{});
+        nb_sorted++;
+      }
+    return it->second;
+  }
+
+  iterator
+  find(const Key &key)
+  {
+    sortPending();
+    auto it = lower_bound(elements.begin(), elements.end(), value_type{key, T{}}, keyLess);
+    if (it == elements.end() || it->first != key)
+      return elements.end();
+    return it;
+  }
+
+  const_iterator
+  find(const Key &key) const
+  {
+    assert(isFinalized());
+    auto it = lower_bound(elements.cbegin(), elements.cend(), value_type{key, T{}}, keyLess);
+    if (it == elements.cend() || it->first != key)
+      return elements.cend();
+    return it;
+  }
+
+  //! Removes the element with the given indices, if any; returns the number of removed elements
+  size_t
+  erase(const Key &key)
+  {
+    auto it = find(key);
+    if (it == elements.end())
+      return 0;
+    elements.erase(it);
+    nb_sorted--;
+    return 1;
+  }
+
+  //! First element of a given equation
+  const_iterator
+  beginEquation(int eq) const
+  {
+    assert(isFinalized());
+    return lower_bound(elements.cbegin(), elements.cend(), eq, EquationLess());
+  }
+
+  //! Past-the-end element of a given equation
+  const_iterator
+  endEquation(int eq) const
+  {
+    assert(isFinalized());
+    return upper_bound(elements.cbegin(), elements.cend(), eq, EquationLess());
+  }
+
+  iterator
+  begin()
+  {
+    sortPending();
+    return elements.begin();
+  }
+
+  iterator
+  end()
+  {
+    sortPending();
+    return elements.end();
+  }
+
+  const_iterator
+  begin() const
+  {
+    assert(isFinalized());
+    return elements.cbegin();
+  }
+
+  const_iterator
+  end() const
+  {
+    assert(isFinalized());
+    return elements.cend();
+  }
+
+  //! Sorts the pending elements; must be called once all the elements have been inserted
+  void
+  finalize()
+  {
+    sortPending();
+  }
+
+  //! Whether there is no pending element (i.e. whether the const methods can be used)
+  bool
+  isFinalized() const
+  {
+    return nb_sorted == elements.size();
+  }
+
+  //! Removes all the elements for which pred(element) is true, in a single pass
+  template<typename Predicate>
+  void
+  eraseIf(Predicate pred)
+  {
+    sortPending();
+    elements.erase(remove_if(elements.begin(), elements.end(), pred), elements.end());
+    nb_sorted = elements.size();
+  }
+
+  size_t
+  size() const
+  {
+    return elements.size();
+  }
+
+  bool
+  empty() const
+  {
+    return elements.empty();
+  }
+
+  void
+  clear()
+  {
+    elements.clear();
+    nb_sorted = 0;
+  }
+};
+
+#endif
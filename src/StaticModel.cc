@@ -28,6 +28,7 @@
 #include <boost/filesystem.hpp>
 
 #include "StaticModel.hh"
+#include "Profiler.hh"
 
 StaticModel::StaticModel(SymbolTable &symbol_table_arg,
                          NumericalConstants &num_constants_arg,
@@ -41,7 +42,7 @@ StaticModel::StaticModel(SymbolTable &symbol_table_arg,
 }
 
 void
-StaticModel::compileDerivative(ofstream &code_file, unsigned int &instruction_number, int eq, int symb_id, map_idx_t &map_idx, temporary_terms_t temporary_terms) const
+StaticModel::compileDerivative(ostream &code_file, unsigned int &instruction_number, int eq, int symb_id, map_idx_t &map_idx, temporary_terms_t temporary_terms) const
 {
   auto it = first_derivatives.find({ eq, getDerivID(symbol_table.getID(SymbolType::endogenous, symb_id), 0) });
   if (it != first_derivatives.end())
@@ -54,7 +55,7 @@ StaticModel::compileDerivative(ofstream &code_file, unsigned int &instruction_nu
 }
 
 void
-StaticModel::compileChainRuleDerivative(ofstream &code_file, unsigned int &instruction_number, int eqr, int varr, int lag, map_idx_t &map_idx, temporary_terms_t temporary_terms) const
+StaticModel::compileChainRuleDerivative(ostream &code_file, unsigned int &instruction_number, int eqr, int varr, int lag, map_idx_t &map_idx, temporary_terms_t temporary_terms) const
 {
   auto it = first_chain_rule_derivatives.find({ eqr, { varr, lag } });
   if (it != first_chain_rule_derivatives.end())
@@ -69,6 +70,8 @@ StaticModel::compileChainRuleDerivative(ofstream &code_file, unsigned int &instr
 void
 StaticModel::computeTemporaryTermsOrdered()
 {
+  Profiler::Phase phase("temporary terms");
+
   map<expr_t, pair<int, int>> first_occurence;
   map<expr_t, int> reference_count;
   BinaryOpNode *eq_node;
@@ -398,19 +401,13 @@ StaticModel::writeModelEquationsCode(const string &basename, map_idx_t map_idx)
 {
 
   ostringstream tmp_output;
-  ofstream code_file;
+  ostringstream code_file;
   unsigned int instruction_number = 0;
   bool file_open = false;
 
   boost::filesystem::create_directories(basename + "/model/bytecode");
 
   string main_name = basename + "/model/bytecode/static.cod";
-  code_file.open(main_name, ios::out | ios::binary | ios::ate);
-  if (!code_file.is_open())
-    {
-      cerr << "Error : Can't open file \"" << main_name << "\" for writing" << endl;
-      exit(EXIT_FAILURE);
-    }
   int count_u;
   int u_count_int = 0;
 
@@ -554,7 +551,7 @@ StaticModel::writeModelEquationsCode(const string &basename, map_idx_t map_idx)
   fendblock.write(code_file, instruction_number);
   FEND_ fend;
   fend.write(code_file, instruction_number);
-  code_file.close();
+  writeBytecodeFile(main_name, code_file.str());
 }
 
 void
@@ -574,7 +571,7 @@ StaticModel::writeModelEquationsCode_Block(const string &basename, map_idx_t map
   int i, v;
   string tmp_s;
   ostringstream tmp_output;
-  ofstream code_file;
+  ostringstream code_file;
   unsigned int instruction_number = 0;
   expr_t lhs = nullptr, rhs = nullptr;
   BinaryOpNode *eq_node;
@@ -587,12 +584,6 @@ StaticModel::writeModelEquationsCode_Block(const string &basename, map_idx_t map
   boost::filesystem::create_directories(basename + "/model/bytecode");
 
   string main_name = basename + "/model/bytecode/static.cod";
-  code_file.open(main_name, ios::out | ios::binary | ios::ate);
-  if (!code_file.is_open())
-    {
-      cerr << "Error : Can't open file \"" << main_name << "\" for writing" << endl;
-      exit(EXIT_FAILURE);
-    }
   //Temporary variables declaration
 
   FDIMST_ fdimst(temporary_terms.size());
@@ -968,7 +959,7 @@ StaticModel::writeModelEquationsCode_Block(const string &basename, map_idx_t map
   fendblock.write(code_file, instruction_number);
   FEND_ fend;
   fend.write(code_file, instruction_number);
-  code_file.close();
+  writeBytecodeFile(main_name, code_file.str());
 }
 
 void
@@ -1045,16 +1036,17 @@ StaticModel::computingPass(const eval_context_t &eval_context, bool no_tmp_terms
   initializeVariablesAndEquations();
 
   vector<BinaryOpNode *> neweqs;
+  ExprNode::expr_memo_t subst_memo, static_memo;
   for (unsigned int eq = 0; eq < equations.size() - aux_equations.size(); eq++)
     {
-      expr_t eq_tmp = equations[eq]->substituteStaticAuxiliaryVariable();
-      neweqs.push_back(dynamic_cast<BinaryOpNode *>(eq_tmp->toStatic(*this)));
+      expr_t eq_tmp = equations[eq]->substituteStaticAuxiliaryVariable(subst_memo);
+      neweqs.push_back(dynamic_cast<BinaryOpNode *>(eq_tmp->toStatic(*this, static_memo)));
     }
 
   for (auto & aux_equation : aux_equations)
     {
       expr_t eq_tmp = aux_equation->substituteStaticAuxiliaryDefinition();
-      neweqs.push_back(dynamic_cast<BinaryOpNode *>(eq_tmp->toStatic(*this)));
+      neweqs.push_back(dynamic_cast<BinaryOpNode *>(eq_tmp->toStatic(*this, static_memo)));
     }
 
   equations.clear();
@@ -1069,6 +1061,21 @@ StaticModel::computingPass(const eval_context_t &eval_context, bool no_tmp_terms
       vars.insert(getDerivID(id, 0));
     }
 
+  // Try to restore the derivatives and temporary terms from a previous run
+  string cache_key;
+  if (!computing_pass_cache.empty() && !block)
+    {
+      cache_key = computingPassCacheKey(vars, hessian, thirdDerivatives, paramsDerivsOrder, no_tmp_terms, true);
+      if (readComputingPassCache(cache_key))
+        {
+          if (!nopreprocessoroutput)
+            cout << "Static model derivatives restored from " << computing_pass_cache << endl;
+          if (!no_tmp_terms && bytecode)
+            computeTemporaryTermsMapping(temporary_terms, map_idx);
+          return;
+        }
+    }
+
   // Launch computations
   if (!nopreprocessoroutput)
     cout << "Computing static model derivatives:" << endl
@@ -1091,6 +1098,9 @@ StaticModel::computingPass(const eval_context_t &eval_context, bool no_tmp_terms
       computeThirdDerivatives(vars);
     }
 
+  // Free the datatrees used for computing the derivatives in parallel
+  freeDerivationWorkers();
+
   if (paramsDerivsOrder > 0)
     {
       if (!nopreprocessoroutput)
@@ -1103,6 +1113,8 @@ StaticModel::computingPass(const eval_context_t &eval_context, bool no_tmp_terms
 
   if (block)
     {
+      Profiler::Phase phase("block decomposition");
+
       jacob_map_t contemporaneous_jacobian, static_jacobian;
       vector<unsigned int> n_static, n_forward, n_backward, n_mixed;
 
@@ -1148,6 +1160,8 @@ StaticModel::computingPass(const eval_context_t &eval_context, bool no_tmp_terms
           if (bytecode)
             computeTemporaryTermsMapping(temporary_terms, map_idx);
         }
+      if (!computing_pass_cache.empty())
+        writeComputingPassCache(cache_key);
     }
 }
 
@@ -2706,23 +2720,23 @@ StaticModel::writeJsonOutput(ostream &output) const
 void
 StaticModel::writeJsonComputingPassOutput(ostream &output, bool writeDetails) const
 {
-  ostringstream model_local_vars_output;   // Used for storing model local vars
-  ostringstream model_output;              // Used for storing model
-  ostringstream jacobian_output;           // Used for storing jacobian equations
-  ostringstream hessian_output;            // Used for storing Hessian equations
-  ostringstream third_derivatives_output;  // Used for storing third order derivatives equations
-
   deriv_node_temp_terms_t tef_terms;
   temporary_terms_t temp_term_union = temporary_terms_res;
   temporary_terms_t temp_term_union_m_1;
 
   string concat = "";
 
-  writeJsonModelLocalVariables(model_local_vars_output, tef_terms);
+  if (writeDetails)
+    output << "\"static_model\": {";
+  else
+    output << "\"static_model_simple\": {";
+
+  writeJsonModelLocalVariables(output, tef_terms);
 
-  writeJsonTemporaryTerms(temporary_terms_res, temp_term_union_m_1, model_output, tef_terms, concat);
-  model_output << ", ";
-  writeJsonModelEquations(model_output, true);
+  output << ", ";
+  writeJsonTemporaryTerms(temporary_terms_res, temp_term_union_m_1, output, tef_terms, concat);
+  output << ", ";
+  writeJsonModelEquations(output, true);
 
   int nrows = equations.size();
   int JacobianColsNbr = symbol_table.endo_nbr();
@@ -2732,16 +2746,17 @@ StaticModel::writeJsonComputingPassOutput(ostream &output, bool writeDetails) co
   temp_term_union_m_1 = temp_term_union;
   temp_term_union.insert(temporary_terms_g1.begin(), temporary_terms_g1.end());
   concat = "jacobian";
-  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, jacobian_output, tef_terms, concat);
-  jacobian_output << ", \"jacobian\": {"
-                  << "  \"nrows\": " << nrows
-                  << ", \"ncols\": " << JacobianColsNbr
-                  << ", \"entries\": [";
+  output << ", ";
+  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, output, tef_terms, concat);
+  output << ", \"jacobian\": {"
+         << "  \"nrows\": " << nrows
+         << ", \"ncols\": " << JacobianColsNbr
+         << ", \"entries\": [";
   for (auto it = first_derivatives.begin();
        it != first_derivatives.end(); it++)
     {
       if (it != first_derivatives.begin())
-        jacobian_output << ", ";
+        output << ", ";
 
       int eq, var;
       tie(eq, var) = it->first;
@@ -2750,36 +2765,37 @@ StaticModel::writeJsonComputingPassOutput(ostream &output, bool writeDetails) co
       expr_t d1 = it->second;
 
       if (writeDetails)
-        jacobian_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        jacobian_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
-      jacobian_output << ", \"col\": " << col + 1;
+      output << ", \"col\": " << col + 1;
 
       if (writeDetails)
-        jacobian_output << ", \"var\": \"" << symbol_table.getName(symb_id) << "\"";
+        output << ", \"var\": \"" << symbol_table.getName(symb_id) << "\"";
 
-      jacobian_output << ", \"val\": \"";
-      d1->writeJsonOutput(jacobian_output, temp_term_union, tef_terms);
-      jacobian_output << "\"}" << endl;
+      output << ", \"val\": \"";
+      d1->writeJsonOutput(output, temp_term_union, tef_terms);
+      output << "\"}" << endl;
     }
-  jacobian_output << "]}";
+  output << "]}";
 
   int g2ncols = symbol_table.endo_nbr() * symbol_table.endo_nbr();
   // Write Hessian w.r. to endogenous only (only if 2nd order derivatives have been computed)
   temp_term_union_m_1 = temp_term_union;
   temp_term_union.insert(temporary_terms_g2.begin(), temporary_terms_g2.end());
   concat = "hessian";
-  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, hessian_output, tef_terms, concat);
-  hessian_output << ", \"hessian\": {"
-                 << "  \"nrows\": " << equations.size()
-                 << ", \"ncols\": " << g2ncols
-                 << ", \"entries\": [";
+  output << ", ";
+  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, output, tef_terms, concat);
+  output << ", \"hessian\": {"
+         << "  \"nrows\": " << equations.size()
+         << ", \"ncols\": " << g2ncols
+         << ", \"entries\": [";
   for (auto it = second_derivatives.begin();
        it != second_derivatives.end(); it++)
     {
       if (it != second_derivatives.begin())
-        hessian_output << ", ";
+        output << ", ";
 
       int eq, var1, var2;
       tie(eq, var1, var2) = it->first;
@@ -2794,48 +2810,49 @@ StaticModel::writeJsonComputingPassOutput(ostream &output, bool writeDetails) co
       int col_sym = tsid2*symbol_table.endo_nbr()+tsid1;
 
       if (writeDetails)
-        hessian_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        hessian_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
-      hessian_output << ", \"col\": [" << col + 1;
+      output << ", \"col\": [" << col + 1;
 
       if (writeDetails)
-        hessian_output << ", \"var1\": \"" << symbol_table.getName(symb_id1) << "\""
-                       << ", \"var2\": \"" << symbol_table.getName(symb_id2) << "\"";
+        output << ", \"var1\": \"" << symbol_table.getName(symb_id1) << "\""
+               << ", \"var2\": \"" << symbol_table.getName(symb_id2) << "\"";
 
       if (symb_id1 != symb_id2)
-        hessian_output << ", " <<  col_sym + 1;
-      hessian_output << "]"
-                     << ", \"val\": \"";
-      d2->writeJsonOutput(hessian_output, temp_term_union, tef_terms);
-      hessian_output << "\"}" << endl;
+        output << ", " <<  col_sym + 1;
+      output << "]"
+             << ", \"val\": \"";
+      d2->writeJsonOutput(output, temp_term_union, tef_terms);
+      output << "\"}" << endl;
     }
-  hessian_output << "]}";
+  output << "]}";
 
   // Writing third derivatives
   temp_term_union_m_1 = temp_term_union;
   temp_term_union.insert(temporary_terms_g3.begin(), temporary_terms_g3.end());
   concat = "third_derivatives";
-  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, third_derivatives_output, tef_terms, concat);
-  third_derivatives_output << ", \"third_derivative\": {"
-                           << "  \"nrows\": " << equations.size()
-                           << ", \"ncols\": " << hessianColsNbr * JacobianColsNbr
-                           << ", \"entries\": [";
+  output << ", ";
+  writeJsonTemporaryTerms(temp_term_union, temp_term_union_m_1, output, tef_terms, concat);
+  output << ", \"third_derivative\": {"
+         << "  \"nrows\": " << equations.size()
+         << ", \"ncols\": " << hessianColsNbr * JacobianColsNbr
+         << ", \"entries\": [";
   for (auto it = third_derivatives.begin();
        it != third_derivatives.end(); it++)
     {
       if (it != third_derivatives.begin())
-        third_derivatives_output << ", ";
+        output << ", ";
 
       int eq, var1, var2, var3;
       tie(eq, var1, var2, var3) = it->first;
       expr_t d3 = it->second;
 
       if (writeDetails)
-        third_derivatives_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        third_derivatives_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
       int id1 = getSymbIDByDerivID(var1);
       int id2 = getSymbIDByDerivID(var2);
@@ -2848,71 +2865,68 @@ StaticModel::writeJsonComputingPassOutput(ostream &output, bool writeDetails) co
       cols.insert(id3 * hessianColsNbr + id1 * JacobianColsNbr + id2);
       cols.insert(id3 * hessianColsNbr + id2 * JacobianColsNbr + id1);
 
-      third_derivatives_output << ", \"col\": [";
+      output << ", \"col\": [";
       for (auto it2 = cols.begin(); it2 != cols.end(); it2++)
         {
           if (it2 != cols.begin())
-            third_derivatives_output << ", ";
-          third_derivatives_output << *it2 + 1;
+            output << ", ";
+          output << *it2 + 1;
         }
-      third_derivatives_output << "]";
+      output << "]";
 
       if (writeDetails)
-        third_derivatives_output << ", \"var1\": \"" << symbol_table.getName(getSymbIDByDerivID(var1)) << "\""
-                                 << ", \"var2\": \"" << symbol_table.getName(getSymbIDByDerivID(var2)) << "\""
-                                 << ", \"var3\": \"" << symbol_table.getName(getSymbIDByDerivID(var3)) << "\"";
+        output << ", \"var1\": \"" << symbol_table.getName(getSymbIDByDerivID(var1)) << "\""
+               << ", \"var2\": \"" << symbol_table.getName(getSymbIDByDerivID(var2)) << "\""
+               << ", \"var3\": \"" << symbol_table.getName(getSymbIDByDerivID(var3)) << "\"";
 
-      third_derivatives_output << ", \"val\": \"";
-      d3->writeJsonOutput(third_derivatives_output, temp_term_union, tef_terms);
-      third_derivatives_output << "\"}" << endl;
+      output << ", \"val\": \"";
+      d3->writeJsonOutput(output, temp_term_union, tef_terms);
+      output << "\"}" << endl;
     }
-  third_derivatives_output << "]}";
+  output << "]}";
 
-  if (writeDetails)
-    output << "\"static_model\": {";
-  else
-    output << "\"static_model_simple\": {";
-  output << model_local_vars_output.str()
-         << ", " << model_output.str()
-         << ", " << jacobian_output.str()
-         << ", " << hessian_output.str()
-         << ", " << third_derivatives_output.str()
-         << "}";
+  output << "}";
+}
+
+bool
+StaticModel::writeBinaryDerivatives(const string &filename) const
+{
+  return writeBinaryDerivativesHelper(filename, [this](int var)
+                                      {
+                                        return symbol_table.getTypeSpecificID(getSymbIDByDerivID(var));
+                                      },
+                                      symbol_table.endo_nbr());
 }
 
 void
 StaticModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails) const
 {
-  if (!residuals_params_derivatives.size()
-      && !residuals_params_second_derivatives.size()
-      && !jacobian_params_derivatives.size()
-      && !jacobian_params_second_derivatives.size()
-      && !hessian_params_derivatives.size())
+  if (!hasParamsDerivatives())
     return;
 
-  ostringstream model_local_vars_output;   // Used for storing model local vars
-  ostringstream model_output;              // Used for storing model temp vars and equations
-  ostringstream jacobian_output;           // Used for storing jacobian equations
-  ostringstream hessian_output;            // Used for storing Hessian equations
-  ostringstream hessian1_output;           // Used for storing Hessian equations
-  ostringstream third_derivs_output;       // Used for storing third order derivatives equations
-  ostringstream third_derivs1_output;      // Used for storing third order derivatives equations
-
   deriv_node_temp_terms_t tef_terms;
-  writeJsonModelLocalVariables(model_local_vars_output, tef_terms);
+
+  if (writeDetails)
+    output << "\"static_model_params_derivative\": {";
+  else
+    output << "\"static_model_params_derivatives_simple\": {";
+
+  writeJsonModelLocalVariables(output, tef_terms);
 
   temporary_terms_t temp_terms_empty;
   string concat = "all";
-  writeJsonTemporaryTerms(params_derivs_temporary_terms, temp_terms_empty, model_output, tef_terms, concat);
-  jacobian_output << "\"deriv_wrt_params\": {"
-                  << "  \"neqs\": " << equations.size()
-                  << ", \"nparamcols\": " << symbol_table.param_nbr()
-                  << ", \"entries\": [";
+  output << ", ";
+  writeJsonTemporaryTerms(params_derivs_temporary_terms, temp_terms_empty, output, tef_terms, concat);
+  output << ", ";
+  output << "\"deriv_wrt_params\": {"
+         << "  \"neqs\": " << equations.size()
+         << ", \"nparamcols\": " << symbol_table.param_nbr()
+         << ", \"entries\": [";
   for (auto it = residuals_params_derivatives.begin();
        it != residuals_params_derivatives.end(); it++)
     {
       if (it != residuals_params_derivatives.begin())
-        jacobian_output << ", ";
+        output << ", ";
 
       int eq, param;
       tie(eq, param) = it->first;
@@ -2921,30 +2935,31 @@ StaticModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails)
       int param_col = symbol_table.getTypeSpecificID(getSymbIDByDerivID(param)) + 1;
 
       if (writeDetails)
-        jacobian_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        jacobian_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
       if (writeDetails)
-        jacobian_output << ", \"param_col\": " << param_col;
+        output << ", \"param_col\": " << param_col;
 
-      jacobian_output << ", \"param\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
+      output << ", \"param\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
 
-      jacobian_output << ", \"val\": \"";
-      d1->writeJsonOutput(jacobian_output, params_derivs_temporary_terms, tef_terms);
-      jacobian_output << "\"}" << endl;
+      output << ", \"val\": \"";
+      d1->writeJsonOutput(output, params_derivs_temporary_terms, tef_terms);
+      output << "\"}" << endl;
     }
-  jacobian_output << "]}";
-  hessian_output << "\"deriv_jacobian_wrt_params\": {"
-                 << "  \"neqs\": " << equations.size()
-                 << ", \"nvarcols\": " << symbol_table.endo_nbr()
-                 << ", \"nparamcols\": " << symbol_table.param_nbr()
-                 << ", \"entries\": [";
+  output << "]}";
+  output << ", ";
+  output << "\"deriv_jacobian_wrt_params\": {"
+         << "  \"neqs\": " << equations.size()
+         << ", \"nvarcols\": " << symbol_table.endo_nbr()
+         << ", \"nparamcols\": " << symbol_table.param_nbr()
+         << ", \"entries\": [";
   for (auto it = jacobian_params_derivatives.begin();
        it != jacobian_params_derivatives.end(); it++)
     {
       if (it != jacobian_params_derivatives.begin())
-        hessian_output << ", ";
+        output << ", ";
 
       int eq, var, param;
       tie(eq, var, param) = it->first;
@@ -2954,32 +2969,33 @@ StaticModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails)
       int param_col = symbol_table.getTypeSpecificID(getSymbIDByDerivID(param)) + 1;
 
       if (writeDetails)
-        hessian_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        hessian_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
       if (writeDetails)
-        hessian_output << ", \"var\": \"" << symbol_table.getName(getSymbIDByDerivID(var)) << "\""
-                       << ", \"param\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
-
-      hessian_output << ", \"var_col\": " << var_col
-                     << ", \"param_col\": " << param_col
-                     << ", \"val\": \"";
-      d2->writeJsonOutput(hessian_output, params_derivs_temporary_terms, tef_terms);
-      hessian_output << "\"}" << endl;
-    }
-  hessian_output << "]}";
-
-  hessian1_output << "\"second_deriv_residuals_wrt_params\": {"
-                  << "  \"nrows\": " << equations.size()
-                  << ", \"nparam1cols\": " << symbol_table.param_nbr()
-                  << ", \"nparam2cols\": " << symbol_table.param_nbr()
-                  << ", \"entries\": [";
+        output << ", \"var\": \"" << symbol_table.getName(getSymbIDByDerivID(var)) << "\""
+               << ", \"param\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
+
+      output << ", \"var_col\": " << var_col
+             << ", \"param_col\": " << param_col
+             << ", \"val\": \"";
+      d2->writeJsonOutput(output, params_derivs_temporary_terms, tef_terms);
+      output << "\"}" << endl;
+    }
+  output << "]}";
+
+  output << ", ";
+  output << "\"second_deriv_residuals_wrt_params\": {"
+         << "  \"nrows\": " << equations.size()
+         << ", \"nparam1cols\": " << symbol_table.param_nbr()
+         << ", \"nparam2cols\": " << symbol_table.param_nbr()
+         << ", \"entries\": [";
   for (auto it = residuals_params_second_derivatives.begin();
        it != residuals_params_second_derivatives.end(); ++it)
     {
       if (it != residuals_params_second_derivatives.begin())
-        hessian1_output << ", ";
+        output << ", ";
 
       int eq, param1, param2;
       tie(eq, param1, param2) = it->first;
@@ -2989,33 +3005,34 @@ StaticModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails)
       int param2_col = symbol_table.getTypeSpecificID(getSymbIDByDerivID(param2)) + 1;
 
       if (writeDetails)
-        hessian1_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        hessian1_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
-      hessian1_output << ", \"param1_col\": " << param1_col
-                      << ", \"param2_col\": " << param2_col;
+      output << ", \"param1_col\": " << param1_col
+             << ", \"param2_col\": " << param2_col;
 
       if (writeDetails)
-        hessian1_output << ", \"param1\": \"" << symbol_table.getName(getSymbIDByDerivID(param1)) << "\""
-                        << ", \"param2\": \"" << symbol_table.getName(getSymbIDByDerivID(param2)) << "\"";
-
-      hessian1_output << ", \"val\": \"";
-      d2->writeJsonOutput(hessian1_output, params_derivs_temporary_terms, tef_terms);
-      hessian1_output << "\"}" << endl;
-    }
-  hessian1_output << "]}";
-  third_derivs_output << "\"second_deriv_jacobian_wrt_params\": {"
-                      << "  \"neqs\": " << equations.size()
-                      << ", \"nvarcols\": " << symbol_table.endo_nbr()
-                      << ", \"nparam1cols\": " << symbol_table.param_nbr()
-                      << ", \"nparam2cols\": " << symbol_table.param_nbr()
-                      << ", \"entries\": [";
+        output << ", \"param1\": \"" << symbol_table.getName(getSymbIDByDerivID(param1)) << "\""
+               << ", \"param2\": \"" << symbol_table.getName(getSymbIDByDerivID(param2)) << "\"";
+
+      output << ", \"val\": \"";
+      d2->writeJsonOutput(output, params_derivs_temporary_terms, tef_terms);
+      output << "\"}" << endl;
+    }
+  output << "]}";
+  output << ", ";
+  output << "\"second_deriv_jacobian_wrt_params\": {"
+         << "  \"neqs\": " << equations.size()
+         << ", \"nvarcols\": " << symbol_table.endo_nbr()
+         << ", \"nparam1cols\": " << symbol_table.param_nbr()
+         << ", \"nparam2cols\": " << symbol_table.param_nbr()
+         << ", \"entries\": [";
   for (auto it = jacobian_params_second_derivatives.begin();
        it != jacobian_params_second_derivatives.end(); ++it)
     {
       if (it != jacobian_params_second_derivatives.begin())
-        third_derivs_output << ", ";
+        output << ", ";
 
       int eq, var, param1, param2;
       tie(eq, var, param1, param2) = it->first;
@@ -3026,35 +3043,36 @@ StaticModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails)
       int param2_col = symbol_table.getTypeSpecificID(getSymbIDByDerivID(param2)) + 1;
 
       if (writeDetails)
-        third_derivs_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        third_derivs_output << "{\"row\": " << eq + 1;
-      third_derivs_output << ", \"var_col\": " << var_col
-                          << ", \"param1_col\": " << param1_col
-                          << ", \"param2_col\": " << param2_col;
+        output << "{\"row\": " << eq + 1;
+      output << ", \"var_col\": " << var_col
+             << ", \"param1_col\": " << param1_col
+             << ", \"param2_col\": " << param2_col;
 
       if (writeDetails)
-        third_derivs_output << ", \"var\": \"" << symbol_table.getName(var) << "\""
-                            << ", \"param1\": \"" << symbol_table.getName(getSymbIDByDerivID(param1)) << "\""
-                            << ", \"param2\": \"" << symbol_table.getName(getSymbIDByDerivID(param2)) << "\"";
-
-      third_derivs_output << ", \"val\": \"";
-      d2->writeJsonOutput(third_derivs_output, params_derivs_temporary_terms, tef_terms);
-      third_derivs_output << "\"}" << endl;
-    }
-  third_derivs_output << "]}" << endl;
-
-  third_derivs1_output << "\"derivative_hessian_wrt_params\": {"
-                       << "  \"neqs\": " << equations.size()
-                       << ", \"nvar1cols\": " << symbol_table.endo_nbr()
-                       << ", \"nvar2cols\": " << symbol_table.endo_nbr()
-                       << ", \"nparamcols\": " << symbol_table.param_nbr()
-                       << ", \"entries\": [";
+        output << ", \"var\": \"" << symbol_table.getName(getSymbIDByDerivID(var)) << "\""
+               << ", \"param1\": \"" << symbol_table.getName(getSymbIDByDerivID(param1)) << "\""
+               << ", \"param2\": \"" << symbol_table.getName(getSymbIDByDerivID(param2)) << "\"";
+
+      output << ", \"val\": \"";
+      d2->writeJsonOutput(output, params_derivs_temporary_terms, tef_terms);
+      output << "\"}" << endl;
+    }
+  output << "]}" << endl;
+
+  output << ", ";
+  output << "\"derivative_hessian_wrt_params\": {"
+         << "  \"neqs\": " << equations.size()
+         << ", \"nvar1cols\": " << symbol_table.endo_nbr()
+         << ", \"nvar2cols\": " << symbol_table.endo_nbr()
+         << ", \"nparamcols\": " << symbol_table.param_nbr()
+         << ", \"entries\": [";
   for (auto it = hessian_params_derivatives.begin();
        it != hessian_params_derivatives.end(); ++it)
     {
       if (it != hessian_params_derivatives.begin())
-        third_derivs1_output << ", ";
+        output << ", ";
 
       int eq, var1, var2, param;
       tie(eq, var1, var2, param) = it->first;
@@ -3065,35 +3083,24 @@ StaticModel::writeJsonParamsDerivativesFile(ostream &output, bool writeDetails)
       int param_col = symbol_table.getTypeSpecificID(getSymbIDByDerivID(param)) + 1;
 
       if (writeDetails)
-        third_derivs1_output << "{\"eq\": " << eq + 1;
+        output << "{\"eq\": " << eq + 1;
       else
-        third_derivs1_output << "{\"row\": " << eq + 1;
+        output << "{\"row\": " << eq + 1;
 
-      third_derivs1_output << ", \"var1_col\": " << var1_col
-                           << ", \"var2_col\": " << var2_col
-                           << ", \"param_col\": " << param_col;
+      output << ", \"var1_col\": " << var1_col
+             << ", \"var2_col\": " << var2_col
+             << ", \"param_col\": " << param_col;
 
       if (writeDetails)
-        third_derivs1_output << ", \"var1\": \"" << symbol_table.getName(getSymbIDByDerivID(var1)) << "\""
-                             << ", \"var2\": \"" << symbol_table.getName(getSymbIDByDerivID(var2)) << "\""
-                             << ", \"param1\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
+        output << ", \"var1\": \"" << symbol_table.getName(getSymbIDByDerivID(var1)) << "\""
+               << ", \"var2\": \"" << symbol_table.getName(getSymbIDByDerivID(var2)) << "\""
+               << ", \"param1\": \"" << symbol_table.getName(getSymbIDByDerivID(param)) << "\"";
 
-      third_derivs1_output << ", \"val\": \"";
-      d2->writeJsonOutput(third_derivs1_output, params_derivs_temporary_terms, tef_terms);
-      third_derivs1_output << "\"}" << endl;
+      output << ", \"val\": \"";
+      d2->writeJsonOutput(output, params_derivs_temporary_terms, tef_terms);
+      output << "\"}" << endl;
     }
-  third_derivs1_output << "]}" << endl;
+  output << "]}" << endl;
 
-  if (writeDetails)
-    output << "\"static_model_params_derivative\": {";
-  else
-    output << "\"static_model_params_derivatives_simple\": {";
-  output << model_local_vars_output.str()
-         << ", " << model_output.str()
-         << ", " << jacobian_output.str()
-         << ", " << hessian_output.str()
-         << ", " << hessian1_output.str()
-         << ", " << third_derivs_output.str()
-         << ", " << third_derivs1_output.str()
-         << "}";
+  output << "}";
 }
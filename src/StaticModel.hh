@@ -82,9 +82,9 @@ private:
   void computeTemporaryTermsMapping(temporary_terms_t &temporary_terms, map_idx_t &map_idx);
 
   //! Write derivative code of an equation w.r. to a variable
-  void compileDerivative(ofstream &code_file, unsigned int &instruction_number, int eq, int symb_id, map_idx_t &map_idx, temporary_terms_t temporary_terms) const;
+  void compileDerivative(ostream &code_file, unsigned int &instruction_number, int eq, int symb_id, map_idx_t &map_idx, temporary_terms_t temporary_terms) const;
   //! Write chain rule derivative code of an equation w.r. to a variable
-  void compileChainRuleDerivative(ofstream &code_file, unsigned int &instruction_number, int eq, int var, int lag, map_idx_t &map_idx, temporary_terms_t temporary_terms) const;
+  void compileChainRuleDerivative(ostream &code_file, unsigned int &instruction_number, int eq, int var, int lag, map_idx_t &map_idx, temporary_terms_t temporary_terms) const;
 
   //! Get the type corresponding to a derivation ID
   SymbolType getTypeByDerivID(int deriv_id) const noexcept(false) override;
@@ -194,6 +194,9 @@ public:
   //! Writes file containing static parameters derivatives
   void writeJsonParamsDerivativesFile(ostream &output, bool writeDetails) const;
 
+  //! Writes the equations and derivatives of the static model in binary form (see BinaryDerivatives.hh)
+  bool writeBinaryDerivatives(const string &filename) const;
+
   //! Writes file containing static parameters derivatives
   void writeParamsDerivativesFile(const string &basename, bool julia) const;
 
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdlib>
+
+#include "StreamPipe.hh"
+
+StreamPipe::ReadBuffer::ReadBuffer(StreamPipe &pipe_arg) : pipe(pipe_arg)
+{
+}
+
+StreamPipe::ReadBuffer::int_type
+StreamPipe::ReadBuffer::underflow()
+{
+  if (gptr() < egptr())
+    return traits_type::to_int_type(*gptr());
+
+  do
+    if (!pipe.pop(chunk))
+      {
+        // The error has already been reported by the writer thread
+        if (pipe.failed)
+          exit(EXIT_FAILURE);
+        return traits_type::eof();
+      }
+  while (chunk.empty());
+
+  setg(&chunk[0], &chunk[0], &chunk[0] + chunk.size());
+  return traits_type::to_int_type(*gptr());
+}
+
+StreamPipe::StreamPipe(size_t chunk_size, size_t max_chunks_arg) :
+  max_chunks(max_chunks_arg),
+  write_buffer([this](const char *data, streamsize size) { return push(string(data, size)); }, chunk_size),
+  read_buffer(*this),
+  out(&write_buffer), in(&read_buffer)
+{
+}
+
+bool
+StreamPipe::push(string chunk)
+{
+  unique_lock<mutex> lock(pipe_mutex);
+  not_full.wait(lock, [&] { return chunks.size() < max_chunks || abandoned; });
+  if (abandoned)
+    return false;
+  chunks.push_back(move(chunk));
+  not_empty.notify_one();
+  return true;
+}
+
+bool
+StreamPipe::pop(string &chunk)
+{
+  unique_lock<mutex> lock(pipe_mutex);
+  not_empty.wait(lock, [&] { return !chunks.empty() || closed; });
+  if (chunks.empty() || failed)
+    return false;
+  chunk = move(chunks.front());
+  chunks.pop_front();
+  not_full.notify_one();
+  return true;
+}
+
+void
+StreamPipe::close(bool error)
+{
+  if (!error)
+    write_buffer.flush();
+  lock_guard<mutex> lock(pipe_mutex);
+  closed = true;
+  failed = error;
+  if (error)
+    chunks.clear();
+  not_empty.notify_all();
+}
+
+void
+StreamPipe::abandon()
+{
+  lock_guard<mutex> lock(pipe_mutex);
+  abandoned = true;
+  chunks.clear();
+  not_full.notify_all();
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _STREAM_PIPE_HH
+#define _STREAM_PIPE_HH
+
+#include <string>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <mutex>
+#include <condition_variable>
+
+#include "BufferedSink.hh"
+
+using namespace std;
+
+//! Bounded buffer between a thread writing to an ostream and a thread reading from an istream
+/*! Used to feed the output of the macro processor to the parser while it is
+  being produced (see the streammacro option). Data goes through a queue of
+  chunks of bounded length, so that the memory used does not depend on the
+  amount of data. The writer blocks while the queue is full, and the reader
+  blocks while it is empty, until the writer calls close().
+
+  If the writer fails, it closes the pipe with the error flag, after having
+  reported the error. The reader thread then exits the program with a failure
+  status, instead of reading a truncated input. The writer thread must not
+  exit the program by itself.
+
+  If the reader stops before the end of data (e.g. the parser exits on an
+  error), it must call abandon() and wait for the end of the writer thread,
+  before the objects used by that thread are destroyed. */
+class StreamPipe
+{
+private:
+  class ReadBuffer : public streambuf
+  {
+  private:
+    StreamPipe &pipe;
+    //! Chunk being read
+    string chunk;
+  public:
+    explicit ReadBuffer(StreamPipe &pipe_arg);
+  protected:
+    int_type underflow() override;
+  };
+
+  mutex pipe_mutex;
+  condition_variable not_empty, not_full;
+  deque<string> chunks;
+  const size_t max_chunks;
+  bool closed{false};
+  //! Whether the writer has failed
+  bool failed{false};
+  //! Whether the reader has stopped reading
+  bool abandoned{false};
+
+  //! Sends the output to the queue, by chunks of fixed size
+  BufferedSink write_buffer;
+  ReadBuffer read_buffer;
+
+  //! Appends a chunk to the queue, waiting for room if necessary; returns false if the pipe is abandoned
+  bool push(string chunk);
+  //! Removes a chunk from the queue, waiting for one if necessary; returns false at the end of data
+  bool pop(string &chunk);
+public:
+  //! Stream to be written by the producer thread
+  ostream out;
+  //! Stream to be read by the consumer thread
+  istream in;
+
+  explicit StreamPipe(size_t chunk_size = 64*1024, size_t max_chunks_arg = 16);
+  //! Sends the pending output, and signals the end of data to the reader
+  /*! Flushing the output stream does not send anything (the macro processor
+    flushes at every end of line): data is only sent by full chunks, or by close().
+    If error is true, the data not yet read is discarded, and the reader exits
+    with a failure status (see above) */
+  void close(bool error = false);
+  //! Signals that the reader stops reading
+  /*! The data not yet read is discarded, and so is any further output of
+    the writer: it no longer blocks, and its output stream goes into the bad
+    state, so that it finishes quickly */
+  void abandon();
+};
+
+#endif
@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Developer tool evaluating the residuals and the Jacobian of a model from the
+   .cod and .bin files written by the bytecode option, without MATLAB/Octave.
+   It checks the consistency of the two files, can compare the results with
+   those of the C code written by the use_dll option, and measures the
+   throughput of the bytecode. */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <random>
+#include <map>
+#include <tuple>
+#include <limits>
+#include <memory>
+#include <functional>
+#include <algorithm>
+
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "Evaluator.hh"
+#include "CompiledModel.hh"
+
+void
+usage()
+{
+  cerr << "Usage: dynare_bytecode_eval <basename>/model/bytecode/{static,dynamic}[.cod] [input=input_file] [seed=N] [print]"
+       << " [check=library] [tolerance=X] [benchmark=N]" << endl
+       << "  input=input_file: values of the inputs, one per line, among:" << endl
+       << "      endo <ID> <lag> <value>" << endl
+       << "      exo <ID> <lag> <value>" << endl
+       << "      exo_det <ID> <lag> <value>" << endl
+       << "      param <ID> <value>" << endl
+       << "      steady_state <ID> <value>" << endl
+       << "    where the IDs start at 0, as in the bytecode; the other inputs are drawn uniformly in [0.5, 1.5]" << endl
+       << "  seed=N: seed of the random inputs (default: 0)" << endl
+       << "  print: prints the residuals and the Jacobian" << endl
+       << "  check=library: compares the results with those of the C code written by the use_dll option," << endl
+       << "    compiled into a shared library (e.g. gcc -shared -fPIC -O2 -o dynamic.so <basename>/model/src/dynamic.c -lm)" << endl
+       << "  tolerance=X: relative tolerance of the comparisons (default: 1e-10)" << endl
+       << "  benchmark=N: measures the time of N evaluations in each mode" << endl;
+  exit(EXIT_FAILURE);
+}
+
+void
+readInputs(const string &input_file, Evaluator &evaluator)
+{
+  ifstream input(input_file);
+  if (!input.is_open())
+    {
+      cerr << "ERROR: Can't open file " << input_file << endl;
+      exit(EXIT_FAILURE);
+    }
+  string line;
+  for (int line_nb = 1; getline(input, line); line_nb++)
+    {
+      istringstream fields(line);
+      string type;
+      int id, lag = 0;
+      double value;
+      if (!(fields >> type) || type[0] == '#')
+        continue;
+      bool lagged = type == "endo" || type == "exo" || type == "exo_det";
+      int nb = type == "endo" || type == "steady_state" ? evaluator.getEndoNbr()
+        : type == "exo" ? evaluator.getExoNbr()
+        : type == "exo_det" ? evaluator.getExoDetNbr()
+        : type == "param" ? evaluator.getParamNbr() : -1;
+      if (nb < 0 || !(fields >> id) || (lagged && !(fields >> lag)) || !(fields >> value)
+          || id < 0 || id >= nb || lag < -evaluator.getMaxLag() || lag > evaluator.getMaxLead())
+        {
+          cerr << "ERROR: " << input_file << ":" << line_nb << ": incorrect input" << endl;
+          exit(EXIT_FAILURE);
+        }
+      if (type == "endo")
+        evaluator.endo(id, lag) = value;
+      else if (type == "exo")
+        evaluator.exo(id, lag) = value;
+      else if (type == "exo_det")
+        evaluator.exoDet(id, lag) = value;
+      else if (type == "param")
+        evaluator.params[id] = value;
+      else
+        evaluator.steady_state[id] = value;
+    }
+}
+
+//! Compares the derivatives computed in simulation mode, at the positions given by the .bin file, with those of the evaluate mode
+/*! The Jacobian of the evaluate mode also contains the derivatives of the
+  blocks which are not solved by the Newton solver, hence only the elements of
+  the .bin file are looked up */
+int
+checkSparseJacobian(const Evaluator &evaluator, const vector<double> &sparse_jacobian, double tolerance)
+{
+  map<tuple<int, int, int>, double> jacobian;
+  for (size_t k = 0; k < evaluator.derivatives.size(); k++)
+    if (evaluator.derivatives[k].type == FirstEndoDerivative)
+      jacobian[{ evaluator.derivatives[k].equation, evaluator.derivatives[k].variable, evaluator.derivatives[k].lag }]
+        = evaluator.jacobian[k];
+
+  int nb_mismatches = 0;
+  for (size_t k = 0; k < evaluator.sparse_jacobian.size(); k++)
+    {
+      const Evaluator::SparseElement &e = evaluator.sparse_jacobian[k];
+      auto it = jacobian.find({ e.equation, e.variable, e.lag });
+      if (it == jacobian.end())
+        {
+          if (nb_mismatches++ < 10)
+            cout << "  derivative of equation " << e.equation + 1 << " with respect to endogenous " << e.variable + 1
+                 << " (lag " << e.lag << ") is in the .bin file, but not in the Jacobian" << endl;
+        }
+      else if (fabs(it->second - sparse_jacobian[k]) > tolerance * max({ 1.0, fabs(it->second), fabs(sparse_jacobian[k]) })
+               && nb_mismatches++ < 10)
+        cout << "  derivative of equation " << e.equation + 1 << " with respect to endogenous " << e.variable + 1
+             << " (lag " << e.lag << "): " << it->second << " in the Jacobian, " << sparse_jacobian[k] << " in the vector u" << endl;
+    }
+  if (nb_mismatches > 10)
+    cout << "  ..." << endl;
+  return nb_mismatches;
+}
+
+//! Runs the function the given number of times, and prints the throughput
+void
+benchmark(const string &name, int nb_evaluations, long instructions, const function<void()> &f)
+{
+  auto start = chrono::steady_clock::now();
+  for (int i = 0; i < nb_evaluations; i++)
+    f();
+  chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  double per_second = nb_evaluations / elapsed.count();
+  cout << "  " << setw(52) << left << name + ":" << right << setw(12) << fixed << setprecision(1) << per_second
+       << " evaluations/s (" << setprecision(3) << 1e6 / per_second << " us per evaluation";
+  if (instructions > 0)
+    cout << ", " << setprecision(1) << instructions * per_second / 1e6 << " M instructions/s";
+  cout << ")" << defaultfloat << endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  if (argc < 2)
+    {
+      cerr << "Missing bytecode file!" << endl;
+      usage();
+    }
+
+  string file_name = argv[1];
+  if (file_name.size() > 4 && file_name.substr(file_name.size() - 4) == ".cod")
+    file_name.erase(file_name.size() - 4);
+  string input_file, library;
+  unsigned int seed = 0;
+  bool print = false;
+  double tolerance = 1e-10;
+  int nb_evaluations = 0;
+
+  for (int arg = 2; arg < argc; arg++)
+    {
+      if (strlen(argv[arg]) >= 5 && !strncmp(argv[arg], "input", 5))
+        {
+          if (strlen(argv[arg]) <= 6 || argv[arg][5] != '=')
+            {
+              cerr << "Incorrect syntax for input option" << endl;
+              usage();
+            }
+          input_file = string(argv[arg] + 6);
+        }
+      else if (strlen(argv[arg]) >= 4 && !strncmp(argv[arg], "seed", 4))
+        {
+          if (strlen(argv[arg]) <= 5 || argv[arg][4] != '='
+              || strspn(argv[arg] + 5, "0123456789") != strlen(argv[arg] + 5))
+            {
+              cerr << "Incorrect syntax for seed option" << endl;
+              usage();
+            }
+          seed = strtoul(argv[arg] + 5, nullptr, 10);
+        }
+      else if (!strcmp(argv[arg], "print"))
+        print = true;
+      else if (strlen(argv[arg]) >= 5 && !strncmp(argv[arg], "check", 5))
+        {
+          if (strlen(argv[arg]) <= 6 || argv[arg][5] != '=')
+            {
+              cerr << "Incorrect syntax for check option" << endl;
+              usage();
+            }
+          library = string(argv[arg] + 6);
+        }
+      else if (strlen(argv[arg]) >= 9 && !strncmp(argv[arg], "tolerance", 9))
+        {
+          char *end;
+          if (strlen(argv[arg]) <= 10 || argv[arg][9] != '='
+              || (tolerance = strtod(argv[arg] + 10, &end), *end != 0) || tolerance < 0)
+            {
+              cerr << "Incorrect syntax for tolerance option" << endl;
+              usage();
+            }
+        }
+      else if (strlen(argv[arg]) >= 9 && !strncmp(argv[arg], "benchmark", 9))
+        {
+          if (strlen(argv[arg]) <= 10 || argv[arg][9] != '='
+              || strspn(argv[arg] + 10, "0123456789") != strlen(argv[arg] + 10)
+              || atoi(argv[arg] + 10) <= 0)
+            {
+              cerr << "Incorrect syntax for benchmark option" << endl;
+              usage();
+            }
+          nb_evaluations = atoi(argv[arg] + 10);
+        }
+      else
+        {
+          cerr << "Unknown option: " << argv[arg] << endl;
+          usage();
+        }
+    }
+
+  Evaluator evaluator(file_name);
+
+  cout << file_name << ".cod: " << (evaluator.isDynamic() ? "dynamic" : "static") << " model, "
+       << evaluator.getInstructionNbr() << " instructions, " << evaluator.getBlockNbr() << " block(s), "
+       << evaluator.getEquationNbr() << " equations, " << evaluator.derivatives.size() << " derivatives" << endl
+       << "  " << evaluator.getEndoNbr() << " endogenous, " << evaluator.getExoNbr() << " exogenous, "
+       << evaluator.getExoDetNbr() << " deterministic exogenous, " << evaluator.getParamNbr() << " parameters";
+  if (evaluator.isDynamic())
+    cout << ", " << evaluator.getMaxLag() << " lag(s), " << evaluator.getMaxLead() << " lead(s)";
+  cout << endl;
+  if (evaluator.hasSparseJacobian())
+    cout << file_name << ".bin: " << evaluator.sparse_jacobian.size() << " nonzero elements in the Jacobians of the blocks" << endl;
+
+  mt19937 generator(seed);
+  uniform_real_distribution<double> distribution(0.5, 1.5);
+  for (auto *v : { &evaluator.y, &evaluator.x, &evaluator.x_det, &evaluator.params, &evaluator.steady_state })
+    for (auto &e : *v)
+      e = distribution(generator);
+  if (!input_file.empty())
+    readInputs(input_file, evaluator);
+
+  /* The evaluation of the equations written in normalized form modifies the
+     endogenous, hence the evaluations are made on a copy of the inputs */
+  vector<double> y = evaluator.y;
+  bool failed = false;
+
+  evaluator.compute(false);
+  vector<double> residuals = evaluator.residuals;
+  vector<double> sparse_jacobian = evaluator.getSparseJacobian();
+  long instructions_simulate = evaluator.getInstructionsExecuted();
+  evaluator.y = y;
+  evaluator.compute(true);
+  long instructions_evaluate = evaluator.getInstructionsExecuted();
+
+  int nb_mismatches = 0;
+  for (int eq = 0; eq < evaluator.getEquationNbr(); eq++)
+    if (evaluator.hasResidual(eq) && !(residuals[eq] == evaluator.residuals[eq]
+                                       || (std::isnan(residuals[eq]) && std::isnan(evaluator.residuals[eq]))))
+      nb_mismatches++;
+  if (nb_mismatches)
+    {
+      cout << "Residuals: " << nb_mismatches << " differences between the evaluate and simulation modes" << endl;
+      failed = true;
+    }
+
+  /* The derivatives of the vector u are computed with the chain rule through
+     the equations evaluated in normalized form, if any */
+  if (evaluator.hasSparseJacobian() && !evaluator.hasNormalizedEquations())
+    {
+      cout << "Checking the Jacobian of the .bin file against the Jacobian of the evaluate mode" << endl;
+      nb_mismatches = checkSparseJacobian(evaluator, sparse_jacobian, tolerance);
+      cout << (nb_mismatches ? "  " + to_string(nb_mismatches) + " mismatch(es)" : "  OK") << endl;
+      failed = failed || nb_mismatches;
+    }
+
+  if (print)
+    {
+      cout << setprecision(numeric_limits<double>::max_digits10);
+      for (int eq = 0; eq < evaluator.getEquationNbr(); eq++)
+        if (evaluator.hasResidual(eq))
+          cout << "residual " << eq << " " << evaluator.residuals[eq] << endl;
+      for (size_t k = 0; k < evaluator.derivatives.size(); k++)
+        {
+          const Evaluator::Derivative &d = evaluator.derivatives[k];
+          cout << "jacobian " << (d.type == FirstEndoDerivative ? "endo"
+                                  : d.type == FirstOtherEndoDerivative ? "other_endo"
+                                  : d.type == FirstExoDerivative ? "exo" : "exo_det")
+               << " " << d.equation << " " << d.variable << " " << d.lag << " " << evaluator.jacobian[k] << endl;
+        }
+      cout << setprecision(6);
+    }
+
+  unique_ptr<CompiledModel> compiled_model;
+  if (!library.empty())
+    {
+      // With the block option, the Jacobian only contains the derivatives with respect to the variables of each block
+      if (evaluator.getBlockNbr() > 1 || evaluator.hasNormalizedEquations())
+        {
+          cerr << "ERROR: the check option needs a model written without the block option" << endl;
+          exit(EXIT_FAILURE);
+        }
+      compiled_model = make_unique<CompiledModel>(library, evaluator);
+      compiled_model->setInputs();
+      compiled_model->compute();
+      cout << "Checking the residuals and the Jacobian against the C code of " << library << endl;
+      nb_mismatches = compiled_model->compare(tolerance, cout);
+      cout << (nb_mismatches ? "  " + to_string(nb_mismatches) + " mismatch(es)" : "  OK") << endl;
+      failed = failed || nb_mismatches;
+    }
+
+  if (nb_evaluations > 0)
+    {
+      cout << "Benchmark (" << nb_evaluations << " evaluations in each mode)" << endl;
+      benchmark("bytecode, evaluate mode (residuals and Jacobian)", nb_evaluations, instructions_evaluate,
+                [&]() { evaluator.compute(true); });
+      benchmark("bytecode, simulation mode (residuals and vector u)", nb_evaluations, instructions_simulate,
+                [&]() { evaluator.compute(false); });
+      if (compiled_model)
+        benchmark("C code (residuals and Jacobian)", nb_evaluations, 0,
+                  [&]() { compiled_model->compute(); });
+    }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#if !defined(_WIN32) && !defined(__CYGWIN32__)
+# include <dlfcn.h>
+#endif
+
+#include "CompiledModel.hh"
+
+CompiledModel::CompiledModel(const string &library, const Evaluator &evaluator_arg) :
+  evaluator{evaluator_arg}
+{
+  string symbol = evaluator.isDynamic() ? "Dynamic" : "Static";
+  void *function;
+#if defined(_WIN32) || defined(__CYGWIN32__)
+  library_handle = LoadLibrary(library.c_str());
+  if (!library_handle)
+    {
+      cerr << "ERROR: Can't load library " << library << endl;
+      exit(EXIT_FAILURE);
+    }
+  function = reinterpret_cast<void *>(GetProcAddress(library_handle, symbol.c_str()));
+#else
+  // Without a slash, dlopen() would search the library in the system directories
+  string path = library.find('/') == string::npos ? "./" + library : library;
+  library_handle = dlopen(path.c_str(), RTLD_NOW);
+  if (!library_handle)
+    {
+      cerr << "ERROR: Can't load library " << library << ": " << dlerror() << endl;
+      exit(EXIT_FAILURE);
+    }
+  function = dlsym(library_handle, symbol.c_str());
+#endif
+  if (!function)
+    {
+      cerr << "ERROR: Can't find function " << symbol << " in library " << library << endl;
+      exit(EXIT_FAILURE);
+    }
+  if (evaluator.isDynamic())
+    dynamic_function = reinterpret_cast<dynamic_fn>(function);
+  else
+    static_function = reinterpret_cast<static_fn>(function);
+
+  int nb_endo_columns;
+  if (evaluator.isDynamic())
+    {
+      // The set is ordered by lag, and then by ID
+      nb_endo_columns = 0;
+      for (const auto &occurrence : evaluator.getEndoOccurrences())
+        endo_columns[occurrence] = nb_endo_columns++;
+      nb_rows_x = evaluator.getPeriods();
+    }
+  else
+    {
+      for (int var = 0; var < evaluator.getEndoNbr(); var++)
+        endo_columns[{ 0, var }] = var;
+      nb_endo_columns = evaluator.getEndoNbr();
+      nb_rows_x = 1;
+    }
+  // The deterministic exogenous follow the exogenous, in x and in the Jacobian
+  nb_columns_g1 = nb_endo_columns;
+  if (evaluator.isDynamic())
+    nb_columns_g1 += evaluator.getExoNbr() + evaluator.getExoDetNbr();
+
+  y.resize(nb_endo_columns);
+  x.resize(nb_rows_x * (evaluator.getExoNbr() + evaluator.getExoDetNbr()));
+  residuals.resize(evaluator.getEquationNbr());
+  g1.resize(evaluator.getEquationNbr() * nb_columns_g1);
+}
+
+CompiledModel::~CompiledModel()
+{
+#if defined(_WIN32) || defined(__CYGWIN32__)
+  FreeLibrary(library_handle);
+#else
+  dlclose(library_handle);
+#endif
+}
+
+void
+CompiledModel::setInputs()
+{
+  int periods = nb_rows_x, max_lag = evaluator.getMaxLag();
+  for (const auto &it : endo_columns)
+    y[it.second] = evaluator.y[it.first.second + (max_lag + it.first.first) * evaluator.getEndoNbr()];
+  for (int t = 0; t < periods; t++)
+    {
+      for (int var = 0; var < evaluator.getExoNbr(); var++)
+        x[t + var * periods] = evaluator.x[t + var * periods];
+      for (int var = 0; var < evaluator.getExoDetNbr(); var++)
+        x[t + (evaluator.getExoNbr() + var) * periods] = evaluator.x_det[t + var * periods];
+    }
+  params = evaluator.params;
+  steady_state = evaluator.steady_state;
+}
+
+void
+CompiledModel::compute()
+{
+  // The C code only writes the nonzero elements of the Jacobian
+  fill(g1.begin(), g1.end(), 0);
+  if (dynamic_function)
+    dynamic_function(y.data(), x.data(), nb_rows_x, params.data(), steady_state.data(), evaluator.getMaxLag(),
+                     residuals.data(), g1.data(), nullptr, nullptr);
+  else
+    static_function(y.data(), x.data(), nb_rows_x, params.data(), residuals.data(), g1.data(), nullptr);
+}
+
+int
+CompiledModel::compare(double tolerance, ostream &output) const
+{
+  const int max_printed = 10;
+  int nb_mismatches = 0;
+  auto equal = [=](double bytecode_value, double c_value)
+    {
+      return fabs(bytecode_value - c_value) <= tolerance * max({ 1.0, fabs(bytecode_value), fabs(c_value) });
+    };
+  auto report = [&](double bytecode_value, double c_value, const string &what)
+    {
+      if (nb_mismatches++ < max_printed)
+        output << "  " << what << ": " << bytecode_value << " in the bytecode, "
+               << c_value << " in the C code" << endl;
+    };
+
+  int nb_rows = evaluator.getEquationNbr();
+  for (int eq = 0; eq < nb_rows; eq++)
+    if (evaluator.hasResidual(eq) && !equal(evaluator.residuals[eq], residuals[eq]))
+      report(evaluator.residuals[eq], residuals[eq], "residual of equation " + to_string(eq + 1));
+
+  /* The derivatives with respect to the exogenous and to the deterministic
+     exogenous are both tagged as FirstExoDerivative outside of the block
+     decomposition, so they are not compared if there are both */
+  bool compare_exo = evaluator.getExoDetNbr() == 0 || evaluator.getExoNbr() == 0;
+  int nb_endo_columns = endo_columns.size();
+  int nb_compared_columns = evaluator.isDynamic() && compare_exo ? nb_columns_g1 : nb_endo_columns;
+  vector<double> bytecode_g1(nb_rows * nb_compared_columns, 0);
+  vector<string> names(nb_compared_columns);
+  for (const auto &it : endo_columns)
+    names[it.second] = "endogenous " + to_string(it.first.second + 1)
+      + (it.first.first ? " (lag " + to_string(it.first.first) + ")" : "");
+  for (int col = nb_endo_columns; col < nb_compared_columns; col++)
+    names[col] = "exogenous " + to_string(col - nb_endo_columns + 1);
+  for (size_t k = 0; k < evaluator.derivatives.size(); k++)
+    {
+      const Evaluator::Derivative &d = evaluator.derivatives[k];
+      int col;
+      if (d.type == FirstEndoDerivative)
+        col = endo_columns.at({ d.lag, d.variable });
+      else if (d.type == FirstExoDerivative && evaluator.isDynamic() && compare_exo)
+        col = nb_endo_columns + d.variable;
+      else
+        continue;
+      bytecode_g1[d.equation + col * nb_rows] = evaluator.jacobian[k];
+    }
+  for (int col = 0; col < nb_compared_columns; col++)
+    for (int eq = 0; eq < nb_rows; eq++)
+      if (!equal(bytecode_g1[eq + col * nb_rows], g1[eq + col * nb_rows]))
+        report(bytecode_g1[eq + col * nb_rows], g1[eq + col * nb_rows],
+               "derivative of equation " + to_string(eq + 1) + " with respect to " + names[col]);
+
+  if (nb_mismatches > max_printed)
+    output << "  ..." << endl;
+  return nb_mismatches;
+}
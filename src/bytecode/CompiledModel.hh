@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _COMPILED_MODEL_HH
+#define _COMPILED_MODEL_HH
+
+using namespace std;
+
+#include <string>
+#include <vector>
+#include <map>
+#include <ostream>
+
+#if defined(_WIN32) || defined(__CYGWIN32__)
+# include <windows.h>
+#endif
+
+#include "Evaluator.hh"
+
+//! Model written in C by the use_dll option, loaded from a shared library
+/*! The library must be built from the C files of the model only, without the
+  MEX gateways, for example with:
+    gcc -shared -fPIC -O2 -o dynamic.so <basename>/model/src/dynamic.c -lm
+  The inputs of the C code are taken from the bytecode evaluator of the same
+  model, which must not have been written with the block option. The columns
+  of the dynamic Jacobian are rebuilt from the endogenous which appear in the
+  bytecode, ordered by lag and then by ID as in the lead-lag incidence matrix. */
+class CompiledModel
+{
+public:
+  CompiledModel(const string &library, const Evaluator &evaluator_arg);
+  ~CompiledModel();
+  CompiledModel(const CompiledModel &) = delete;
+  CompiledModel &operator=(const CompiledModel &) = delete;
+  //! Copies the inputs of the evaluator, in the layout expected by the C code
+  void setInputs();
+  //! Computes the residuals and the Jacobian
+  void compute();
+  //! Compares the results with those of the last evaluation of the bytecode in evaluate mode
+  /*! Prints the mismatches and returns their number */
+  int compare(double tolerance, ostream &output) const;
+private:
+  using dynamic_fn = void (*)(double *y, double *x, int nb_row_x, double *params, double *steady_state, int it_,
+                              double *residual, double *g1, double *v2, double *v3);
+  using static_fn = void (*)(double *y, double *x, int nb_row_x, double *params,
+                             double *residual, double *g1, double *v2);
+#if defined(_WIN32) || defined(__CYGWIN32__)
+  HINSTANCE library_handle;
+#else
+  void *library_handle;
+#endif
+  dynamic_fn dynamic_function{nullptr};
+  static_fn static_function{nullptr};
+  const Evaluator &evaluator;
+  //! Column of each endogenous in y and in the Jacobian, indexed by (lag, ID)
+  map<pair<int, int>, int> endo_columns;
+  //! Inputs of the C code, and its outputs (g1 is stored column-major)
+  vector<double> y, x, params, steady_state;
+  vector<double> residuals, g1;
+  int nb_rows_x, nb_columns_g1;
+};
+
+#endif
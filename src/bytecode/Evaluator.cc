@@ -0,0 +1,770 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cmath>
+#include <algorithm>
+
+#include "Evaluator.hh"
+
+Evaluator::Evaluator(const string &file_name)
+{
+  tags = code_load.get_op_code(file_name);
+  if (tags.empty())
+    {
+      cerr << "ERROR: Can't open file " << file_name << ".cod" << endl;
+      exit(EXIT_FAILURE);
+    }
+  if (tags.back().first != FEND)
+    {
+      cerr << "ERROR: " << file_name << ".cod: unknown instruction after instruction " << tags.size() << endl;
+      exit(EXIT_FAILURE);
+    }
+
+  analyze();
+
+  int periods = getPeriods();
+  y.assign(endo_nbr * periods, 0);
+  x.assign(periods * exo_nbr, 0);
+  x_det.assign(periods * exo_det_nbr, 0);
+  params.assign(param_nbr, 0);
+  steady_state.assign(endo_nbr, 0);
+  residuals.assign(equation_nbr, 0);
+  jacobian.assign(derivatives.size(), 0);
+
+  loadSparseJacobian(file_name);
+}
+
+Evaluator::~Evaluator()
+{
+  for (auto &tag : tags)
+    if (tag.first == FBEGINBLOCK)
+      delete static_cast<FBEGINBLOCK_ *>(tag.second);
+    else if (tag.first == FCALL)
+      delete static_cast<FCALL_ *>(tag.second);
+}
+
+void
+Evaluator::analyze()
+{
+  FNUMEXPR_ *expr = nullptr;
+  int min_lag = 0;
+  store_index.resize(tags.size(), -1);
+
+  auto checkVariable = [&](uint8_t type, unsigned int pos, int lag, size_t i, bool steady_state_value = false)
+    {
+      switch (static_cast<SymbolType>(type))
+        {
+        case SymbolType::endogenous:
+          endo_nbr = max(endo_nbr, static_cast<int>(pos) + 1);
+          if (!steady_state_value)
+            endo_occurrences.emplace(lag, pos);
+          break;
+        case SymbolType::exogenous:
+          exo_nbr = max(exo_nbr, static_cast<int>(pos) + 1);
+          break;
+        case SymbolType::exogenousDet:
+          exo_det_nbr = max(exo_det_nbr, static_cast<int>(pos) + 1);
+          break;
+        case SymbolType::parameter:
+          param_nbr = max(param_nbr, static_cast<int>(pos) + 1);
+          break;
+        default:
+          cerr << "ERROR: instruction " << i << ": variable of unsupported type " << static_cast<int>(type) << endl;
+          exit(EXIT_FAILURE);
+        }
+      min_lag = min(min_lag, lag);
+      max_lead = max(max_lead, lag);
+    };
+
+  for (size_t i = 0; i < tags.size(); i++)
+    {
+      void *tag = tags[i].second;
+      switch (tags[i].first)
+        {
+        case FLDZ:
+        case FLDC:
+        case FCUML:
+        case FENDBLOCK:
+        case FENDEQU:
+        case FEND:
+          break;
+        case FDIMT:
+          dynamic = true;
+          T.resize(static_cast<FDIMT_ *>(tag)->get_size());
+          break;
+        case FDIMST:
+          T.resize(static_cast<FDIMST_ *>(tag)->get_size());
+          break;
+        case FBEGINBLOCK:
+          {
+            auto *fbeginblock = static_cast<FBEGINBLOCK_ *>(tag);
+            blocks.push_back(fbeginblock);
+            r.emplace_back();
+            u.emplace_back();
+            exo_nbr = max(exo_nbr, static_cast<int>(fbeginblock->get_exo_size()));
+            exo_det_nbr = max(exo_det_nbr, static_cast<int>(fbeginblock->get_det_exo_size()));
+          }
+          break;
+        case FNUMEXPR:
+          expr = static_cast<FNUMEXPR_ *>(tag);
+          break;
+        case FLDT:
+        case FLDST:
+        case FSTPT:
+        case FSTPST:
+          // These four tags have the same layout
+          if (static_cast<FLDT_ *>(tag)->get_pos() >= T.size())
+            {
+              cerr << "ERROR: instruction " << i << ": temporary term out of bounds" << endl;
+              exit(EXIT_FAILURE);
+            }
+          break;
+        case FLDU:
+        case FLDSU:
+        case FSTPU:
+        case FSTPSU:
+        case FLDR:
+        case FSTPR:
+          {
+            if (blocks.empty())
+              {
+                cerr << "ERROR: instruction " << i << ": no block has been started" << endl;
+                exit(EXIT_FAILURE);
+              }
+            unsigned int pos = static_cast<FLDU_ *>(tag)->get_pos();
+            vector<double> &v = tags[i].first == FLDR || tags[i].first == FSTPR ? r.back() : u.back();
+            if (v.size() <= pos)
+              v.resize(pos + 1);
+            if (tags[i].first == FSTPR)
+              {
+                if (!expr || expr->get_expression_type() != ModelEquation)
+                  {
+                    cerr << "ERROR: instruction " << i << ": residual stored outside of an equation" << endl;
+                    exit(EXIT_FAILURE);
+                  }
+                store_index[i] = expr->get_equation();
+                equation_nbr = max(equation_nbr, static_cast<int>(expr->get_equation()) + 1);
+              }
+          }
+          break;
+        case FSTPG:
+        case FSTPG2:
+        case FSTPG3:
+          if (!expr || (expr->get_expression_type() != FirstEndoDerivative
+                        && expr->get_expression_type() != FirstOtherEndoDerivative
+                        && expr->get_expression_type() != FirstExoDerivative
+                        && expr->get_expression_type() != FirstExodetDerivative))
+            {
+              cerr << "ERROR: instruction " << i << ": derivative stored outside of a first order derivative" << endl;
+              exit(EXIT_FAILURE);
+            }
+          store_index[i] = derivatives.size();
+          derivatives.push_back({ expr->get_expression_type(), static_cast<int>(expr->get_equation()),
+                static_cast<int>(expr->get_dvariable1()), expr->get_lag1() });
+          break;
+        case FLDV:
+          {
+            auto *fldv = static_cast<FLDV_ *>(tag);
+            checkVariable(fldv->get_type(), fldv->get_pos(), fldv->get_lead_lag(), i);
+          }
+          break;
+        case FSTPV:
+          {
+            auto *fstpv = static_cast<FSTPV_ *>(tag);
+            checkVariable(fstpv->get_type(), fstpv->get_pos(), fstpv->get_lead_lag(), i);
+            normalized_equations = true;
+          }
+          break;
+        case FLDSV:
+          {
+            auto *fldsv = static_cast<FLDSV_ *>(tag);
+            checkVariable(fldsv->get_type(), fldsv->get_pos(), 0, i);
+          }
+          break;
+        case FLDVS:
+          {
+            auto *fldvs = static_cast<FLDVS_ *>(tag);
+            checkVariable(fldvs->get_type(), fldvs->get_pos(), 0, i, true);
+          }
+          break;
+        case FSTPSV:
+          {
+            auto *fstpsv = static_cast<FSTPSV_ *>(tag);
+            checkVariable(fstpsv->get_type(), fstpsv->get_pos(), 0, i);
+            normalized_equations = true;
+          }
+          break;
+        case FUNARY:
+          switch (static_cast<UnaryOpcode>(static_cast<FUNARY_ *>(tag)->get_op_type()))
+            {
+            case UnaryOpcode::steadyState:
+            case UnaryOpcode::steadyStateParamDeriv:
+            case UnaryOpcode::steadyStateParam2ndDeriv:
+            case UnaryOpcode::expectation:
+            case UnaryOpcode::diff:
+            case UnaryOpcode::adl:
+              cerr << "ERROR: instruction " << i << ": unsupported unary operator" << endl;
+              exit(EXIT_FAILURE);
+            default:
+              break;
+            }
+          break;
+        case FBINARY:
+          if (static_cast<BinaryOpcode>(static_cast<FBINARY_ *>(tag)->get_op_type()) == BinaryOpcode::equal)
+            {
+              cerr << "ERROR: instruction " << i << ": unsupported binary operator" << endl;
+              exit(EXIT_FAILURE);
+            }
+          break;
+        case FTRINARY:
+          break;
+        case FJMPIFEVAL:
+        case FJMP:
+          // These two tags have the same layout
+          if (i + static_cast<FJMP_ *>(tag)->get_pos() + 1 >= tags.size())
+            {
+              cerr << "ERROR: instruction " << i << ": jump out of the code" << endl;
+              exit(EXIT_FAILURE);
+            }
+          break;
+        case FCALL:
+          cerr << "ERROR: instruction " << i << ": call to the external function "
+               << static_cast<FCALL_ *>(tag)->get_function_name() << ", external functions are not supported" << endl;
+          exit(EXIT_FAILURE);
+        case FPUSH:
+        case FPOP:
+        case FLDTEF:
+        case FSTPTEF:
+        case FLDTEFD:
+        case FSTPTEFD:
+        case FLDTEFDD:
+        case FSTPTEFDD:
+          cerr << "ERROR: instruction " << i << ": instruction " << static_cast<int>(tags[i].first)
+               << " of an external function, external functions are not supported" << endl;
+          exit(EXIT_FAILURE);
+        default:
+          cerr << "ERROR: instruction " << i << ": unsupported instruction " << static_cast<int>(tags[i].first) << endl;
+          exit(EXIT_FAILURE);
+        }
+    }
+
+  if (dynamic)
+    max_lag = -min_lag;
+  else
+    max_lead = 0;
+  for (auto block : blocks)
+    endo_nbr = max(endo_nbr, static_cast<int>(block->get_size()));
+  residual_computed.resize(equation_nbr, false);
+  for (size_t i = 0; i < tags.size(); i++)
+    if (tags[i].first == FSTPR)
+      residual_computed[store_index[i]] = true;
+}
+
+void
+Evaluator::loadSparseJacobian(const string &file_name)
+{
+  ifstream bin_file(file_name + ".bin", ios::in | ios::binary);
+  if (!bin_file.is_open())
+    return;
+
+  auto readInt = [&]()
+    {
+      int v;
+      bin_file.read(reinterpret_cast<char *>(&v), sizeof(v));
+      if (!bin_file)
+        {
+          cerr << "ERROR: " << file_name << ".bin is too short for the blocks of " << file_name << ".cod" << endl;
+          exit(EXIT_FAILURE);
+        }
+      return v;
+    };
+
+  for (size_t block = 0; block < blocks.size(); block++)
+    {
+      uint8_t type = blocks[block]->get_type();
+      if (type != SOLVE_TWO_BOUNDARIES_SIMPLE && type != SOLVE_TWO_BOUNDARIES_COMPLETE
+          && type != SOLVE_BACKWARD_COMPLETE && type != SOLVE_FORWARD_COMPLETE)
+        continue;
+      int size = static_cast<int>(blocks[block]->get_size());
+      int nb_elements = blocks[block]->get_u_count_int();
+      if (type == SOLVE_TWO_BOUNDARIES_SIMPLE || type == SOLVE_TWO_BOUNDARIES_COMPLETE)
+        nb_elements -= size;
+      vector<SparseElement> elements;
+      for (int i = 0; i < nb_elements; i++)
+        {
+          SparseElement e;
+          e.equation = readInt();
+          e.variable = readInt();
+          e.lag = readInt();
+          e.u = readInt();
+          e.variable -= e.lag * size;
+          if (e.equation < 0 || e.equation >= size || e.variable < 0 || e.variable >= size
+              || e.u < 0 || e.u >= static_cast<int>(u[block].size()))
+            {
+              cerr << "ERROR: " << file_name << ".bin: element " << i << " of block " << block + 1
+                   << " is inconsistent with " << file_name << ".cod" << endl;
+              exit(EXIT_FAILURE);
+            }
+          elements.push_back(e);
+        }
+      // The elements refer to the equations and variables of the block, whose IDs follow
+      vector<int> variables, equations;
+      for (int i = 0; i < size; i++)
+        variables.push_back(readInt());
+      for (int i = 0; i < size; i++)
+        equations.push_back(readInt());
+      for (auto &e : elements)
+        {
+          e.equation = equations[e.equation];
+          e.variable = variables[e.variable];
+          sparse_jacobian.push_back(e);
+          sparse_jacobian_block.push_back(block);
+        }
+    }
+  if (bin_file.peek() != EOF)
+    {
+      cerr << "ERROR: " << file_name << ".bin is too long for the blocks of " << file_name << ".cod" << endl;
+      exit(EXIT_FAILURE);
+    }
+  sparse_jacobian_loaded = true;
+}
+
+double
+Evaluator::powerDeriv(double x, double p, int k)
+{
+  // Same definition as in the generated code (see DataTree::writePowerDeriv())
+  if (fabs(x) < near_zero && p > 0 && k > p && fabs(p-nearbyint(p)) < near_zero)
+    return 0.0;
+  else
+    {
+      double dxp = pow(x, p-k);
+      for (int i = 0; i < k; i++)
+        dxp *= p--;
+      return dxp;
+    }
+}
+
+void
+Evaluator::compute(bool evaluate)
+{
+  int it_ = max_lag, periods = getPeriods();
+  int block = -1;
+  double *r_block = nullptr, *u_block = nullptr;
+  long executed = 0;
+  stack.clear();
+
+  auto pop = [&](size_t i)
+    {
+      if (stack.empty())
+        {
+          cerr << "ERROR: instruction " << i << ": stack underflow" << endl;
+          exit(EXIT_FAILURE);
+        }
+      double v = stack.back();
+      stack.pop_back();
+      return v;
+    };
+
+  auto variable = [&](uint8_t type, unsigned int pos, int lag) -> double &
+    {
+      switch (static_cast<SymbolType>(type))
+        {
+        case SymbolType::endogenous:
+          return y[pos + (it_ + lag) * endo_nbr];
+        case SymbolType::exogenous:
+          return x[it_ + lag + pos * periods];
+        case SymbolType::exogenousDet:
+          return x_det[it_ + lag + pos * periods];
+        default:
+          return params[pos];
+        }
+    };
+
+  for (size_t i = 0; tags[i].first != FEND; i++)
+    {
+      executed++;
+      void *tag = tags[i].second;
+      switch (tags[i].first)
+        {
+        case FLDZ:
+          stack.push_back(0);
+          break;
+        case FLDC:
+          stack.push_back(static_cast<FLDC_ *>(tag)->get_value());
+          break;
+        case FDIMT:
+        case FDIMST:
+        case FNUMEXPR:
+        case FENDEQU:
+        case FENDBLOCK:
+          break;
+        case FBEGINBLOCK:
+          block++;
+          r_block = r[block].data();
+          u_block = u[block].data();
+          break;
+        case FLDT:
+        case FLDST:
+          stack.push_back(T[static_cast<FLDT_ *>(tag)->get_pos()]);
+          break;
+        case FSTPT:
+        case FSTPST:
+          T[static_cast<FSTPT_ *>(tag)->get_pos()] = pop(i);
+          break;
+        case FLDU:
+        case FLDSU:
+          stack.push_back(u_block[static_cast<FLDU_ *>(tag)->get_pos()]);
+          break;
+        case FSTPU:
+        case FSTPSU:
+          u_block[static_cast<FSTPU_ *>(tag)->get_pos()] = pop(i);
+          break;
+        case FLDR:
+          stack.push_back(r_block[static_cast<FLDR_ *>(tag)->get_pos()]);
+          break;
+        case FSTPR:
+          r_block[static_cast<FSTPR_ *>(tag)->get_pos()] = residuals[store_index[i]] = pop(i);
+          break;
+        case FSTPG:
+        case FSTPG2:
+        case FSTPG3:
+          jacobian[store_index[i]] = pop(i);
+          break;
+        case FLDV:
+          {
+            auto *fldv = static_cast<FLDV_ *>(tag);
+            stack.push_back(variable(fldv->get_type(), fldv->get_pos(), fldv->get_lead_lag()));
+          }
+          break;
+        case FSTPV:
+          {
+            auto *fstpv = static_cast<FSTPV_ *>(tag);
+            variable(fstpv->get_type(), fstpv->get_pos(), fstpv->get_lead_lag()) = pop(i);
+          }
+          break;
+        case FLDSV:
+          {
+            auto *fldsv = static_cast<FLDSV_ *>(tag);
+            stack.push_back(variable(fldsv->get_type(), fldsv->get_pos(), 0));
+          }
+          break;
+        case FSTPSV:
+          {
+            auto *fstpsv = static_cast<FSTPSV_ *>(tag);
+            variable(fstpsv->get_type(), fstpsv->get_pos(), 0) = pop(i);
+          }
+          break;
+        case FLDVS:
+          {
+            auto *fldvs = static_cast<FLDVS_ *>(tag);
+            if (static_cast<SymbolType>(fldvs->get_type()) == SymbolType::endogenous)
+              stack.push_back(steady_state[fldvs->get_pos()]);
+            else
+              stack.push_back(variable(fldvs->get_type(), fldvs->get_pos(), 0));
+          }
+          break;
+        case FUNARY:
+          {
+            double v = pop(i);
+            switch (static_cast<UnaryOpcode>(static_cast<FUNARY_ *>(tag)->get_op_type()))
+              {
+              case UnaryOpcode::uminus:
+                v = -v;
+                break;
+              case UnaryOpcode::exp:
+                v = exp(v);
+                break;
+              case UnaryOpcode::log:
+                v = log(v);
+                break;
+              case UnaryOpcode::log10:
+                v = log10(v);
+                break;
+              case UnaryOpcode::cos:
+                v = cos(v);
+                break;
+              case UnaryOpcode::sin:
+                v = sin(v);
+                break;
+              case UnaryOpcode::tan:
+                v = tan(v);
+                break;
+              case UnaryOpcode::acos:
+                v = acos(v);
+                break;
+              case UnaryOpcode::asin:
+                v = asin(v);
+                break;
+              case UnaryOpcode::atan:
+                v = atan(v);
+                break;
+              case UnaryOpcode::cosh:
+                v = cosh(v);
+                break;
+              case UnaryOpcode::sinh:
+                v = sinh(v);
+                break;
+              case UnaryOpcode::tanh:
+                v = tanh(v);
+                break;
+              case UnaryOpcode::acosh:
+                v = acosh(v);
+                break;
+              case UnaryOpcode::asinh:
+                v = asinh(v);
+                break;
+              case UnaryOpcode::atanh:
+                v = atanh(v);
+                break;
+              case UnaryOpcode::sqrt:
+                v = sqrt(v);
+                break;
+              case UnaryOpcode::abs:
+                v = fabs(v);
+                break;
+              case UnaryOpcode::sign:
+                v = (v > 0) ? 1 : ((v < 0) ? -1 : 0);
+                break;
+              case UnaryOpcode::erf:
+                v = erf(v);
+                break;
+              default:
+                // Rejected by analyze()
+                break;
+              }
+            stack.push_back(v);
+          }
+          break;
+        case FBINARY:
+          {
+            double v2 = pop(i);
+            double v1 = pop(i);
+            switch (static_cast<BinaryOpcode>(static_cast<FBINARY_ *>(tag)->get_op_type()))
+              {
+              case BinaryOpcode::plus:
+                v1 += v2;
+                break;
+              case BinaryOpcode::minus:
+                v1 -= v2;
+                break;
+              case BinaryOpcode::times:
+                v1 *= v2;
+                break;
+              case BinaryOpcode::divide:
+                v1 /= v2;
+                break;
+              case BinaryOpcode::power:
+                v1 = pow(v1, v2);
+                break;
+              case BinaryOpcode::powerDeriv:
+                // The order of derivation has been pushed before the two arguments
+                v1 = powerDeriv(v1, v2, static_cast<int>(pop(i)));
+                break;
+              case BinaryOpcode::max:
+                v1 = v1 < v2 ? v2 : v1;
+                break;
+              case BinaryOpcode::min:
+                v1 = v1 > v2 ? v2 : v1;
+                break;
+              case BinaryOpcode::less:
+                v1 = v1 < v2;
+                break;
+              case BinaryOpcode::greater:
+                v1 = v1 > v2;
+                break;
+              case BinaryOpcode::lessEqual:
+                v1 = v1 <= v2;
+                break;
+              case BinaryOpcode::greaterEqual:
+                v1 = v1 >= v2;
+                break;
+              case BinaryOpcode::equalEqual:
+                v1 = v1 == v2;
+                break;
+              case BinaryOpcode::different:
+                v1 = v1 != v2;
+                break;
+              case BinaryOpcode::equal:
+                // Rejected by analyze()
+                break;
+              }
+            stack.push_back(v1);
+          }
+          break;
+        case FTRINARY:
+          {
+            double v3 = pop(i);
+            double v2 = pop(i);
+            double v1 = pop(i);
+            switch (static_cast<TrinaryOpcode>(static_cast<FTRINARY_ *>(tag)->get_op_type()))
+              {
+              case TrinaryOpcode::normcdf:
+                v1 = 0.5*(1+erf((v1-v2)/v3/M_SQRT2));
+                break;
+              case TrinaryOpcode::normpdf:
+                v1 = 1/(v3*sqrt(2*M_PI)*exp(pow((v1-v2)/v3, 2)/2));
+                break;
+              }
+            stack.push_back(v1);
+          }
+          break;
+        case FCUML:
+          {
+            double v2 = pop(i);
+            double v1 = pop(i);
+            stack.push_back(v1 + v2);
+          }
+          break;
+        case FJMPIFEVAL:
+          if (evaluate)
+            i += static_cast<FJMPIFEVAL_ *>(tag)->get_pos();
+          break;
+        case FJMP:
+          i += static_cast<FJMP_ *>(tag)->get_pos();
+          break;
+        default:
+          // Rejected by analyze()
+          break;
+        }
+    }
+  instructions_executed = executed + 1;
+}
+
+vector<double>
+Evaluator::getSparseJacobian() const
+{
+  vector<double> values;
+  for (size_t k = 0; k < sparse_jacobian.size(); k++)
+    values.push_back(u[sparse_jacobian_block[k]][sparse_jacobian[k].u]);
+  return values;
+}
+
+double &
+Evaluator::endo(int var, int lag)
+{
+  return y[var + (max_lag + lag) * endo_nbr];
+}
+
+double &
+Evaluator::exo(int var, int lag)
+{
+  return x[max_lag + lag + var * getPeriods()];
+}
+
+double &
+Evaluator::exoDet(int var, int lag)
+{
+  return x_det[max_lag + lag + var * getPeriods()];
+}
+
+bool
+Evaluator::hasResidual(int eq) const
+{
+  return residual_computed[eq];
+}
+
+bool
+Evaluator::isDynamic() const
+{
+  return dynamic;
+}
+
+bool
+Evaluator::hasNormalizedEquations() const
+{
+  return normalized_equations;
+}
+
+bool
+Evaluator::hasSparseJacobian() const
+{
+  return sparse_jacobian_loaded;
+}
+
+int
+Evaluator::getEndoNbr() const
+{
+  return endo_nbr;
+}
+
+int
+Evaluator::getExoNbr() const
+{
+  return exo_nbr;
+}
+
+int
+Evaluator::getExoDetNbr() const
+{
+  return exo_det_nbr;
+}
+
+int
+Evaluator::getParamNbr() const
+{
+  return param_nbr;
+}
+
+int
+Evaluator::getEquationNbr() const
+{
+  return equation_nbr;
+}
+
+int
+Evaluator::getBlockNbr() const
+{
+  return blocks.size();
+}
+
+int
+Evaluator::getMaxLag() const
+{
+  return max_lag;
+}
+
+int
+Evaluator::getMaxLead() const
+{
+  return max_lead;
+}
+
+int
+Evaluator::getPeriods() const
+{
+  return max_lag + max_lead + 1;
+}
+
+size_t
+Evaluator::getInstructionNbr() const
+{
+  return tags.size();
+}
+
+long
+Evaluator::getInstructionsExecuted() const
+{
+  return instructions_executed;
+}
+
+const set<pair<int, int>> &
+Evaluator::getEndoOccurrences() const
+{
+  return endo_occurrences;
+}
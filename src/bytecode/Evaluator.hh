@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _EVALUATOR_HH
+#define _EVALUATOR_HH
+
+using namespace std;
+
+#include <string>
+#include <vector>
+#include <set>
+
+#include "CodeInterpreter.hh"
+
+//! Reference interpreter of the code of the .cod files
+/*! Executes the code of model/bytecode/static.cod or dynamic.cod for one
+  period, in either of the two modes of the interpreter of the MEX file:
+  - in evaluate mode, the FJMPIFEVAL jumps are taken, and the code computes
+    the residuals and the Jacobian (FSTPG/FSTPG2/FSTPG3);
+  - in simulation mode, the code computes the residuals and the vector u used
+    by the Newton solver, whose elements are the derivatives listed in the .bin
+    file.
+  Every stored residual and derivative is identified by the FNUMEXPR tag which
+  precedes its computation, which gives the equation, the variable and the lag
+  with respect to the whole model, in both block and non-block modes.
+
+  External functions (FCALL and related tags) are not supported: the code
+  using them is rejected when it is loaded. */
+class Evaluator
+{
+public:
+  //! A derivative stored by the code
+  struct Derivative
+  {
+    //! One of FirstEndoDerivative, FirstOtherEndoDerivative, FirstExoDerivative or FirstExodetDerivative
+    ExpressionType type;
+    int equation, variable, lag;
+  };
+  //! An element of the Jacobian used by the Newton solver, as listed in the .bin file
+  struct SparseElement
+  {
+    int equation, variable, lag;
+    //! Position of the derivative in the vector u of the block
+    int u;
+  };
+
+  //! Loads <file_name>.cod, and <file_name>.bin if it exists
+  explicit Evaluator(const string &file_name);
+  ~Evaluator();
+  Evaluator(const Evaluator &) = delete;
+  Evaluator &operator=(const Evaluator &) = delete;
+
+  //! Runs the code, in evaluate mode or in simulation mode
+  void compute(bool evaluate);
+
+  bool isDynamic() const;
+  //! Whether some equations are evaluated in normalized form (block option), in which case they store an endogenous instead of a residual
+  bool hasNormalizedEquations() const;
+  bool hasSparseJacobian() const;
+  int getEndoNbr() const;
+  int getExoNbr() const;
+  int getExoDetNbr() const;
+  int getParamNbr() const;
+  int getEquationNbr() const;
+  int getBlockNbr() const;
+  //! Number of lags and leads of the variables, in the dynamic model
+  int getMaxLag() const;
+  int getMaxLead() const;
+  //! Number of periods of the y, x and x_det arrays (1 in the static model)
+  int getPeriods() const;
+  size_t getInstructionNbr() const;
+  //! Number of instructions executed by the last call to compute()
+  long getInstructionsExecuted() const;
+  //! The (lag, variable) pairs of the endogenous which appear in the code
+  const set<pair<int, int>> &getEndoOccurrences() const;
+
+  /*! Inputs of the code: y is a endo_nbr×periods matrix, x and x_det are
+    periods×exo_nbr and periods×exo_det_nbr matrices, all stored column-major,
+    and the current period is the period getMaxLag(), as in the interpreter of
+    the MEX file. The steady state is used by the STEADY_STATE operator. */
+  vector<double> y, x, x_det, params, steady_state;
+  double &endo(int var, int lag);
+  double &exo(int var, int lag);
+  double &exoDet(int var, int lag);
+
+  //! Residuals of the equations, as computed by the last call to compute()
+  /*! Only the equations for which hasResidual() is true are computed */
+  vector<double> residuals;
+  bool hasResidual(int eq) const;
+  //! The derivatives stored by the code, and their values as computed by the last call to compute(true)
+  vector<Derivative> derivatives;
+  vector<double> jacobian;
+  //! The Jacobians of the blocks solved by the Newton solver, as listed in the .bin file
+  vector<SparseElement> sparse_jacobian;
+  //! Values of sparse_jacobian, as computed by the last call to compute(false)
+  vector<double> getSparseJacobian() const;
+private:
+  CodeLoad code_load;
+  tags_liste_t tags;
+  bool dynamic{false};
+  bool normalized_equations{false};
+  bool sparse_jacobian_loaded{false};
+  int endo_nbr{0}, exo_nbr{0}, exo_det_nbr{0}, param_nbr{0}, equation_nbr{0};
+  int max_lag{0}, max_lead{0};
+  set<pair<int, int>> endo_occurrences;
+  //! For the stores of residuals (resp. derivatives), the index in residuals (resp. derivatives)
+  vector<int> store_index;
+  vector<bool> residual_computed;
+  //! The FBEGINBLOCK tags, and the index of the block of each element of sparse_jacobian
+  vector<FBEGINBLOCK_ *> blocks;
+  vector<int> sparse_jacobian_block;
+  //! Temporary terms, and residuals and vector u of each block
+  vector<double> T;
+  vector<vector<double>> r, u;
+  vector<double> stack;
+  long instructions_executed{0};
+
+  //! Checks the code, and computes the sizes of the arrays
+  void analyze();
+  void loadSparseJacobian(const string &file_name);
+  static double powerDeriv(double x, double p, int k);
+};
+
+#endif
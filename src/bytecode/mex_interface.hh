@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _MEX_INTERFACE_HH
+#define _MEX_INTERFACE_HH
+
+/* Replacements for the few MEX functions used by the loader of the .cod files
+   (CodeLoad in CodeInterpreter.hh), so that it can be compiled outside of
+   MATLAB/Octave (BYTE_CODE and DEBUG_EX must both be defined) */
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+
+inline void *
+mxMalloc(size_t n)
+{
+  return malloc(n);
+}
+
+inline void
+mxFree(void *ptr)
+{
+  free(ptr);
+}
+
+inline int
+mexPrintf(const char *format, ...)
+{
+  va_list args;
+  va_start(args, format);
+  int n = vfprintf(stderr, format, args);
+  va_end(args);
+  return n;
+}
+
+inline int
+mexEvalString(const char *str)
+{
+  return 0;
+}
+
+#endif
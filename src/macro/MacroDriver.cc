@@ -25,6 +25,8 @@
 #include <sstream>
 
 #include "MacroDriver.hh"
+#include "SHA256.hh"
+#include "BufferedSink.hh"
 
 void
 MacroDriver::parse(const string &f, const string &fb, const string &modfiletxt,
@@ -57,25 +59,197 @@ MacroDriver::parse(const string &f, const string &fb, const string &modfiletxt,
       }
   file_with_endl << modfiletxt << endl;
 
-  lexer = make_unique<MacroFlex>(&file_with_endl, &out, no_line_macro, path);
+  // Skip the expansion if its result is in the cache
+  string cache_key;
+  if (!cache.empty())
+    {
+      cache_key = cacheKey(file_with_endl.str(), path);
+      if (readCache(cache_key, out))
+        return;
+    }
+  // Forwards the output, and keeps a copy of it for the cache
+  string output_copy;
+  streambuf *out_buffer = out.rdbuf();
+  BufferedSink cache_buffer([&](const char *data, streamsize size)
+                            {
+                              output_copy.append(data, size);
+                              return out_buffer->sputn(data, size) == size;
+                            });
+  ostream cache_out(&cache_buffer);
+  ostream &dest = cache.empty() ? out : cache_out;
+
+  lexer = make_unique<MacroFlex>(&file_with_endl, &dest, no_line_macro, path);
   lexer->set_debug(debug);
 
-  Macro::parser parser(*this, out);
+  Macro::parser parser(*this, dest);
   parser.set_debug_level(debug);
 
   // Output first @#line statement
   if (!no_line_macro)
-    out << "@#line \"" << file << "\" 1" << endl;
+    dest << "@#line \"" << file << "\" 1" << endl;
 
   // Launch macro-processing
   parser.parse();
+  dest.flush();
+
+  if (!cache.empty())
+    {
+      cache_buffer.flush();
+      writeCache(cache_key, output_copy);
+    }
+}
+
+void
+MacroDriver::add_read_file(const string &filename, bool found)
+{
+  if (found)
+    read_files.insert(filename);
+  else
+    missing_files.insert(filename);
+}
+
+string
+MacroDriver::cacheKey(const string &code, const vector<string> &path) const
+{
+  // Each component is preceded by its length, so that the concatenation is unambiguous
+  SHA256 sha;
+  auto add = [&](const string &component)
+             {
+               sha.update(to_string(component.size()) + " ");
+               sha.update(component);
+             };
+  // The code includes the definitions given on the command line
+  add(code);
+  add(file);
+  add(no_line_macro ? "1" : "0");
+  for (const auto &it : path)
+    add(it);
+  return sha.hexDigest();
+}
+
+bool
+MacroDriver::fileDigest(const string &filename, string &file_digest)
+{
+  ifstream input(filename, ios::binary);
+  if (input.fail())
+    return false;
+  file_digest = SHA256::digest(string(istreambuf_iterator<char>(input), istreambuf_iterator<char>()));
+  return true;
+}
+
+bool
+MacroDriver::readCache(const string &key, ostream &out) const
+{
+  ifstream input(cache, ios::binary);
+  string header, cache_key;
+  if (!(input >> header >> cache_key) || header != "dynare_macro_cache")
+    {
+      if (cache_debug)
+        cout << "Macro cache miss: no valid cache in " << cache << endl;
+      return false;
+    }
+  if (cache_key != key)
+    {
+      if (cache_debug)
+        cout << "Macro cache miss: the main file, the definitions or the include path have changed" << endl;
+      return false;
+    }
+
+  /* Every file read by the cached expansion must be unchanged, and the files
+     that were looked for in vain must still be missing, since they would
+     otherwise be found instead of others */
+  size_t nb_files, length;
+  string filename, file_digest, cached_digest;
+  bool ok = static_cast<bool>(input >> nb_files);
+  for (size_t i = 0; ok && i < nb_files; i++)
+    {
+      ok = (input >> cached_digest >> length) && input.get() == ' ';
+      if (ok)
+        {
+          filename.resize(length);
+          ok = static_cast<bool>(input.read(&filename[0], length));
+        }
+      if (ok && (!fileDigest(filename, file_digest) || file_digest != cached_digest))
+        {
+          if (cache_debug)
+            cout << "Macro cache miss: " << filename << " has changed" << endl;
+          return false;
+        }
+    }
+  ok = ok && (input >> nb_files);
+  for (size_t i = 0; ok && i < nb_files; i++)
+    {
+      ok = (input >> length) && input.get() == ' ';
+      if (ok)
+        {
+          filename.resize(length);
+          ok = static_cast<bool>(input.read(&filename[0], length));
+        }
+      if (ok && ifstream(filename).good())
+        {
+          if (cache_debug)
+            cout << "Macro cache miss: " << filename << " now exists" << endl;
+          return false;
+        }
+    }
+
+  string output;
+  ok = ok && (input >> length) && input.get() == '\n';
+  if (ok)
+    {
+      output.resize(length);
+      ok = static_cast<bool>(input.read(&output[0], length));
+    }
+  if (!ok)
+    {
+      if (cache_debug)
+        cout << "Macro cache miss: " << cache << " is truncated" << endl;
+      return false;
+    }
+
+  if (cache_debug)
+    cout << "Macro cache hit: expansion restored from " << cache << endl;
+  out << output;
+  out.flush();
+  return true;
+}
+
+void
+MacroDriver::writeCache(const string &key, const string &output) const
+{
+  ostringstream header;
+  header << "dynare_macro_cache " << key << endl
+         << read_files.size() << endl;
+  string file_digest;
+  for (const auto &it : read_files)
+    {
+      // A file which cannot be read anymore would make the cache useless
+      if (!fileDigest(it, file_digest))
+        return;
+      header << file_digest << " " << it.size() << " " << it << endl;
+    }
+  header << missing_files.size() << endl;
+  for (const auto &it : missing_files)
+    header << it.size() << " " << it << endl;
+  header << output.size() << endl;
+
+  ofstream cache_file(cache, ios::out | ios::binary);
+  if (!cache_file.is_open())
+    {
+      cerr << "ERROR: Can't open file " << cache << " for writing" << endl;
+      throw MacroError();
+    }
+  cache_file << header.str() << output;
+  cache_file.close();
+  if (cache_debug)
+    cout << "Macro cache: expansion saved in " << cache << endl;
 }
 
 void
-MacroDriver::error(const Macro::parser::location_type &l, const string &m) const
+MacroDriver::error(const Macro::parser::location_type &l, const string &m) const noexcept(false)
 {
   cerr << "ERROR in macro-processor: " << l << ": " << m << endl;
-  exit(EXIT_FAILURE);
+  throw MacroError();
 }
 
 string
@@ -86,9 +260,10 @@ MacroDriver::replace_vars_in_str(const string &s) const
 
   string retval(s);
   smatch name;
-  string name_str ("[A-Za-z_][A-Za-z0-9_]*");
-  regex name_regex (name_str);                               // Matches NAME
-  regex macro_regex ("@\\s*\\{\\s*" + name_str + "\\s*\\}"); // Matches @{NAME} with potential whitespace
+  // The regular expressions are only compiled once
+  static const string name_str ("[A-Za-z_][A-Za-z0-9_]*");
+  static const regex name_regex (name_str);                               // Matches NAME
+  static const regex macro_regex ("@\\s*\\{\\s*" + name_str + "\\s*\\}"); // Matches @{NAME} with potential whitespace
   for(sregex_iterator it = sregex_iterator(s.begin(), s.end(), macro_regex);
       it != std::sregex_iterator(); ++it)
     {
@@ -155,7 +330,7 @@ MacroDriver::eval_string_function(const string &name, const vector<MacroValuePtr
       cerr << "Macroprocessor: The evaluation of: " << name << " could not be completed" << endl
            << "because the number of arguments provided is different than the number of" << endl
            << "arguments used in its definition" << endl;
-      exit(EXIT_FAILURE);
+      throw MacroError();
     }
 
   int i = 0;
@@ -247,7 +422,7 @@ MacroDriver::iter_loop()  noexcept(false)
               cerr << "Error in for loop: tuple in array contains " << tmv->length()
                    << " elements while you are assigning to " << names.size() << " variables."
                    << endl;
-              exit(EXIT_FAILURE);
+              throw MacroError();
             }
 
           for (auto &name: names)
@@ -169,7 +169,25 @@ private:
   //! Second is the array over which iteration is done
   //! Third is subscript to be used by next call of iter_loop() (beginning with 0) */
   stack<tuple<vector<string>, shared_ptr<ArrayMV>, int>> loop_stack;
+
+  //! Files read by the expansion, and files that were looked for without being found (for the cache)
+  set<string> read_files, missing_files;
+
+  //! Key of the cache, which depends on everything that determines the expansion, except the @#include'd files
+  /*! It is a SHA-256 digest, as are those of the files, so that a hit cannot come from a collision */
+  string cacheKey(const string &code, const vector<string> &path) const;
+  //! Computes the SHA-256 digest of the content of a file, returns false if it cannot be read
+  static bool fileDigest(const string &filename, string &file_digest);
+  //! Writes the output stored in the cache, if it is still valid, and returns whether it was
+  bool readCache(const string &key, ostream &out) const;
+  void writeCache(const string &key, const string &output) const;
+
 public:
+  //! Exception thrown once an error has been reported, to stop the expansion
+  class MacroError
+  {
+  };
+
   //! Exception thrown when value of an unknown variable is requested
   class UnknownVariable
   {
@@ -200,8 +218,18 @@ public:
   //! Used to store the value of the last @#if condition
   bool last_if;
 
+  //! File storing the output for the next runs, which skip the expansion if no input has changed (see the macro_cache option)
+  /*! Empty if there is no cache */
+  string cache;
+  //! Whether to report the cache hits and misses
+  bool cache_debug{false};
+
+  //! Records a file read by an @#include, or a file looked for by an @#include but not found (for the cache)
+  void add_read_file(const string &filename, bool found);
+
   //! Error handler
-  void error(const Macro::parser::location_type &l, const string &m) const;
+  /*! Reports the error, and throws MacroError */
+  void error(const Macro::parser::location_type &l, const string &m) const noexcept(false);
 
   //! Print variables
   string printvars(const Macro::parser::location_type &l, const bool save) const;
@@ -490,6 +490,7 @@ MacroFlex::create_include_context(string *filename, Macro::parser::location_type
   save_context(yylloc);
   // Open new file
   input = new ifstream(*filename, ios::binary);
+  driver.add_read_file(*filename, !input->fail());
   if (input->fail())
     {
       ostringstream dirs;
@@ -498,6 +499,7 @@ MacroFlex::create_include_context(string *filename, Macro::parser::location_type
         {
           string testfile = *it + FILESEP + *filename;
           input = new ifstream(testfile, ios::binary);
+          driver.add_read_file(testfile, input->good());
           if (input->good())
             break;
           dirs << *it << endl;
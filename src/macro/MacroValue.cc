@@ -470,10 +470,7 @@ ArrayMV::times(const MacroValuePtr &mv) noexcept(false)
                 if (lmvt)
                   new_tuple = lmvt->values;
                 else
-                  {
-                    cerr << "ArrayMV::times: unsupported type on lhs" << endl;
-                    exit(EXIT_FAILURE);
-                  }
+                  throw TypeError("Unsupported type on the left of the * operator");
               }
           }
 
@@ -492,10 +489,7 @@ ArrayMV::times(const MacroValuePtr &mv) noexcept(false)
                   for (auto &tit : rmvt->values)
                     new_tuple.push_back(tit);
                  else
-                  {
-                    cerr << "ArrayMV::times: unsupported type on rhs" << endl;
-                    exit(EXIT_FAILURE);
-                  }
+                  throw TypeError("Unsupported type on the right of the * operator");
               }
           }
 
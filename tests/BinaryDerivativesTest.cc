@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Checks that the binary export of the derivatives (binaryderivs option)
+  describes the same tensors as the JSON output, for the dynamic and static
+  models at order 3. The nodes of the binary file are rebuilt in the datatree
+  of the model (with DataTree::readNodes()), and the value of every non-zero
+  element is written as in the JSON output, which must contain exactly the
+  same elements with the same values. The computing pass is done without
+  temporary terms, so that the JSON output contains the whole expressions.
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <regex>
+
+#include "TestModel.hh"
+#include "BinaryDerivatives.hh"
+
+using BinaryDerivatives::Tensor;
+
+//! Elements of a tensor, indexed by the equation and the set of columns of all the permutations of the variables
+using elements_t = map<pair<int, set<int>>, string>;
+
+//! Reads the elements of a tensor of the JSON output of the computing pass
+static elements_t
+readJsonTensor(const string &json, const string &name)
+{
+  elements_t elements;
+  size_t begin = json.find("\"" + name + "\": {");
+  if (begin == string::npos)
+    return elements;
+  size_t end = json.find("]}", begin);
+  string section = json.substr(begin, end - begin);
+
+  static const regex entry_regex(R"re(\{"row": (\d+), "col": \[?([\d, ]+)\]?, "val": "([^"]*)"\})re");
+  static const regex col_regex(R"(\d+)");
+  for (sregex_iterator it(section.begin(), section.end(), entry_regex), it_end; it != it_end; ++it)
+    {
+      set<int> cols;
+      string col_list = (*it)[2];
+      for (sregex_iterator col(col_list.begin(), col_list.end(), col_regex); col != sregex_iterator(); ++col)
+        cols.insert(stoi(col->str()) - 1);
+      elements[{ stoi((*it)[1]) - 1, cols }] = (*it)[3];
+    }
+  return elements;
+}
+
+//! Rebuilds the nodes of the binary file in the datatree, by writing them in the form read by DataTree::readNodes()
+static bool
+rebuildNodes(DataTree &datatree, const BinaryDerivatives::Reader &reader, vector<expr_t> &nodes)
+{
+  using BinaryDerivatives::NodeType;
+
+  ostringstream text;
+  // Constants are formatted as the numerical constants table does
+  text << setprecision(16) << reader.nbNodes() << " " << reader.nbNodes() << endl;
+  for (int i = 0; i < reader.nbNodes(); i++)
+    {
+      const BinaryDerivatives::Node &n = reader.nodes()[i];
+      text << i << " ";
+      switch (n.type)
+        {
+        case NodeType::constant:
+          text << "n " << n.value;
+          break;
+        case NodeType::variable:
+          text << "v " << n.arg1 << " " << n.arg2;
+          break;
+        case NodeType::unaryOp:
+          text << "u " << n.op_code << " " << n.arg1 << " " << n.extra << " " << n.arg2 << " " << n.arg3;
+          break;
+        case NodeType::binaryOp:
+          text << "b " << n.op_code << " " << n.arg1 << " " << n.arg2 << " " << n.extra;
+          break;
+        case NodeType::trinaryOp:
+          text << "t " << n.op_code << " " << n.arg1 << " " << n.arg2 << " " << n.arg3;
+          break;
+        }
+      text << endl;
+    }
+  istringstream input(text.str());
+  return datatree.readNodes(input, nodes);
+}
+
+//! Reads the elements of a tensor of the binary file
+static elements_t
+readBinaryTensor(const BinaryDerivatives::Reader &reader, Tensor tensor, const vector<expr_t> &nodes)
+{
+  int n = reader.header().nb_var_cols, rank = BinaryDerivatives::tensorRank(tensor);
+  elements_t elements;
+  for (int k = 0; k < reader.nnz(tensor); k++)
+    {
+      const int32_t *key = reader.indices(tensor) + k * rank;
+      // Columns of all the permutations of the variables, as in the JSON output
+      vector<int> vars(key + 1, key + rank);
+      sort(vars.begin(), vars.end());
+      set<int> cols;
+      do
+        {
+          int col = 0;
+          for (int var : vars)
+            col = col * n + var;
+          cols.insert(col);
+        }
+      while (next_permutation(vars.begin(), vars.end()));
+
+      ostringstream value;
+      nodes[reader.values(tensor)[k]]->writeJsonOutput(value, temporary_terms_t(), deriv_node_temp_terms_t());
+      elements[{ key[0], cols }] = value.str();
+    }
+  return elements;
+}
+
+//! Compares the binary file of a model with its JSON output
+static bool
+compare(const string &name, DataTree &datatree, const string &filename, const string &json)
+{
+  BinaryDerivatives::Reader reader;
+  vector<expr_t> nodes;
+  if (!reader.open(filename) || !rebuildNodes(datatree, reader, nodes))
+    {
+      cout << name << ": can't read " << filename << endl;
+      return false;
+    }
+
+  bool ok = true;
+  for (auto tensor : { make_pair(Tensor::jacobian, "jacobian"),
+                       make_pair(Tensor::hessian, "hessian"),
+                       make_pair(Tensor::thirdDerivatives, "third_derivative") })
+    {
+      elements_t binary_elements = readBinaryTensor(reader, tensor.first, nodes);
+      elements_t json_elements = readJsonTensor(json, tensor.second);
+      bool same = !json_elements.empty() && binary_elements == json_elements;
+      cout << name << " " << tensor.second << " (" << json_elements.size() << " elements): "
+           << (same ? "OK" : "FAILED") << endl;
+      ok = ok && same;
+    }
+  return ok;
+}
+
+int
+main()
+{
+  TestModel model(40);
+  model.computingPass(3, false, false, true);
+
+  ostringstream dynamic_json, static_json;
+  model.dynamic_model.writeJsonComputingPassOutput(dynamic_json, false);
+  model.static_model.writeJsonComputingPassOutput(static_json, false);
+  if (!model.dynamic_model.writeBinaryDerivatives("binary_derivatives_dynamic.derivs")
+      || !model.static_model.writeBinaryDerivatives("binary_derivatives_static.derivs"))
+    {
+      cerr << "The binary files were not written" << endl;
+      return EXIT_FAILURE;
+    }
+
+  bool ok = compare("dynamic", model.dynamic_model, "binary_derivatives_dynamic.derivs", dynamic_json.str());
+  ok = compare("static", model.static_model, "binary_derivatives_static.derivs", static_json.str()) && ok;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
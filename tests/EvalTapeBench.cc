@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Compares the recursive ExprNode::eval() with the evaluation tape (EvalTape)
+  on a chain of n links, each of which reuses the previous one:
+  - entries: 5 expressions per link, as the entries of a Jacobian sharing
+    subexpressions (see evaluateAndReduceJacobian());
+  - assignments: one assignment per link to an endogenous, whose expression
+    uses the whole chain and the endogenous assigned just before, as the
+    auxiliary and model local variables (see DynamicModel::fillEvalContext()).
+  The values must be identical. The times are the best of three runs, and
+  include the construction of the tape.
+
+  Usage: bench_eval_tape [number of links]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "TestModel.hh"
+#include "EvalTape.hh"
+
+//! Returns true if both values have the same binary representation
+static bool
+sameValue(double a, double b)
+{
+  return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+int
+main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000;
+
+  TestModel model(n);
+  DynamicModel &m = model.dynamic_model;
+
+  // The chain only depends on the parameters and exogenous, which are not assigned
+  vector<expr_t> links, entries;
+  expr_t link = m.AddVariable(model.p);
+  for (int i = 0; i < n; i++)
+    {
+      expr_t e = m.AddVariable(model.exos[i % model.exos.size()]);
+      link = m.AddPlus(m.AddTimes(link, m.AddVariable(model.q)), m.AddExp(e));
+      links.push_back(link);
+      entries.push_back(link);
+      entries.push_back(m.AddTimes(link, m.AddVariable(model.p)));
+      entries.push_back(m.AddDivide(link, m.AddPlus(m.Two, e)));
+      entries.push_back(m.AddMinus(m.AddLog(m.AddPlus(m.Two, m.AddPower(link, m.Two))), e));
+      entries.push_back(m.AddSqrt(m.AddPlus(m.One, m.AddTimes(link, link))));
+    }
+  vector<expr_t> assigned(n);
+  for (int i = 0; i < n; i++)
+    assigned[i] = m.AddPlus(links.back(), m.AddTimes(m.AddVariable(model.endos[i > 0 ? i - 1 : 0]),
+                                                        m.AddVariable(model.q)));
+
+  double entries_eval_time = 0, entries_tape_time = 0, assign_eval_time = 0, assign_tape_time = 0;
+  int entries_size = 0, assign_size = 0;
+  bool same = true;
+  for (int run = 0; run < 3; run++)
+    {
+      // Entries
+      vector<double> eval_values;
+      auto start = chrono::steady_clock::now();
+      for (auto entry : entries)
+        eval_values.push_back(entry->eval(model.eval_context));
+      double t = elapsed(start);
+      entries_eval_time = run == 0 ? t : min(entries_eval_time, t);
+
+      start = chrono::steady_clock::now();
+      EvalTape entries_tape;
+      vector<int> slots;
+      for (auto entry : entries)
+        slots.push_back(entries_tape.add(entry));
+      entries_tape.eval(model.eval_context);
+      t = elapsed(start);
+      entries_tape_time = run == 0 ? t : min(entries_tape_time, t);
+      entries_size = entries_tape.size();
+      for (size_t i = 0; i < entries.size(); i++)
+        same = same && sameValue(eval_values[i], entries_tape.getValue(slots[i]));
+
+      // Assignments
+      eval_context_t eval_context = model.eval_context;
+      start = chrono::steady_clock::now();
+      for (int i = 0; i < n; i++)
+        eval_context.set(model.endos[i], assigned[i]->eval(eval_context));
+      t = elapsed(start);
+      assign_eval_time = run == 0 ? t : min(assign_eval_time, t);
+
+      eval_context_t tape_context = model.eval_context;
+      start = chrono::steady_clock::now();
+      EvalTape assign_tape;
+      for (int i = 0; i < n; i++)
+        assign_tape.addAssignment(model.endos[i], assigned[i]);
+      assign_tape.eval(tape_context);
+      assign_tape.writeAssignments(tape_context);
+      t = elapsed(start);
+      assign_tape_time = run == 0 ? t : min(assign_tape_time, t);
+      assign_size = assign_tape.size();
+      for (int i = 0; i < n; i++)
+        same = same && sameValue(eval_context.get(model.endos[i]), tape_context.get(model.endos[i]));
+    }
+
+  cout << "Chain of " << n << " links" << endl
+       << fixed << setprecision(4)
+       << "  " << entries.size() << " entries:" << endl
+       << "    recursive eval(): " << entries_eval_time << "s" << endl
+       << "    tape:             " << entries_tape_time << "s (" << entries_size << " instructions)" << endl
+       << "  " << n << " assignments:" << endl
+       << "    recursive eval(): " << assign_eval_time << "s" << endl
+       << "    tape:             " << assign_tape_time << "s (" << assign_size << " instructions)" << endl;
+  if (!same)
+    {
+      cerr << "The tape and eval() give different values" << endl;
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Measures the memory used by the JSON output of the computing pass: runs the
+  computing pass of the synthetic model at third order, with the second order
+  derivatives with respect to the parameters, and writes the static, dynamic
+  and parameters derivatives JSON files as ModFile::writeJsonComputingPassOutput()
+  does, streaming each output to its file through a BufferedSink. For
+  comparison, the files are then written again by building each output in
+  an ostringstream before copying it to the file, as the preprocessor did
+  before.
+
+  The growth of the peak resident set size during the first run of each
+  method is reported (the streamed output being written first, so that it
+  is not hidden by the other), with the time of the writing (best of three
+  runs). The two methods must produce the same files.
+
+  Usage: bench_json_output [number of equations]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+
+#include <sys/resource.h>
+
+#include <boost/filesystem.hpp>
+
+#include "TestModel.hh"
+#include "BufferedSink.hh"
+
+//! Returns the peak resident set size, in MB
+static double
+peakRSS()
+{
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss / 1024.0;
+}
+
+int
+main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000;
+
+  TestModel model(n);
+  model.dynamic_model.computingPass(true, true, true, 2, model.eval_context, false, false, true, false, true);
+  model.dynamic_model.toStatic(model.static_model);
+  model.static_model.computingPass(model.eval_context, false, true, true, 2, false, false, true);
+
+  // The outputs of ModFile::writeJsonComputingPassOutput()
+  const vector<pair<string, function<void(ostream &)>>> outputs{
+    { "static.json", [&](ostream &output)
+      {
+        output << "{";
+        model.static_model.writeJsonComputingPassOutput(output, true);
+        output << "}";
+      } },
+    { "dynamic.json", [&](ostream &output)
+      {
+        output << "{";
+        model.dynamic_model.writeJsonComputingPassOutput(output, true);
+        output << "}";
+      } },
+    { "static_params_derivs.json", [&](ostream &output)
+      {
+        output << "{";
+        model.static_model.writeJsonParamsDerivativesFile(output, true);
+        output << "}" << endl;
+      } },
+    { "params_derivs.json", [&](ostream &output)
+      {
+        output << "{";
+        model.dynamic_model.writeJsonParamsDerivativesFile(output, true);
+        output << "}" << endl;
+      } }
+  };
+
+  const string directory = "json_output_bench";
+  boost::filesystem::create_directories(directory + "/streamed");
+  boost::filesystem::create_directories(directory + "/in_memory");
+
+  vector<function<void(const string &, const function<void(ostream &)> &)>> methods{
+    [](const string &filename, const function<void(ostream &)> &writer)
+    {
+      ofstream file(filename, ios::out | ios::binary);
+      BufferedSink buffer([&](const char *data, streamsize size)
+                          {
+                            return file.rdbuf()->sputn(data, size) == size;
+                          });
+      ostream output(&buffer);
+      writer(output);
+      buffer.flush();
+    },
+    [](const string &filename, const function<void(ostream &)> &writer)
+    {
+      ostringstream output;
+      writer(output);
+      ofstream file(filename, ios::out | ios::binary);
+      file << output.str();
+    }
+  };
+  const vector<string> names{ "streamed", "in_memory" };
+
+  cout << "JSON output of the computing pass at third order, " << n << " equations" << endl
+       << fixed << setprecision(1) << "  peak RSS after the computing pass: " << peakRSS() << " MB" << endl;
+  for (size_t i = 0; i < methods.size(); i++)
+    {
+      double time = 0, rss_growth = 0;
+      for (int run = 0; run < 3; run++)
+        {
+          double rss_before = peakRSS();
+          auto start = chrono::steady_clock::now();
+          for (const auto &it : outputs)
+            methods[i](directory + "/" + names[i] + "/" + it.first, it.second);
+          time = run == 0 ? elapsed(start) : min(time, elapsed(start));
+          if (run == 0)
+            rss_growth = peakRSS() - rss_before;
+        }
+      cout << "  " << left << setw(10) << names[i] << right << setprecision(1)
+           << " peak RSS growth: " << setw(6) << rss_growth << " MB, time: "
+           << setprecision(3) << time << "s" << endl;
+    }
+
+  bool ok = true;
+  uintmax_t size = 0;
+  for (const auto &it : outputs)
+    {
+      string streamed = readFile(directory + "/streamed/" + it.first);
+      if (streamed != readFile(directory + "/in_memory/" + it.first))
+        {
+          cerr << "The two methods give different contents for " << it.first << endl;
+          ok = false;
+        }
+      size += streamed.size();
+    }
+  cout << "  size of the JSON files: " << setprecision(1) << size / (1024.0 * 1024.0) << " MB" << endl;
+
+  boost::filesystem::remove_all(directory);
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Measures the memory used by the nodes of a DataTree: builds the synthetic
+  model and runs the computing pass of the dynamic model at the given order,
+  and reports the number of nodes, the number of heap allocations, the peak
+  resident set size, and the time of the whole run including the destruction
+  of the model (best of three runs).
+
+  Usage: bench_node_memory [number of equations [order]]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <new>
+#include <atomic>
+#include <algorithm>
+
+#include <sys/resource.h>
+
+#include "TestModel.hh"
+
+static atomic<long> nb_allocations{0};
+
+void *
+operator new(size_t size)
+{
+  nb_allocations++;
+  void *p = malloc(size == 0 ? 1 : size);
+  if (!p)
+    throw bad_alloc();
+  return p;
+}
+
+void
+operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void
+operator delete(void *p, size_t size) noexcept
+{
+  free(p);
+}
+
+int
+main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000;
+  int order = argc > 2 ? atoi(argv[2]) : 2;
+
+  cout << "Computing pass of the dynamic model at order " << order << ", " << n << " equations" << endl;
+  double time = 0;
+  for (int run = 0; run < 3; run++)
+    {
+      long allocations_before = nb_allocations;
+      auto start = chrono::steady_clock::now();
+      int nb_nodes;
+      {
+        TestModel model(n);
+        model.dynamic_model.computingPass(true, order >= 2, order >= 3, 0, model.eval_context,
+                                          false, false, true, false, true);
+        nb_nodes = model.dynamic_model.getNodeCount();
+      }
+      time = run == 0 ? elapsed(start) : min(time, elapsed(start));
+      if (run == 0)
+        {
+          // The peak RSS is only meaningful for the first run
+          struct rusage usage;
+          getrusage(RUSAGE_SELF, &usage);
+          cout << "  nodes: " << nb_nodes << endl
+               << "  allocations: " << nb_allocations - allocations_before << endl
+               << "  peak RSS: " << fixed << setprecision(1) << usage.ru_maxrss / 1024.0 << " MB" << endl;
+        }
+    }
+  cout << "  time: " << fixed << setprecision(3) << time << "s" << endl;
+  return EXIT_SUCCESS;
+}
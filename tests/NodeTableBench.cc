@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Compares the table used by DataTree for sharing binary nodes (NodeHashTable)
+  with the std::map keyed by (arg1, arg2, op_code, powerDerivOrder) that it
+  replaced, on K distinct binary nodes created in random order from the
+  variables of a synthetic model (best of three runs).
+
+  Also measures the computing pass of a smaller model at order 3, which is
+  dominated by node creations.
+
+  Usage: bench_node_table [K [number of equations of the smaller model]]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <map>
+#include <tuple>
+#include <random>
+#include <algorithm>
+#include <functional>
+
+#include "TestModel.hh"
+#include "NodeHashTable.hh"
+
+//! Returns the best of three runs of f, in seconds
+static double
+bestOfThree(const function<void()> &f)
+{
+  double time = 0;
+  for (int run = 0; run < 3; run++)
+    {
+      auto start = chrono::steady_clock::now();
+      f();
+      time = run == 0 ? elapsed(start) : min(time, elapsed(start));
+    }
+  return time;
+}
+
+//! Returns nkeys distinct pairs of distinct variables of the model (with lags -1 to 1), in random order
+static vector<pair<expr_t, expr_t>>
+variablePairs(TestModel &model, int nkeys)
+{
+  vector<expr_t> leaves;
+  for (int lag = -1; lag <= 1; lag++)
+    for (int endo : model.endos)
+      leaves.push_back(model.dynamic_model.AddVariable(endo, lag));
+  int nleaves = leaves.size();
+  if (nkeys > nleaves * (nleaves - 1))
+    {
+      cerr << "Too many keys for " << nleaves << " variables" << endl;
+      exit(EXIT_FAILURE);
+    }
+
+  vector<pair<expr_t, expr_t>> pairs;
+  for (int k = 0; k < nkeys; k++)
+    pairs.emplace_back(leaves[k % nleaves], leaves[(k % nleaves + 1 + k / nleaves) % nleaves]);
+  shuffle(pairs.begin(), pairs.end(), mt19937(42));
+  return pairs;
+}
+
+int
+main(int argc, char **argv)
+{
+  int nkeys = argc > 1 ? atoi(argv[1]) : 2000000;
+  int n = argc > 2 ? atoi(argv[2]) : 300;
+
+  // The variables of a model with 1000 equations give about 9M pairs
+  TestModel model(1000);
+  DynamicModel &m = model.dynamic_model;
+  auto pairs = variablePairs(model, nkeys);
+
+  cout << "Sharing of " << nkeys << " binary nodes (best of three runs)" << endl;
+
+  // Creation through the DataTree (includes the allocation of the nodes)
+  double creation_time = 0;
+  for (int run = 0; run < 3; run++)
+    {
+      TestModel tree(1000);
+      auto tree_pairs = variablePairs(tree, nkeys);
+      auto start = chrono::steady_clock::now();
+      for (const auto &it : tree_pairs)
+        tree.dynamic_model.AddMinus(it.first, it.second);
+      creation_time = run == 0 ? elapsed(start) : min(creation_time, elapsed(start));
+    }
+  vector<BinaryOpNode *> nodes;
+  for (const auto &it : pairs)
+    nodes.push_back(dynamic_cast<BinaryOpNode *>(m.AddMinus(it.first, it.second)));
+  double lookup_time = bestOfThree([&]()
+                                   {
+                                     for (const auto &it : pairs)
+                                       m.AddMinus(it.first, it.second);
+                                   });
+  cout << "  DataTree::AddMinus: creation " << fixed << setprecision(3) << creation_time
+       << "s, lookup " << lookup_time << "s" << endl;
+
+  // The two tables on the same nodes (without allocation)
+  using map_t = map<tuple<expr_t, expr_t, BinaryOpcode, int>, BinaryOpNode *>;
+  map_t node_map;
+  double map_insert_time = bestOfThree([&]()
+                                       {
+                                         node_map.clear();
+                                         for (auto node : nodes)
+                                           node_map[{ node->get_arg1(), node->get_arg2(), node->get_op_code(), node->get_power_deriv_order() }] = node;
+                                       });
+  size_t found = 0;
+  double map_lookup_time = bestOfThree([&]()
+                                       {
+                                         for (const auto &it : pairs)
+                                           found += node_map.find({ it.first, it.second, BinaryOpcode::minus, 0 }) != node_map.end();
+                                       });
+
+  NodeHashTable<BinaryOpNode> node_table;
+  double table_insert_time = bestOfThree([&]()
+                                         {
+                                           node_table.clear();
+                                           for (auto node : nodes)
+                                             node_table.insert(BinaryOpNode::computeStructuralHash(node->get_arg1(), node->get_op_code(), node->get_arg2(), node->get_power_deriv_order()), node);
+                                         });
+  double table_lookup_time = bestOfThree([&]()
+                                         {
+                                           for (const auto &it : pairs)
+                                             {
+                                               size_t hash = BinaryOpNode::computeStructuralHash(it.first, BinaryOpcode::minus, it.second, 0);
+                                               found += node_table.find(hash, [&](const BinaryOpNode *node)
+                                                                        {
+                                                                          return node->get_arg1() == it.first && node->get_arg2() == it.second
+                                                                            && node->get_op_code() == BinaryOpcode::minus
+                                                                            && node->get_power_deriv_order() == 0;
+                                                                        }) != nullptr;
+                                             }
+                                         });
+  if (found != 6 * pairs.size())
+    {
+      cerr << "Some nodes were not found" << endl;
+      return EXIT_FAILURE;
+    }
+  cout << "  std::map:      insertion " << map_insert_time << "s, lookup " << map_lookup_time << "s" << endl
+       << "  NodeHashTable: insertion " << table_insert_time << "s, lookup " << table_lookup_time << "s" << endl;
+
+  double pass_time = 0;
+  for (int run = 0; run < 3; run++)
+    {
+      TestModel pass_model(n);
+      auto start = chrono::steady_clock::now();
+      pass_model.dynamic_model.computingPass(true, true, true, 0, pass_model.eval_context,
+                                             false, false, true, false, true);
+      pass_time = run == 0 ? elapsed(start) : min(pass_time, elapsed(start));
+    }
+  cout << "Computing pass of the dynamic model at order 3, " << n << " equations: " << pass_time << "s" << endl;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Measures the time of the computing pass of the dynamic model at order 3,
+  computing the derivatives sequentially and then with 1 to N threads (best
+  of three runs).
+
+  Usage: bench_parallel_derivatives [number of equations [N]]
+*/
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
+
+#include "TestModel.hh"
+
+int
+main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 1000;
+  int max_threads = argc > 2 ? atoi(argv[2]) : max(4, static_cast<int>(thread::hardware_concurrency()));
+
+  cout << "Computing pass of the dynamic model at order 3, " << n << " equations ("
+       << thread::hardware_concurrency() << " hardware threads)" << endl;
+  double sequential_time = 0;
+  for (int nthreads = 0; nthreads <= max_threads; nthreads++)
+    {
+      // Best of three runs
+      double time = 0;
+      for (int run = 0; run < 3; run++)
+        {
+          TestModel model(n);
+          model.dynamic_model.nthreads = nthreads;
+          auto start = chrono::steady_clock::now();
+          model.dynamic_model.computingPass(true, true, true, 0, model.eval_context, false, false, true, false, true);
+          time = run == 0 ? elapsed(start) : min(time, elapsed(start));
+        }
+      if (nthreads == 0)
+        {
+          sequential_time = time;
+          cout << "  sequential: " << fixed << setprecision(3) << time << "s" << endl;
+        }
+      else
+        cout << "  nthreads=" << nthreads << ": " << fixed << setprecision(3) << time << "s (speedup "
+             << setprecision(2) << sequential_time / time << ")" << endl;
+    }
+  return EXIT_SUCCESS;
+}
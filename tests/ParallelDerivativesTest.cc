@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Checks that computing the derivatives in parallel (nthreads option) gives
+  the same output, byte for byte, as the sequential algorithm, and creates the
+  same nodes.
+*/
+
+#include <iostream>
+#include <cstdlib>
+
+#include "TestModel.hh"
+
+int
+main()
+{
+  const int n = 60;
+  string reference_output;
+  int reference_node_count = 0;
+  bool ok = true;
+  for (int nthreads : { 0, 1, 2, 3, 7 })
+    {
+      TestModel model(n);
+      model.dynamic_model.nthreads = nthreads;
+      model.static_model.nthreads = nthreads;
+      model.computingPass(3, false, false, false);
+      string output = model.writeCOutput("parallel_derivatives_" + to_string(nthreads));
+      int node_count = model.dynamic_model.getNodeCount();
+      if (nthreads == 0)
+        {
+          reference_output = output;
+          reference_node_count = node_count;
+          continue;
+        }
+      cout << "nthreads=" << nthreads << ": ";
+      if (output != reference_output || node_count != reference_node_count)
+        {
+          cout << "FAILED (" << node_count << " nodes, " << reference_node_count << " in the sequential algorithm"
+               << (output != reference_output ? ", different output" : "") << ")" << endl;
+          ok = false;
+        }
+      else
+        cout << "OK" << endl;
+    }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
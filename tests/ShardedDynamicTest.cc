@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+  Checks that a C dynamic model split into several translation units (dll_shards
+  option) builds with the generated makefile, and computes the same residuals
+  and derivatives as the model written in a single file.
+
+  The MEX files are built by the makefile with a script emulating the mex
+  command, which compiles with $CC against a minimal implementation of the MEX
+  API (written below), so that the resulting shared libraries can be loaded
+  and called by this program.
+*/
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <dlfcn.h>
+#include <sys/stat.h>
+
+#include <boost/filesystem.hpp>
+
+#include "TestModel.hh"
+
+// Minimal MEX API, implemented by mex.c (the layout of mxArray is also used by this program)
+extern "C" {
+  typedef struct { double *pr; size_t m, n; } mxArray;
+  typedef void (*mex_function_t)(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]);
+}
+
+static const char *mex_h =
+  "#include <stddef.h>\n"
+  "typedef struct { double *pr; size_t m, n; } mxArray;\n"
+  "typedef enum { mxREAL } mxComplexity;\n"
+  "double *mxGetPr(const mxArray *a);\n"
+  "double mxGetScalar(const mxArray *a);\n"
+  "size_t mxGetM(const mxArray *a);\n"
+  "mxArray *mxCreateDoubleMatrix(size_t m, size_t n, mxComplexity c);\n"
+  "void mexErrMsgTxt(const char *msg);\n";
+
+static const char *mex_c =
+  "#include <stdlib.h>\n"
+  "#include <stdio.h>\n"
+  "#include \"mex.h\"\n"
+  "double *mxGetPr(const mxArray *a) { return a->pr; }\n"
+  "double mxGetScalar(const mxArray *a) { return a->pr[0]; }\n"
+  "size_t mxGetM(const mxArray *a) { return a->m; }\n"
+  "mxArray *mxCreateDoubleMatrix(size_t m, size_t n, mxComplexity c)\n"
+  "{\n"
+  "  mxArray *a = malloc(sizeof(mxArray));\n"
+  "  a->pr = calloc(m * n + 1, sizeof(double));\n"
+  "  a->m = m;\n"
+  "  a->n = n;\n"
+  "  return a;\n"
+  "}\n"
+  "void mexErrMsgTxt(const char *msg) { fprintf(stderr, \"%s\\n\", msg); exit(EXIT_FAILURE); }\n";
+
+// Emulates "mex -c <source>" and "mex -output <name> <objects>"
+static const char *fake_mex =
+  "#!/bin/sh\n"
+  "dir=$(dirname \"$0\")\n"
+  "if [ \"$1\" = -c ]; then\n"
+  "  exec ${CC:-cc} -O2 -fPIC -I\"$dir\" -c \"$2\"\n"
+  "elif [ \"$1\" = -output ]; then\n"
+  "  output=$2\n"
+  "  shift 2\n"
+  "  exec ${CC:-cc} -shared -Wl,--no-undefined -o \"$output.so\" \"$@\" \"$dir/mex.o\" -lm\n"
+  "fi\n"
+  "exit 1\n";
+
+static void
+writeFile(const string &filename, const string &contents)
+{
+  ofstream f(filename, ios::binary);
+  f << contents;
+}
+
+//! Builds the MEX files of the model written in directory, and returns their outputs on some input
+static vector<vector<double>>
+buildAndRun(const string &directory, const string &mex_dir, int jobs)
+{
+  boost::filesystem::create_directories(directory + "/+model");
+  string src_dir = directory + "/model/model/src", mex = mex_dir + "/mex", command;
+  if (boost::filesystem::exists(src_dir + "/dynamic.mk"))
+    command = "MAKEFLAGS= make -s -C " + src_dir + " -f dynamic.mk -j" + to_string(jobs)
+      + " MEX=" + mex + " MEXOUTPUT=-output MEXEXT=so dynamic static";
+  else
+    // Same commands as dyn_mex
+    command = "cd " + src_dir + " && " + mex + " -c dynamic.c && " + mex + " -c dynamic_mex.c"
+      + " && " + mex + " -c static.c && " + mex + " -c static_mex.c"
+      + " && " + mex + " -output ../../../+model/dynamic dynamic.o dynamic_mex.o"
+      + " && " + mex + " -output ../../../+model/static static.o static_mex.o";
+  if (!runCommand(command))
+    exit(EXIT_FAILURE);
+
+  vector<vector<double>> results;
+  for (const char *name : { "dynamic", "static" })
+    {
+      string library = directory + "/+model/" + name + ".so";
+      void *handle = dlopen(library.c_str(), RTLD_NOW | RTLD_LOCAL);
+      if (!handle)
+        {
+          cerr << "Can't load " << library << ": " << dlerror() << endl;
+          exit(EXIT_FAILURE);
+        }
+      auto mex_function = reinterpret_cast<mex_function_t>(dlsym(handle, "mexFunction"));
+      if (!mex_function)
+        {
+          cerr << "No mexFunction in " << library << endl;
+          exit(EXIT_FAILURE);
+        }
+
+      // Inputs large enough for both models: y, x (3 rows), params, steady_state, it_
+      const int size = 1000;
+      vector<double> y(size), x(3 * size), params(size), steady_state(size), it{2};
+      for (int i = 0; i < size; i++)
+        {
+          y[i] = 0.1 + 0.01 * (i % 13);
+          steady_state[i] = 0.1;
+          params[i] = 0.3 + 0.4 * (i % 2);
+        }
+      for (int i = 0; i < 3 * size; i++)
+        x[i] = 0.01 * (i % 7);
+      mxArray inputs[5] = { { y.data(), static_cast<size_t>(size), 1 },
+                            { x.data(), 3, static_cast<size_t>(size) },
+                            { params.data(), static_cast<size_t>(size), 1 },
+                            { steady_state.data(), static_cast<size_t>(size), 1 },
+                            { it.data(), 1, 1 } };
+      const mxArray *prhs[5] = { &inputs[0], &inputs[1], &inputs[2], &inputs[3], &inputs[4] };
+      // The static MEX file takes y, x and params, and returns the residuals, g1 and g2
+      int nrhs = !strcmp(name, "dynamic") ? 5 : 3;
+      int nlhs = !strcmp(name, "dynamic") ? 4 : 3;
+      mxArray *plhs[4] = { nullptr, nullptr, nullptr, nullptr };
+      mex_function(nlhs, plhs, nrhs, prhs);
+      for (int i = 0; i < nlhs; i++)
+        results.emplace_back(plhs[i]->pr, plhs[i]->pr + plhs[i]->m * plhs[i]->n);
+      dlclose(handle);
+    }
+  return results;
+}
+
+int
+main()
+{
+  string mex_dir = boost::filesystem::absolute("sharded_dynamic_mex").string();
+  boost::filesystem::create_directories(mex_dir);
+  writeFile(mex_dir + "/mex.h", mex_h);
+  writeFile(mex_dir + "/mex.c", mex_c);
+  writeFile(mex_dir + "/mex", fake_mex);
+  chmod((mex_dir + "/mex").c_str(), 0755);
+  if (!runCommand(getEnvironment("CC", "cc") + " -O2 -fPIC -c " + mex_dir + "/mex.c -o " + mex_dir + "/mex.o"))
+    return EXIT_FAILURE;
+
+  /* The dynamic model is computed at order 3, but the static model at order 2,
+     since the C static model does not support third derivatives */
+  TestModel model(40);
+  model.order = 3;
+  model.dynamic_model.computingPass(true, true, true, 0, model.eval_context, false, false, true, false, true);
+  model.dynamic_model.toStatic(model.static_model);
+  model.static_model.computingPass(model.eval_context, false, true, false, 0, false, false, true);
+
+  model.writeCOutput("sharded_dynamic_1", 1);
+  auto reference = buildAndRun(boost::filesystem::absolute("sharded_dynamic_1").string(), mex_dir, 1);
+
+  bool ok = true;
+  for (int dll_shards : { 2, 4 })
+    {
+      string directory = boost::filesystem::absolute("sharded_dynamic_" + to_string(dll_shards)).string();
+      model.writeCOutput(directory, dll_shards);
+      int nfiles = 0;
+      for (int i = 1; i <= dll_shards; i++)
+        nfiles += boost::filesystem::exists(directory + "/model/model/src/dynamic_" + to_string(i) + ".c");
+      auto results = buildAndRun(directory, mex_dir, dll_shards);
+      bool same = nfiles > 1 && results.size() == reference.size();
+      for (size_t i = 0; same && i < results.size(); i++)
+        same = results[i].size() == reference[i].size()
+          && memcmp(results[i].data(), reference[i].data(), results[i].size() * sizeof(double)) == 0;
+      cout << "dll_shards=" << dll_shards << " (" << nfiles << " translation units): "
+           << (same ? "OK" : "FAILED") << endl;
+      ok = ok && same;
+    }
+
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
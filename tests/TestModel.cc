@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdlib>
+
+#include <boost/filesystem.hpp>
+
+#include "TestModel.hh"
+
+TestModel::TestModel(int n) :
+  trend_component_model_table(symbol_table),
+  var_model_table(symbol_table),
+  dynamic_model(symbol_table, num_constants, external_functions_table,
+                trend_component_model_table, var_model_table),
+  static_model(symbol_table, num_constants, external_functions_table,
+               trend_component_model_table, var_model_table)
+{
+  for (int i = 0; i < n; i++)
+    endos.push_back(symbol_table.addSymbol("x" + to_string(i), SymbolType::endogenous));
+  for (int i = 0; i < n / 5 + 1; i++)
+    exos.push_back(symbol_table.addSymbol("e" + to_string(i), SymbolType::exogenous));
+  p = symbol_table.addSymbol("p", SymbolType::parameter);
+  q = symbol_table.addSymbol("q", SymbolType::parameter);
+  int mlv = symbol_table.addSymbol("mlv", SymbolType::modelLocalVariable);
+
+  DynamicModel &m = dynamic_model;
+  m.AddLocalVariable(mlv, m.AddExp(m.AddTimes(m.AddVariable(p), m.AddVariable(endos[0]))));
+  for (int i = 0; i < n; i++)
+    {
+      int g = i / 4, r = i % 4;
+      expr_t t = m.AddVariable(endos[i]);
+      if (r > 0)
+        t = m.AddMinus(t, m.AddTimes(m.AddNonNegativeConstant("0.5"), m.AddExp(m.AddVariable(endos[i - 1]))));
+      if (r == 1 && i + 1 < n)
+        t = m.AddPlus(t, m.AddTimes(m.AddVariable(q), m.AddVariable(endos[i + 1])));
+      if (g > 0)
+        {
+          expr_t s1 = m.AddLog(m.AddPlus(m.Two, m.AddPower(m.AddVariable(endos[4 * g - 1], -1), m.Two)));
+          expr_t s2 = m.AddExp(m.AddTimes(m.AddVariable(p), m.AddVariable(endos[4 * g - 2])));
+          t = m.AddPlus(t, m.AddTimes(m.AddVariable(p), m.AddTimes(s1, s2)));
+          t = m.AddMinus(t, m.AddDivide(s2, m.AddPlus(m.AddNonNegativeConstant("3"), m.AddVariable(endos[4 * g - 3], 1))));
+          if (r == 0)
+            t = m.AddPlus(t, m.AddPower(m.AddPlus(m.AddNonNegativeConstant("1.5"), m.AddVariable(endos[4 * g - 4], 1)),
+                                        m.AddVariable(q)));
+        }
+      if (i % 7 == 0)
+        t = m.AddPlus(t, m.AddDivide(m.AddVariable(endos[i], -1),
+                                     m.AddPlus(m.AddNonNegativeConstant("3"), m.AddExp(m.AddVariable(endos[i], 1)))));
+      if (i % 5 == 0)
+        t = m.AddMinus(t, m.AddTimes(m.AddNonNegativeConstant("0.1"), m.AddVariable(mlv)));
+      t = m.AddMinus(t, m.AddVariable(exos[i % exos.size()]));
+      m.addEquation(m.AddEqual(t, m.Zero), i + 1);
+    }
+  symbol_table.freeze();
+
+  for (int i = 0; i < n; i++)
+    eval_context.set(endos[i], 0.1 + 0.01 * (i % 13));
+  for (int e : exos)
+    eval_context.set(e, 0);
+  eval_context.set(p, 0.3);
+  eval_context.set(q, 0.7);
+}
+
+void
+TestModel::computingPass(int order_arg, bool block, bool bytecode, bool no_tmp_terms)
+{
+  order = order_arg;
+  dynamic_model.computingPass(true, order >= 2, order >= 3, 0, eval_context, no_tmp_terms,
+                              block, !bytecode, bytecode, true);
+  dynamic_model.toStatic(static_model);
+  static_model.computingPass(eval_context, no_tmp_terms, order >= 2, order >= 3, 0, block, bytecode, true);
+}
+
+string
+TestModel::writeCOutput(const string &directory, int dll_shards) const
+{
+  // The basename appears in the output, so it is the same for all directories
+  boost::filesystem::create_directories(directory);
+  boost::filesystem::path cwd = boost::filesystem::current_path();
+  boost::filesystem::current_path(directory);
+  dynamic_model.writeDynamicFile("model", false, false, true, order, false, dll_shards);
+  static_model.writeStaticFile("model", false, false, true, false);
+  boost::filesystem::current_path(cwd);
+
+  ostringstream output;
+  output << readFile(directory + "/model/model/src/dynamic.c")
+         << readFile(directory + "/model/model/src/static.c");
+  dynamic_model.writeJsonComputingPassOutput(output, true);
+  static_model.writeJsonComputingPassOutput(output, true);
+  return output.str();
+}
+
+void
+TestModel::writeBytecode(const string &directory, bool block) const
+{
+  boost::filesystem::create_directories(directory);
+  boost::filesystem::path cwd = boost::filesystem::current_path();
+  boost::filesystem::current_path(directory);
+  dynamic_model.writeDynamicFile("model", block, true, false, order, false, 1);
+  static_model.writeStaticFile("model", block, true, false, false);
+  boost::filesystem::current_path(cwd);
+}
+
+string
+readFile(const string &filename)
+{
+  ifstream f(filename, ios::binary);
+  if (!f.is_open())
+    {
+      cerr << "ERROR: Can't open file " << filename << endl;
+      exit(EXIT_FAILURE);
+    }
+  ostringstream contents;
+  contents << f.rdbuf();
+  return contents.str();
+}
+
+bool
+runCommand(const string &command)
+{
+  if (system(command.c_str()) == 0)
+    return true;
+  cerr << "Command failed: " << command << endl;
+  return false;
+}
+
+string
+getEnvironment(const char *name, const string &default_value)
+{
+  const char *value = getenv(name);
+  return value ? value : default_value;
+}
+
+string
+bytecodeEvalPath()
+{
+  return getEnvironment("BYTECODE_EVAL", "../src/bytecode/dynare_bytecode_eval");
+}
@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2018 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _TEST_MODEL_HH
+#define _TEST_MODEL_HH
+
+using namespace std;
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+#include "SymbolTable.hh"
+#include "NumericalConstants.hh"
+#include "ExternalFunctionsTable.hh"
+#include "SubModel.hh"
+#include "DynamicModel.hh"
+#include "StaticModel.hh"
+
+//! Synthetic model used by the tests and the benchmarks
+/*! The model has n endogenous, n/5+1 exogenous, two parameters and a model
+  local variable. Its equations come by groups of four: each group depends on
+  the previous one (with lags and leads), and contains two simultaneous
+  equations, so that the block decomposition has both recursive and
+  simultaneous blocks. The equations use most of the usual operators, so
+  that the derivatives have shared subexpressions. */
+class TestModel
+{
+public:
+  SymbolTable symbol_table;
+  NumericalConstants num_constants;
+  ExternalFunctionsTable external_functions_table;
+  TrendComponentModelTable trend_component_model_table;
+  VarModelTable var_model_table;
+  DynamicModel dynamic_model;
+  StaticModel static_model;
+  //! Values of the symbols, close to the steady state
+  eval_context_t eval_context;
+  vector<int> endos, exos;
+  int p, q;
+  //! Order of the derivatives computed by computingPass()
+  int order{0};
+
+  explicit TestModel(int n);
+  //! Runs the computing pass of the dynamic model, and then of the static model
+  /*! The temporary terms are those of the C output, unless bytecode is true */
+  void computingPass(int order_arg, bool block, bool bytecode, bool no_tmp_terms);
+  //! Writes the C files of the model in the given directory
+  /*! The dynamic model is split into dll_shards translation units.
+    Returns the contents of dynamic.c and static.c, followed by the JSON output of the computing pass */
+  string writeCOutput(const string &directory, int dll_shards = 1) const;
+  //! Writes the bytecode files of the model in the given directory
+  /*! The models must have been computed with bytecode set to true */
+  void writeBytecode(const string &directory, bool block) const;
+};
+
+//! Returns the time elapsed since start, in seconds
+inline double
+elapsed(const chrono::steady_clock::time_point &start)
+{
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//! Returns the contents of the given file
+string readFile(const string &filename);
+
+//! Runs a shell command, and returns true if it succeeded (otherwise, prints the command)
+bool runCommand(const string &command);
+
+//! Returns the value of an environment variable, or default_value if it is not set
+/*! Used for the programs given by the test harness (e.g. $CC) */
+string getEnvironment(const char *name, const string &default_value);
+
+//! Returns the path of dynare_bytecode_eval, given by the BYTECODE_EVAL environment variable
+string bytecodeEvalPath();
+
+#endif